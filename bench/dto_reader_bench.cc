@@ -0,0 +1,87 @@
+// Parses a full manifest page the way the receiver does, comparing nlohmann::json with
+// DtoReader on a copied and on an in-place body.
+//
+//   dto_reader_bench [iterations]
+
+#include <chrono>
+#include <core/constant/transfer.h>
+#include <core/model.h>
+#include <core/util/dto_reader.h>
+#include <cstdio>
+#include <cstdlib>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace lansend::core;
+
+namespace {
+
+std::string MakeBody() {
+    RequestSendDto dto;
+    dto.device_info.device_id = "8c5e1f0a-6a43-4b8e-9d51-2f0c3b7e9a10";
+    dto.device_info.hostname = "workstation";
+    dto.device_info.operating_system = "linux";
+    dto.device_info.ip_address = "192.168.1.2";
+    dto.device_info.port = 56789;
+    dto.device_info.addresses = {{.ip_address = "192.168.1.2", .link_speed_mbps = 1000},
+                                 {.ip_address = "10.0.0.2", .link_speed_mbps = 2500}};
+    for (std::size_t i = 0; i < transfer::kManifestPageSize; ++i) {
+        FileDto file;
+        file.file_id = "file-" + std::to_string(i);
+        file.file_name = "photos/2024/IMG_" + std::to_string(10000 + i) + ".jpg";
+        file.file_size = 4 * 1024 * 1024 + i;
+        file.chunk_size = transfer::kDefaultChunkSize;
+        file.total_chunks = 5;
+        file.file_checksum = std::string(64, 'a' + i % 26);
+        dto.files.push_back(std::move(file));
+    }
+    dto.total_files = dto.files.size();
+    return nlohmann::json(dto).dump();
+}
+
+template<typename Parse>
+void Measure(const char* name, std::size_t body_size, int iterations, Parse&& parse) {
+    std::size_t files = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        files += parse();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double us_per_body = elapsed.count() * 1e6 / iterations;
+    double mb_per_s = static_cast<double>(body_size) * iterations / elapsed.count() / 1e6;
+    std::printf("%-22s %10.1f us/body %10.1f MB/s  (%zu files)\n",
+                name,
+                us_per_body,
+                mb_per_s,
+                files / iterations);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    std::string json = MakeBody();
+    // Laid out like a body HttpServer read, with the padding past its end
+    std::vector<std::uint8_t> body(json.begin(), json.end());
+    body.reserve(body.size() + transfer::kBodyPadding);
+    std::string_view view(reinterpret_cast<const char*>(body.data()), body.size());
+    std::printf("manifest page of %zu files, %zu bytes, %d iterations\n",
+                transfer::kManifestPageSize,
+                body.size(),
+                iterations);
+
+    Measure("nlohmann::json", body.size(), iterations, [&] {
+        RequestSendDto dto;
+        nlohmann::from_json(nlohmann::json::parse(view), dto);
+        return dto.files.size();
+    });
+    Measure("DtoReader (copied)", body.size(), iterations, [&] {
+        return DtoReader::ReadRequestSend(view).files.size();
+    });
+    Measure("DtoReader (in place)", body.size(), iterations, [&] {
+        return DtoReader::ReadRequestSend(view, body.capacity()).files.size();
+    });
+    return 0;
+}
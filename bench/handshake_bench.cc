@@ -0,0 +1,123 @@
+// Full TLS handshakes over loopback with a fresh identity of each certificate key type, through
+// the contexts HttpServer and HttpsClient use. Generating the identity is timed as well.
+//
+//   handshake_bench [handshakes per key type]
+
+#include <algorithm>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <chrono>
+#include <core/model/security_context.h>
+#include <core/security/certificate_manager.h>
+#include <core/security/open_ssl_provider.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+#include <thread>
+
+using namespace lansend::core;
+namespace net = boost::asio;
+namespace ssl = net::ssl;
+namespace fs = std::filesystem;
+using tcp = net::ip::tcp;
+
+namespace {
+
+struct Result {
+    double generation_ms = 0;
+    double handshake_us = 0; // Mean over the handshakes, as the client sees it
+    int failed = 0;
+};
+
+Result Run(KeyType key_type, int handshakes, const fs::path& root) {
+    Result result;
+    fs::path dir = root / std::string(KeyTypeToString(key_type));
+    fs::remove_all(dir);
+
+    auto started = std::chrono::steady_clock::now();
+    CertificateManager receiver_certs(dir / "receiver", key_type);
+    std::chrono::duration<double, std::milli> generation = std::chrono::steady_clock::now()
+                                                           - started;
+    result.generation_ms = generation.count();
+
+    CertificateManager sender_certs(dir / "sender", key_type);
+    sender_certs.SetUnregisteredAllowed(true);
+
+    const auto& identity = receiver_certs.security_context();
+    auto server_ctx = OpenSSLProvider::BuildServerContext(identity.certificate_pem,
+                                                          identity.private_key_pem);
+    net::io_context ioc;
+    tcp::acceptor acceptor(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+    auto endpoint = acceptor.local_endpoint();
+
+    std::thread server([&]() {
+        for (int i = 0; i < handshakes; ++i) {
+            try {
+                ssl::stream<tcp::socket> stream(acceptor.accept(), server_ctx);
+                stream.handshake(ssl::stream_base::server);
+            } catch (const boost::system::system_error&) {
+                // Counted by the client
+            }
+        }
+    });
+
+    // A fresh context per handshake, nothing is resumed
+    std::chrono::steady_clock::duration total{};
+    for (int i = 0; i < handshakes; ++i) {
+        auto client_ctx = OpenSSLProvider::BuildClientContext(
+            [&](bool preverified, ssl::verify_context& ctx) {
+                return sender_certs.VerifyCertificate(preverified,
+                                                      ctx,
+                                                      endpoint.address().to_string(),
+                                                      endpoint.port());
+            });
+        ssl::stream<tcp::socket> stream(ioc, client_ctx);
+        try {
+            auto handshake_started = std::chrono::steady_clock::now();
+            stream.next_layer().connect(endpoint);
+            stream.handshake(ssl::stream_base::client);
+            total += std::chrono::steady_clock::now() - handshake_started;
+        } catch (const boost::system::system_error&) {
+            ++result.failed;
+        }
+    }
+    server.join();
+
+    int succeeded = handshakes - result.failed;
+    if (succeeded > 0) {
+        result.handshake_us = std::chrono::duration<double, std::micro>(total).count()
+                              / succeeded;
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int handshakes = argc > 1 ? std::max(1, std::atoi(argv[1])) : 500;
+    spdlog::set_level(spdlog::level::err);
+    OpenSSLProvider::InitOpenSSL();
+
+    fs::path root = fs::temp_directory_path() / "lansend-handshake-bench";
+    std::printf("%d full handshakes per key type over loopback\n", handshakes);
+    std::printf("%12s %14s %14s %14s %8s\n",
+                "key type",
+                "keygen ms",
+                "handshake us",
+                "handshakes/s",
+                "failed");
+    for (auto key_type : {KeyType::kEcdsaP256, KeyType::kEd25519, KeyType::kRsa2048}) {
+        auto result = Run(key_type, handshakes, root);
+        std::printf("%12s %14.1f %14.1f %14.0f %8d\n",
+                    KeyTypeToString(key_type).data(),
+                    result.generation_ms,
+                    result.handshake_us,
+                    result.handshake_us > 0 ? 1e6 / result.handshake_us : 0.0,
+                    result.failed);
+    }
+    fs::remove_all(root);
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <core/constant/transfer.h>
+#include <core/network/client/chunk_scheduler.h>
+
+namespace lansend::core {
+
+ChunkScheduler::ChunkScheduler(std::size_t path_count) : paths_(path_count) {}
+
+void ChunkScheduler::StartFile(std::size_t total_chunks) {
+    pending_.clear();
+    for (std::size_t chunk = 0; chunk < total_chunks; ++chunk) {
+        pending_.push_back(chunk);
+    }
+    attempts_.clear();
+    in_flight_ = 0;
+    completed_ = 0;
+    failed_ = false;
+}
+
+std::optional<std::size_t> ChunkScheduler::Take(std::size_t path_index, std::size_t credits) {
+    // Chunks in flight on other paths may still come back. The receiver's credits cap the
+    // chunks in flight over all paths, so it is never sent more than its disk takes.
+    if (failed_ || paths_.at(path_index).failed || pending_.empty() || in_flight_ >= credits
+        || !shouldTakeChunk(path_index)) {
+        return std::nullopt;
+    }
+    auto chunk = pending_.front();
+    pending_.pop_front();
+    ++in_flight_;
+    return chunk;
+}
+
+void ChunkScheduler::ChunkSent(std::size_t path_index,
+                               std::size_t bytes,
+                               std::size_t streams,
+                               std::chrono::duration<double> elapsed) {
+    auto& path = paths_.at(path_index);
+    // The path's other streams were sending meanwhile
+    double rate = static_cast<double>(bytes * streams) / std::max(elapsed.count(), 1e-6);
+    path.throughput = path.throughput == 0 ? rate
+                                           : (1 - kSmoothing) * path.throughput
+                                                 + kSmoothing * rate;
+    ++path.chunks_sent;
+    --in_flight_;
+    ++completed_;
+}
+
+void ChunkScheduler::ChunkFailed(std::size_t path_index, std::size_t chunk) {
+    paths_.at(path_index).failed = true;
+    --in_flight_;
+    pending_.push_front(chunk);
+    if (++attempts_[chunk] >= transfer::kMaxChunkAttempts) {
+        failed_ = true;
+    }
+}
+
+void ChunkScheduler::Abandon(std::optional<std::size_t> chunk) {
+    if (chunk) {
+        --in_flight_;
+    }
+    failed_ = true;
+}
+
+bool ChunkScheduler::shouldTakeChunk(std::size_t path_index) const {
+    // Take it unless the other paths would send all pending chunks before this one sent a
+    // single chunk. The fastest path always takes one, so the transfer never stalls.
+    const auto& path = paths_[path_index];
+    double others = 0;
+    double fastest = 0;
+    for (std::size_t i = 0; i < paths_.size(); ++i) {
+        if (i != path_index && !paths_[i].failed) {
+            others += paths_[i].throughput;
+            fastest = std::max(fastest, paths_[i].throughput);
+        }
+    }
+    if (path.throughput == 0 || others == 0 || path.throughput >= fastest) {
+        return true;
+    }
+    return others <= static_cast<double>(pending_.size()) * path.throughput;
+}
+
+} // namespace lansend::core
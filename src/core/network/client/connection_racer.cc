@@ -0,0 +1,129 @@
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <core/network/client/connection_racer.h>
+#include <memory>
+#include <spdlog/spdlog.h>
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace lansend::core {
+
+using Strand = net::strand<net::io_context::executor_type>;
+
+// Shared by the attempts, only touched on the race's strand
+struct RaceState {
+    explicit RaceState(const Strand& strand)
+        : next_attempt(strand)
+        , done(strand) {}
+
+    net::steady_timer next_attempt; // Cancelled by a failed attempt to start the next one early
+    net::steady_timer done;         // Cancelled once there is a winner or every attempt failed
+    std::vector<std::unique_ptr<tcp::socket>> sockets;
+    std::optional<std::size_t> winner;
+    std::size_t attempts = 0;
+    std::size_t failed = 0;
+    bool finished = false;
+};
+
+static net::awaitable<void> Attempt(std::shared_ptr<RaceState> state,
+                                    std::size_t index,
+                                    std::string address,
+                                    unsigned short port) {
+    boost::system::error_code ec;
+    auto ip = net::ip::make_address(address, ec);
+    if (!ec) {
+        co_await state->sockets[index]->async_connect(tcp::endpoint(ip, port),
+                                                      net::redirect_error(net::use_awaitable,
+                                                                          ec));
+    }
+    if (state->finished) {
+        co_return;
+    }
+    if (!ec) {
+        state->winner = index;
+        state->finished = true;
+        state->done.cancel();
+        co_return;
+    }
+    spdlog::debug("Connection attempt to {}:{} failed: {}", address, port, ec.message());
+    if (++state->failed == state->attempts) {
+        state->finished = true;
+        state->done.cancel();
+    } else {
+        state->next_attempt.cancel();
+    }
+}
+
+static net::awaitable<void> LaunchAttempts(std::shared_ptr<RaceState> state,
+                                           net::io_context& ioc,
+                                           Strand strand,
+                                           std::vector<std::string> addresses,
+                                           unsigned short port,
+                                           std::chrono::milliseconds attempt_delay) {
+    for (std::size_t i = 0; i < addresses.size() && !state->finished; ++i) {
+        state->sockets.push_back(std::make_unique<tcp::socket>(ioc));
+        net::co_spawn(strand, Attempt(state, i, addresses[i], port), net::detached);
+        if (i + 1 < addresses.size()) {
+            state->next_attempt.expires_after(attempt_delay);
+            boost::system::error_code ec;
+            co_await state->next_attempt.async_wait(net::redirect_error(net::use_awaitable, ec));
+        }
+    }
+}
+
+static net::awaitable<std::optional<RacedConnection>> Race(
+    net::io_context& ioc,
+    Strand strand,
+    std::vector<std::string> addresses,
+    unsigned short port,
+    std::chrono::milliseconds attempt_delay,
+    std::chrono::milliseconds timeout) {
+    auto state = std::make_shared<RaceState>(strand);
+    state->attempts = addresses.size();
+    state->done.expires_after(timeout);
+    net::co_spawn(strand,
+                  LaunchAttempts(state, ioc, strand, addresses, port, attempt_delay),
+                  net::detached);
+
+    boost::system::error_code ec;
+    co_await state->done.async_wait(net::redirect_error(net::use_awaitable, ec));
+    state->finished = true;
+    state->next_attempt.cancel();
+
+    std::optional<RacedConnection> connection;
+    if (state->winner) {
+        connection.emplace(RacedConnection{
+            .address = addresses[*state->winner],
+            .socket = std::move(*state->sockets[*state->winner]),
+        });
+    }
+    // The losers still connecting
+    for (const auto& socket : state->sockets) {
+        if (socket->is_open()) {
+            socket->close(ec);
+        }
+    }
+    co_return connection;
+}
+
+net::awaitable<std::optional<RacedConnection>> RaceConnect(net::io_context& ioc,
+                                                           std::vector<std::string> addresses,
+                                                           unsigned short port,
+                                                           std::chrono::milliseconds attempt_delay,
+                                                           std::chrono::milliseconds timeout) {
+    if (addresses.empty()) {
+        co_return std::nullopt;
+    }
+    auto strand = net::make_strand(ioc);
+    co_return co_await net::co_spawn(
+        strand,
+        Race(ioc, strand, std::move(addresses), port, attempt_delay, timeout),
+        net::use_awaitable);
+}
+
+} // namespace lansend::core
@@ -1,3 +1,7 @@
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <core/constant/mux.h>
 #include <core/network/client/http_client.h>
 #include <core/security/open_ssl_provider.h>
 #include <spdlog/spdlog.h>
@@ -9,10 +13,17 @@ HttpsClient::HttpsClient(net::io_context& ioc, CertificateManager& cert_manager)
     , cert_manager_(cert_manager)
     , ssl_ctx_(OpenSSLProvider::BuildClientContext([this](bool preverified,
                                                           ssl::verify_context& ctx) -> bool {
-        return cert_manager_.VerifyCertificate(preverified, ctx, current_host_, current_port_);
+        return cert_manager_.VerifyCertificate(preverified,
+                                               ctx,
+                                               current_host_,
+                                               current_port_,
+                                               accept_replacement_);
     })) {}
 
 HttpsClient::~HttpsClient() {
+    if (mux_) {
+        mux_->Close();
+    }
     if (ssl_session_) {
         SSL_SESSION_free(ssl_session_);
         ssl_session_ = nullptr;
@@ -20,6 +31,18 @@ HttpsClient::~HttpsClient() {
 }
 
 net::awaitable<bool> HttpsClient::Connect(std::string_view host, unsigned short port) {
+    co_return co_await connect(tcp::socket(ioc_), host, port);
+}
+
+net::awaitable<bool> HttpsClient::Connect(tcp::socket socket,
+                                          std::string_view host,
+                                          unsigned short port) {
+    co_return co_await connect(std::move(socket), host, port);
+}
+
+net::awaitable<bool> HttpsClient::connect(tcp::socket socket,
+                                          std::string_view host,
+                                          unsigned short port) {
     try {
         if (connection_) {
             co_await Disconnect();
@@ -29,19 +52,23 @@ net::awaitable<bool> HttpsClient::Connect(std::string_view host, unsigned short
         current_host_ = host;
         current_port_ = port;
 
-        connection_ = std::make_unique<beast::ssl_stream<beast::tcp_stream>>(beast::tcp_stream(ioc_),
-                                                                             ssl_ctx_);
+        bool connected = socket.is_open();
+        connection_ = std::make_shared<beast::ssl_stream<beast::tcp_stream>>(
+            beast::tcp_stream(std::move(socket)),
+            ssl_ctx_);
 
         if (!OpenSSLProvider::SetHostname(connection_->native_handle(), host)) {
             throw std::runtime_error("Failed to set SNI Hostname");
         }
 
-        tcp::resolver resolver(ioc_);
-        auto results = co_await resolver.async_resolve(host, std::to_string(port));
+        if (!connected) {
+            tcp::resolver resolver(ioc_);
+            auto results = co_await resolver.async_resolve(host, std::to_string(port));
 
-        beast::get_lowest_layer(*connection_).expires_after(std::chrono::seconds(30));
-        co_await beast::get_lowest_layer(*connection_).async_connect(results);
-        beast::get_lowest_layer(*connection_).expires_never();
+            beast::get_lowest_layer(*connection_).expires_after(std::chrono::seconds(30));
+            co_await beast::get_lowest_layer(*connection_).async_connect(results);
+            beast::get_lowest_layer(*connection_).expires_never();
+        }
 
         co_await connection_->async_handshake(ssl::stream_base::client);
 
@@ -68,6 +95,12 @@ net::awaitable<bool> HttpsClient::Disconnect() {
     }
 
     try {
+        if (mux_) {
+            mux_->Close();
+            co_await mux_->WaitStopped();
+            mux_.reset();
+        }
+
         beast::error_code ec;
         connection_->shutdown(ec);
 
@@ -83,6 +116,7 @@ net::awaitable<bool> HttpsClient::Disconnect() {
         co_return true;
     } catch (const std::exception& e) {
         spdlog::error("Disconnect error: {}", e.what());
+        mux_.reset();
         connection_.reset();
         current_host_.clear();
         current_port_ = 0;
@@ -91,6 +125,51 @@ net::awaitable<bool> HttpsClient::Disconnect() {
     }
 }
 
+net::awaitable<bool> HttpsClient::UpgradeToMux() {
+    if (!connection_ || mux_) {
+        co_return IsMultiplexed();
+    }
+
+    try {
+        auto req = CreateRequest<http::empty_body>(http::verb::get, std::string(ApiRoute::kMux));
+        req.set(http::field::connection, "Upgrade");
+        req.set(http::field::upgrade, mux::kProtocol);
+        co_await http::async_write(*connection_, req);
+
+        beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        co_await http::async_read(*connection_, buffer, res);
+        if (res.result() != http::status::switching_protocols) {
+            // Older receivers answer 404 and keep serving HTTP/1.1 on the connection
+            spdlog::debug("{} does not support the multiplexed protocol", current_host_);
+            co_return false;
+        }
+
+        auto leftover = buffer.data();
+        mux_ = std::make_shared<MuxConnection>(
+            *connection_,
+            true,
+            std::span<const std::uint8_t>(static_cast<const std::uint8_t*>(leftover.data()),
+                                          leftover.size()),
+            connection_);
+        net::co_spawn(
+            co_await net::this_coro::executor,
+            [mux = mux_]() -> net::awaitable<void> {
+                try {
+                    co_await mux->Run();
+                } catch (const std::exception& e) {
+                    spdlog::debug("Multiplexed connection closed: {}", e.what());
+                }
+            },
+            net::detached);
+        spdlog::debug("Connection to {} switched to the multiplexed protocol", current_host_);
+        co_return true;
+    } catch (const std::exception& e) {
+        spdlog::warn("Failed to switch to the multiplexed protocol: {}", e.what());
+        co_return false;
+    }
+}
+
 bool HttpsClient::IsConnected() const {
     return connection_ != nullptr;
 }
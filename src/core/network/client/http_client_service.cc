@@ -5,6 +5,7 @@
 #include <boost/asio.hpp>
 #include <boost/beast/http/string_body_fwd.hpp>
 #include <core/network/client/http_client_service.h>
+#include <algorithm>
 #include <iostream>
 #include <nlohmann/json.hpp>
 
@@ -30,8 +31,8 @@ void HttpClientService::SetFeedbackCallback(FeedbackCallback callback) {
 void HttpClientService::Ping(std::string_view host, unsigned short port) {
     auto client_ptr = std::make_shared<HttpsClient>(ioc_, cert_manager_);
     net::co_spawn(
-        ioc_,
-        [&]() -> net::awaitable<void> {
+        net::make_strand(ioc_),
+        [client_ptr, host = std::string(host), port]() -> net::awaitable<void> {
             try {
                 co_await client_ptr->Connect(host, port);
                 if (client_ptr->IsConnected()) {
@@ -63,9 +64,15 @@ void HttpClientService::ConnectDevice(std::string_view pin_code,
                                       unsigned short port,
                                       std::string_view device_id) {
     auto client_ptr = std::make_shared<HttpsClient>(ioc_, cert_manager_);
+    // Captured by value, the coroutine runs after the caller has returned
     net::co_spawn(
-        ioc_,
-        [&]() -> net::awaitable<void> {
+        net::make_strand(ioc_),
+        [this,
+         client_ptr,
+         pin_code = std::string(pin_code),
+         ip = std::string(ip),
+         port,
+         device_id = std::string(device_id)]() -> net::awaitable<void> {
             try {
                 co_await client_ptr->Connect(ip, port);
                 if (client_ptr->IsConnected()) {
@@ -122,7 +129,38 @@ void HttpClientService::SendFiles(std::string_view ip_address,
                                   unsigned short port,
                                   const std::vector<std::filesystem::path>& file_paths,
                                   std::string_view device_id) {
-    send_session_manager_.SendFiles(ip_address, port, file_paths, device_id);
+    send_session_manager_.SendFiles({std::string(ip_address)}, port, file_paths, device_id);
+}
+
+// The faster links first. Among equally fast ones the address the device was seen at goes
+// first, that one is known to be reachable from here.
+static std::vector<std::string> CandidateAddresses(const DeviceInfo& device) {
+    std::vector<DeviceAddress> addresses = device.addresses;
+    if (std::ranges::find(addresses, device.ip_address, &DeviceAddress::ip_address)
+        == addresses.end()) {
+        addresses.insert(addresses.begin(), DeviceAddress{.ip_address = device.ip_address});
+    }
+    std::ranges::stable_sort(addresses, [&](const DeviceAddress& lhs, const DeviceAddress& rhs) {
+        if (lhs.link_speed_mbps != rhs.link_speed_mbps) {
+            return lhs.link_speed_mbps > rhs.link_speed_mbps;
+        }
+        return lhs.ip_address == device.ip_address && rhs.ip_address != device.ip_address;
+    });
+
+    std::vector<std::string> candidates;
+    candidates.reserve(addresses.size());
+    for (auto& address : addresses) {
+        candidates.push_back(std::move(address.ip_address));
+    }
+    return candidates;
+}
+
+void HttpClientService::SendFiles(const DeviceInfo& device,
+                                  const std::vector<std::filesystem::path>& file_paths) {
+    send_session_manager_.SendFiles(CandidateAddresses(device),
+                                    device.port,
+                                    file_paths,
+                                    device.device_id);
 }
 
 void HttpClientService::CancelSend(const std::string& session_id) {
@@ -1,14 +1,24 @@
 #include "core/model/feedback.h"
 #include "core/model/feedback/send_session_end.h"
+#include <boost/asio/experimental/awaitable_operators.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <charconv>
+#include <core/constant/mux.h>
 #include <core/constant/route.h>
 #include <core/constant/transfer.h>
 #include <core/model.h>
+#include <core/network/client/connection_racer.h>
 #include <core/network/client/send_session.h>
+#include <core/security/file_encryptor.h>
 #include <core/util/binary_message.h>
+#include <core/util/compute_pool.h>
+#include <core/util/config.h>
+#include <core/util/memory_governor.h>
+#include <core/util/system.h>
 #include <fstream>
+#include <limits>
 #include <spdlog/spdlog.h>
 
 namespace net = boost::asio;
@@ -16,6 +26,8 @@ namespace beast = boost::beast;
 namespace http = beast::http;
 namespace fs = std::filesystem;
 using json = nlohmann::json;
+using tcp = net::ip::tcp;
+using namespace boost::asio::experimental::awaitable_operators;
 
 namespace lansend::core {
 
@@ -23,13 +35,18 @@ SendSession::SendSession(boost::asio::io_context& ioc,
                          CertificateManager& cert_manager,
                          FeedbackCallback callback)
     : ioc_(ioc)
+    , strand_(net::make_strand(ioc))
     , client_(ioc, cert_manager)
     , cert_manager_(cert_manager)
-    , callback_(callback) {}
+    , progress_(settings.progress_rate_hz)
+    , callback_(callback)
+    , cancel_notified_(strand_, net::steady_timer::time_point::max()) {}
 
 void SendSession::Cancel() {
     spdlog::info("Try to cancel send session: {}", session_id_);
-    net::co_spawn(ioc_, cancelSend(), net::detached);
+    net::post(strand_, [this, requested_at = std::chrono::steady_clock::now()]() {
+        abort(requested_at);
+    });
 }
 
 bool SendSession::IsCancelled() const {
@@ -37,19 +54,72 @@ bool SendSession::IsCancelled() const {
            || session_status_ == SessionStatus::kCancelledByReceiver;
 }
 
+void SendSession::abort(std::chrono::steady_clock::time_point requested_at) {
+    if (session_status_ != SessionStatus::kSending) {
+        spdlog::debug("Send session {} is not sending, nothing to cancel", session_id_);
+        return;
+    }
+    session_status_ = SessionStatus::kCancelledBySender;
+    cancel_requested_at_ = requested_at;
+
+    // The receiver is told in parallel, Start() keeps the connections open until it knows
+    cancel_notifying_ = true;
+    net::co_spawn(strand_, notifyCancel(requested_at), net::detached);
+
+    // Chunks stop mid-way instead of being sent to the end. A multiplexed connection cancels
+    // their streams, an HTTP/1.1 connection is left unusable and closed with the session.
+    spdlog::info("Aborting {} request(s) in flight of send session {}",
+                 request_signals_.size(),
+                 session_id_);
+    for (auto& signal : request_signals_) {
+        signal.emit(net::cancellation_type::terminal);
+    }
+}
+
+net::awaitable<void> SendSession::notifyCancel(std::chrono::steady_clock::time_point requested_at) {
+    net::steady_timer timeout(strand_, transfer::kCancelNotifyTimeout);
+    auto result = co_await (cancelSend() || timeout.async_wait(net::use_awaitable));
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - requested_at);
+    if (result.index() == 0 && std::get<0>(result)) {
+        spdlog::info("Receiver acknowledged the cancellation of session {} after {} ms",
+                     session_id_,
+                     elapsed.count());
+    } else {
+        spdlog::warn("Receiver did not acknowledge the cancellation of session {} within {} ms",
+                     session_id_,
+                     elapsed.count());
+    }
+    cancel_notifying_ = false;
+    cancel_notified_.cancel();
+}
+
 boost::asio::awaitable<bool> SendSession::cancelSend() {
     spdlog::debug("SendSession::CancelSend");
+    // A multiplexed connection takes it on a stream of its own, ahead of any queued data. An
+    // HTTP/1.1 connection may be in the middle of a chunk, the cancel gets a connection then.
+    HttpsClient control(ioc_, cert_manager_);
+    HttpsClient* client = &client_;
     try {
+        if (!client_.IsMultiplexed()) {
+            if (!co_await control.Connect(client_.current_host(), client_.current_port())) {
+                co_return false;
+            }
+            client = &control;
+        }
+
         json data;
         data["session_id"] = session_id_;
 
-        auto req = client_.CreateRequest<http::string_body>(http::verb::post,
+        auto req = client->CreateRequest<http::string_body>(http::verb::post,
                                                             ApiRoute::kCancelSend.data(),
                                                             false);
         req.body() = data.dump();
         req.prepare_payload();
 
-        auto res = co_await client_.SendRequest(req);
+        auto res = co_await client->SendRequest(req);
+        co_await control.Disconnect();
 
         if (res.result() != http::status::ok) {
             spdlog::error("Failed to cancel send: {}:{}",
@@ -57,8 +127,6 @@ boost::asio::awaitable<bool> SendSession::cancelSend() {
                           res.body());
             co_return false;
         }
-
-        session_status_ = SessionStatus::kCancelledBySender;
         co_return true;
     } catch (const std::exception& e) {
         spdlog::error("Error cancelling file transfer: {}", e.what());
@@ -66,7 +134,36 @@ boost::asio::awaitable<bool> SendSession::cancelSend() {
     }
 }
 
-std::vector<FileDto> SendSession::prepareFiles(const std::vector<std::filesystem::path>& file_paths) {
+template<typename RequestBody>
+net::awaitable<http::response<http::string_body>> SendSession::sendAbortable(
+    HttpsClient& client, http::request<RequestBody>& req) {
+    auto signal = request_signals_.emplace(request_signals_.end());
+    try {
+        auto res = co_await net::co_spawn(strand_,
+                                          client.SendRequest(req),
+                                          net::bind_cancellation_slot(signal->slot(),
+                                                                      net::use_awaitable));
+        requestSettled(signal);
+        co_return res;
+    } catch (...) {
+        requestSettled(signal);
+        throw;
+    }
+}
+
+void SendSession::requestSettled(std::list<net::cancellation_signal>::iterator signal) {
+    request_signals_.erase(signal);
+    if (cancel_requested_at_ && request_signals_.empty()) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - *cancel_requested_at_);
+        spdlog::info("Requests of send session {} stopped {} ms after the cancel",
+                     session_id_,
+                     elapsed.count());
+    }
+}
+
+net::awaitable<std::vector<FileDto>> SendSession::prepareFiles(
+    const std::vector<std::filesystem::path>& file_paths) {
     std::vector<FileDto> prepared_files;
     for (const auto& file_path : file_paths) {
         if (fs::exists(file_path)) {
@@ -79,7 +176,9 @@ std::vector<FileDto> SendSession::prepareFiles(const std::vector<std::filesystem
             file_dto.chunk_size = transfer::kDefaultChunkSize;
             file_dto.total_chunks = (file_dto.file_size + file_dto.chunk_size - 1)
                                     / file_dto.chunk_size;
-            file_dto.file_checksum = FileHasher::CalculateFileChecksum(file_path);
+            file_dto.file_checksum = co_await ComputePool::Run("file-checksum", [&file_path]() {
+                return FileHasher::CalculateFileChecksum(file_path);
+            });
             file_dto.file_type = GetFileType(file_path.string());
             spdlog::debug(
                 "FileDto: file_id={}, file_name={}, file_size={}, chunk_size={}, total_chunks={}, "
@@ -101,21 +200,33 @@ std::vector<FileDto> SendSession::prepareFiles(const std::vector<std::filesystem
             spdlog::error("File not found: {}", file_path.string());
         }
     }
-    return prepared_files;
+    co_return prepared_files;
 }
 
-boost::asio::awaitable<void> SendSession::Start(const std::vector<std::filesystem::path>& file_paths,
-                                                std::string_view host,
+boost::asio::awaitable<void> SendSession::Start(std::vector<std::filesystem::path> file_paths,
+                                                std::vector<std::string> hosts,
                                                 unsigned int port,
                                                 SessionStartedCallback callback) {
+    co_await run(std::move(file_paths), std::move(hosts), port, std::move(callback));
+    // The receiver hears of a cancellation before the session and its connections go away
+    while (cancel_notifying_) {
+        boost::system::error_code ec;
+        co_await cancel_notified_.async_wait(net::redirect_error(net::use_awaitable, ec));
+    }
+}
+
+boost::asio::awaitable<void> SendSession::run(std::vector<std::filesystem::path> file_paths,
+                                              std::vector<std::string> hosts,
+                                              unsigned int port,
+                                              SessionStartedCallback callback) {
     spdlog::debug("SendSession::Start");
-    auto prepared_files = prepareFiles(file_paths);
+    auto prepared_files = co_await prepareFiles(file_paths);
     if (prepared_files.empty()) {
         spdlog::error("No files to send");
         co_return;
     }
 
-    if (host.empty() || port == 0) {
+    if (hosts.empty() || hosts.front().empty() || port == 0) {
         spdlog::error("Invalid host or port");
         co_return;
     }
@@ -123,8 +234,18 @@ boost::asio::awaitable<void> SendSession::Start(const std::vector<std::filesyste
         RequestSendDto send_request_dto;
         send_request_dto.device_info = DeviceInfo::LocalDeviceInfo();
         send_request_dto.files = std::move(prepared_files);
-
-        bool connected = co_await client_.Connect(host, port);
+        send_request_dto.udp_transport = settings.udp_transport;
+
+        std::string host = hosts.front();
+        bool connected = false;
+        if (hosts.size() == 1) {
+            connected = co_await client_.Connect(host, port);
+        } else if (auto connection = co_await RaceConnect(ioc_, hosts, port);
+                   connection) {
+            host = std::move(connection->address);
+            spdlog::info("Sending over {}", host);
+            connected = co_await client_.Connect(std::move(connection->socket), host, port);
+        }
         if (!connected) {
             spdlog::error("Failed to connect to server");
 
@@ -135,6 +256,9 @@ boost::asio::awaitable<void> SendSession::Start(const std::vector<std::filesyste
             co_return;
         }
 
+        if (settings.mux_transport) {
+            co_await client_.UpgradeToMux();
+        }
         session_status_ = SessionStatus::kWaiting;
 
         // Local endpoint information for this specific connection
@@ -150,7 +274,13 @@ boost::asio::awaitable<void> SendSession::Start(const std::vector<std::filesyste
                     spdlog::info("send request was cancelled");
                     co_return;
                 } else if (session_status_ == SessionStatus::kWaiting) {
-                    // Receiver is busy, wait for a while and retry
+                    if (!queue_ticket_.empty()) {
+                        // The receiver long-polls queued requests, retry right away with
+                        // the ticket to keep our place
+                        spdlog::info("Receiver is busy, waiting in its queue...");
+                        continue;
+                    }
+                    // Receiver does not queue senders, wait for a while and retry
                     spdlog::info("Receiver is busy, retrying in 1 second...");
                     auto timer = net::steady_timer(co_await net::this_coro::executor,
                                                    std::chrono::seconds(1));
@@ -175,6 +305,9 @@ boost::asio::awaitable<void> SendSession::Start(const std::vector<std::filesyste
         } while (session_status_ == SessionStatus::kWaiting);
 
         spdlog::info("send request to {}:{} was accepted", host, port);
+        if (callback) {
+            callback();
+        }
 
         // feedback receiver accepted
         feedback(Feedback{
@@ -198,7 +331,9 @@ boost::asio::awaitable<void> SendSession::Start(const std::vector<std::filesyste
         for (const auto& [file_id, file_size] : files_by_size) {
             spdlog::info("File ID: {}, Size: {}", file_id, file_size);
         }
-        spdlog::info("Start sending files");
+        co_await openPaths(hosts, port);
+        scheduler_ = ChunkScheduler(paths_.size());
+        spdlog::info("Start sending files over {} path(s)", paths_.size());
 
         // Start sending files one by one in order of increasing size
         for (const auto& [file_id, _] : files_by_size) {
@@ -206,13 +341,16 @@ boost::asio::awaitable<void> SendSession::Start(const std::vector<std::filesyste
             if (session_status_ == SessionStatus::kCancelledBySender
                 || session_status_ == SessionStatus::kCancelledByReceiver) {
                 spdlog::info("File transfer cancelled");
+                co_await closePaths();
                 co_return;
             }
             if (session_status_ == SessionStatus::kFailed) {
                 spdlog::info("Send session {} failed", session_id_);
+                co_await closePaths();
                 co_return;
             }
         }
+        co_await closePaths();
         spdlog::info("All files sent successfully, closing session: {}", session_id_);
         session_status_ = SessionStatus::kCompleted;
 
@@ -236,16 +374,37 @@ boost::asio::awaitable<void> SendSession::Start(const std::vector<std::filesyste
 net::awaitable<bool> SendSession::requestSend(const RequestSendDto& send_request_dto) {
     spdlog::debug("SendSession::SendRequest");
     try {
-        json data = send_request_dto;
+        // The manifest does not change between retries, serialize it once
+        if (request_send_body_.empty()) {
+            if (send_request_dto.files.size() > transfer::kManifestPageSize) {
+                // Large manifests are paged, the first page rides on the request itself
+                RequestSendDto first_page{
+                    .device_info = send_request_dto.device_info,
+                    .files = {send_request_dto.files.begin(),
+                              send_request_dto.files.begin() + transfer::kManifestPageSize},
+                    .total_files = send_request_dto.files.size(),
+                    .udp_transport = send_request_dto.udp_transport,
+                };
+                request_send_body_ = json(first_page).dump();
+            } else {
+                request_send_body_ = json(send_request_dto).dump();
+            }
+        }
         auto req = client_.CreateRequest<http::string_body>(http::verb::post,
                                                             ApiRoute::kRequestSend.data(),
                                                             true);
+        if (!queue_ticket_.empty()) {
+            req.set(ApiHeader::kQueueTicket, queue_ticket_);
+        }
 
-        req.body() = data.dump();
+        req.body() = request_send_body_;
         req.prepare_payload();
 
-        spdlog::debug("Sending SendRequestDto: {}", req.body());
+        spdlog::debug("Sending SendRequestDto of {} bytes", req.body().size());
         auto res = co_await client_.SendRequest(req);
+        if (res.result() == http::status::ok) {
+            res = co_await sendManifestPages(send_request_dto, std::move(res));
+        }
 
         if (session_status_ == SessionStatus::kCancelledBySender) {
             spdlog::debug("Sender cancelled waiting for user confirmation");
@@ -256,8 +415,14 @@ net::awaitable<bool> SendSession::requestSend(const RequestSendDto& send_request
             if (res.result() == http::status::forbidden) {
                 spdlog::info("Send request is forbidden: {}", res.body());
                 if (res.body() == "receiver busy") {
-                    spdlog::info(
-                        "The receiver is busy right now, automatically reject the request");
+                    queue_ticket_ = std::string(res[ApiHeader::kQueueTicket]);
+                    if (queue_ticket_.empty()) {
+                        spdlog::info(
+                            "The receiver is busy right now, automatically reject the request");
+                    } else {
+                        spdlog::info("The receiver is busy right now, queued at position {}",
+                                     std::string_view(res[ApiHeader::kQueuePosition]));
+                    }
                     session_status_ = SessionStatus::kWaiting;
                 } else if (res.body() == "declined") {
                     spdlog::info("Send request is cancelled by the sender");
@@ -290,6 +455,7 @@ net::awaitable<bool> SendSession::requestSend(const RequestSendDto& send_request
         session_id_ = std::move(response_dto.session_id);
         spdlog::info("Send Request is accepted, session_id: {}", session_id_);
         session_status_ = SessionStatus::kSending;
+        openUdpChannel(response_dto);
 
         for (auto& [file_id, file_token] : response_dto.file_tokens) {
             auto it = transfer_files_.find(file_id);
@@ -311,6 +477,35 @@ net::awaitable<bool> SendSession::requestSend(const RequestSendDto& send_request
     }
 }
 
+net::awaitable<http::response<http::string_body>> SendSession::sendManifestPages(
+    const RequestSendDto& send_request_dto, http::response<http::string_body> res) {
+    const auto& files = send_request_dto.files;
+    std::size_t sent = std::min(files.size(), transfer::kManifestPageSize);
+    while (res.result() == http::status::ok && sent < files.size()) {
+        RequestSendResponseDto response_dto;
+        nlohmann::from_json(json::parse(res.body()), response_dto);
+        if (!response_dto.manifest_pending) {
+            break;
+        }
+
+        std::size_t page_end = std::min(files.size(), sent + transfer::kManifestPageSize);
+        ManifestPageDto manifest_page_dto{
+            .session_id = response_dto.session_id,
+            .files = {files.begin() + sent, files.begin() + page_end},
+        };
+        auto req = client_.CreateRequest<http::string_body>(http::verb::post,
+                                                            ApiRoute::kManifestPage.data(),
+                                                            true);
+        req.body() = json(manifest_page_dto).dump();
+        req.prepare_payload();
+
+        spdlog::debug("Sending manifest entries {}-{} of {}", sent + 1, page_end, files.size());
+        res = co_await client_.SendRequest(req);
+        sent = page_end;
+    }
+    co_return res;
+}
+
 boost::asio::awaitable<void> SendSession::sendFile(std::string_view file_id) {
     spdlog::debug("SendSession::SendFile");
     try {
@@ -323,80 +518,30 @@ boost::asio::awaitable<void> SendSession::sendFile(std::string_view file_id) {
         }
         TransferFileInfo& file_info = transfer_files_.at(file_id.data());
 
-        std::ifstream file(file_info.file_path, std::ios::binary);
-        if (!file) {
-            spdlog::error("Failed to open file: {}", file_info.file_path.string());
-            throw std::runtime_error("Failed to open file");
-        }
-
-        for (std::size_t chunk_idx = 0; chunk_idx < file_info.total_chunks; ++chunk_idx) {
-            std::size_t current_chunk_size = std::min(transfer::kDefaultChunkSize,
-                                                      file_info.file_size
-                                                          - chunk_idx * transfer::kDefaultChunkSize);
-            BinaryData chunk_data(current_chunk_size);
-
-            file.read(reinterpret_cast<char*>(chunk_data.data()), transfer::kDefaultChunkSize);
+        bool sent = udp_sender_ ? co_await sendOverUdp(file_id) : co_await sendChunks(file_id);
+        progress_.Remove(file_id);
 
-            if (file.gcount() == 0) {
-                break;
-            }
-
-            SendChunkDto send_chunk_dto{
-                session_id_,
-                file_id.data(),
-                file_info.file_token,
-                chunk_idx,
-                FileHasher::CalculateDataChecksum(chunk_data),
-            };
-
-            bool chunk_sent = co_await sendChunk(send_chunk_dto, chunk_data);
-            // judge if send is cancelled
-            if (!chunk_sent) {
-                if (session_status_ == SessionStatus::kCancelledBySender
-                    || session_status_ == SessionStatus::kCancelledByReceiver) {
-                    spdlog::info("File transfer cancelled");
-                } else {
-                    spdlog::error("Failed to send chunk {}/{} of file {}",
-                                  chunk_idx + 1,
-                                  file_info.total_chunks,
-                                  file_id);
-                    session_status_ = SessionStatus::kFailed;
-
-                    // feedback session failed
-                    feedback(Feedback{
-                        .type = FeedbackType::kSendSessionEnded,
-                        .data = feedback::SendSessionEnd{
-                            .session_id = session_id_,
-                            .device_id = receiver_device_id_,
-                            .success = false,
-                            .error_message = "Failed to send chunk",
-                        },
-                    });
-                }
-                file.close();
-                co_return;
-            }
+        if (session_status_ == SessionStatus::kCancelledBySender
+            || session_status_ == SessionStatus::kCancelledByReceiver) {
+            spdlog::info("File transfer cancelled");
+            co_return;
+        }
+        if (!sent) {
+            session_status_ = SessionStatus::kFailed;
 
-            // feedback file sending progress
+            // feedback session failed
             feedback(Feedback{
-                .type = FeedbackType::kFileSendingProgress,
-                .data = feedback::FileSendingProgress{
+                .type = FeedbackType::kSendSessionEnded,
+                .data = feedback::SendSessionEnd{
                     .session_id = session_id_,
-                    .filename = file_info.file_path.string(),
-                    .progress = 100.0 * (chunk_idx + 1) / file_info.total_chunks,
+                    .device_id = receiver_device_id_,
+                    .success = false,
+                    .error_message = "Failed to send chunk",
                 },
             });
-
-            if ((chunk_idx + 1) % 10 == 0 || chunk_idx + 1 == file_info.total_chunks) {
-                spdlog::info("Sent chunk {}/{} ({:.1f}%)",
-                             chunk_idx + 1,
-                             file_info.total_chunks,
-                             100.0 * (chunk_idx + 1) / file_info.total_chunks);
-            }
+            co_return;
         }
 
-        file.close();
-
         spdlog::info("File {} sent successfully", file_info.file_path.string());
         bool finalized = co_await verifyIntegrity(
             {session_id_, file_id.data(), file_info.file_token});
@@ -451,7 +596,346 @@ boost::asio::awaitable<void> SendSession::sendFile(std::string_view file_id) {
     }
 }
 
-net::awaitable<bool> SendSession::sendChunk(const SendChunkDto& send_chunk_dto,
+net::awaitable<bool> SendSession::sendChunks(std::string_view file_id) {
+    const auto& file_info = transfer_files_.at(std::string(file_id));
+
+    ChunkSchedule schedule{
+        .changed = net::steady_timer(strand_, net::steady_timer::time_point::max()),
+    };
+    scheduler_.StartFile(file_info.total_chunks);
+    for (std::size_t path_index = 0; path_index < paths_.size(); ++path_index) {
+        if (scheduler_.Path(path_index).failed) {
+            continue;
+        }
+        // A multiplexed connection carries several chunks at once on separate streams
+        paths_[path_index].streams = paths_[path_index].client->IsMultiplexed()
+                                         ? mux::kStreamsPerPath
+                                         : 1;
+        for (std::size_t i = 0; i < paths_[path_index].streams; ++i) {
+            ++schedule.workers;
+            net::co_spawn(strand_,
+                          pathWorker(std::string(file_id), path_index, schedule),
+                          net::detached);
+        }
+    }
+    while (schedule.workers > 0) {
+        boost::system::error_code ec;
+        co_await schedule.changed.async_wait(net::redirect_error(net::use_awaitable, ec));
+    }
+    if (scheduler_.Completed() < file_info.total_chunks && !IsCancelled()) {
+        spdlog::error("Failed to send file {}, {}/{} chunks sent",
+                      file_id,
+                      scheduler_.Completed(),
+                      file_info.total_chunks);
+    }
+    co_return scheduler_.Completed() == file_info.total_chunks;
+}
+
+net::awaitable<bool> SendSession::sendOverUdp(std::string_view file_id) {
+    std::string id(file_id);
+    const auto& file_info = transfer_files_.at(id);
+    auto file_index = std::ranges::lower_bound(udp_file_ids_, id) - udp_file_ids_.begin();
+
+    auto result = co_await udp_sender_->SendFile(
+        static_cast<std::uint32_t>(file_index),
+        file_info.file_path,
+        file_info.file_size,
+        [this] { return IsCancelled(); },
+        [this, &id, &file_info](std::uint64_t bytes_acked) {
+            reportSendProgress(id, file_info, bytes_acked);
+        });
+    switch (result) {
+    case UdpSendResult::kCompleted:
+        co_return true;
+    case UdpSendResult::kReceiverCancelled:
+        spdlog::info("File transfer cancelled by receiver");
+        session_status_ = SessionStatus::kCancelledByReceiver;
+
+        // feedback receiver cancellation
+        feedback(Feedback{
+            .type = FeedbackType::kSendSessionEnded,
+            .data = feedback::SendSessionEnd{
+                .session_id = session_id_,
+                .device_id = receiver_device_id_,
+                .success = false,
+                .cancelled_by_receiver = true,
+            },
+        });
+        co_return false;
+    case UdpSendResult::kFailed:
+        spdlog::error("Failed to send file {} over the UDP data channel", id);
+        co_return false;
+    case UdpSendResult::kCancelled:
+        break;
+    }
+    co_return false;
+}
+
+void SendSession::reportSendProgress(const std::string& file_id,
+                                     const TransferFileInfo& file_info,
+                                     std::uint64_t bytes_sent) {
+    // feedback file sending progress, coalesced to settings.progress_rate_hz
+    if (auto sample = progress_.Update(file_id, bytes_sent, file_info.file_size); sample) {
+        feedback(Feedback{
+            .type = FeedbackType::kFileSendingProgress,
+            .data = feedback::FileSendingProgress{
+                .session_id = session_id_,
+                .filename = file_info.file_path.string(),
+                .progress = sample->progress,
+                .bytes_transferred = sample->bytes_transferred,
+                .total_bytes = sample->total_bytes,
+                .throughput = sample->throughput,
+                .average_throughput = sample->average_throughput,
+                .eta_seconds = sample->eta_seconds,
+            },
+        });
+    }
+}
+
+net::awaitable<void> SendSession::pathWorker(std::string file_id,
+                                             std::size_t path_index,
+                                             ChunkSchedule& schedule) {
+    auto& path = paths_[path_index];
+    const auto& file_info = transfer_files_.at(file_id);
+    std::optional<std::size_t> taken;
+    try {
+        std::ifstream file(file_info.file_path, std::ios::binary);
+        if (!file) {
+            spdlog::error("Failed to open file: {}", file_info.file_path.string());
+            throw std::runtime_error("Failed to open file");
+        }
+
+        while (!IsCancelled() && !scheduler_.Finished() && !scheduler_.Path(path_index).failed) {
+            taken = scheduler_.Take(path_index, chunk_credits_);
+            if (!taken) {
+                boost::system::error_code ec;
+                co_await schedule.changed.async_wait(net::redirect_error(net::use_awaitable, ec));
+                continue;
+            }
+
+            std::size_t chunk_idx = *taken;
+            std::size_t offset = chunk_idx * transfer::kDefaultChunkSize;
+            std::size_t current_chunk_size = std::min(transfer::kDefaultChunkSize,
+                                                      file_info.file_size - offset);
+            // The chunk is held twice while it is sent: as read and framed into the request
+            auto reservation = co_await MemoryGovernor::Reserve(2 * current_chunk_size);
+            BinaryData chunk_data(current_chunk_size);
+
+            file.seekg(static_cast<std::streamoff>(offset));
+            file.read(reinterpret_cast<char*>(chunk_data.data()),
+                      static_cast<std::streamsize>(current_chunk_size));
+            if (static_cast<std::size_t>(file.gcount()) != current_chunk_size) {
+                throw std::runtime_error("File was truncated while being sent");
+            }
+
+            auto chunk_checksum = co_await ComputePool::Run("chunk-checksum", [&chunk_data]() {
+                return FileHasher::CalculateDataChecksum(chunk_data);
+            });
+            SendChunkDto send_chunk_dto{
+                session_id_,
+                file_id,
+                file_info.file_token,
+                chunk_idx,
+                std::move(chunk_checksum),
+            };
+
+            auto started_at = std::chrono::steady_clock::now();
+            bool chunk_sent = co_await sendChunk(*path.client, send_chunk_dto, chunk_data);
+            taken.reset();
+
+            if (chunk_sent) {
+                scheduler_.ChunkSent(path_index,
+                                     current_chunk_size,
+                                     path.streams,
+                                     std::chrono::steady_clock::now() - started_at);
+                auto completed = scheduler_.Completed();
+                reportSendProgress(file_id,
+                                   file_info,
+                                   std::min(file_info.file_size,
+                                            completed * transfer::kDefaultChunkSize));
+
+                if (completed % 10 == 0 || completed == file_info.total_chunks) {
+                    spdlog::info("Sent chunk {}/{} ({:.1f}%)",
+                                 completed,
+                                 file_info.total_chunks,
+                                 100.0 * completed / file_info.total_chunks);
+                }
+            } else if (IsCancelled()) {
+                scheduler_.Abandon(chunk_idx);
+            } else {
+                spdlog::warn("Path {} -> {} failed on chunk {}/{} of file {}",
+                             path.local_address,
+                             path.remote_address,
+                             chunk_idx + 1,
+                             file_info.total_chunks,
+                             file_id);
+                scheduler_.ChunkFailed(path_index, chunk_idx);
+            }
+            schedule.changed.cancel();
+        }
+    } catch (const std::exception& e) {
+        if (!IsCancelled()) {
+            spdlog::error("Error occurred on SendSession::PathWorker: {}", e.what());
+        }
+        scheduler_.Abandon(taken);
+    }
+    --schedule.workers;
+    schedule.changed.cancel();
+}
+
+void SendSession::openUdpChannel(RequestSendResponseDto& response_dto) {
+    if (response_dto.udp_port == 0 || response_dto.udp_key.size() != FileEncryptor::KEY_SIZE) {
+        return;
+    }
+    try {
+        net::ip::udp::endpoint receiver(net::ip::make_address(client_.current_host()),
+                                        response_dto.udp_port);
+        udp_sender_ = std::make_shared<UdpSender>(
+            strand_,
+            client_.local_endpoint().value().address().to_string(),
+            receiver,
+            std::move(response_dto.udp_key));
+        udp_sender_->Start();
+
+        // Both sides number the accepted files in the order of their ids
+        udp_file_ids_.clear();
+        for (const auto& [file_id, file_token] : response_dto.file_tokens) {
+            udp_file_ids_.push_back(file_id);
+        }
+        std::ranges::sort(udp_file_ids_);
+        spdlog::info("Sending over the UDP data channel to port {}", response_dto.udp_port);
+    } catch (const std::exception& e) {
+        spdlog::warn("Failed to open the UDP data channel, sending chunks over HTTPS: {}",
+                     e.what());
+        udp_sender_.reset();
+    }
+}
+
+net::awaitable<void> SendSession::openPaths(const std::vector<std::string>& hosts,
+                                            unsigned short port) {
+    paths_.clear();
+    paths_.push_back(TransferPath{
+        .local_address = client_.local_endpoint().value().address().to_string(),
+        .remote_address = client_.current_host(),
+        .client = &client_,
+    });
+    if (!settings.multipath_transfer || udp_sender_) {
+        co_return;
+    }
+
+    // A local interface pairs with the receiver's addresses in its subnet. An address no
+    // interface is on (e.g. behind a router) is left to the routing table.
+    std::vector<std::pair<std::string, std::string>> candidates;
+    auto interfaces = system::NetworkInterfaces();
+    for (const auto& host : hosts) {
+        boost::system::error_code ec;
+        auto address = net::ip::make_address(host, ec);
+        if (ec || !address.is_v4()) {
+            continue;
+        }
+        bool on_link = false;
+        for (const auto& network_interface : interfaces) {
+            auto network = net::ip::make_network_v4(
+                net::ip::make_address_v4(network_interface.address),
+                net::ip::make_address_v4(network_interface.netmask));
+            if (net::ip::network_v4(address.to_v4(), network.prefix_length()).canonical()
+                == network.canonical()) {
+                candidates.emplace_back(network_interface.address, host);
+                on_link = true;
+            }
+        }
+        if (!on_link) {
+            candidates.emplace_back(std::string(), host);
+        }
+    }
+
+    // Copied, paths_ grows below
+    std::string control_local = paths_.front().local_address;
+    std::string control_remote = paths_.front().remote_address;
+    for (const auto& [local, remote] : candidates) {
+        if (paths_.size() >= transfer::kMaxTransferPaths) {
+            break;
+        }
+        if (remote == control_remote && (local.empty() || local == control_local)) {
+            continue;
+        }
+        try {
+            beast::tcp_stream stream(ioc_);
+            stream.socket().open(tcp::v4());
+            if (!local.empty()) {
+                stream.socket().bind(tcp::endpoint(net::ip::make_address(local), 0));
+            }
+            stream.expires_after(transfer::kPathConnectTimeout);
+            co_await stream.async_connect(tcp::endpoint(net::ip::make_address(remote), port),
+                                          net::use_awaitable);
+            stream.expires_never();
+
+            auto client = std::make_unique<HttpsClient>(ioc_, cert_manager_);
+            if (!co_await client->Connect(stream.release_socket(), remote, port)) {
+                continue;
+            }
+            if (settings.mux_transport) {
+                co_await client->UpgradeToMux();
+            }
+            auto local_address = client->local_endpoint().value().address().to_string();
+            auto& path = paths_.emplace_back(TransferPath{
+                .local_address = std::move(local_address),
+                .remote_address = remote,
+                .owned_client = std::move(client),
+            });
+            path.client = path.owned_client.get();
+            spdlog::info("Opened transfer path {} -> {}", path.local_address, remote);
+        } catch (const std::exception& e) {
+            spdlog::debug("No transfer path {} -> {}: {}",
+                          local.empty() ? "default route" : local,
+                          remote,
+                          e.what());
+        }
+    }
+}
+
+net::awaitable<void> SendSession::closePaths() {
+    if (udp_sender_) {
+        auto stats = udp_sender_->Stats();
+        spdlog::info("UDP data channel: {} packets, {} lost, {:.1f} MB/s paced, RTT {} us "
+                     "(min {} us)",
+                     stats.packets_sent,
+                     stats.packets_lost,
+                     stats.rate / (1024 * 1024),
+                     stats.smoothed_rtt.count(),
+                     stats.min_rtt.count());
+        udp_sender_->Close();
+        udp_sender_.reset();
+        udp_file_ids_.clear();
+    }
+    for (std::size_t i = 0; i < paths_.size(); ++i) {
+        auto& path = paths_[i];
+        const auto& stats = scheduler_.Path(i);
+        spdlog::info("Transfer path {} -> {}: {} chunks, {:.1f} MB/s{}",
+                     path.local_address,
+                     path.remote_address,
+                     stats.chunks_sent,
+                     stats.throughput / (1024 * 1024),
+                     stats.failed ? ", failed" : "");
+        if (path.owned_client) {
+            co_await path.owned_client->Disconnect();
+        }
+    }
+    paths_.clear();
+    scheduler_ = ChunkScheduler();
+}
+
+HttpsClient& SendSession::liveClient() {
+    for (std::size_t i = 0; i < paths_.size(); ++i) {
+        if (!scheduler_.Path(i).failed) {
+            return *paths_[i].client;
+        }
+    }
+    return client_;
+}
+
+net::awaitable<bool> SendSession::sendChunk(HttpsClient& client,
+                                            const SendChunkDto& send_chunk_dto,
                                             const BinaryData& chunk_data) {
     spdlog::debug("SendSession::SendChunk");
     try {
@@ -463,14 +947,14 @@ net::awaitable<bool> SendSession::sendChunk(const SendChunkDto& send_chunk_dto,
 
         BinaryMessage binary_message = CreateBinaryMessage(metadata, chunk_data);
 
-        auto req = client_.CreateRequest<http::vector_body<uint8_t>>(http::verb::post,
-                                                                     ApiRoute::kSendChunk.data(),
-                                                                     true);
+        auto req = client.CreateRequest<http::vector_body<uint8_t>>(http::verb::post,
+                                                                    ApiRoute::kSendChunk.data(),
+                                                                    true);
 
         req.body() = std::move(binary_message);
         req.prepare_payload();
 
-        auto res = co_await client_.SendRequest(req);
+        auto res = co_await sendAbortable(client, req);
         // Check if the session is cancelled by sender
         // Since status modification takes place parallelly to this co_await
         if (session_status_ == SessionStatus::kCancelledBySender) {
@@ -479,6 +963,7 @@ net::awaitable<bool> SendSession::sendChunk(const SendChunkDto& send_chunk_dto,
 
         if (res.result() == http::status::ok) {
             spdlog::debug("Chunk {} sent successfully", send_chunk_dto.current_chunk_index);
+            updateChunkCredits(res);
             co_return true;
         } else if (res.result() == http::status::forbidden && res.body() == "receiver cancelled") {
             spdlog::info("File transfer cancelled by receiver");
@@ -511,6 +996,24 @@ net::awaitable<bool> SendSession::sendChunk(const SendChunkDto& send_chunk_dto,
     }
 }
 
+void SendSession::updateChunkCredits(const http::response<http::string_body>& res) {
+    std::string_view granted(res[ApiHeader::kChunkCredits]);
+    std::size_t credits = 0;
+    if (granted.empty()) {
+        // The receiver does not grant credits, nothing holds the paths back
+        credits = std::numeric_limits<std::size_t>::max();
+    } else if (auto [end, ec] = std::from_chars(granted.data(),
+                                                granted.data() + granted.size(),
+                                                credits);
+               ec != std::errc() || credits == 0) {
+        return;
+    }
+    if (credits != chunk_credits_) {
+        spdlog::debug("Receiver grants {} chunk(s) in flight", credits);
+        chunk_credits_ = credits;
+    }
+}
+
 net::awaitable<bool> SendSession::verifyIntegrity(const VerifyIntegrityDto& verify_integrity_dto) {
     spdlog::debug("SendSession::VerifyIntegrity");
     try {
@@ -520,14 +1023,16 @@ net::awaitable<bool> SendSession::verifyIntegrity(const VerifyIntegrityDto& veri
 
         json metadata = verify_integrity_dto;
 
-        auto req = client_.CreateRequest<http::string_body>(http::verb::post,
-                                                            ApiRoute::kVerifyIntegrity.data(),
-                                                            true);
+        // The control connection may be the path that failed
+        auto& client = liveClient();
+        auto req = client.CreateRequest<http::string_body>(http::verb::post,
+                                                           ApiRoute::kVerifyIntegrity.data(),
+                                                           true);
 
         req.body() = metadata.dump();
         req.prepare_payload();
 
-        auto res = co_await client_.SendRequest(req);
+        auto res = co_await sendAbortable(client, req);
         if (session_status_ == SessionStatus::kCancelledBySender) {
             co_return false;
         }
@@ -15,15 +15,15 @@ SendSessionManager::SendSessionManager(boost::asio::io_context& ioc,
     , cert_manager_(cert_manager)
     , callback_(callback) {};
 
-void SendSessionManager::SendFiles(std::string_view host,
+void SendSessionManager::SendFiles(std::vector<std::string> hosts,
                                    unsigned short port,
                                    const std::vector<std::filesystem::path>& file_paths,
                                    std::string_view device_id) {
-    auto send_session = std::make_shared<SendSession>(ioc_, cert_manager_);
+    auto send_session = std::make_shared<SendSession>(ioc_, cert_manager_, callback_);
     send_session->RecordReceiverId(device_id);
-    net::co_spawn(ioc_,
+    net::co_spawn(send_session->strand(),
                   send_session->Start(file_paths,
-                                      host,
+                                      std::move(hosts),
                                       port,
                                       [this, send_session]() {
                                           this->addSendSession(send_session);
@@ -31,6 +31,7 @@ void SendSessionManager::SendFiles(std::string_view host,
                   [this, send_session](std::exception_ptr p) {
                       // Clean up the session
                       const auto& session_id = send_session->session_id();
+                      std::lock_guard lock(sessions_mutex_);
                       if (this->send_sessions_.contains(session_id)) {
                           if (this->send_sessions_[session_id]->session_status()
                               == SessionStatus::kSending) {
@@ -45,16 +46,23 @@ void SendSessionManager::SendFiles(std::string_view host,
 }
 
 void SendSessionManager::CancelSend(const std::string& session_id) {
-    if (send_sessions_.contains(session_id)) {
-        send_sessions_[session_id]->Cancel();
+    std::shared_ptr<SendSession> session;
+    {
+        std::lock_guard lock(sessions_mutex_);
+        if (auto it = send_sessions_.find(session_id); it != send_sessions_.end()) {
+            session = it->second;
+        }
+    }
+    if (session) {
+        session->Cancel();
     }
 }
 
 void SendSessionManager::CancelWaitForConfirmation(std::string_view ip, unsigned short port) {
     auto client_ptr = std::make_shared<HttpsClient>(ioc_, cert_manager_);
     net::co_spawn(
-        ioc_,
-        [&]() -> net::awaitable<void> {
+        net::make_strand(ioc_),
+        [this, client_ptr, ip = std::string(ip), port]() -> net::awaitable<void> {
             try {
                 co_await client_ptr->Connect(ip, port);
                 if (client_ptr->IsConnected()) {
@@ -64,7 +72,7 @@ void SendSessionManager::CancelWaitForConfirmation(std::string_view ip, unsigned
                                                                       true);
 
                     nlohmann::json data;
-                    auto& local_device = DeviceInfo::LocalDeviceInfo();
+                    auto local_device = DeviceInfo::LocalDeviceInfo();
                     data["ip"] = local_device.ip_address;
                     data["port"] = local_device.port;
                     req.set(http::field::user_agent, "Lansend");
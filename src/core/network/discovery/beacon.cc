@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <boost/endian/conversion.hpp>
+#include <core/network/discovery/beacon.h>
+
+namespace lansend::core {
+
+static constexpr std::array<char, 2> kMagic{'L', 'S'};
+static constexpr std::size_t kHeaderSize = 2 + 1 + 1 + 2 + 4 + 8 + 1;
+
+std::string EncodeBeacon(const Beacon& beacon) {
+    std::size_t id_size = std::min(beacon.device_id.size(), Beacon::kMaxDeviceIdSize);
+    std::string data(kHeaderSize + id_size, '\0');
+    auto* out = reinterpret_cast<unsigned char*>(data.data());
+
+    out[0] = kMagic[0];
+    out[1] = kMagic[1];
+    out[2] = Beacon::kFormat;
+    out[3] = static_cast<std::uint8_t>(beacon.type);
+    boost::endian::store_big_u16(out + 4, beacon.port);
+    boost::endian::store_big_u32(out + 6, beacon.info_version);
+    std::copy(beacon.fingerprint_digest.begin(), beacon.fingerprint_digest.end(), out + 10);
+    out[18] = static_cast<std::uint8_t>(id_size);
+    std::copy_n(beacon.device_id.data(), id_size, data.data() + kHeaderSize);
+    return data;
+}
+
+std::optional<Beacon> DecodeBeacon(std::string_view data) {
+    if (data.size() < kHeaderSize || data[0] != kMagic[0] || data[1] != kMagic[1]) {
+        return std::nullopt;
+    }
+    const auto* in = reinterpret_cast<const unsigned char*>(data.data());
+    if (in[2] != Beacon::kFormat || in[3] > static_cast<std::uint8_t>(BroadcastType::kGoodbye)) {
+        return std::nullopt;
+    }
+    std::size_t id_size = in[18];
+    if (data.size() != kHeaderSize + id_size || id_size == 0) {
+        return std::nullopt;
+    }
+
+    Beacon beacon;
+    beacon.type = static_cast<BroadcastType>(in[3]);
+    beacon.port = boost::endian::load_big_u16(in + 4);
+    beacon.info_version = boost::endian::load_big_u32(in + 6);
+    std::copy_n(in + 10, beacon.fingerprint_digest.size(), beacon.fingerprint_digest.begin());
+    beacon.device_id.assign(data.substr(kHeaderSize));
+    return beacon;
+}
+
+std::array<std::uint8_t, 8> FingerprintDigest(std::string_view hex_fingerprint) {
+    auto nibble = [](char c) -> std::uint8_t {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return 0;
+    };
+
+    std::array<std::uint8_t, 8> digest{};
+    for (std::size_t i = 0; i < digest.size() && 2 * i + 1 < hex_fingerprint.size(); ++i) {
+        digest[i] = (nibble(hex_fingerprint[2 * i]) << 4) | nibble(hex_fingerprint[2 * i + 1]);
+    }
+    return digest;
+}
+
+} // namespace lansend::core
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <core/network/discovery/device_registry.h>
+
+namespace lansend::core {
+
+static bool SameAddresses(const std::vector<DeviceAddress>& a,
+                          const std::vector<DeviceAddress>& b) {
+    return std::ranges::equal(a, b, [](const DeviceAddress& x, const DeviceAddress& y) {
+        return x.ip_address == y.ip_address && x.link_speed_mbps == y.link_speed_mbps;
+    });
+}
+
+// A device that gained or lost an interface, or whose link speed changed, is an update too,
+// the multipath sender picks its paths from the addresses
+static bool SameInfo(const DeviceInfo& a, const DeviceInfo& b) {
+    return a.hostname == b.hostname && a.operating_system == b.operating_system
+           && a.ip_address == b.ip_address && a.port == b.port
+           && SameAddresses(a.addresses, b.addresses);
+}
+
+std::string DeviceRegistry::endpointKey(const std::string& ip, std::uint16_t port) {
+    return ip + ":" + std::to_string(port);
+}
+
+DeviceRegistry::Change DeviceRegistry::Upsert(const DeviceInfo& device,
+                                              Clock::time_point expires_at,
+                                              std::uint32_t info_version) {
+    auto it = devices_.find(device.device_id);
+    if (it == devices_.end()) {
+        ++version_;
+        devices_.emplace(device.device_id,
+                         Entry{device, expires_at, info_version, version_, version_});
+        by_endpoint_[endpointKey(device.ip_address, device.port)] = device.device_id;
+        deadlines_.push(Deadline{expires_at, device.device_id, version_});
+        return Change::kAdded;
+    }
+
+    auto& entry = it->second;
+    entry.expires_at = std::max(entry.expires_at, expires_at);
+    entry.info_version = info_version;
+    if (SameInfo(entry.device, device)) {
+        return Change::kNone;
+    }
+    by_endpoint_.erase(endpointKey(entry.device.ip_address, entry.device.port));
+    by_endpoint_[endpointKey(device.ip_address, device.port)] = device.device_id;
+    entry.device = device;
+    entry.version = ++version_;
+    return Change::kUpdated;
+}
+
+bool DeviceRegistry::Refresh(const std::string& device_id,
+                             std::uint32_t info_version,
+                             Clock::time_point expires_at) {
+    auto it = devices_.find(device_id);
+    if (it == devices_.end() || it->second.info_version != info_version) {
+        return false;
+    }
+    it->second.expires_at = std::max(it->second.expires_at, expires_at);
+    return true;
+}
+
+std::optional<DeviceInfo> DeviceRegistry::Remove(const std::string& device_id) {
+    auto it = devices_.find(device_id);
+    if (it == devices_.end()) {
+        return std::nullopt;
+    }
+    DeviceInfo device = std::move(it->second.device);
+    erase(it);
+    // Its deadline stays in the heap and is dropped when it surfaces
+    return device;
+}
+
+std::vector<DeviceInfo> DeviceRegistry::Expire(Clock::time_point now) {
+    std::vector<DeviceInfo> expired;
+    while (!deadlines_.empty() && deadlines_.top().expires_at <= now) {
+        Deadline deadline = deadlines_.top();
+        deadlines_.pop();
+
+        auto it = devices_.find(deadline.device_id);
+        if (it == devices_.end() || it->second.added_version != deadline.added_version) {
+            continue; // Removed meanwhile
+        }
+        if (it->second.expires_at > now) {
+            // Refreshed since the deadline was pushed
+            deadline.expires_at = it->second.expires_at;
+            deadlines_.push(std::move(deadline));
+            continue;
+        }
+        expired.push_back(std::move(it->second.device));
+        erase(it);
+    }
+    return expired;
+}
+
+void DeviceRegistry::erase(std::unordered_map<std::string, Entry>::iterator it) {
+    by_endpoint_.erase(endpointKey(it->second.device.ip_address, it->second.device.port));
+    tombstones_.emplace_back(++version_, it->first);
+    if (tombstones_.size() > kMaxTombstones) {
+        forgotten_version_ = tombstones_.front().first;
+        tombstones_.pop_front();
+    }
+    devices_.erase(it);
+}
+
+const DeviceInfo* DeviceRegistry::Find(const std::string& device_id) const {
+    auto it = devices_.find(device_id);
+    return it != devices_.end() ? &it->second.device : nullptr;
+}
+
+const DeviceInfo* DeviceRegistry::FindByEndpoint(const std::string& ip,
+                                                 std::uint16_t port) const {
+    auto it = by_endpoint_.find(endpointKey(ip, port));
+    return it != by_endpoint_.end() ? Find(it->second) : nullptr;
+}
+
+std::vector<DeviceInfo> DeviceRegistry::Snapshot() const {
+    std::vector<DeviceInfo> devices;
+    devices.reserve(devices_.size());
+    for (const auto& [device_id, entry] : devices_) {
+        devices.push_back(entry.device);
+    }
+    return devices;
+}
+
+DeviceRegistry::Delta DeviceRegistry::Changes(std::uint64_t since_version) const {
+    Delta delta;
+    delta.version = version_;
+    if (since_version == version_) {
+        return delta;
+    }
+    if (since_version < forgotten_version_ || since_version > version_) {
+        delta.full = true;
+        delta.upserted = Snapshot();
+        return delta;
+    }
+    for (const auto& [device_id, entry] : devices_) {
+        if (entry.version > since_version) {
+            delta.upserted.push_back(entry.device);
+        }
+    }
+    for (auto it = tombstones_.rbegin(); it != tombstones_.rend() && it->first > since_version;
+         ++it) {
+        delta.removed.push_back(it->second);
+    }
+    return delta;
+}
+
+std::optional<DeviceRegistry::Clock::time_point> DeviceRegistry::NextExpiry() const {
+    if (deadlines_.empty()) {
+        return std::nullopt;
+    }
+    return deadlines_.top().expires_at;
+}
+
+} // namespace lansend::core
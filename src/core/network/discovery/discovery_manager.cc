@@ -1,14 +1,18 @@
 #include "core/model/dto/broadcast_dto.h"
 #include <boost/asio/co_spawn.hpp>
 #include <boost/asio/detached.hpp>
+#include <boost/asio/ip/address.hpp>
 #include <boost/asio/ip/address_v4.hpp>
 #include <boost/asio/ip/multicast.hpp>
+#include <boost/asio/ip/network_v4.hpp>
 #include <boost/asio/ip/udp.hpp>
+#include <boost/asio/redirect_error.hpp>
 #include <boost/asio/use_awaitable.hpp>
 #include <chrono>
+#include <core/constant/route.h>
 #include <core/model.h>
+#include <core/network/client/http_client.h>
 #include <core/network/discovery/discovery_manager.h>
-#include <random>
 #include <spdlog/spdlog.h>
 #include <string>
 
@@ -19,8 +23,8 @@ namespace lansend::core {
 
 DiscoveryManager::DiscoveryManager(io_context& ioc, CertificateManager& cert_manager)
     : io_context_(ioc)
+    , strand_(make_strand(ioc))
     , cert_manager_(cert_manager)
-    , broadcast_socket_(ioc)
     , listen_socket_(ioc)
     , broadcast_timer_(ioc)
     , cleanup_timer_(ioc)
@@ -29,7 +33,8 @@ DiscoveryManager::DiscoveryManager(io_context& ioc, CertificateManager& cert_man
         [](const DeviceInfo& device) { spdlog::info("Device found:{}", device.device_id); })
     , device_lost_callback_(
           [](std::string_view device_id) { spdlog::info("Device lost:{}", device_id); }) {
-    device_id_ = generateDeviceId();
+    // Beacons carry the local device id, so that is what our own beacons are recognized by
+    device_id_ = DeviceInfo::LocalDeviceInfo().device_id;
     spdlog::info("discovery_manager created.");
 }
 
@@ -41,22 +46,21 @@ DiscoveryManager::~DiscoveryManager() {
 void DiscoveryManager::Start(uint16_t port) {
     try {
         spdlog::info("start to discover devices...");
-        // 初始化广播套接字
-        broadcast_socket_.open(ip::udp::v4());
-        broadcast_socket_.set_option(socket_base::broadcast(true));
-        broadcast_socket_.set_option(socket_base::reuse_address(true));
-
+        port_ = port;
         // 初始化监听套接字
         ip::udp::endpoint listen_endpoint(ip::udp::v4(), port);
         listen_socket_.open(listen_endpoint.protocol());
         listen_socket_.set_option(socket_base::reuse_address(true));
         listen_socket_.bind(listen_endpoint);
 
+        // 初始化各接口的发送套接字
+        openInterfaceSockets();
+
         // 启动广播和监听协程
-        co_spawn(io_context_, broadcaster(), detached);
-        co_spawn(io_context_, listener(), detached);
+        co_spawn(strand_, broadcaster(), detached);
+        co_spawn(strand_, listener(), detached);
         // 启动清理协程
-        co_spawn(io_context_, cleanupDevices(), detached);
+        co_spawn(strand_, cleanupDevices(), detached);
     } catch (const std::exception& e) {
         spdlog::error("Error starting DiscoveryManager: {}", e.what());
     }
@@ -64,10 +68,16 @@ void DiscoveryManager::Start(uint16_t port) {
 
 void DiscoveryManager::Stop() {
     try {
-        if (broadcast_socket_.is_open()) {
-            broadcast_socket_.close();
-            spdlog::info("broadcast socket is closed");
+        // Peers drop us right away instead of waiting for the device timeout
+        std::string goodbye = beaconData(BroadcastType::kGoodbye);
+        for (const auto& entry : interface_sockets_) {
+            if (entry->socket.is_open()) {
+                boost::system::error_code ec;
+                entry->socket.send_to(buffer(goodbye), entry->announce_endpoint, 0, ec);
+                entry->socket.close(ec);
+            }
         }
+        spdlog::info("broadcast sockets are closed");
         if (listen_socket_.is_open()) {
             listen_socket_.close();
             spdlog::info("listen socket is closed");
@@ -80,24 +90,37 @@ void DiscoveryManager::Stop() {
     }
 }
 
-void DiscoveryManager::AddDevice(const DeviceInfo& device) {
-    // std::lock_guard<std::mutex> lock(devices_mutex_);
-    auto it = discovered_devices_.find(device.device_id);
-    if (it == discovered_devices_.end()) {
-        discovered_devices_[device.device_id] = {device, std::chrono::system_clock::now()};
-        if (device_found_callback_) {
-            device_found_callback_(device);
+void DiscoveryManager::NotifyLocalInfoChanged() {
+    post(strand_, [this]() {
+        if (!listen_socket_.is_open()) {
+            return;
         }
-    } else {
-        it->second.last_seen = std::chrono::system_clock::now();
+        // Memberships and sending sockets belong to interfaces that may be gone now
+        openInterfaceSockets();
+        if (refreshLocalInfo()) {
+            spdlog::info("Local device info changed, announcing version {}",
+                         info_version_.load());
+            beacon_interval_ = discovery::kMinBeaconInterval;
+            broadcast_timer_.cancel();
+        }
+    });
+}
+
+void DiscoveryManager::AddDevice(const DeviceInfo& device, std::uint32_t info_version) {
+    std::lock_guard<std::mutex> lock(devices_mutex_);
+    // Repeated beacons only extend the expiry, the UI hears about new and changed devices
+    auto change = registry_.Upsert(device,
+                                   std::chrono::steady_clock::now() + discovery::kDeviceTimeout,
+                                   info_version);
+    if (change != DeviceRegistry::Change::kNone && device_found_callback_) {
+        device_found_callback_(device);
     }
 }
 
 void DiscoveryManager::RemoveDevice(const std::string& device_id) {
-    // std::lock_guard<std::mutex> lock(devices_mutex_);
-    auto it = discovered_devices_.find(device_id);
-    if (it != discovered_devices_.end()) {
-        discovered_devices_.erase(it);
+    std::lock_guard<std::mutex> lock(devices_mutex_);
+    if (auto device = registry_.Remove(device_id); device) {
+        removeFingerprints(*device);
         if (device_lost_callback_) {
             device_lost_callback_(device_id);
         }
@@ -105,19 +128,30 @@ void DiscoveryManager::RemoveDevice(const std::string& device_id) {
 }
 
 std::optional<DeviceInfo> DiscoveryManager::GetDevice(const std::string& device_id) const {
-    if (discovered_devices_.contains(device_id)) {
-        return discovered_devices_.at(device_id).device;
+    std::lock_guard<std::mutex> lock(devices_mutex_);
+    if (const auto* device = registry_.Find(device_id); device) {
+        return *device;
     }
     return std::nullopt;
 }
 
-std::vector<DeviceInfo> DiscoveryManager::GetDevices() const {
-    // std::lock_guard<std::mutex> lock(devices_mutex_);
-    std::vector<DeviceInfo> devices;
-    for (const auto& pair : discovered_devices_) {
-        devices.push_back(pair.second.device);
+std::optional<DeviceInfo> DiscoveryManager::GetDeviceByEndpoint(const std::string& ip,
+                                                                 uint16_t port) const {
+    std::lock_guard<std::mutex> lock(devices_mutex_);
+    if (const auto* device = registry_.FindByEndpoint(ip, port); device) {
+        return *device;
     }
-    return devices;
+    return std::nullopt;
+}
+
+std::vector<DeviceInfo> DiscoveryManager::GetDevices() const {
+    std::lock_guard<std::mutex> lock(devices_mutex_);
+    return registry_.Snapshot();
+}
+
+DeviceRegistry::Delta DiscoveryManager::GetDeviceChanges(std::uint64_t since_version) const {
+    std::lock_guard<std::mutex> lock(devices_mutex_);
+    return registry_.Changes(since_version);
 }
 
 void DiscoveryManager::SetDeviceFoundCallback(std::function<void(const DeviceInfo&)> callback) {
@@ -128,47 +162,289 @@ void DiscoveryManager::SetDeviceLostCallback(std::function<void(std::string_view
     device_lost_callback_ = callback;
 }
 
-awaitable<void> DiscoveryManager::broadcaster() {
-    try {
-        const std::string broadcast_address = "255.255.255.255";
+std::string DiscoveryManager::beaconData(BroadcastType type) const {
+    Beacon beacon;
+    beacon.type = type;
+    beacon.device_id = device_id_;
+    beacon.port = settings.port;
+    beacon.info_version = info_version_.load();
+    beacon.fingerprint_digest = FingerprintDigest(
+        cert_manager_.security_context().certificate_hash);
+    return EncodeBeacon(beacon);
+}
 
-        const uint16_t broadcast_port = 37020;
+void DiscoveryManager::openInterfaceSockets() {
+    auto group = ip::make_address_v4(discovery::kMulticastGroup);
+    for (const auto& entry : interface_sockets_) {
+        boost::system::error_code ec;
+        if (entry->announce_endpoint.address().is_multicast()) {
+            auto address = entry->network.address();
+            listen_socket_.set_option(address.is_unspecified()
+                                          ? ip::multicast::leave_group(group)
+                                          : ip::multicast::leave_group(group, address),
+                                      ec);
+        }
+        entry->socket.close(ec);
+    }
+    interface_sockets_.clear();
 
-        ip::udp::endpoint broadcast_endpoint(ip::make_address(broadcast_address), broadcast_port);
+    auto interfaces = system::NetworkInterfaces();
+    if (interfaces.empty()) {
+        // 识别不出接口时只用默认路由所在的接口
+        interfaces.emplace_back();
+    }
+    for (auto& network_interface : interfaces) {
+        try {
+            ip::network_v4 network;
+            if (!network_interface.address.empty()) {
+                network = ip::make_network_v4(ip::make_address_v4(network_interface.address),
+                                              ip::make_address_v4(network_interface.netmask));
+            }
+            auto address = network.address();
+
+            ip::udp::socket socket(io_context_);
+            socket.open(ip::udp::v4());
+            socket.set_option(socket_base::broadcast(true));
+            socket.set_option(socket_base::reuse_address(true));
+            socket.set_option(ip::multicast::hops(1));
+            if (!address.is_unspecified()) {
+                socket.set_option(ip::multicast::outbound_interface(address));
+            }
+            socket.bind(ip::udp::endpoint(address, 0));
+
+            // 加入组播组，失败时（例如该接口没有组播路由）退回到子网广播
+            ip::udp::endpoint announce_endpoint;
+            boost::system::error_code ec;
+            listen_socket_.set_option(address.is_unspecified()
+                                          ? ip::multicast::join_group(group)
+                                          : ip::multicast::join_group(group, address),
+                                      ec);
+            if (!ec) {
+                announce_endpoint = ip::udp::endpoint(group, port_);
+            } else {
+                spdlog::warn("Failed to join multicast group {} on {}, falling back to "
+                             "broadcast: {}",
+                             discovery::kMulticastGroup,
+                             network_interface.name,
+                             ec.message());
+                announce_endpoint = ip::udp::endpoint(address.is_unspecified()
+                                                          ? ip::address_v4::broadcast()
+                                                          : network.broadcast(),
+                                                      port_);
+            }
 
-        // 将设备信息和指纹添加到广播数据包中
-        BroadcastDto broadcast_dto;
-        broadcast_dto.device_info = DeviceInfo::LocalDeviceInfo();
-        broadcast_dto.fingerprint = cert_manager_.security_context().certificate_hash;
-        std::string data = json(broadcast_dto).dump();
+            spdlog::debug("Discovery on {} ({}, {} Mbps)",
+                          network_interface.name,
+                          network_interface.address,
+                          network_interface.link_speed_mbps);
+            interface_sockets_.push_back(std::make_shared<InterfaceSocket>(InterfaceSocket{
+                .network_interface = std::move(network_interface),
+                .network = network,
+                .socket = std::move(socket),
+                .announce_endpoint = announce_endpoint,
+            }));
+        } catch (const std::exception& e) {
+            spdlog::warn("Failed to open discovery socket on {}: {}",
+                         network_interface.name,
+                         e.what());
+        }
+    }
+}
 
-        while (broadcast_socket_.is_open()) {
-            spdlog::info("start to broadcast device info every 3 seconds...");
+std::shared_ptr<DiscoveryManager::InterfaceSocket> DiscoveryManager::interfaceSocketFor(
+    const ip::address& peer) const {
+    for (const auto& entry : interface_sockets_) {
+        if (peer.is_v4()
+            && ip::network_v4(peer.to_v4(), entry->network.prefix_length()).canonical()
+                   == entry->network.canonical()) {
+            return entry;
+        }
+    }
+    return interface_sockets_.empty() ? nullptr : interface_sockets_.front();
+}
 
-            co_await broadcast_socket_.async_send_to(buffer(data),
-                                                     broadcast_endpoint,
-                                                     use_awaitable);
+awaitable<void> DiscoveryManager::announce(BroadcastType type) {
+    std::string data = beaconData(type);
+    // A copy, NotifyLocalInfoChanged() may replace the sockets while we are sending
+    auto sockets = interface_sockets_;
+    for (const auto& entry : sockets) {
+        boost::system::error_code ec;
+        co_await entry->socket.async_send_to(buffer(data),
+                                             entry->announce_endpoint,
+                                             redirect_error(use_awaitable, ec));
+        if (ec && ec != error::operation_aborted) {
+            spdlog::debug("Failed to send beacon on {}: {}",
+                          entry->network_interface.name,
+                          ec.message());
+        }
+    }
+}
 
-            co_await broadcast_timer_.async_wait(use_awaitable);
-            broadcast_timer_.expires_after(std::chrono::seconds(3)); // 每 3 秒广播一次
+void DiscoveryManager::removeFingerprints(const DeviceInfo& device) {
+    // Other addresses only were registered for this device if no one else held them
+    auto fingerprint = cert_manager_.GetDeviceFingerprint(device.ip_address, device.port);
+    for (const auto& address : device.addresses) {
+        if (address.ip_address != device.ip_address
+            && cert_manager_.GetDeviceFingerprint(address.ip_address, device.port) == fingerprint) {
+            cert_manager_.RemoveDeviceFingerprint(address.ip_address, device.port);
+        }
+    }
+    cert_manager_.RemoveDeviceFingerprint(device.ip_address, device.port);
+}
+
+bool DiscoveryManager::refreshLocalInfo() {
+    // 与 /device-info 返回的内容相同
+    BroadcastDto broadcast_dto;
+    broadcast_dto.device_info = DeviceInfo::LocalDeviceInfo();
+    broadcast_dto.fingerprint = cert_manager_.security_context().certificate_hash;
+    broadcast_dto.previous_fingerprint = cert_manager_.security_context().previous_certificate_hash;
+    std::string info = json(broadcast_dto).dump();
+    if (info == local_info_) {
+        return false;
+    }
+    local_info_ = std::move(info);
+    ++info_version_;
+    return true;
+}
+
+awaitable<void> DiscoveryManager::broadcaster() {
+    try {
+        refreshLocalInfo();
+        // A newcomer asks once, peers answer right away instead of at their next beacon
+        co_await announce(BroadcastType::kQuery);
+
+        while (listen_socket_.is_open()) {
+            co_await announce(BroadcastType::kAnnounce);
+            spdlog::debug("Announced device info version {}, next beacon in {}ms",
+                          info_version_.load(),
+                          std::chrono::duration_cast<std::chrono::milliseconds>(beacon_interval_)
+                              .count());
+
+            // NotifyLocalInfoChanged() cuts the wait short and starts over at the minimum
+            broadcast_timer_.expires_after(beacon_interval_);
+            beacon_interval_ = std::min<std::chrono::steady_clock::duration>(
+                beacon_interval_ * 2,
+                discovery::kMaxBeaconInterval);
+            boost::system::error_code ec;
+            co_await broadcast_timer_.async_wait(redirect_error(use_awaitable, ec));
         }
     } catch (const std::exception& e) {
         spdlog::error("Error in broadcaster: {}", e.what());
     }
 }
 
-std::string DiscoveryManager::generateDeviceId() {
-    auto now = std::chrono::system_clock::now();
+awaitable<void> DiscoveryManager::answerQuery(ip::udp::endpoint querier) {
+    try {
+        // Jittered, so the peers answering one query do not all reply at the same instant
+        std::uniform_int_distribution<int> jitter_ms(0, discovery::kMaxReplyJitter.count());
+        steady_timer jitter(strand_, std::chrono::milliseconds(jitter_ms(rng_)));
+        co_await jitter.async_wait(use_awaitable);
+        // Sent from the interface facing the querier, it learns that address of ours
+        auto entry = interfaceSocketFor(querier.address());
+        if (!listen_socket_.is_open() || !entry) {
+            co_return;
+        }
+        co_await entry->socket.async_send_to(buffer(beaconData(BroadcastType::kAnnounce)),
+                                             querier,
+                                             use_awaitable);
+    } catch (const std::exception& e) {
+        spdlog::debug("Failed to answer discovery query from {}: {}",
+                      querier.address().to_string(),
+                      e.what());
+    }
+}
 
-    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch())
-                         .count();
+awaitable<void> DiscoveryManager::fetchDeviceInfo(ip::address address, Beacon beacon) {
+    std::string ip = address.to_string();
+    try {
+        // A device that changed its certificate presents the new one, whose digest the beacon
+        // already carries. Only this fetch accepts it, the pin stays until the fetch succeeds.
+        std::string replacement;
+        HttpsClient client(io_context_, cert_manager_);
+        client.AcceptReplacementCertificate(
+            [&replacement, digest = beacon.fingerprint_digest](const std::string& fingerprint) {
+                if (FingerprintDigest(fingerprint) != digest) {
+                    return false;
+                }
+                replacement = fingerprint;
+                return true;
+            });
+        if (!co_await client.Connect(ip, beacon.port)) {
+            throw std::runtime_error("connection error");
+        }
+        auto req = client.CreateRequest<http::string_body>(http::verb::get,
+                                                           ApiRoute::kDeviceInfo.data(),
+                                                           false);
+        req.prepare_payload();
+        auto res = co_await client.SendRequest(req);
+        co_await client.Disconnect();
+        if (res.result() != http::status::ok) {
+            throw std::runtime_error(res.body());
+        }
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(1000, 9999);
-    int randomNum = dis(gen);
+        BroadcastDto broadcast_dto;
+        nlohmann::from_json(json::parse(res.body()), broadcast_dto);
+        if (broadcast_dto.device_info.device_id != beacon.device_id
+            || FingerprintDigest(broadcast_dto.fingerprint) != beacon.fingerprint_digest) {
+            throw std::runtime_error("device info does not match the beacon");
+        }
+        if (!replacement.empty() && broadcast_dto.fingerprint != replacement) {
+            throw std::runtime_error("device info does not match the certificate");
+        }
+
+        DeviceInfo device = std::move(broadcast_dto.device_info);
+        device.ip_address = ip;
+        device.port = beacon.port;
+        cert_manager_.RegisterDeviceFingerprint(ip,
+                                                beacon.port,
+                                                broadcast_dto.fingerprint,
+                                                broadcast_dto.previous_fingerprint);
+        // The device's other interfaces are candidates when sending to it. They are pinned to
+        // the same certificate, unless another device already is known at that address.
+        for (const auto& address : device.addresses) {
+            if (address.ip_address != ip
+                && !cert_manager_.GetDeviceFingerprint(address.ip_address, beacon.port)) {
+                cert_manager_.RegisterDeviceFingerprint(address.ip_address,
+                                                        beacon.port,
+                                                        broadcast_dto.fingerprint,
+                                                        broadcast_dto.previous_fingerprint);
+            }
+        }
+        AddDevice(device, beacon.info_version);
+        spdlog::debug("Fetched device info version {} of {} from {}:{}",
+                      beacon.info_version,
+                      beacon.device_id,
+                      ip,
+                      beacon.port);
+    } catch (const std::exception& e) {
+        // Retried on the device's next beacon
+        spdlog::warn("Failed to fetch device info from {}:{}: {}", ip, beacon.port, e.what());
+    }
+    pending_fetches_.erase(beacon.device_id);
+}
 
-    return std::to_string(timestamp) + "_" + std::to_string(randomNum);
+void DiscoveryManager::handleJsonBeacon(std::string_view data, const ip::udp::endpoint& sender) {
+    // Beacons of versions before the binary format carry the full device info
+    try {
+        BroadcastDto broadcast_dto;
+        nlohmann::from_json(json::parse(data), broadcast_dto);
+        DeviceInfo device = std::move(broadcast_dto.device_info);
+        if (device.device_id == device_id_) {
+            return;
+        }
+        if (broadcast_dto.type == BroadcastType::kGoodbye) {
+            RemoveDevice(device.device_id);
+            return;
+        }
+        device.ip_address = sender.address().to_string();
+        cert_manager_.RegisterDeviceFingerprint(device.ip_address,
+                                                device.port,
+                                                broadcast_dto.fingerprint,
+                                                broadcast_dto.previous_fingerprint);
+        AddDevice(device);
+    } catch (const json::exception& e) {
+        spdlog::error("Error parsing discovery message: {}", e.what());
+    }
 }
 
 awaitable<void> DiscoveryManager::listener() {
@@ -182,33 +458,45 @@ awaitable<void> DiscoveryManager::listener() {
                                                                                sender_endpoint,
                                                                                use_awaitable);
 
-            std::string data(recv_buffer.data(), bytes_received);
+            std::string_view data(recv_buffer.data(), bytes_received);
+            auto beacon = DecodeBeacon(data);
+            if (!beacon) {
+                handleJsonBeacon(data, sender_endpoint);
+                continue;
+            }
 
-            try {
-                json broadcast_json = json::parse(data);
-                BroadcastDto broadcast_dto;
-                nlohmann::from_json(broadcast_json, broadcast_dto);
-                DeviceInfo device = broadcast_dto.device_info;
+            // 判断是否是自己的设备，若是则跳过后续处理
+            if (beacon->device_id == device_id_) {
+                spdlog::trace("Received message from self, skipping...");
+                continue;
+            }
 
-                // 判断是否是自己的设备，若是则跳过后续处理
-                if (device.device_id == device_id_) {
-                    spdlog::info("Received message from self, skipping...");
-                    // std::cout << "Received message from self, skipping..." << std::endl;
-                    continue;
-                }
+            if (beacon->type == BroadcastType::kGoodbye) {
+                spdlog::info("Device {} said goodbye", beacon->device_id);
+                RemoveDevice(beacon->device_id);
+                continue;
+            }
 
-                // 登记设备指纹
-                cert_manager_.RegisterDeviceFingerprint(sender_endpoint.address().to_string(),
-                                                        sender_endpoint.port(),
-                                                        broadcast_dto.fingerprint);
-
-                // 添加设备到已发现设备列表
-                AddDevice(device);
-                spdlog::info("Received device info from {}:{}",
-                             sender_endpoint.address().to_string(),
-                             sender_endpoint.port());
-            } catch (const json::parse_error& e) {
-                spdlog::error("Error parsing JSON data: {}", e.what());
+            if (beacon->type == BroadcastType::kQuery) {
+                // Answered on the querier's listen port, the query came from its sending socket
+                co_spawn(strand_,
+                         answerQuery(ip::udp::endpoint(sender_endpoint.address(), port_)),
+                         detached);
+            }
+
+            // The common case: a known device whose info did not change, only its expiry moves
+            bool up_to_date;
+            {
+                std::lock_guard<std::mutex> lock(devices_mutex_);
+                up_to_date = registry_.Refresh(beacon->device_id,
+                                               beacon->info_version,
+                                               std::chrono::steady_clock::now()
+                                                   + discovery::kDeviceTimeout);
+            }
+            if (!up_to_date && pending_fetches_.insert(beacon->device_id).second) {
+                co_spawn(strand_,
+                         fetchDeviceInfo(sender_endpoint.address(), std::move(*beacon)),
+                         detached);
             }
         }
     } catch (const std::exception& e) {
@@ -218,25 +506,24 @@ awaitable<void> DiscoveryManager::listener() {
 
 awaitable<void> DiscoveryManager::cleanupDevices() {
     try {
-        const auto timeout_duration = std::chrono::seconds(10); // 设备超时时间
-        const auto cleanup_interval = std::chrono::seconds(5);  // 清理间隔
-
         while (listen_socket_.is_open()) {
-            co_await cleanup_timer_.async_wait(use_awaitable);
-            cleanup_timer_.expires_after(cleanup_interval);
-
-            // std::lock_guard<std::mutex> lock(devices_mutex_);
-            for (auto& [device_id, device_entry] : discovered_devices_) {
-                if (std::chrono::system_clock::now() - device_entry.last_seen > timeout_duration) {
-                    if (device_lost_callback_) {
-                        device_lost_callback_(device_id);
-                    }
-
-                    cert_manager_.RemoveDeviceFingerprint(device_entry.device.ip_address,
-                                                          device_entry.device.port);
+            // Sleep until the earliest deadline instead of scanning every device periodically.
+            // A device added meanwhile expires later than a full timeout from now.
+            {
+                std::lock_guard<std::mutex> lock(devices_mutex_);
+                auto next_expiry = registry_.NextExpiry();
+                cleanup_timer_.expires_at(next_expiry.value_or(std::chrono::steady_clock::now()
+                                                               + discovery::kDeviceTimeout));
+            }
+            boost::system::error_code ec;
+            co_await cleanup_timer_.async_wait(redirect_error(use_awaitable, ec));
 
-                    discovered_devices_.erase(device_id);
+            std::lock_guard<std::mutex> lock(devices_mutex_);
+            for (const auto& device : registry_.Expire(std::chrono::steady_clock::now())) {
+                if (device_lost_callback_) {
+                    device_lost_callback_(device.device_id);
                 }
+                removeFingerprints(device);
             }
         }
     } catch (const std::exception& e) {
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <boost/endian/conversion.hpp>
+#include <core/network/mux/frame.h>
+
+namespace lansend::core {
+
+std::vector<std::uint8_t> EncodeFrame(FrameType type,
+                                      std::uint8_t flags,
+                                      std::uint32_t stream_id,
+                                      std::span<const std::uint8_t> payload) {
+    std::vector<std::uint8_t> frame(mux::kFrameHeaderSize + payload.size());
+    boost::endian::store_big_u32(frame.data(), static_cast<std::uint32_t>(payload.size()));
+    frame[4] = static_cast<std::uint8_t>(type);
+    frame[5] = flags;
+    boost::endian::store_big_u32(frame.data() + 6, stream_id);
+    std::copy(payload.begin(), payload.end(), frame.begin() + mux::kFrameHeaderSize);
+    return frame;
+}
+
+std::optional<FrameHeader> DecodeFrameHeader(
+    std::span<const std::uint8_t, mux::kFrameHeaderSize> bytes) {
+    FrameHeader header;
+    header.length = boost::endian::load_big_u32(bytes.data());
+    header.type = static_cast<FrameType>(bytes[4]);
+    header.flags = bytes[5];
+    header.stream_id = boost::endian::load_big_u32(bytes.data() + 6);
+
+    std::size_t limit = 0;
+    switch (header.type) {
+    case FrameType::kData:
+        limit = mux::kMaxDataFrameSize;
+        break;
+    case FrameType::kHeaders:
+    case FrameType::kAck:
+        limit = mux::kMaxControlFrameSize;
+        break;
+    case FrameType::kWindowUpdate:
+        limit = 4;
+        break;
+    case FrameType::kCancel:
+        limit = 1;
+        break;
+    default:
+        return std::nullopt;
+    }
+    if (header.length > limit) {
+        return std::nullopt;
+    }
+    return header;
+}
+
+std::vector<std::uint8_t> EncodeWindowUpdate(std::uint32_t stream_id, std::uint32_t increment) {
+    std::uint8_t payload[4];
+    boost::endian::store_big_u32(payload, increment);
+    return EncodeFrame(FrameType::kWindowUpdate, 0, stream_id, payload);
+}
+
+std::optional<std::uint32_t> DecodeWindowUpdate(std::span<const std::uint8_t> payload) {
+    if (payload.size() != 4) {
+        return std::nullopt;
+    }
+    return boost::endian::load_big_u32(payload.data());
+}
+
+std::vector<std::uint8_t> EncodeCancel(std::uint32_t stream_id, CancelCode code) {
+    std::uint8_t payload[1]{static_cast<std::uint8_t>(code)};
+    return EncodeFrame(FrameType::kCancel, 0, stream_id, payload);
+}
+
+} // namespace lansend::core
@@ -0,0 +1,529 @@
+#include <algorithm>
+#include <boost/asio/cancellation_type.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+#include <core/network/mux/mux_connection.h>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+namespace lansend::core {
+
+static constexpr std::size_t kReadSize = 64 * 1024;
+
+static boost::system::system_error ProtocolError(const char* what) {
+    return boost::system::system_error(
+        boost::system::errc::make_error_code(boost::system::errc::protocol_error),
+        what);
+}
+
+MuxStream::MuxStream(std::shared_ptr<MuxConnection> connection, std::uint32_t id)
+    : connection_(std::move(connection))
+    , id_(id)
+    , recv_credit_(mux::kStreamWindow)
+    , send_credit_(mux::kStreamWindow) {}
+
+void MuxStream::throwIfAborted() const {
+    if (cancelled_) {
+        throw boost::system::system_error(net::error::operation_aborted);
+    }
+    if (connection_->closed_) {
+        throw boost::system::system_error(connection_->error_ ? connection_->error_
+                                                              : net::error::connection_aborted);
+    }
+}
+
+net::awaitable<std::size_t> MuxStream::ReadSome(std::span<std::uint8_t> out) {
+    while (inbound_.empty()) {
+        throwIfAborted();
+        if (remote_done_) {
+            co_return 0;
+        }
+        co_await connection_->wait();
+    }
+    throwIfAborted();
+
+    std::size_t filled = 0;
+    while (filled < out.size() && !inbound_.empty()) {
+        const auto& piece = inbound_.front();
+        std::size_t n = std::min(out.size() - filled, piece.size() - inbound_offset_);
+        std::copy_n(piece.data() + inbound_offset_, n, out.data() + filled);
+        filled += n;
+        inbound_offset_ += n;
+        if (inbound_offset_ == piece.size()) {
+            inbound_.pop_front();
+            inbound_offset_ = 0;
+        }
+    }
+    inbound_bytes_ -= filled;
+    connection_->consumed(*this, filled);
+    co_return filled;
+}
+
+net::awaitable<std::vector<std::uint8_t>> MuxStream::ReadAll(std::size_t limit,
+                                                             std::size_t padding) {
+    std::vector<std::uint8_t> body;
+    if (content_length_) {
+        if (*content_length_ > limit) {
+            throw std::runtime_error("Request body too large");
+        }
+        body.reserve(*content_length_ + padding);
+    }
+    while (true) {
+        throwIfAborted();
+        if (inbound_.empty()) {
+            if (remote_done_) {
+                break;
+            }
+            co_await connection_->wait();
+            continue;
+        }
+        auto piece = std::move(inbound_.front());
+        inbound_.pop_front();
+        std::size_t n = piece.size() - inbound_offset_;
+        if (body.size() + n > limit) {
+            throw std::runtime_error("Request body too large");
+        }
+        body.insert(body.end(), piece.begin() + inbound_offset_, piece.end());
+        inbound_offset_ = 0;
+        inbound_bytes_ -= n;
+        connection_->consumed(*this, n);
+    }
+    co_return body;
+}
+
+net::awaitable<void> MuxStream::Write(std::span<const std::uint8_t> data, bool end_stream) {
+    if (data.empty() && !end_stream) {
+        co_return;
+    }
+    while (!local_done_) {
+        throwIfAborted();
+        if (response_) {
+            co_return;
+        }
+        std::size_t credit = std::min(send_credit_, connection_->send_credit_);
+        if ((credit == 0 && !data.empty())
+            || queued_frames_ >= mux::kMaxQueuedFramesPerStream) {
+            co_await connection_->wait();
+            continue;
+        }
+
+        std::size_t n = std::min({data.size(), credit, mux::kMaxDataFrameSize});
+        bool last = end_stream && n == data.size();
+        send_credit_ -= n;
+        connection_->send_credit_ -= n;
+        connection_->queueData(*this,
+                               EncodeFrame(FrameType::kData,
+                                           last ? FrameFlag::kEndStream : 0,
+                                           id_,
+                                           data.first(n)));
+        data = data.subspan(n);
+        if (last) {
+            local_done_ = true;
+        } else if (data.empty()) {
+            co_return;
+        }
+    }
+}
+
+void MuxStream::Respond(const Response& res) {
+    if (cancelled_ || !connection_->IsOpen()) {
+        return;
+    }
+    std::ostringstream out;
+    out << res;
+    auto bytes = std::move(out).str();
+    if (bytes.size() > mux::kMaxControlFrameSize) {
+        Cancel(CancelCode::kProtocolError);
+        return;
+    }
+    connection_->queueControl(
+        EncodeFrame(FrameType::kAck,
+                    0,
+                    id_,
+                    {reinterpret_cast<const std::uint8_t*>(bytes.data()), bytes.size()}));
+    connection_->removeStream(id_);
+}
+
+net::awaitable<MuxStream::Response> MuxStream::ReadResponse() {
+    while (!response_) {
+        throwIfAborted();
+        co_await connection_->wait();
+    }
+
+    http::response_parser<http::string_body> parser;
+    parser.eager(true);
+    parser.body_limit(mux::kMaxControlFrameSize);
+    beast::error_code ec;
+    auto buffer = net::buffer(*response_);
+    while (buffer.size() > 0 && !parser.is_done()) {
+        std::size_t used = parser.put(buffer, ec);
+        if (ec || used == 0) {
+            break;
+        }
+        buffer += used;
+    }
+    if (!ec && !parser.is_done()) {
+        parser.put_eof(ec);
+    }
+    if (ec) {
+        throw beast::system_error(ec);
+    }
+    co_return parser.release();
+}
+
+void MuxStream::Cancel(CancelCode code) {
+    if (cancelled_ || response_) {
+        return;
+    }
+    cancelled_ = true;
+    if (connection_->IsOpen()) {
+        connection_->queueControl(EncodeCancel(id_, code));
+    }
+    connection_->removeStream(id_);
+}
+
+MuxConnection::MuxConnection(Stream& stream,
+                             bool client,
+                             std::span<const std::uint8_t> leftover,
+                             std::shared_ptr<void> owner)
+    : stream_(stream)
+    , owner_(std::move(owner))
+    , executor_(stream.get_executor())
+    , client_(client)
+    , changed_(stream.get_executor(), net::steady_timer::time_point::max()) {
+    net::buffer_copy(read_buffer_.prepare(leftover.size()),
+                     net::buffer(leftover.data(), leftover.size()));
+    read_buffer_.commit(leftover.size());
+}
+
+net::awaitable<void> MuxConnection::Run(StreamHandler handler) {
+    auto self = shared_from_this();
+    executor_ = co_await net::this_coro::executor;
+    handler_ = std::move(handler);
+
+    // Run outlives the writer, it waits for it below
+    writer_running_ = true;
+    net::co_spawn(executor_, writeLoop(), net::detached);
+    try {
+        co_await readLoop();
+    } catch (const boost::system::system_error& e) {
+        fail(e.code());
+    } catch (const std::exception&) {
+        fail(boost::system::errc::make_error_code(boost::system::errc::protocol_error));
+    }
+    while (writer_running_) {
+        co_await wait();
+    }
+
+    handler_ = nullptr;
+    stopped_ = true;
+    notify();
+    if (error_ && error_ != net::error::operation_aborted) {
+        throw boost::system::system_error(error_);
+    }
+}
+
+net::awaitable<MuxStream::Response> MuxConnection::SendRequest(
+    std::string head,
+    std::span<const std::uint8_t> body) {
+    auto stream = co_await openStream(std::move(head), body.empty());
+    try {
+        co_await stream->Write(body, true);
+        co_return co_await stream->ReadResponse();
+    } catch (...) {
+        stream->Cancel();
+        throw;
+    }
+}
+
+void MuxConnection::Close() {
+    fail(net::error::operation_aborted);
+}
+
+net::awaitable<void> MuxConnection::WaitStopped() {
+    while (!stopped_) {
+        co_await wait();
+    }
+}
+
+net::awaitable<void> MuxConnection::readLoop() {
+    while (!closed_) {
+        co_await fill(mux::kFrameHeaderSize);
+        auto header = DecodeFrameHeader(std::span<const std::uint8_t, mux::kFrameHeaderSize>(
+            static_cast<const std::uint8_t*>(read_buffer_.data().data()),
+            mux::kFrameHeaderSize));
+        if (!header) {
+            throw ProtocolError("Malformed frame header");
+        }
+
+        std::size_t frame_size = mux::kFrameHeaderSize + header->length;
+        co_await fill(frame_size);
+        const auto* frame = static_cast<const std::uint8_t*>(read_buffer_.data().data());
+        onFrame(*header, {frame + mux::kFrameHeaderSize, header->length});
+        read_buffer_.consume(frame_size);
+    }
+}
+
+net::awaitable<void> MuxConnection::writeLoop() {
+    std::vector<std::vector<std::uint8_t>> batch;
+    std::vector<net::const_buffer> buffers;
+    try {
+        while (!closed_) {
+            if (control_queue_.empty() && data_queue_.empty()) {
+                co_await wait();
+                continue;
+            }
+
+            // Control frames first, a response or a credit update never waits behind data
+            batch.clear();
+            std::size_t bytes = 0;
+            while (!control_queue_.empty() && bytes < mux::kMaxWriteBatch) {
+                bytes += control_queue_.front().size();
+                batch.push_back(std::move(control_queue_.front()));
+                control_queue_.pop_front();
+            }
+            while (!data_queue_.empty() && bytes < mux::kMaxWriteBatch) {
+                auto& [stream_id, frame] = data_queue_.front();
+                if (auto it = streams_.find(stream_id); it != streams_.end()) {
+                    --it->second->queued_frames_;
+                    bytes += frame.size();
+                    batch.push_back(std::move(frame));
+                } else {
+                    // The stream was cancelled or answered, the peer reads no more of it. Its
+                    // credit is never handed back for bytes that are not sent.
+                    send_credit_ += frame.size() - mux::kFrameHeaderSize;
+                }
+                data_queue_.pop_front();
+            }
+            // Streams waiting for room in the queue refill it while this batch is written
+            notify();
+
+            buffers.clear();
+            for (const auto& frame : batch) {
+                buffers.push_back(net::buffer(frame));
+            }
+            beast::get_lowest_layer(stream_).expires_after(mux::kIdleTimeout);
+            co_await net::async_write(stream_, buffers, net::use_awaitable);
+        }
+    } catch (const boost::system::system_error& e) {
+        fail(e.code());
+    }
+    writer_running_ = false;
+    notify();
+}
+
+net::awaitable<void> MuxConnection::fill(std::size_t size) {
+    while (read_buffer_.size() < size) {
+        beast::get_lowest_layer(stream_).expires_after(mux::kIdleTimeout);
+        auto buffer = read_buffer_.prepare(std::max(size - read_buffer_.size(), kReadSize));
+        std::size_t n = co_await stream_.async_read_some(buffer, net::use_awaitable);
+        read_buffer_.commit(n);
+    }
+}
+
+void MuxConnection::onFrame(const FrameHeader& header, std::span<const std::uint8_t> payload) {
+    switch (header.type) {
+    case FrameType::kHeaders:
+        onHeaders(header, payload);
+        break;
+    case FrameType::kData:
+        onData(header, payload);
+        break;
+    case FrameType::kAck: {
+        if (!client_) {
+            throw ProtocolError("Response sent to the server");
+        }
+        // The stream may have been cancelled meanwhile
+        if (auto it = streams_.find(header.stream_id); it != streams_.end()) {
+            it->second->response_.emplace(payload.begin(), payload.end());
+            removeStream(header.stream_id);
+        }
+        break;
+    }
+    case FrameType::kWindowUpdate: {
+        auto increment = DecodeWindowUpdate(payload);
+        if (!increment) {
+            throw ProtocolError("Malformed window update");
+        }
+        if (header.stream_id == 0) {
+            send_credit_ += *increment;
+        } else if (auto it = streams_.find(header.stream_id); it != streams_.end()) {
+            it->second->send_credit_ += *increment;
+        }
+        notify();
+        break;
+    }
+    case FrameType::kCancel:
+        if (auto it = streams_.find(header.stream_id); it != streams_.end()) {
+            it->second->cancelled_ = true;
+            removeStream(header.stream_id);
+        }
+        break;
+    }
+}
+
+void MuxConnection::onHeaders(const FrameHeader& header, std::span<const std::uint8_t> payload) {
+    if (client_ || header.stream_id % 2 == 0 || header.stream_id <= last_peer_stream_id_) {
+        throw ProtocolError("Unexpected stream id");
+    }
+    last_peer_stream_id_ = header.stream_id;
+    if (streams_.size() >= mux::kMaxConcurrentStreams) {
+        queueControl(EncodeCancel(header.stream_id, CancelCode::kRefused));
+        return;
+    }
+
+    // The head is parsed as HTTP/1.1, the body arrives in DATA frames. Routes limit its size.
+    http::request_parser<http::empty_body> parser;
+    parser.body_limit(std::numeric_limits<std::uint64_t>::max());
+    beast::error_code ec;
+    parser.put(net::buffer(payload.data(), payload.size()), ec);
+    if (ec || !parser.is_header_done()) {
+        queueControl(EncodeCancel(header.stream_id, CancelCode::kProtocolError));
+        return;
+    }
+
+    auto stream = std::make_shared<MuxStream>(shared_from_this(), header.stream_id);
+    if (auto length = parser.content_length(); length) {
+        stream->content_length_ = *length;
+    }
+    stream->request_ = parser.release();
+    stream->remote_done_ = (header.flags & FrameFlag::kEndStream) != 0;
+    streams_.emplace(header.stream_id, stream);
+    net::co_spawn(executor_, handler_(std::move(stream)), net::detached);
+}
+
+void MuxConnection::onData(const FrameHeader& header, std::span<const std::uint8_t> payload) {
+    if (payload.size() > recv_credit_) {
+        throw ProtocolError("Connection credit exceeded");
+    }
+    recv_credit_ -= payload.size();
+
+    auto it = streams_.find(header.stream_id);
+    if (it == streams_.end()) {
+        // Sent before the peer learnt the stream ended, dropped and credited right away
+        returnCredit(payload.size());
+        return;
+    }
+    auto& stream = *it->second;
+    if (stream.remote_done_ || payload.size() > stream.recv_credit_) {
+        throw ProtocolError("Stream credit exceeded");
+    }
+    stream.recv_credit_ -= payload.size();
+    if (!payload.empty()) {
+        stream.inbound_.emplace_back(payload.begin(), payload.end());
+        stream.inbound_bytes_ += payload.size();
+    }
+    stream.remote_done_ = (header.flags & FrameFlag::kEndStream) != 0;
+    notify();
+}
+
+net::awaitable<std::shared_ptr<MuxStream>> MuxConnection::openStream(std::string head,
+                                                                     bool end_stream) {
+    while (!closed_ && streams_.size() >= mux::kMaxConcurrentStreams) {
+        co_await wait();
+    }
+    if (closed_) {
+        throw boost::system::system_error(error_ ? error_ : net::error::connection_aborted);
+    }
+
+    std::uint32_t id = next_stream_id_;
+    next_stream_id_ += 2;
+    auto stream = std::make_shared<MuxStream>(shared_from_this(), id);
+    stream->local_done_ = end_stream;
+    streams_.emplace(id, stream);
+    queueControl(EncodeFrame(FrameType::kHeaders,
+                             end_stream ? FrameFlag::kEndStream : 0,
+                             id,
+                             {reinterpret_cast<const std::uint8_t*>(head.data()), head.size()}));
+    co_return stream;
+}
+
+void MuxConnection::removeStream(std::uint32_t id) {
+    auto it = streams_.find(id);
+    if (it == streams_.end()) {
+        return;
+    }
+    auto stream = std::move(it->second);
+    streams_.erase(it);
+    if (stream->inbound_bytes_ > 0) {
+        returnCredit(stream->inbound_bytes_);
+        stream->inbound_.clear();
+        stream->inbound_offset_ = 0;
+        stream->inbound_bytes_ = 0;
+    }
+    notify();
+}
+
+void MuxConnection::consumed(MuxStream& stream, std::size_t bytes) {
+    stream.unacked_consumed_ += bytes;
+    if (!stream.remote_done_ && stream.unacked_consumed_ >= mux::kStreamWindow / 2) {
+        queueControl(EncodeWindowUpdate(stream.id_,
+                                        static_cast<std::uint32_t>(stream.unacked_consumed_)));
+        stream.recv_credit_ += stream.unacked_consumed_;
+        stream.unacked_consumed_ = 0;
+    }
+    returnCredit(bytes);
+}
+
+void MuxConnection::returnCredit(std::size_t bytes) {
+    unacked_consumed_ += bytes;
+    if (unacked_consumed_ >= mux::kConnectionWindow / 2) {
+        queueControl(EncodeWindowUpdate(0, static_cast<std::uint32_t>(unacked_consumed_)));
+        recv_credit_ += unacked_consumed_;
+        unacked_consumed_ = 0;
+    }
+}
+
+void MuxConnection::queueControl(std::vector<std::uint8_t> frame) {
+    if (closed_) {
+        return;
+    }
+    control_queue_.push_back(std::move(frame));
+    notify();
+}
+
+void MuxConnection::queueData(MuxStream& stream, std::vector<std::uint8_t> frame) {
+    if (closed_) {
+        return;
+    }
+    ++stream.queued_frames_;
+    data_queue_.emplace_back(stream.id_, std::move(frame));
+    notify();
+}
+
+void MuxConnection::fail(boost::system::error_code ec) {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    error_ = ec;
+
+    // Wakes the reader and the writer, every stream fails on its next call
+    boost::system::error_code ignored;
+    beast::get_lowest_layer(stream_).socket().cancel(ignored);
+    streams_.clear();
+    control_queue_.clear();
+    data_queue_.clear();
+    notify();
+}
+
+net::awaitable<void> MuxConnection::wait() {
+    boost::system::error_code ec;
+    co_await changed_.async_wait(net::redirect_error(net::use_awaitable, ec));
+    // The timer is cancelled to wake waiters, only the coroutine's state tells an abort apart
+    auto state = co_await net::this_coro::cancellation_state;
+    if (state.cancelled() != net::cancellation_type::none) {
+        throw boost::system::system_error(net::error::operation_aborted);
+    }
+}
+
+} // namespace lansend::core
@@ -0,0 +1,147 @@
+#include <array>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <core/network/network_monitor.h>
+#include <core/util/system.h>
+#include <spdlog/spdlog.h>
+#ifdef __linux__
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace net = boost::asio;
+
+namespace lansend::core {
+
+// Both run, a change of either one is announced
+static bool RefreshLocalAddresses() {
+    bool public_address_changed = system::RefreshPublicIpv4Address();
+    bool interfaces_changed = system::RefreshNetworkInterfaces();
+    return public_address_changed || interfaces_changed;
+}
+
+NetworkMonitor::NetworkMonitor(net::io_context& ioc)
+    : strand_(net::make_strand(ioc))
+    , timer_(strand_)
+#ifdef __linux__
+    , netlink_socket_(strand_)
+#endif
+{
+}
+
+void NetworkMonitor::SetChangeCallback(ChangeCallback callback) {
+    callback_ = std::move(callback);
+}
+
+void NetworkMonitor::Start() {
+    net::post(strand_, [this]() {
+        if (running_) {
+            return;
+        }
+        running_ = true;
+#ifdef __linux__
+        // Address, link and route changes all may move the default route to another interface
+        int fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        sockaddr_nl address{};
+        address.nl_family = AF_NETLINK;
+        address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR
+                            | RTMGRP_IPV4_ROUTE;
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            spdlog::warn("Failed to open netlink socket, polling the local address instead");
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        } else {
+            netlink_socket_.assign(net::generic::raw_protocol(AF_NETLINK, NETLINK_ROUTE), fd);
+        }
+#endif
+        net::co_spawn(strand_, watch(), net::detached);
+    });
+}
+
+void NetworkMonitor::Stop() {
+    net::post(strand_, [this]() {
+        running_ = false;
+        timer_.cancel();
+#ifdef __linux__
+        boost::system::error_code ec;
+        netlink_socket_.close(ec);
+#endif
+    });
+}
+
+net::awaitable<void> NetworkMonitor::watch() {
+#ifdef __linux__
+    if (netlink_socket_.is_open()) {
+        std::array<char, 8192> buffer;
+        while (running_) {
+            boost::system::error_code ec;
+            std::size_t size = co_await netlink_socket_.async_receive(
+                net::buffer(buffer),
+                net::redirect_error(net::use_awaitable, ec));
+            if (ec) {
+                if (ec != net::error::operation_aborted) {
+                    spdlog::warn("Netlink monitor stopped: {}", ec.message());
+                }
+                co_return;
+            }
+
+            bool interfaces_changed = false;
+            int remaining = static_cast<int>(size);
+            for (auto* header = reinterpret_cast<nlmsghdr*>(buffer.data());
+                 NLMSG_OK(header, remaining);
+                 header = NLMSG_NEXT(header, remaining)) {
+                switch (header->nlmsg_type) {
+                case RTM_NEWADDR:
+                case RTM_DELADDR:
+                case RTM_NEWLINK:
+                case RTM_DELLINK:
+                case RTM_NEWROUTE:
+                case RTM_DELROUTE:
+                    interfaces_changed = true;
+                    break;
+                default:
+                    break;
+                }
+            }
+            if (interfaces_changed && !refresh_scheduled_) {
+                refresh_scheduled_ = true;
+                net::co_spawn(strand_, refreshSoon(), net::detached);
+            }
+        }
+        co_return;
+    }
+#endif
+    while (running_) {
+        timer_.expires_after(kPollInterval);
+        boost::system::error_code ec;
+        co_await timer_.async_wait(net::redirect_error(net::use_awaitable, ec));
+        if (!running_) {
+            break;
+        }
+        if (RefreshLocalAddresses() && callback_) {
+            callback_();
+        }
+    }
+}
+
+net::awaitable<void> NetworkMonitor::refreshSoon() {
+    timer_.expires_after(kSettleDelay);
+    boost::system::error_code ec;
+    co_await timer_.async_wait(net::redirect_error(net::use_awaitable, ec));
+    refresh_scheduled_ = false;
+    if (!running_) {
+        co_return;
+    }
+    // Probes the routing table with a UDP connect and lists the interfaces, once per settled
+    // change
+    if (RefreshLocalAddresses() && callback_) {
+        callback_();
+    }
+}
+
+} // namespace lansend::core
@@ -1,4 +1,5 @@
 #include "core/model/device_info.h"
+#include "core/model/dto/broadcast_dto.h"
 #include "core/model/feedback.h"
 #include <boost/beast/http/string_body_fwd.hpp>
 #include <core/constant/route.h>
@@ -16,7 +17,8 @@ using json = nlohmann::json;
 namespace lansend::core {
 
 CommonController::CommonController(HttpServer& server, FeedbackCallback callback)
-    : callback_(callback) {
+    : cert_manager_(server.GetCertificateManager())
+    , callback_(callback) {
     InstallRoutes(server);
 }
 
@@ -60,6 +62,17 @@ net::awaitable<http::response<http::string_body>> CommonController::onConnect(
     co_return HttpServer::Ok(req.version(), req.keep_alive(), "Connection accepted");
 }
 
+net::awaitable<HttpResponse> CommonController::onDeviceInfo(
+    const http::request<http::string_body>& req) {
+    spdlog::debug("CommonController::OnDeviceInfo");
+    BroadcastDto device_info_dto;
+    device_info_dto.device_info = DeviceInfo::LocalDeviceInfo();
+    device_info_dto.fingerprint = cert_manager_.security_context().certificate_hash;
+    device_info_dto.previous_fingerprint = cert_manager_.security_context()
+                                               .previous_certificate_hash;
+    co_return HttpServer::Ok(req.version(), req.keep_alive(), json(device_info_dto).dump());
+}
+
 void CommonController::InstallRoutes(HttpServer& server) {
     server.AddRoute(ApiRoute::kPing.data(),
                     http::verb::get,
@@ -67,6 +80,9 @@ void CommonController::InstallRoutes(HttpServer& server) {
     server.AddRoute(ApiRoute::kConnect.data(),
                     http::verb::post,
                     std::bind(&CommonController::onConnect, this, std::placeholders::_1));
+    server.AddRoute(ApiRoute::kDeviceInfo.data(),
+                    http::verb::get,
+                    std::bind(&CommonController::onDeviceInfo, this, std::placeholders::_1));
 }
 
 } // namespace lansend::core
\ No newline at end of file
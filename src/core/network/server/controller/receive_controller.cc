@@ -1,20 +1,32 @@
 #include <algorithm>
+#include <array>
 #include <boost/beast/http/string_body_fwd.hpp>
 #include <boost/beast/http/vector_body.hpp>
+#include <boost/endian/conversion.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <cmath>
 #include <core/constant/route.h>
+#include <core/constant/transfer.h>
+#include <core/constant/udp.h>
 #include <core/model.h>
 #include <core/network/server/controller/receive_controller.h>
 #include <core/network/server/http_server.h>
 #include <core/util/binary_message.h>
+#include <core/util/compute_pool.h>
+#include <core/util/config.h>
+#include <core/util/dto_reader.h>
+#include <core/util/memory_governor.h>
 #include <fstream>
+#include <iterator>
+#include <list>
 #include <nlohmann/json.hpp>
 #include <ranges>
 #include <regex>
 #include <spdlog/spdlog.h>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace net = boost::asio;
 namespace beast = boost::beast;
@@ -24,330 +36,877 @@ using json = nlohmann::json;
 
 namespace lansend::core {
 
+static SessionId GenerateSessionId() {
+    // Generate a unique session ID with timestamp
+    boost::uuids::random_generator uuid_gen;
+    std::string timestamp = std::to_string(
+        std::chrono::system_clock::now().time_since_epoch().count());
+    return timestamp + boost::uuids::to_string(uuid_gen());
+}
+
+// Large manifests are summarized in the log, only the first files are listed
+template<typename Describe>
+static std::string DescribeFiles(const std::vector<FileDto>& files, Describe describe) {
+    constexpr std::size_t kListedFiles = 10;
+    std::string description;
+    for (const auto& file : files | std::views::take(kListedFiles)) {
+        description += describe(file);
+        description += '\n';
+    }
+    if (files.size() > kListedFiles) {
+        description += std::format("... and {} more\n", files.size() - kListedFiles);
+    }
+    return description;
+}
+
+// The chunk layout comes from the sender, every offset and chunk index is computed from it
+static bool HasValidChunking(const FileDto& file) {
+    if (file.chunk_size == 0 || file.chunk_size > transfer::kMaxChunkSize) {
+        return false;
+    }
+    return file.total_chunks == file.file_size / file.chunk_size
+                                    + (file.file_size % file.chunk_size != 0 ? 1 : 0);
+}
+
+// Chunk bodies are streamed to disk in pieces of this size
+static constexpr std::size_t kChunkPieceSize = 256 * 1024;
+static constexpr std::uint32_t kMaxChunkMetadataSize = 64 * 1024;
+
+// A chunk body is a BinaryMessage: big-endian metadata size, metadata JSON, then the data.
+// Only the metadata is read here, the data is left in the stream.
+static net::awaitable<SendChunkDto> ReadChunkMetadata(RequestStream& body) {
+    std::array<std::uint8_t, sizeof(std::uint32_t)> size_bytes;
+    co_await body.ReadExact(size_bytes);
+    std::uint32_t metadata_size = boost::endian::load_big_u32(size_bytes.data());
+    if (metadata_size > kMaxChunkMetadataSize) {
+        throw std::runtime_error(std::format("Chunk metadata of {} bytes", metadata_size));
+    }
+
+    std::vector<std::uint8_t> metadata(metadata_size);
+    co_await body.ReadExact(metadata);
+    SendChunkDto send_chunk_dto;
+    nlohmann::from_json(json::parse(metadata), send_chunk_dto);
+    co_return send_chunk_dto;
+}
+
+// Opens a temp file for writing at any offset. A missing file is created without truncating,
+// chunks of the same file are written concurrently.
+static void OpenTempFile(std::fstream& file,
+                         const fs::path& temp_file_path,
+                         const std::string& file_name) {
+    file.open(temp_file_path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file) {
+        file.clear();
+        {
+            std::ofstream create(temp_file_path, std::ios::binary | std::ios::app);
+        }
+        file.open(temp_file_path, std::ios::binary | std::ios::in | std::ios::out);
+    }
+    if (!file) {
+        throw std::runtime_error(std::format("Failed to create temporary file {} for file {}",
+                                             temp_file_path.string(),
+                                             file_name));
+    }
+}
+
+// Awaits op on the current executor, throws operation_aborted once slot's signal is emitted
+template<typename T>
+static net::awaitable<T> Abortable(net::awaitable<T> op, net::cancellation_slot slot) {
+    co_return co_await net::co_spawn(co_await net::this_coro::executor,
+                                     std::move(op),
+                                     net::bind_cancellation_slot(slot, net::use_awaitable));
+}
+
+static std::string ProgressKey(std::string_view session_id, std::string_view file_id) {
+    return std::format("{}/{}", session_id, file_id);
+}
+
 ReceiveController::ReceiveController(HttpServer& server,
                                      const std::filesystem::path& save_dir,
                                      FeedbackCallback callback)
     : server_(server)
+    , strand_(net::make_strand(server.GetIoContext()))
     , save_dir_(save_dir)
-    , callback_(callback) {
+    , callback_(callback)
+    , bandwidth_limiter_(settings.max_receive_bandwidth * 1024.0)
+    , progress_(settings.progress_rate_hz) {
     if (!std::filesystem::exists(save_dir_)) {
         std::filesystem::create_directories(save_dir_);
     }
     installRoutes();
 }
 
+// The setters are called from the IPC thread, the handlers reading the fields run on strand_
+
 void ReceiveController::SetSaveDirectory(const std::filesystem::path& save_dir) {
-    save_dir_ = save_dir;
-    if (!std::filesystem::exists(save_dir_)) {
-        std::filesystem::create_directories(save_dir_);
-    }
+    net::post(strand_, [this, save_dir]() {
+        save_dir_ = save_dir;
+        if (!std::filesystem::exists(save_dir_)) {
+            std::filesystem::create_directories(save_dir_);
+        }
+    });
 }
 
-ReceiveSessionStatus ReceiveController::session_status() const {
-    return session_status_;
+void ReceiveController::NotifyConfirmation(std::string session_id) {
+    auto notified_at = std::chrono::steady_clock::now();
+    net::post(strand_, [this, session_id = std::move(session_id), notified_at]() {
+        for (const auto& [id, session] : sessions_) {
+            if (session->status != ReceiveSessionStatus::kWaiting
+                || (!session_id.empty() && id != session_id)) {
+                continue;
+            }
+            session->confirm_notified_at = notified_at;
+            if (session->confirm_signal) {
+                session->confirm_signal->cancel();
+            }
+        }
+    });
 }
 
-std::string_view ReceiveController::sender_ip() const {
-    return sender_ip_;
-}
+void ReceiveController::NotifySenderLost(std::string ip, unsigned short port) {
+    net::post(strand_, [this, ip = std::move(ip), port]() {
+        std::vector<SessionId> lost_sessions;
+        for (const auto& [session_id, session] : sessions_) {
+            if (session->sender_ip == ip && session->sender_port == port) {
+                lost_sessions.push_back(session_id);
+            }
+        }
+        for (const auto& session_id : lost_sessions) {
+            spdlog::error("Lost connection to sender {}:{} while receiving file", ip, port);
+            spdlog::info("Being notified that sender is lost before session {} is completed",
+                         session_id);
+            endSession(session_id);
 
-unsigned short ReceiveController::sender_port() const {
-    return sender_port_;
+            // feedback session failed
+            feedback(Feedback{
+                .type = FeedbackType::kReceiveSessionEnded,
+                .data = feedback::ReceiveSessionEnd{
+                    .session_id = session_id,
+                    .success = false,
+                    .error_message = "Sender is lost",
+                },
+            });
+        }
+    });
 }
 
-void ReceiveController::NotifySenderLost() {
-    spdlog::info("Being notified that sender is lost before the session is completed");
-    resetToIdle();
-
-    // feedback session failed
-    feedback(Feedback{
-        .type = FeedbackType::kReceiveSessionEnded,
-        .data = feedback::ReceiveSessionEnd{
-            .session_id = session_id_,
-            .success = false,
-            .error_message = "Sender is lost",
-        },
-    });
+bool ReceiveController::HasActiveSession(const std::string& ip) const {
+    std::lock_guard<std::mutex> lock(active_peers_mutex_);
+    return active_peers_.contains(ip);
 }
 
 void ReceiveController::SetFeedbackCallback(FeedbackCallback callback) {
-    callback_ = callback;
+    net::post(strand_, [this, callback = std::move(callback)]() { callback_ = callback; });
 }
 
 void ReceiveController::SetWaitConditionFunc(WaitConditionFunc func) {
-    wait_condition_ = func;
+    net::post(strand_, [this, func = std::move(func)]() { wait_condition_ = func; });
 }
 
 void ReceiveController::SetCancelConditionFunc(CancelConditionFunc func) {
-    cancel_condition_ = func;
+    net::post(strand_, [this, func = std::move(func)]() { cancel_condition_ = func; });
 }
 
-net::awaitable<http::response<http::string_body>> ReceiveController::onRequestSend(
-    const http::request<http::string_body>& req) {
+void ReceiveController::SetBandwidthLimit(std::uint64_t bytes_per_second) {
+    bandwidth_limiter_.SetRate(static_cast<double>(bytes_per_second));
+}
+
+static std::string_view BodyView(const BinaryRequest& req) {
+    return {reinterpret_cast<const char*>(req.body().data()), req.body().size()};
+}
+
+net::awaitable<HttpResponse> ReceiveController::onRequestSend(const BinaryRequest& req) {
     spdlog::debug("ReceiveController::OnRequestSend");
+    SessionId session_id;
     try {
+        // Queue for a free session slot before spending anything on the manifest
+        std::string ticket(req[ApiHeader::kQueueTicket]);
+        if (!co_await waitForAdmission(ticket)) {
+            auto position = std::ranges::find_if(admission_queue_,
+                                                 [&ticket](const auto& entry) {
+                                                     return entry->ticket == ticket;
+                                                 })
+                            - admission_queue_.begin() + 1;
+            spdlog::debug("The receiver is busy, sender keeps queue position {}", position);
+            auto res = HttpServer::Forbidden(req.version(), req.keep_alive(), "receiver busy");
+            res.set(ApiHeader::kQueueTicket, ticket);
+            res.set(ApiHeader::kQueuePosition, std::to_string(position));
+            co_return res;
+        }
+
         RequestSendDto request_send_dto;
-        // NEW
         try {
-            json data = json::parse(req.body());
-            nlohmann::from_json(data, request_send_dto);
+            request_send_dto = DtoReader::ReadRequestSend(BodyView(req), req.body().capacity());
         } catch (const std::exception& e) {
             spdlog::error("Error parsing request: {}", e.what());
             co_return HttpServer::BadRequest(req.version(), req.keep_alive(), "invalid data");
         }
-
-        DeviceInfo device_info = std::move(request_send_dto.device_info);
-        std::vector<FileDto> files = std::move(request_send_dto.files);
-        std::string all_file_names{};
-        for (const auto& file : files) {
-            all_file_names += std::format("{} ({})\n",
-                                          file.file_name,
-                                          FileTypeToString(file.file_type));
-        }
-        spdlog::info("{} {} ({}:{}) wants to send {} files:\n{}",
-                     device_info.hostname,
-                     device_info.operating_system,
-                     device_info.ip_address,
-                     device_info.port,
-                     files.size(),
-                     all_file_names);
-
-        if (session_status_ != ReceiveSessionStatus::kIdle) {
-            spdlog::info("The receiver is busy, automatically reject the request");
-            co_return HttpServer::Forbidden(req.version(), req.keep_alive(), "receiver busy");
-        } else {
-            spdlog::info("The receiver is idle, start handling the request");
-            session_status_ = ReceiveSessionStatus::kWorking;
+        // The announced total sizes the manifest up front, it is bounded before anything is
+        // reserved for it
+        if (request_send_dto.total_files > transfer::kMaxManifestFiles
+            || request_send_dto.files.size() > transfer::kMaxManifestFiles) {
+            spdlog::warn("Rejected a send request of {} files, at most {} are accepted",
+                         std::max(request_send_dto.total_files, request_send_dto.files.size()),
+                         transfer::kMaxManifestFiles);
+            co_return HttpServer::BadRequest(req.version(), req.keep_alive(), "too many files");
         }
 
-        std::vector<std::string> file_names;
-        for (const auto& file : files) {
-            file_names.push_back(file.file_name);
+        // Record sender's network information
+        auto session = std::make_shared<ReceiveSession>();
+        session->session_id = session_id = GenerateSessionId();
+        session->sender_ip = request_send_dto.device_info.ip_address;
+        session->sender_port = request_send_dto.device_info.port;
+        session->peer_ip = std::string(req[ApiHeader::kPeerAddress]);
+        session->udp_offered = request_send_dto.udp_transport;
+        session->sender_device = std::move(request_send_dto.device_info);
+        session->manifest = std::move(request_send_dto.files);
+        session->expected_files = std::max(request_send_dto.total_files, session->manifest.size());
+        sessions_.emplace(session_id, session);
+        {
+            std::lock_guard<std::mutex> lock(active_peers_mutex_);
+            active_peers_[session->peer_ip]++;
+        }
+        spdlog::info("Start handling the request in session {} ({} of {} sessions)",
+                     session_id,
+                     sessions_.size(),
+                     sessionCapacity());
+
+        if (session->manifest.size() < session->expected_files) {
+            // The rest of the manifest follows on /manifest-page, the last page is answered
+            // once the user confirmed
+            spdlog::info("Waiting for the manifest of {} files in session {}",
+                         session->expected_files,
+                         session_id);
+            session->status = ReceiveSessionStatus::kManifest;
+            session->manifest_expires_at = std::chrono::steady_clock::now()
+                                           + kManifestIdleTimeout;
+            session->manifest.reserve(session->expected_files);
+            RequestSendResponseDto response_dto;
+            response_dto.session_id = session_id;
+            response_dto.manifest_pending = true;
+            co_return HttpServer::Ok(req.version(), req.keep_alive(), json(response_dto).dump());
         }
 
-        // feedback session started
-        feedback(Feedback{
-            .type = FeedbackType::kRequestReceiveFiles,
-            .data = feedback::RequestReceiveFiles{
-                .device_info = device_info,
-                .file_names = file_names,
-            },
-        });
-
-        // Record sender's network information
-        sender_ip_ = device_info.ip_address;
-        sender_port_ = device_info.port;
+        co_return co_await confirmManifest(session, req.version(), req.keep_alive());
+    } catch (const std::exception& e) {
+        spdlog::error("Error processing request: {}", e.what());
+        if (!session_id.empty()) {
+            endSession(session_id);
+        }
+        co_return HttpServer::InternalServerError(req.version(), req.keep_alive(), e.what());
+    }
+}
 
-        spdlog::debug("Wait for user confirmation");
+net::awaitable<HttpResponse> ReceiveController::onManifestPage(const BinaryRequest& req) {
+    spdlog::debug("ReceiveController::onManifestPage");
+    ManifestPageDto manifest_page_dto;
+    try {
+        manifest_page_dto = DtoReader::ReadManifestPage(BodyView(req), req.body().capacity());
+    } catch (const std::exception& e) {
+        spdlog::error("Error parsing manifest page: {}", e.what());
+        co_return HttpServer::BadRequest(req.version(), req.keep_alive(), "invalid data");
+    }
 
-        // Wait for user confirmation
-        std::optional<std::vector<FileDto>> accepted_files
-            = co_await waitForUserConfirmation(device_info.device_id, files, 30);
+    auto session = findSession(manifest_page_dto.session_id, ReceiveSessionStatus::kManifest);
+    if (session == nullptr) {
+        spdlog::warn("Manifest page for unknown session {}", manifest_page_dto.session_id);
+        co_return HttpServer::Forbidden(req.version(), req.keep_alive(), "sender cancelled");
+    }
 
-        // Sender might cancel waiting for user confirmation
-        // resetToIdle() was called cocurrently when handling sender's request
-        if (session_status_ != ReceiveSessionStatus::kWorking) {
-            spdlog::info("Sender cancelled waiting for user confirmation");
-            co_return HttpServer::Forbidden(req.version(), req.keep_alive(), "sender cancelled");
+    try {
+        if (session->manifest.size() + manifest_page_dto.files.size() > session->expected_files) {
+            throw std::runtime_error(std::format("Manifest of session {} exceeds {} files",
+                                                 session->session_id,
+                                                 session->expected_files));
         }
-
-        spdlog::debug("Wait for user confirmation finished");
-
-        if (accepted_files == std::nullopt) {
-            spdlog::info("Send request is rejected by the receiver");
-            resetToIdle();
-            co_return HttpServer::Forbidden(req.version(), req.keep_alive(), "declined");
+        std::ranges::move(manifest_page_dto.files, std::back_inserter(session->manifest));
+        spdlog::debug("Session {} received {}/{} manifest entries",
+                      session->session_id,
+                      session->manifest.size(),
+                      session->expected_files);
+
+        if (session->manifest.size() < session->expected_files) {
+            session->manifest_expires_at = std::chrono::steady_clock::now()
+                                           + kManifestIdleTimeout;
+            RequestSendResponseDto response_dto;
+            response_dto.session_id = session->session_id;
+            response_dto.manifest_pending = true;
+            co_return HttpServer::Ok(req.version(), req.keep_alive(), json(response_dto).dump());
         }
 
-        // Generate a unique session ID with timestamp
-        boost::uuids::random_generator uuid_gen;
-        std::string timestamp = std::to_string(
-            std::chrono::system_clock::now().time_since_epoch().count());
-        session_id_ = timestamp + boost::uuids::to_string(uuid_gen());
-        spdlog::info("Send request accepted, generate session_id: {}", session_id_);
-
-        // Create a session context and generate file tokens with file-specific information
-        std::unordered_map<std::string, std::string> file_tokens;
-        std::string receive_file_message;
-
-        for (const auto& file : accepted_files.value()) {
-            // Create a targeted token using file attributes
-            std::string file_hash = std::to_string(
-                std::hash<std::string>{}(file.file_name + file.file_id));
-            std::string random_part = boost::uuids::to_string(uuid_gen()).substr(0, 12);
-            std::string file_token = file_hash.substr(0, 8) + random_part;
-            file_tokens[file.file_id] = file_token;
-
-            // Create a temporary file path
-            fs::path temp_file_path = save_dir_ / (file.file_id + ".part");
-
-            // Add file to session context
-            received_files_[file.file_id] = ReceiveFileContext{.file_name = file.file_name,
-                                                               .temp_file_path = temp_file_path,
-                                                               .file_token = file_token,
-                                                               .file_size = file.file_size,
-                                                               .chunk_size = file.chunk_size,
-                                                               .total_chunks = file.total_chunks,
-                                                               .received_chunks = {},
-                                                               .file_checksum = file.file_checksum};
-
-            // Build message about the file
-            receive_file_message += std::format("{} ({} bytes), {} chunks expected\n",
-                                                file.file_name,
-                                                file.file_size,
-                                                file.total_chunks);
-        }
-        spdlog::info("Started receiving {} files:\n{}",
-                     accepted_files.value().size(),
-                     receive_file_message);
-
-        RequestSendResponseDto response_dto;
-        response_dto.session_id = session_id_;
-        response_dto.file_tokens = file_tokens;
-        json response_data = response_dto;
-
-        spdlog::info("Send request accepted, session_id: {}", session_id_);
-        co_return HttpServer::Ok(req.version(), req.keep_alive(), response_data.dump());
+        co_return co_await confirmManifest(session, req.version(), req.keep_alive());
     } catch (const std::exception& e) {
-        spdlog::error("Error processing request: {}", e.what());
-        resetToIdle();
+        spdlog::error("Error processing manifest page: {}", e.what());
+        endSession(session->session_id);
         co_return HttpServer::InternalServerError(req.version(), req.keep_alive(), e.what());
     }
 }
 
-net::awaitable<http::response<http::string_body>> ReceiveController::onSendChunk(
-    const http::request<http::vector_body<std::uint8_t>>& req) {
+net::awaitable<HttpResponse> ReceiveController::confirmManifest(
+    std::shared_ptr<ReceiveSession> session, unsigned int version, bool keep_alive) {
+    SessionId session_id = session->session_id;
+    const auto& device_info = session->sender_device;
+    if (auto invalid = std::ranges::find_if_not(session->manifest, HasValidChunking);
+        invalid != session->manifest.end()) {
+        spdlog::error("File {} of session {} has an invalid chunk layout: {} bytes in {} "
+                      "chunks of {} bytes",
+                      invalid->file_name,
+                      session_id,
+                      invalid->file_size,
+                      invalid->total_chunks,
+                      invalid->chunk_size);
+        endSession(session_id);
+        co_return HttpServer::BadRequest(version, keep_alive, "invalid manifest");
+    }
+    session->status = ReceiveSessionStatus::kWaiting;
+
+    spdlog::info("{} {} ({}:{}) wants to send {} files:\n{}",
+                 device_info.hostname,
+                 device_info.operating_system,
+                 device_info.ip_address,
+                 device_info.port,
+                 session->manifest.size(),
+                 DescribeFiles(session->manifest, [](const FileDto& file) {
+                     return std::format("{} ({})",
+                                        file.file_name,
+                                        FileTypeToString(file.file_type));
+                 }));
+
+    std::vector<std::string> file_names;
+    std::vector<std::string> file_ids;
+    file_names.reserve(session->manifest.size());
+    file_ids.reserve(session->manifest.size());
+    for (const auto& file : session->manifest) {
+        file_names.push_back(file.file_name);
+        file_ids.push_back(file.file_id);
+    }
+
+    // feedback session started
+    feedback(Feedback{
+        .type = FeedbackType::kRequestReceiveFiles,
+        .data = feedback::RequestReceiveFiles{
+            .session_id = session_id,
+            .device_info = device_info,
+            .file_names = std::move(file_names),
+            .file_ids = std::move(file_ids),
+        },
+    });
+
+    spdlog::debug("Wait for user confirmation");
+
+    // Wait for user confirmation
+    std::optional<std::vector<FileDto>> accepted_files
+        = co_await waitForUserConfirmation(session, session->manifest, 30);
+
+    // Sender might cancel waiting for user confirmation
+    // The session was ended cocurrently when handling sender's request
+    if (findSession(session_id, ReceiveSessionStatus::kWaiting) == nullptr) {
+        spdlog::info("Sender cancelled waiting for user confirmation");
+        co_return HttpServer::Forbidden(version, keep_alive, "sender cancelled");
+    }
+
+    spdlog::debug("Wait for user confirmation finished");
+
+    if (accepted_files == std::nullopt || accepted_files->empty()) {
+        spdlog::info("Send request is rejected by the receiver");
+        endSession(session_id);
+        co_return HttpServer::Forbidden(version, keep_alive, "declined");
+    }
+
+    // The accepted files are all that is needed from now on
+    session->manifest = {};
+
+    // Create a session context and generate file tokens with file-specific information
+    boost::uuids::random_generator uuid_gen;
+    std::unordered_map<std::string, std::string> file_tokens;
+    file_tokens.reserve(accepted_files->size());
+    session->files.reserve(accepted_files->size());
+
+    for (const auto& file : accepted_files.value()) {
+        // Create a targeted token using file attributes
+        std::string file_hash = std::to_string(
+            std::hash<std::string>{}(file.file_name + file.file_id));
+        std::string random_part = boost::uuids::to_string(uuid_gen()).substr(0, 12);
+        std::string file_token = file_hash.substr(0, 8) + random_part;
+        file_tokens[file.file_id] = file_token;
+
+        // Create a temporary file path, unique per session
+        fs::path temp_file_path = save_dir_ / std::format("{}.{}.part", session_id, file.file_id);
+
+        // Add file to session context
+        session->files[file.file_id] = ReceiveFileContext{
+            .file_name = file.file_name,
+            .temp_file_path = temp_file_path,
+            .file_token = file_token,
+            .file_size = file.file_size,
+            .chunk_size = file.chunk_size,
+            .total_chunks = file.total_chunks,
+            .received_chunks = ChunkBitmap(file.total_chunks),
+            .file_checksum = file.file_checksum,
+        };
+    }
+    spdlog::info("Started receiving {} files:\n{}",
+                 accepted_files->size(),
+                 DescribeFiles(accepted_files.value(), [](const FileDto& file) {
+                     return std::format("{} ({} bytes), {} chunks expected",
+                                        file.file_name,
+                                        file.file_size,
+                                        file.total_chunks);
+                 }));
+    session->status = ReceiveSessionStatus::kWorking;
+
+    RequestSendResponseDto response_dto;
+    response_dto.session_id = session_id;
+    response_dto.file_tokens = std::move(file_tokens);
+    if (session->udp_offered && settings.udp_transport) {
+        openUdpChannel(session, response_dto);
+    }
+    json response_data = response_dto;
+
+    spdlog::info("Send request accepted, session_id: {}", session_id);
+    co_return HttpServer::Ok(version, keep_alive, response_data.dump());
+}
+
+net::awaitable<HttpResponse> ReceiveController::onSendChunk(RequestStream& body) {
     spdlog::debug("ReceiveController::OnSendChunk");
+    const auto& req = body.header();
+    unsigned int version = req.version();
+    bool keep_alive = req.keep_alive();
+
+    SendChunkDto send_chunk_dto;
+    try {
+        send_chunk_dto = co_await ReadChunkMetadata(body);
+    } catch (const std::exception& e) {
+        spdlog::error("Error parsing request: {}", e.what());
+        co_return HttpServer::BadRequest(version, keep_alive, "invalid data");
+    }
+
+    auto admitted = co_await net::co_spawn(strand_,
+                                           admitChunk(std::move(send_chunk_dto),
+                                                      version,
+                                                      keep_alive,
+                                                      co_await net::this_coro::executor),
+                                           net::use_awaitable);
+    if (auto* res = std::get_if<HttpResponse>(&admitted)) {
+        co_return std::move(*res);
+    }
+    auto chunk = std::get<IncomingChunk>(std::move(admitted));
+
+    // Whatever happened to the body, the chunk leaves the write queue on the strand
+    std::exception_ptr error;
+    try {
+        co_await receiveChunkData(body, chunk);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    co_return co_await net::co_spawn(strand_,
+                                     completeChunk(std::move(chunk), error, version, keep_alive),
+                                     net::use_awaitable);
+}
+
+net::awaitable<std::variant<HttpResponse, IncomingChunk>> ReceiveController::admitChunk(
+    SendChunkDto send_chunk_dto,
+    unsigned int version,
+    bool keep_alive,
+    net::any_io_executor executor) {
     // Sender might still send several data when receiver received the cancellation request
-    // and resetToIdle() was called cocurrently
+    // and the session was ended cocurrently
     // Notify sender to stop the sending coroutine
-    if (session_status_ != ReceiveSessionStatus::kWorking) {
+    auto session = findSession(send_chunk_dto.session_id, ReceiveSessionStatus::kWorking);
+    if (session == nullptr) {
         spdlog::info("Chunk data sent when receive session is already cancelled by sender");
-        co_return HttpServer::Forbidden(req.version(), req.keep_alive(), "sender cancelled");
+        co_return HttpServer::Forbidden(version, keep_alive, "sender cancelled");
     }
 
     // This should be polling the event stream to check the ui operation
-    if (cancel_condition_()) {
-        spdlog::info("receiver cancelled the session");
-        resetToIdle();
-        co_return HttpServer::Forbidden(req.version(), req.keep_alive(), "receiver cancelled");
+    if (cancel_condition_ && cancel_condition_(session->session_id)) {
+        spdlog::info("receiver cancelled the session {}", session->session_id);
+        endSession(session->session_id);
+        co_return HttpServer::Forbidden(version, keep_alive, "receiver cancelled");
     }
 
     try {
-        const BinaryMessage& binary_message = req.body();
-
-        SendChunkDto send_chunk_dto;
-        BinaryData chunk_data;
-        try {
-            json metadata;
-            if (!ParseBinaryMessage(binary_message, metadata, chunk_data)) {
-                throw std::runtime_error("Failed to parse binary message");
-            }
-            nlohmann::from_json(metadata, send_chunk_dto);
-        } catch (const std::exception& e) {
-            spdlog::error("Error parsing request: {}", e.what());
-            co_return HttpServer::BadRequest(req.version(), req.keep_alive(), "invalid data");
+        // Check if file_id is valid
+        auto iter = session->files.find(send_chunk_dto.file_id);
+        if (iter == session->files.end()) {
+            throw std::runtime_error(std::format("Invalid file_id {} in session_id {}",
+                                                 send_chunk_dto.file_id,
+                                                 send_chunk_dto.session_id));
         }
-
-        // Check if the session ID matches
-        if (send_chunk_dto.session_id != session_id_) {
-            spdlog::error("Session ID mismatch: expected {}, got {}",
-                          session_id_,
-                          send_chunk_dto.session_id);
-            throw std::runtime_error("Session ID mismatch");
+        auto& file_context = iter->second;
+        // Check if the file token matches
+        if (file_context.file_token != send_chunk_dto.file_token) {
+            throw std::runtime_error(
+                std::format("Invalid file token for file_id {} in session_id {}",
+                            send_chunk_dto.file_id,
+                            send_chunk_dto.session_id));
+        }
+        if (send_chunk_dto.current_chunk_index >= file_context.total_chunks) {
+            throw std::runtime_error(
+                std::format("Chunk index {} out of range for file_id {} ({} chunks)",
+                            send_chunk_dto.current_chunk_index,
+                            send_chunk_dto.file_id,
+                            file_context.total_chunks));
+        }
+        // Check if the chunk has already been received
+        if (file_context.received_chunks.Test(send_chunk_dto.current_chunk_index)) {
+            spdlog::warn("Chunk {} for file_id {} in session_id {} already received",
+                         send_chunk_dto.current_chunk_index,
+                         send_chunk_dto.file_id,
+                         send_chunk_dto.session_id);
+            auto res = HttpServer::Ok(version, keep_alive);
+            grantChunkCredits(res, *session, file_context.chunk_size);
+            co_return res;
         }
 
-        // Check if file_id is valid
-        if (auto iter = received_files_.find(send_chunk_dto.file_id);
-            iter != received_files_.end()) {
-            auto& file_context = iter->second;
-            // Check if the file token matches
-            if (file_context.file_token == send_chunk_dto.file_token) {
-                // Check if the chunk has already been received
-                if (file_context.received_chunks.contains(send_chunk_dto.current_chunk_index)) {
-                    spdlog::warn("Chunk {} for file_id {} in session_id {} already received",
-                                 send_chunk_dto.current_chunk_index,
-                                 send_chunk_dto.file_id,
-                                 send_chunk_dto.session_id);
-                    co_return HttpServer::Ok(req.version(), req.keep_alive());
-                }
-
-                // All valid, process the chunk
-                auto actual_checksum = FileHasher::CalculateDataChecksum(chunk_data);
-                if (actual_checksum != send_chunk_dto.chunk_checksum) {
-                    throw std::runtime_error(
-                        std::format("Chunk checksum mismatch for file_id {} in session_id {}",
-                                    send_chunk_dto.file_id,
-                                    send_chunk_dto.session_id));
-                }
+        std::uint64_t offset = send_chunk_dto.current_chunk_index * file_context.chunk_size;
+        IncomingChunk chunk{
+            .session = session,
+            .temp_file_path = file_context.temp_file_path,
+            .file_name = file_context.file_name,
+            .offset = offset,
+            .expected_size = static_cast<std::size_t>(
+                std::min<std::uint64_t>(file_context.chunk_size, file_context.file_size - offset)),
+            .abort = std::make_shared<ChunkAbort>(),
+        };
+        chunk.dto = std::move(send_chunk_dto);
+        chunk.abort->executor = std::move(executor);
+        chunk.abort_position = session->chunk_cancellations.insert(
+            session->chunk_cancellations.end(),
+            chunk.abort);
+        ++chunks_writing_;
+        ++session->chunks_writing;
+        co_return chunk;
+    } catch (const std::exception& e) {
+        spdlog::error("Error processing chunk: {}", e.what());
+        endSession(session->session_id);
 
-                // Create or open the temporary file
-                std::fstream temp_file(file_context.temp_file_path,
-                                       std::ios::binary | std::ios::in | std::ios::out);
-                if (!temp_file) {
-                    temp_file.open(file_context.temp_file_path, std::ios::binary | std::ios::out);
-                    if (!temp_file) {
-                        throw std::runtime_error(
-                            std::format("Failed to create temporary file {} for file {}",
-                                        file_context.temp_file_path.string(),
-                                        file_context.file_name));
-                    }
-                }
+        // feedback session failed
+        feedback(Feedback{
+            .type = FeedbackType::kReceiveSessionEnded,
+            .data = feedback::ReceiveSessionEnd{
+                .session_id = session->session_id,
+                .success = false,
+                .error_message = e.what(),
+            },
+        });
+        co_return HttpServer::InternalServerError(version, keep_alive, e.what());
+    }
+}
 
-                std::size_t offset = send_chunk_dto.current_chunk_index * file_context.chunk_size;
-                temp_file.seekp(offset);
-                temp_file.write(reinterpret_cast<const char*>(chunk_data.data()), chunk_data.size());
+net::awaitable<void> ReceiveController::receiveChunkData(RequestStream& body,
+                                                         IncomingChunk& chunk) {
+    // Each piece waits for the aggregate bandwidth budget, then is hashed and written straight
+    // to disk on the compute pool. Ending the session aborts a pending read or budget wait.
+    std::fstream temp_file;
+    co_await ComputePool::Run("chunk-write", [&chunk, &temp_file]() {
+        OpenTempFile(temp_file, chunk.temp_file_path, chunk.file_name);
+        temp_file.seekp(static_cast<std::streamoff>(chunk.offset));
+    });
 
+    IncrementalHasher hasher;
+    auto reservation = co_await MemoryGovernor::Reserve(kChunkPieceSize);
+    std::vector<std::uint8_t> piece(kChunkPieceSize);
+    while (true) {
+        // The session may have ended while no read was pending to abort
+        if (chunk.abort->aborted) {
+            throw boost::system::system_error(net::error::operation_aborted);
+        }
+        std::size_t n = co_await Abortable(body.ReadSome(piece), chunk.abort->signal.slot());
+        if (n == 0) {
+            break;
+        }
+        chunk.received_size += n;
+        if (chunk.received_size > chunk.expected_size) {
+            break;
+        }
+        co_await Abortable(bandwidth_limiter_.Acquire(static_cast<double>(n)),
+                           chunk.abort->signal.slot());
+        chunk.disk_time += co_await ComputePool::Run(
+            "chunk-write",
+            [&chunk, &hasher, &piece, &temp_file, n]() {
+                hasher.Update(piece.data(), n);
+                auto write_started = std::chrono::steady_clock::now();
+                temp_file.write(reinterpret_cast<const char*>(piece.data()),
+                                static_cast<std::streamsize>(n));
                 if (!temp_file) {
                     throw std::runtime_error(
                         std::format("Failed to write chunk to temporary file {} for file {}",
-                                    file_context.temp_file_path.string(),
-                                    file_context.file_name));
+                                    chunk.temp_file_path.string(),
+                                    chunk.file_name));
                 }
+                return std::chrono::steady_clock::now() - write_started;
+            });
+    }
+    chunk.disk_time += co_await ComputePool::Run("chunk-write", [&temp_file]() {
+        auto close_started = std::chrono::steady_clock::now();
+        temp_file.close();
+        return std::chrono::steady_clock::now() - close_started;
+    });
+    chunk.checksum = hasher.Finish();
+}
 
-                temp_file.close();
+net::awaitable<HttpResponse> ReceiveController::completeChunk(IncomingChunk chunk,
+                                                              std::exception_ptr error,
+                                                              unsigned int version,
+                                                              bool keep_alive) {
+    const auto& session = chunk.session;
+    const auto& send_chunk_dto = chunk.dto;
+    --chunks_writing_;
+    --session->chunks_writing;
+    session->chunk_cancellations.erase(chunk.abort_position);
+    // The session was cleaned up while the chunk was written, its temp file may be back
+    if (session->status == ReceiveSessionStatus::kIdle && session->chunks_writing == 0) {
+        doCleanup(*session);
+    }
 
-                // Update the received chunks count
-                file_context.received_chunks.insert(send_chunk_dto.current_chunk_index);
+    try {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        recordDiskWrite(chunk.received_size, chunk.disk_time);
 
-                // feedback file receiving progress
-                feedback(Feedback{
-                    .type = FeedbackType::kFileReceivingProgress,
-                    .data = feedback::FileReceivingProgress{
-                        .session_id = session_id_,
-                        .filename = file_context.file_name,
-                        .progress = 
-                            static_cast<double>(file_context.received_chunks.size())
-                            / file_context.total_chunks * 100.0,
-                    },
-                });
-                co_return HttpServer::Ok(req.version(), req.keep_alive(), "ok");
-            } else {
-                throw std::runtime_error(
-                    std::format("Invalid file token for file_id {} in session_id {}",
-                                send_chunk_dto.file_id,
-                                send_chunk_dto.session_id));
-            }
-        } else {
-            throw std::runtime_error(std::format("Invalid file_id {} in session_id {}",
+        if (session->status != ReceiveSessionStatus::kWorking) {
+            spdlog::info("Receive session ended while the chunk was being received");
+            co_return HttpServer::Forbidden(version, keep_alive, "sender cancelled");
+        }
+        if (chunk.received_size != chunk.expected_size) {
+            throw std::runtime_error(std::format("Chunk {} of file_id {} has {} bytes, expected {}",
+                                                 send_chunk_dto.current_chunk_index,
                                                  send_chunk_dto.file_id,
-                                                 send_chunk_dto.session_id));
+                                                 chunk.received_size,
+                                                 chunk.expected_size));
+        }
+        // A corrupted chunk is never marked received, its bytes on disk are overwritten
+        // if it is sent again
+        if (chunk.checksum != send_chunk_dto.chunk_checksum) {
+            throw std::runtime_error(
+                std::format("Chunk checksum mismatch for file_id {} in session_id {}",
+                            send_chunk_dto.file_id,
+                            send_chunk_dto.session_id));
         }
 
+        // Update the received chunks count
+        auto& file_context = session->files.at(send_chunk_dto.file_id);
+        file_context.received_chunks.Set(send_chunk_dto.current_chunk_index);
+        reportReceiveProgress(*session,
+                              send_chunk_dto.file_id,
+                              file_context,
+                              std::min(file_context.file_size,
+                                       file_context.received_chunks.Count()
+                                           * file_context.chunk_size));
+        auto res = HttpServer::Ok(version, keep_alive, "ok");
+        grantChunkCredits(res, *session, file_context.chunk_size);
+        co_return res;
+    } catch (const boost::system::system_error& e) {
+        // The body was cut off: the session ended, or the sender aborted the chunk or lost the
+        // path it came over. Not a failure of the session, the server drops the connection.
+        spdlog::info("Chunk {} of file_id {} aborted: {}",
+                     send_chunk_dto.current_chunk_index,
+                     send_chunk_dto.file_id,
+                     e.code().message());
+        throw;
     } catch (const std::exception& e) {
         spdlog::error("Error processing chunk: {}", e.what());
-        resetToIdle();
+        endSession(session->session_id);
 
         // feedback session failed
         feedback(Feedback{
             .type = FeedbackType::kReceiveSessionEnded,
             .data = feedback::ReceiveSessionEnd{
-                .session_id = session_id_,
+                .session_id = session->session_id,
+                .success = false,
+                .error_message = e.what(),
+            },
+        });
+        co_return HttpServer::InternalServerError(version, keep_alive, e.what());
+    }
+}
+
+void ReceiveController::recordDiskWrite(std::size_t bytes,
+                                        std::chrono::steady_clock::duration elapsed) {
+    // Writes land in the page cache until the kernel throttles dirty pages, a slow disk shows
+    // up as write calls that block
+    std::chrono::duration<double> seconds = elapsed;
+    double rate = static_cast<double>(bytes) / std::max(seconds.count(), 1e-6);
+    disk_rate_ = disk_rate_ == 0 ? rate : 0.8 * disk_rate_ + 0.2 * rate;
+}
+
+void ReceiveController::grantChunkCredits(HttpResponse& res,
+                                          const ReceiveSession& session,
+                                          std::size_t chunk_size) const {
+    std::size_t credits = transfer::kInitialChunkCredits;
+    if (disk_rate_ > 0) {
+        // As many chunks as the slowest stage, disk or bandwidth limit, drains within the
+        // target delay. Chunks other sessions have queued for the same disk count against it.
+        double rate = disk_rate_;
+        if (bandwidth_limiter_.IsLimited()) {
+            rate = std::min(rate, bandwidth_limiter_.Rate());
+        }
+        std::chrono::duration<double> target = transfer::kTargetWriteDelay;
+        double chunks = rate * target.count()
+                        / static_cast<double>(std::max<std::size_t>(chunk_size, 1));
+        auto queue = std::clamp<std::size_t>(static_cast<std::size_t>(std::ceil(chunks)),
+                                             1,
+                                             transfer::kMaxChunkCredits);
+        std::size_t others = chunks_writing_ - session.chunks_writing;
+        credits = others < queue ? queue - others : 1;
+    }
+    res.set(ApiHeader::kChunkCredits, std::to_string(credits));
+}
+
+void ReceiveController::openUdpChannel(const std::shared_ptr<ReceiveSession>& session,
+                                       RequestSendResponseDto& response_dto) {
+    // Data frames carry the position of the file id among the accepted ids in sorted order,
+    // the sender derives the same from its file tokens
+    std::vector<FileId> file_ids;
+    file_ids.reserve(session->files.size());
+    for (const auto& [file_id, file_context] : session->files) {
+        file_ids.push_back(file_id);
+    }
+    std::ranges::sort(file_ids);
+
+    try {
+        // Datagrams are decrypted on a strand of the session's own, only the segments that
+        // pass enter strand_
+        auto receiver = std::make_shared<UdpReceiver>(net::make_strand(server_.GetIoContext()),
+                                                      session->sender_ip);
+        for (const auto& file_id : file_ids) {
+            const auto& file_context = session->files.at(file_id);
+            UdpFileState state{
+                .file_id = file_id,
+                .segments = ChunkBitmap((file_context.file_size + udp::kSegmentSize - 1)
+                                        / udp::kSegmentSize),
+                .chunk_missing_bytes = std::vector<std::size_t>(file_context.total_chunks),
+                .stream = std::make_shared<std::fstream>(),
+            };
+            for (std::size_t chunk = 0; chunk < file_context.total_chunks; ++chunk) {
+                state.chunk_missing_bytes[chunk] = std::min(file_context.chunk_size,
+                                                            file_context.file_size
+                                                                - chunk * file_context.chunk_size);
+            }
+            session->udp_files.push_back(std::move(state));
+        }
+
+        std::weak_ptr<ReceiveSession> weak_session = session;
+        receiver->Start([this, weak_session](const DataFrame& frame) {
+            return net::co_spawn(strand_, onUdpData(weak_session, frame), net::use_awaitable);
+        });
+        response_dto.udp_port = receiver->port();
+        response_dto.udp_key = receiver->key();
+        session->udp_receiver = std::move(receiver);
+        spdlog::info("Session {} receives over the UDP data channel on port {}",
+                     session->session_id,
+                     response_dto.udp_port);
+    } catch (const std::exception& e) {
+        spdlog::warn("No UDP data channel for session {}, chunks come over HTTPS: {}",
+                     session->session_id,
+                     e.what());
+        session->udp_files.clear();
+    }
+}
+
+net::awaitable<void> ReceiveController::onUdpData(std::weak_ptr<ReceiveSession> weak_session,
+                                                  DataFrame frame) {
+    auto session = weak_session.lock();
+    if (session == nullptr || session->status != ReceiveSessionStatus::kWorking
+        || frame.file_index >= session->udp_files.size()) {
+        co_return;
+    }
+    auto& state = session->udp_files[frame.file_index];
+    auto& file_context = session->files.at(state.file_id);
+
+    // The frame is authentic, a segment that does not fit the file is a sender bug
+    std::size_t segment = frame.offset / udp::kSegmentSize;
+    if (frame.offset % udp::kSegmentSize != 0 || segment >= state.segments.Size()
+        || frame.data.size() != std::min<std::uint64_t>(udp::kSegmentSize,
+                                                         file_context.file_size - frame.offset)) {
+        spdlog::warn("Ignoring a malformed segment at offset {} of file {}",
+                     frame.offset,
+                     file_context.file_name);
+        co_return;
+    }
+    if (state.segments.Test(segment)) {
+        co_return;
+    }
+
+    try {
+        co_await bandwidth_limiter_.Acquire(static_cast<double>(frame.data.size()));
+        if (session->status != ReceiveSessionStatus::kWorking) {
+            co_return;
+        }
+
+        // Segments of a session are handled one at a time, the stream has no other writer.
+        // The last one is flushed before it is acknowledged, the sender verifies right after.
+        auto stream = state.stream;
+        bool last_segment = state.segments.Count() + 1 == state.segments.Size();
+        co_await ComputePool::Run(
+            "segment-write",
+            [&frame, &file_context, stream, last_segment]() {
+                if (!stream->is_open()) {
+                    OpenTempFile(*stream, file_context.temp_file_path, file_context.file_name);
+                }
+                stream->seekp(static_cast<std::streamoff>(frame.offset));
+                stream->write(reinterpret_cast<const char*>(frame.data.data()),
+                              static_cast<std::streamsize>(frame.data.size()));
+                if (!*stream) {
+                    throw std::runtime_error(
+                        std::format("Failed to write segment to temporary file {} for file {}",
+                                    file_context.temp_file_path.string(),
+                                    file_context.file_name));
+                }
+                if (last_segment) {
+                    stream->close();
+                }
+            });
+        // Ending the session meanwhile dropped the state of its files
+        if (session->status != ReceiveSessionStatus::kWorking) {
+            stream.reset();
+            doCleanup(*session);
+            co_return;
+        }
+        state.segments.Set(segment);
+
+        // A segment may end in the next chunk
+        bool chunk_completed = false;
+        std::uint64_t position = frame.offset;
+        std::uint64_t end = frame.offset + frame.data.size();
+        while (position < end) {
+            std::size_t chunk = position / file_context.chunk_size;
+            std::uint64_t chunk_end = std::min<std::uint64_t>((chunk + 1) * file_context.chunk_size,
+                                                              end);
+            state.chunk_missing_bytes[chunk] -= chunk_end - position;
+            if (state.chunk_missing_bytes[chunk] == 0) {
+                file_context.received_chunks.Set(chunk);
+                chunk_completed = true;
+            }
+            position = chunk_end;
+        }
+        reportReceiveProgress(*session,
+                              state.file_id,
+                              file_context,
+                              std::min<std::uint64_t>(file_context.file_size,
+                                                      state.segments.Count() * udp::kSegmentSize));
+
+        // Polled once per chunk, as for chunks sent over HTTPS
+        if (chunk_completed && cancel_condition_ && cancel_condition_(session->session_id)) {
+            spdlog::info("receiver cancelled the session {}", session->session_id);
+            session->udp_receiver->Close(CloseReason::kCancelled);
+            endSession(session->session_id);
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Error processing UDP data: {}", e.what());
+        endSession(session->session_id);
+
+        // feedback session failed
+        feedback(Feedback{
+            .type = FeedbackType::kReceiveSessionEnded,
+            .data = feedback::ReceiveSessionEnd{
+                .session_id = session->session_id,
                 .success = false,
                 .error_message = e.what(),
             },
         });
-        co_return HttpServer::InternalServerError(req.version(), req.keep_alive(), e.what());
     }
 }
 
@@ -355,56 +914,61 @@ net::awaitable<http::response<http::string_body>> ReceiveController::onVerifyInt
     const http::request<http::string_body>& req) {
     spdlog::debug("ReceiveController::OnVerifyIntegrity");
 
-    if (session_status_ != ReceiveSessionStatus::kWorking) {
+    VerifyIntegrityDto verify_integrity_dto;
+    try {
+        verify_integrity_dto = DtoReader::ReadVerifyIntegrity(req.body());
+    } catch (const std::exception& e) {
+        spdlog::error("Error parsing request: {}", e.what());
+        co_return HttpServer::BadRequest(req.version(), req.keep_alive(), "invalid data");
+    }
+
+    auto session = findSession(verify_integrity_dto.session_id, ReceiveSessionStatus::kWorking);
+    if (session == nullptr) {
         spdlog::info("Chunk data sent when receive session is already cancelled by sender");
         co_return HttpServer::Forbidden(req.version(), req.keep_alive(), "sender cancelled");
     }
 
     // This should be polling the event stream to check the ui operation
-    if (cancel_condition_()) {
-        spdlog::info("receiver cancelled the session");
-        resetToIdle();
+    if (cancel_condition_ && cancel_condition_(session->session_id)) {
+        spdlog::info("receiver cancelled the session {}", session->session_id);
+        endSession(session->session_id);
         co_return HttpServer::Forbidden(req.version(), req.keep_alive(), "receiver cancelled");
     }
 
     try {
-        VerifyIntegrityDto verify_integrity_dto;
-        try {
-            json data = json::parse(req.body());
-            nlohmann::from_json(data, verify_integrity_dto);
-        } catch (const std::exception& e) {
-            spdlog::error("Error parsing request: {}", e.what());
-            co_return HttpServer::BadRequest(req.version(), req.keep_alive(), "invalid data");
-        }
-
-        // Check if the session ID matches
-        if (verify_integrity_dto.session_id != session_id_) {
-            throw std::runtime_error(std::format("Session ID mismatch: expected {}, got {}",
-                                                 session_id_,
-                                                 verify_integrity_dto.session_id));
-        }
-
         // Check if file_id is valid
-        if (auto iter = received_files_.find(verify_integrity_dto.file_id);
-            iter != received_files_.end()) {
+        if (auto iter = session->files.find(verify_integrity_dto.file_id);
+            iter != session->files.end()) {
             auto& file_context = iter->second;
             // Check if the file token matches
             if (file_context.file_token == verify_integrity_dto.file_token) {
                 // Check if the file is complete
-                if (file_context.received_chunks.size() != file_context.total_chunks) {
-                    spdlog::error("File {} is not completely received ({} of {} chunks)",
-                                  file_context.file_name,
-                                  file_context.received_chunks.size(),
-                                  file_context.total_chunks);
+                if (!file_context.received_chunks.IsComplete()) {
+                    auto first_missing = file_context.received_chunks.FirstMissing().value_or(0);
+                    spdlog::error(
+                        "File {} is not completely received ({} of {} chunks, chunk {} missing)",
+                        file_context.file_name,
+                        file_context.received_chunks.Count(),
+                        file_context.total_chunks,
+                        first_missing);
                     throw std::runtime_error(
                         std::format("File {} is not completely received ({} of {} chunks)",
                                     file_context.file_name,
-                                    file_context.received_chunks.size(),
+                                    file_context.received_chunks.Count(),
                                     file_context.total_chunks));
                 }
-                // Verify the file checksum
-                auto actual_checksum = FileHasher::CalculateFileChecksum(
-                    file_context.temp_file_path);
+                // Verify the file checksum on the compute pool
+                auto actual_checksum = co_await ComputePool::Run(
+                    "file-checksum",
+                    [temp_file_path = file_context.temp_file_path]() {
+                        return FileHasher::CalculateFileChecksum(temp_file_path);
+                    });
+                if (session->status != ReceiveSessionStatus::kWorking) {
+                    spdlog::info("Receive session ended while the file was being verified");
+                    co_return HttpServer::Forbidden(req.version(),
+                                                    req.keep_alive(),
+                                                    "sender cancelled");
+                }
                 if (actual_checksum != file_context.file_checksum) {
                     spdlog::debug("File checksum: {}, actual checksum: {}",
                                   file_context.file_checksum,
@@ -415,7 +979,6 @@ net::awaitable<http::response<http::string_body>> ReceiveController::onVerifyInt
                                     verify_integrity_dto.file_id,
                                     verify_integrity_dto.session_id));
                 }
-
                 fs::path final_file_path = save_dir_ / file_context.file_name;
                 // Add suffix if the file already exists
                 if (fs::exists(final_file_path)) {
@@ -447,19 +1010,19 @@ net::awaitable<http::response<http::string_body>> ReceiveController::onVerifyInt
                              file_context.file_name,
                              final_file_path.string());
 
-                completed_file_count_++;
+                session->completed_file_count++;
 
                 // feedback file receiving completed
                 feedback(Feedback{
                     .type = FeedbackType::kFileReceivingCompleted,
                     .data = feedback::FileReceivingCompleted{
-                        .session_id = session_id_,
+                        .session_id = session->session_id,
                         .filename = file_context.file_name,
                     },
                 });
 
                 // Check if all files in the session are completed
-                checkSessionCompletion();
+                checkSessionCompletion(*session);
 
                 co_return HttpServer::Ok(req.version(), req.keep_alive(), "ok");
             } else {
@@ -476,13 +1039,13 @@ net::awaitable<http::response<http::string_body>> ReceiveController::onVerifyInt
 
     } catch (const std::exception& e) {
         spdlog::error("Error processing file integrity verification: {}", e.what());
-        resetToIdle();
+        endSession(session->session_id);
 
         // feedback session failed
         feedback(Feedback{
             .type = FeedbackType::kReceiveSessionEnded,
             .data = feedback::ReceiveSessionEnd{
-                .session_id = session_id_,
+                .session_id = session->session_id,
                 .success = false,
                 .error_message = e.what(),
             },
@@ -494,43 +1057,42 @@ net::awaitable<http::response<http::string_body>> ReceiveController::onVerifyInt
 net::awaitable<boost::beast::http::response<boost::beast::http::string_body>>
 ReceiveController::onCancelSend(const http::request<boost::beast::http::string_body>& req) {
     spdlog::debug("ReceiveController::OnCancelSend");
-    if (session_status_ != ReceiveSessionStatus::kWorking) {
-        spdlog::info(
-            "cancel send request sent when receive session is already cancelled by sender");
-        co_return HttpServer::Ok(req.version(), req.keep_alive(), "Not receiving");
-    }
-
     try {
         std::string session_id;
         try {
-            json data = json::parse(req.body());
-            session_id = data["session_id"].get<std::string>();
+            session_id = DtoReader::ReadSessionId(req.body());
         } catch (const std::exception& e) {
             spdlog::error("Error parsing request: {}", e.what());
             // NEW
             co_return HttpServer::BadRequest(req.version(), req.keep_alive(), "invalid data");
         }
 
-        if (session_id == session_id_) {
-            // Cancel the session
-            resetToIdle();
+        auto it = sessions_.find(session_id);
+        if (it == sessions_.end()) {
+            spdlog::info(
+                "cancel send request sent when receive session is already cancelled by sender");
+            co_return HttpServer::Ok(req.version(), req.keep_alive(), "Not receiving");
+        }
 
-            spdlog::info("Session {} is cancelled by the sender", session_id);
+        // Cancel the session
+        std::size_t chunks_aborted = it->second->chunk_cancellations.size();
+        endSession(session_id);
 
-            // feedback session cancelled
-            feedback(Feedback{
-                .type = FeedbackType::kReceiveSessionEnded,
-                .data = feedback::ReceiveSessionEnd{
-                    .session_id = session_id_,
-                    .success = false,
-                    .cancelled_by_sender = true,
-                },
-            });
+        spdlog::info("Session {} is cancelled by the sender, {} chunk(s) being received aborted",
+                     session_id,
+                     chunks_aborted);
 
-            co_return HttpServer::Ok(req.version(), req.keep_alive());
-        } else {
-            throw std::runtime_error("Invalid session ID: " + session_id);
-        }
+        // feedback session cancelled
+        feedback(Feedback{
+            .type = FeedbackType::kReceiveSessionEnded,
+            .data = feedback::ReceiveSessionEnd{
+                .session_id = session_id,
+                .success = false,
+                .cancelled_by_sender = true,
+            },
+        });
+
+        co_return HttpServer::Ok(req.version(), req.keep_alive());
     } catch (const std::exception& e) {
         spdlog::error("Error processing cancel request: {}", e.what());
         co_return HttpServer::InternalServerError(req.version(), req.keep_alive(), e.what());
@@ -540,12 +1102,6 @@ ReceiveController::onCancelSend(const http::request<boost::beast::http::string_b
 net::awaitable<boost::beast::http::response<boost::beast::http::string_body>>
 ReceiveController::onCancelWait(const http::request<boost::beast::http::string_body>& req) {
     spdlog::debug("ReceiveController::OnCancelWait");
-    if (session_status_ != ReceiveSessionStatus::kWorking) {
-        spdlog::info(
-            "cancel wait request sent when receive session is already cancelled by sender");
-        co_return HttpServer::Ok(req.version(), req.keep_alive(), "Not waiting");
-    }
-
     try {
         std::string ip;
         unsigned short port;
@@ -558,26 +1114,35 @@ ReceiveController::onCancelWait(const http::request<boost::beast::http::string_b
             co_return HttpServer::BadRequest(req.version(), req.keep_alive(), "invalid data");
         }
 
-        if (ip == sender_ip_ && port == sender_port_) {
-            resetToIdle();
+        // The body only names the sender, a session is cancelled from the host that requested it
+        std::string peer_ip(req[ApiHeader::kPeerAddress]);
+        std::vector<SessionId> waiting_sessions;
+        for (const auto& [session_id, session] : sessions_) {
+            if (session->status == ReceiveSessionStatus::kWaiting && session->sender_ip == ip
+                && session->sender_port == port && session->peer_ip == peer_ip) {
+                waiting_sessions.push_back(session_id);
+            }
+        }
+        if (waiting_sessions.empty()) {
+            spdlog::info(
+                "cancel wait request sent when receive session is already cancelled by sender");
+            co_return HttpServer::Ok(req.version(), req.keep_alive(), "Not waiting");
+        }
+
+        for (const auto& session_id : waiting_sessions) {
+            endSession(session_id);
             spdlog::info("Wait for user confirmation is cancelled by the sender");
 
             // feedback session cancelled
             feedback(Feedback{
                 .type = FeedbackType::kReceiveSessionEnded,
                 .data = feedback::ReceiveSessionEnd{
-                    .session_id = session_id_,
+                    .session_id = session_id,
                     .success = false,
                     .cancelled_by_sender = true,
                 },
             });
-            co_return HttpServer::Ok(req.version(), req.keep_alive());
-        } else {
-            co_return HttpServer::Forbidden(req.version(),
-                                            req.keep_alive(),
-                                            "invalid sender ip or port");
         }
-
         co_return HttpServer::Ok(req.version(), req.keep_alive());
     } catch (const std::exception& e) {
         spdlog::error("Error processing cancel wait request: {}", e.what());
@@ -586,109 +1151,275 @@ ReceiveController::onCancelWait(const http::request<boost::beast::http::string_b
 }
 
 boost::asio::awaitable<std::optional<std::vector<FileDto>>> ReceiveController::waitForUserConfirmation(
-    std::string device_id, const std::vector<FileDto>& files, int timeout_seconds) {
+    std::shared_ptr<ReceiveSession> session,
+    const std::vector<FileDto>& files,
+    int timeout_seconds) {
     if (wait_condition_ == nullptr) {
         spdlog::warn("No wait condition function set, automatically accepting all files");
         co_return files;
     }
 
-    auto executor = co_await net::this_coro::executor;
-    std::optional<std::vector<FileDto>> result = std::nullopt;
+    session->confirm_signal = std::make_shared<net::steady_timer>(
+        co_await net::this_coro::executor);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_seconds);
 
-    bool timeout = false;
-    auto confirmation_task = [&]() -> net::awaitable<void> {
-        auto start_time = std::chrono::steady_clock::now();
-        while (session_status_ == ReceiveSessionStatus::kWorking) {
-            if (auto filenames = wait_condition_(); filenames) {
+    try {
+        // The answer may already be there, otherwise sleep until NotifyConfirmation(),
+        // endSession() or the deadline wakes us up
+        while (session->status == ReceiveSessionStatus::kWaiting) {
+            if (auto accepted = wait_condition_(session->session_id); accepted) {
+                if (session->confirm_notified_at) {
+                    spdlog::debug("Session {} woke up {}us after the user's confirmation",
+                                  session->session_id,
+                                  std::chrono::duration_cast<std::chrono::microseconds>(
+                                      std::chrono::steady_clock::now()
+                                      - *session->confirm_notified_at)
+                                      .count());
+                }
+                // Answers name files by id, or by name from older frontends
+                std::unordered_set<std::string_view> accepted_set(accepted->begin(),
+                                                                  accepted->end());
                 std::vector<FileDto> accepted_files;
-                for (auto file : files) {
-                    if (auto iter = std::ranges::find(filenames.value(), file.file_name);
-                        iter != filenames->end()) {
+                for (const auto& file : files) {
+                    if (accepted_set.contains(file.file_id)
+                        || accepted_set.contains(file.file_name)) {
                         accepted_files.emplace_back(file);
                     }
                 }
-                co_return;
-            } else {
-                auto duration = std::chrono::steady_clock::now() - start_time;
-                if (std::chrono::duration_cast<std::chrono::seconds>(duration).count()
-                    >= timeout_seconds) {
-                    timeout = true;
-                    spdlog::info("Timeout waiting for user confirmation, automatically declining");
-                    co_return;
-                }
-                co_await net::post(executor);
+                co_return accepted_files;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                spdlog::info("Timeout waiting for user confirmation, automatically declining");
+                co_return std::nullopt;
             }
-        }
-    };
 
-    try {
-        co_await confirmation_task();
+            session->confirm_signal->expires_at(deadline);
+            boost::system::error_code ec;
+            co_await session->confirm_signal->async_wait(
+                net::redirect_error(net::use_awaitable, ec));
+        }
     } catch (const std::exception& e) {
         spdlog::error("Error waiting for user confirmation: {}", e.what());
     }
 
-    co_return result;
+    co_return std::nullopt;
 }
 
 void ReceiveController::installRoutes() {
     server_.AddRoute(ApiRoute::kRequestSend.data(),
                      http::verb::post,
-                     std::bind(&ReceiveController::onRequestSend, this, std::placeholders::_1));
+                     onStrand(&ReceiveController::onRequestSend));
+    server_.AddRoute(ApiRoute::kManifestPage.data(),
+                     http::verb::post,
+                     onStrand(&ReceiveController::onManifestPage));
     server_.AddRoute(ApiRoute::kSendChunk.data(),
                      http::verb::post,
-                     std::bind(&ReceiveController::onSendChunk, this, std::placeholders::_1));
+                     [this](RequestStream& body) { return onSendChunk(body); });
     server_.AddRoute(ApiRoute::kVerifyIntegrity.data(),
                      http::verb::post,
-                     std::bind(&ReceiveController::onVerifyIntegrity, this, std::placeholders::_1));
+                     onStrand(&ReceiveController::onVerifyIntegrity));
     server_.AddRoute(ApiRoute::kCancelSend.data(),
                      http::verb::post,
-                     std::bind(&ReceiveController::onCancelSend, this, std::placeholders::_1));
+                     onStrand(&ReceiveController::onCancelSend));
+    // The sender's client sends it as a GET with a body
+    server_.AddRoute(ApiRoute::kCancelWait.data(),
+                     http::verb::get,
+                     onStrand(&ReceiveController::onCancelWait));
+}
+
+std::shared_ptr<ReceiveSession> ReceiveController::findSession(const SessionId& session_id,
+                                                               ReceiveSessionStatus status) {
+    if (auto it = sessions_.find(session_id);
+        it != sessions_.end() && it->second->status == status) {
+        return it->second;
+    }
+    return nullptr;
 }
 
-void ReceiveController::doCleanup() {
-    if (session_id_.empty() || received_files_.empty()) {
+void ReceiveController::endSession(const SessionId& session_id) {
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end()) {
         return;
     }
-    for (const auto& [file_id, file_context] : received_files_) {
-        if (fs::exists(file_context.temp_file_path)) {
-            spdlog::info("Cleaning up unfinished temp file of \"{}\"", file_context.file_name);
-            fs::remove(file_context.temp_file_path);
+    // Handlers still holding the session see it ended once they resume
+    it->second->status = ReceiveSessionStatus::kIdle;
+    for (const auto& [file_id, file_context] : it->second->files) {
+        progress_.Remove(ProgressKey(session_id, file_id));
+    }
+    if (it->second->confirm_signal) {
+        it->second->confirm_signal->cancel();
+    }
+    // Chunks being received stop reading now, not once their bodies are complete
+    for (const auto& abort : it->second->chunk_cancellations) {
+        abort->aborted = true;
+        net::post(abort->executor,
+                  [abort]() { abort->signal.emit(net::cancellation_type::terminal); });
+    }
+    if (it->second->udp_receiver) {
+        it->second->udp_receiver->Close();
+    }
+    it->second->udp_files.clear(); // Closes the temp files before they are removed
+    doCleanup(*it->second);
+    {
+        std::lock_guard<std::mutex> lock(active_peers_mutex_);
+        if (auto peer = active_peers_.find(it->second->peer_ip);
+            peer != active_peers_.end() && --peer->second == 0) {
+            active_peers_.erase(peer);
+        }
+    }
+    sessions_.erase(it);
+    spdlog::debug("Session {} ended, {} sessions left", session_id, sessions_.size());
 
-            // Since the files are sent in order, we can assume that the last file is the one
-            // that was being sent when the session was cancelled
+    // A slot is free, the next queued sender is admitted right away
+    wakeAdmissionQueue();
+}
+
+net::awaitable<bool> ReceiveController::waitForAdmission(std::string& ticket) {
+    purgeManifestSessions();
+    purgeAdmissionQueue();
+
+    std::shared_ptr<AdmissionTicket> entry;
+    if (!ticket.empty()) {
+        if (auto it = std::ranges::find_if(admission_queue_,
+                                           [&ticket](const auto& queued) {
+                                               return queued->ticket == ticket;
+                                           });
+            it != admission_queue_.end() && !(*it)->polling) {
+            entry = *it;
+        }
+    }
+    if (entry == nullptr) {
+        // Nobody is waiting, no need to queue
+        if (admission_queue_.empty() && sessions_.size() < sessionCapacity()) {
+            co_return true;
+        }
+        boost::uuids::random_generator uuid_gen;
+        entry = std::make_shared<AdmissionTicket>();
+        entry->ticket = boost::uuids::to_string(uuid_gen());
+        entry->timer = std::make_shared<net::steady_timer>(co_await net::this_coro::executor);
+        admission_queue_.push_back(entry);
+        spdlog::info("The receiver is busy, sender queued at position {}", admission_queue_.size());
+    }
+
+    // A polling entry is never purged, the queue holds it for as long as the request waits
+    entry->polling = true;
+    auto poll_deadline = std::chrono::steady_clock::now() + kAdmissionLongPoll;
+    while (true) {
+        purgeManifestSessions();
+        purgeAdmissionQueue();
+        if (!admission_queue_.empty() && admission_queue_.front() == entry
+            && sessions_.size() < sessionCapacity()) {
+            admission_queue_.pop_front();
+            wakeAdmissionQueue();
+            co_return true;
+        }
+        if (std::chrono::steady_clock::now() >= poll_deadline) {
             break;
         }
+
+        // Woken by wakeAdmissionQueue() when a slot frees up, or by the long-poll deadline
+        entry->timer->expires_at(poll_deadline);
+        boost::system::error_code ec;
+        co_await entry->timer->async_wait(net::redirect_error(net::use_awaitable, ec));
     }
+
+    // Keep the place in the queue for the sender's next request
+    entry->polling = false;
+    entry->expires_at = std::chrono::steady_clock::now() + kTicketGracePeriod;
+    ticket = entry->ticket;
+    co_return false;
 }
 
-void ReceiveController::checkSessionCompletion() {
-    if (!session_id_.empty()) {
-        if (!received_files_.empty() && completed_file_count_ == received_files_.size()) {
-            spdlog::info("All files in session {} have been received successfully.", session_id_);
-            resetToIdle();
+void ReceiveController::wakeAdmissionQueue() {
+    purgeAdmissionQueue();
+    if (!admission_queue_.empty() && sessions_.size() < sessionCapacity()) {
+        if (auto& head = admission_queue_.front(); head->polling) {
+            head->timer->cancel();
+        }
+    }
+}
 
-            // feedback session completeds
-            feedback(Feedback{
-                .type = FeedbackType::kReceiveSessionEnded,
-                .data = feedback::ReceiveSessionEnd{
-                    .session_id = session_id_,
-                    .success = true,
-                },
-            });
-        } else {
-            spdlog::info("Session {} is still in progress.", session_id_);
+void ReceiveController::purgeAdmissionQueue() {
+    // Senders that gave up do not come back with their ticket
+    auto now = std::chrono::steady_clock::now();
+    std::erase_if(admission_queue_, [now](const auto& entry) {
+        return !entry->polling && entry->expires_at <= now;
+    });
+}
+
+void ReceiveController::purgeManifestSessions() {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<SessionId> expired;
+    for (const auto& [session_id, session] : sessions_) {
+        if (session->status == ReceiveSessionStatus::kManifest
+            && session->manifest_expires_at <= now) {
+            expired.push_back(session_id);
         }
     }
+    for (const auto& session_id : expired) {
+        spdlog::warn("Session {} received no manifest page for {} seconds, ending it",
+                     session_id,
+                     kManifestIdleTimeout.count());
+        endSession(session_id);
+    }
 }
 
-void ReceiveController::resetToIdle() {
-    doCleanup();
-    session_id_.clear();
-    session_status_ = ReceiveSessionStatus::kIdle;
-    received_files_.clear();
-    completed_file_count_ = 0;
-    sender_ip_.clear();
-    sender_port_ = 0;
+std::size_t ReceiveController::sessionCapacity() const {
+    return std::max<std::size_t>(1, settings.max_receive_sessions);
+}
+
+void ReceiveController::doCleanup(const ReceiveSession& session) {
+    for (const auto& [file_id, file_context] : session.files) {
+        std::error_code ec;
+        if (fs::exists(file_context.temp_file_path, ec)) {
+            spdlog::info("Cleaning up unfinished temp file of \"{}\"", file_context.file_name);
+            fs::remove(file_context.temp_file_path, ec);
+        }
+    }
+}
+
+void ReceiveController::reportReceiveProgress(const ReceiveSession& session,
+                                              const FileId& file_id,
+                                              const ReceiveFileContext& file_context,
+                                              std::uint64_t bytes_received) {
+    // feedback file receiving progress, coalesced to settings.progress_rate_hz
+    if (auto sample = progress_.Update(ProgressKey(session.session_id, file_id),
+                                       bytes_received,
+                                       file_context.file_size);
+        sample) {
+        feedback(Feedback{
+            .type = FeedbackType::kFileReceivingProgress,
+            .data = feedback::FileReceivingProgress{
+                .session_id = session.session_id,
+                .filename = file_context.file_name,
+                .progress = sample->progress,
+                .bytes_transferred = sample->bytes_transferred,
+                .total_bytes = sample->total_bytes,
+                .throughput = sample->throughput,
+                .average_throughput = sample->average_throughput,
+                .eta_seconds = sample->eta_seconds,
+            },
+        });
+    }
+}
+
+void ReceiveController::checkSessionCompletion(const ReceiveSession& session) {
+    if (!session.files.empty() && session.completed_file_count == session.files.size()) {
+        SessionId session_id = session.session_id;
+        spdlog::info("All files in session {} have been received successfully.", session_id);
+        endSession(session_id);
+
+        // feedback session completeds
+        feedback(Feedback{
+            .type = FeedbackType::kReceiveSessionEnded,
+            .data = feedback::ReceiveSessionEnd{
+                .session_id = session_id,
+                .success = true,
+            },
+        });
+    } else {
+        spdlog::info("Session {} is still in progress.", session.session_id);
+    }
 }
 
 } // namespace lansend::core
\ No newline at end of file
@@ -12,10 +12,14 @@
 #include <boost/beast/http.hpp>
 #include <boost/beast/ssl.hpp>
 #include <boost/beast/version.hpp>
+#include <core/constant/mux.h>
+#include <core/constant/route.h>
 #include <core/constant/transfer.h>
 #include <core/network/server/controller/common_controller.h>
 #include <core/network/server/controller/receive_controller.h>
 #include <core/network/server/http_server.h>
+#include <core/util/config.h>
+#include <core/util/memory_governor.h>
 
 namespace lansend::core {
 
@@ -62,6 +66,15 @@ void HttpServer::AddRoute(const std::string& path,
     spdlog::info(std::format("Added route: {} {}", std::string(http::to_string(method)), path));
 }
 
+void HttpServer::AddRoute(const std::string& path,
+                          boost::beast::http::verb method,
+                          StreamRequestHandler&& handler) {
+    routes_[path] = {method, RequestType::kStream, std::move(handler)};
+    spdlog::info(std::format("Added streaming route: {} {}",
+                             std::string(http::to_string(method)),
+                             path));
+}
+
 void HttpServer::Start(uint16_t port) {
     if (running_) {
         spdlog::warn("Server is already running.");
@@ -180,14 +193,26 @@ HttpResponse HttpServer::MethodNotAllowed(unsigned int version,
 boost::asio::awaitable<void> HttpServer::acceptConnections() {
     while (running_) {
         try {
-            tcp::socket socket = co_await acceptor_.async_accept();
-            spdlog::info(std::format("Accepted connection from: {}",
-                                     std::string(socket.remote_endpoint().address().to_string())));
+            // Every connection gets its own strand, so connections are served in parallel by
+            // the worker threads while a single connection never runs on two threads at once
+            auto strand = net::make_strand(io_context_);
+            tcp::socket socket = co_await acceptor_.async_accept(strand, net::use_awaitable);
+            std::string peer_ip = socket.remote_endpoint().address().to_string();
+
+            // Checked before the TLS handshake, a rejected peer costs no CPU
+            if (!admitConnection(peer_ip)) {
+                beast::error_code ec;
+                socket.close(ec);
+                continue;
+            }
+            spdlog::info(std::format("Accepted connection from: {}", peer_ip));
 
             beast::ssl_stream<beast::tcp_stream> stream(beast::tcp_stream(std::move(socket)),
                                                         ssl_context_);
 
-            net::co_spawn(io_context_, handleConnection(std::move(stream)), net::detached);
+            net::co_spawn(strand,
+                          handleConnection(std::move(stream), std::move(peer_ip)),
+                          net::detached);
         } catch (const boost::system::system_error& e) {
             if (e.code() == net::error::operation_aborted) {
                 spdlog::info("Accept operation cancelled.");
@@ -202,13 +227,61 @@ boost::asio::awaitable<void> HttpServer::acceptConnections() {
     spdlog::info("Stopped accepting connections.");
 }
 
-boost::asio::awaitable<void> HttpServer::handleConnection(ssl::stream<beast::tcp_stream> stream) {
+bool HttpServer::admitConnection(const std::string& peer_ip) {
+    // Peers already transferring to us keep getting through when the server is saturated
+    bool priority = receive_controller_->HasActiveSession(peer_ip);
+
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    if (peers_.size() >= kMaxTrackedPeers) {
+        std::erase_if(peers_, [](const auto& entry) { return entry.second.active == 0; });
+    }
+    auto [it, inserted] = peers_.try_emplace(peer_ip);
+    auto& peer = it->second;
+    if (inserted) {
+        peer.handshakes.SetRate(settings.peer_handshake_rate);
+    }
+
+    std::string_view reason;
+    if (settings.max_peer_connections > 0 && peer.active >= settings.max_peer_connections) {
+        reason = "too many connections from peer";
+    } else if (!priority && settings.max_connections > 0
+               && active_connections_ >= settings.max_connections) {
+        reason = "connection limit reached";
+    } else if (!priority && !peer.handshakes.TryAcquire()) {
+        reason = "handshake rate exceeded";
+    }
+    if (!reason.empty()) {
+        // Debug only, a reconnect storm would flood the log otherwise
+        spdlog::debug("Rejected connection from {}: {} ({} active, {} from peer)",
+                      peer_ip,
+                      reason,
+                      active_connections_,
+                      peer.active);
+        return false;
+    }
+
+    peer.active++;
+    active_connections_++;
+    return true;
+}
+
+void HttpServer::releaseConnection(const std::string& peer_ip) {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    active_connections_--;
+    if (auto it = peers_.find(peer_ip); it != peers_.end() && it->second.active > 0) {
+        it->second.active--;
+    }
+}
+
+boost::asio::awaitable<void> HttpServer::handleConnection(ssl::stream<beast::tcp_stream> stream,
+                                                          std::string peer_ip) {
     try {
         auto& socket = stream.next_layer().socket();
         auto endpoint = socket.remote_endpoint();
         auto endpoint_ip_str = endpoint.address().to_string();
         spdlog::info("New connection from: {}:{}", endpoint_ip_str, endpoint.port());
 
+        beast::get_lowest_layer(stream).expires_after(kHandshakeTimeout);
         co_await stream.async_handshake(ssl::stream_base::server, net::use_awaitable);
         spdlog::debug("SSL handshake completed successfully");
 
@@ -219,19 +292,70 @@ boost::asio::awaitable<void> HttpServer::handleConnection(ssl::stream<beast::tcp
             try {
                 beast::get_lowest_layer(stream).expires_after(std::chrono::seconds(30));
 
-                http::request_parser<http::vector_body<uint8_t>> parser;
-                parser.body_limit(transfer::kMaxChunkSize + 8);
+                // The header comes first, the route decides whether the body is buffered
+                http::request_parser<http::empty_body> header_parser;
+                header_parser.body_limit(transfer::kMaxChunkSize + 8);
 
                 spdlog::debug("Waiting for client request...");
-                co_await http::async_read(stream, buffer, parser);
-                auto req = parser.release();
-
-                spdlog::info("Received {} request for {}", req.method_string(), req.target());
-
-                keep_alive = req.keep_alive();
+                co_await http::async_read_header(stream, buffer, header_parser);
+
+                const auto& header = header_parser.get();
+                spdlog::info("Received {} request for {}", header.method_string(), header.target());
+
+                keep_alive = header.keep_alive();
+                unsigned int version = header.version();
+
+                if (std::string(header.target()) == ApiRoute::kMux
+                    && header.method() == http::verb::get
+                    && beast::iequals(header[http::field::upgrade], mux::kProtocol)) {
+                    HttpResponse upgrade{http::status::switching_protocols, version};
+                    upgrade.set(http::field::connection, "Upgrade");
+                    upgrade.set(http::field::upgrade, mux::kProtocol);
+                    co_await http::async_write(stream, upgrade);
+                    co_await serveMux(stream, buffer, peer_ip);
+                    break;
+                }
 
-                HttpResponse res = co_await handleRequest(std::move(req));
+                HttpResponse res;
+                if (const auto* handler = findStreamHandler(header); handler) {
+                    http::request_parser<http::buffer_body> parser(std::move(header_parser));
+                    parser.body_limit(transfer::kMaxChunkSize + 8);
+                    HttpRequestStream body(stream, buffer, parser);
+                    try {
+                        res = co_await (*handler)(body);
+                    } catch (const boost::system::system_error&) {
+                        throw;
+                    } catch (const std::exception& e) {
+                        spdlog::error("Error executing streaming handler: {}", e.what());
+                        res = InternalServerError(version, keep_alive, e.what());
+                    }
+                    // Whatever the handler left unread belongs to this request
+                    co_await body.Discard();
+                } else {
+                    // The body is buffered whole, its bytes are reserved before they are read.
+                    // While the budget is exhausted the socket is left unread, which pushes
+                    // back on the sender through TCP flow control. A request with neither a
+                    // length nor chunked encoding has no body.
+                    std::size_t body_size = header_parser.content_length().value_or(
+                        header_parser.chunked() ? transfer::kMaxChunkSize + 8 : 0);
+                    auto reservation = co_await MemoryGovernor::Reserve(body_size);
+                    beast::get_lowest_layer(stream).expires_after(std::chrono::seconds(30));
+
+                    http::request_parser<http::vector_body<uint8_t>> parser(
+                        std::move(header_parser));
+                    parser.body_limit(transfer::kMaxChunkSize + 8);
+                    // Reserved ahead of the reader's own reserve, which then keeps the padding
+                    if (auto length = parser.content_length()) {
+                        parser.get().body().reserve(*length + transfer::kBodyPadding);
+                    }
+                    co_await http::async_read(stream, buffer, parser);
+                    // Only the read is paced, handlers may long-poll for many seconds
+                    reservation.Release();
+                    res = co_await handleRequest(parser.release(), peer_ip);
+                }
 
+                // Handlers may long-poll, the write gets its own deadline
+                beast::get_lowest_layer(stream).expires_after(std::chrono::seconds(30));
                 co_await http::async_write(stream, res);
 
                 if (!keep_alive) {
@@ -240,15 +364,7 @@ boost::asio::awaitable<void> HttpServer::handleConnection(ssl::stream<beast::tcp
                 }
             } catch (const boost::system::system_error& e) {
                 // Notify the receiver if the sender is lost
-                if (receive_controller_->session_status() == ReceiveSessionStatus::kWorking) {
-                    if (receive_controller_->sender_ip() == endpoint_ip_str
-                        && receive_controller_->sender_port() == endpoint.port()) {
-                        spdlog::error("Lost connection to sender {}:{} while receiving file",
-                                      endpoint_ip_str,
-                                      endpoint.port());
-                        receive_controller_->NotifySenderLost();
-                    }
-                }
+                receive_controller_->NotifySenderLost(endpoint_ip_str, endpoint.port());
 
                 if (e.code() == boost::beast::error::timeout || e.code() == boost::asio::error::eof
                     || e.code() == boost::asio::error::operation_aborted
@@ -276,10 +392,76 @@ boost::asio::awaitable<void> HttpServer::handleConnection(ssl::stream<beast::tcp
             spdlog::error("Session error: {}", error_msg);
         }
     }
+    releaseConnection(peer_ip);
     spdlog::info("Connection handling finished.");
 }
 
-boost::asio::awaitable<HttpResponse> HttpServer::handleRequest(HttpRequest&& req) {
+boost::asio::awaitable<void> HttpServer::serveMux(ssl::stream<beast::tcp_stream>& stream,
+                                                 beast::flat_buffer& buffer,
+                                                 const std::string& peer_ip) {
+    spdlog::debug("Connection switched to the multiplexed protocol");
+    auto leftover = buffer.data();
+    auto connection = std::make_shared<MuxConnection>(
+        stream,
+        false,
+        std::span<const std::uint8_t>(static_cast<const std::uint8_t*>(leftover.data()),
+                                      leftover.size()));
+    buffer.consume(buffer.size());
+
+    // Every request runs on its own stream, concurrently with the others on the connection
+    co_await connection->Run(
+        [this, peer_ip](std::shared_ptr<MuxStream> mux_stream) -> boost::asio::awaitable<void> {
+            co_await serveMuxStream(std::move(mux_stream), peer_ip);
+        });
+}
+
+boost::asio::awaitable<void> HttpServer::serveMuxStream(std::shared_ptr<MuxStream> stream,
+                                                        std::string peer_ip) {
+    const auto& header = stream->header();
+    spdlog::info("Received {} request for {} on stream {}",
+                 header.method_string(),
+                 header.target(),
+                 stream->id());
+    unsigned int version = header.version();
+
+    try {
+        HttpResponse res;
+        if (const auto* handler = findStreamHandler(header); handler) {
+            MuxRequestStream body(stream);
+            try {
+                res = co_await (*handler)(body);
+            } catch (const boost::system::system_error&) {
+                throw;
+            } catch (const std::exception& e) {
+                spdlog::error("Error executing streaming handler: {}", e.what());
+                res = InternalServerError(version, true, e.what());
+            }
+        } else {
+            // Buffered like on HTTP/1.1, the stream's credit holds the sender back meanwhile
+            constexpr std::uint64_t kMaxBodySize = transfer::kMaxChunkSize + 8;
+            std::uint64_t body_size = stream->IsDone() ? 0 : kMaxBodySize;
+            auto reservation = co_await MemoryGovernor::Reserve(
+                std::min(stream->ContentLength().value_or(body_size), kMaxBodySize));
+            BinaryRequest req(stream->header());
+            req.body() = co_await stream->ReadAll(kMaxBodySize, transfer::kBodyPadding);
+            reservation.Release();
+            res = co_await handleRequest(std::move(req), peer_ip);
+        }
+        stream->Respond(res);
+    } catch (const boost::system::system_error& e) {
+        // The stream was cancelled or the connection is gone
+        spdlog::debug("Stream {} ended: {}", stream->id(), e.code().message());
+        stream->Cancel();
+    } catch (const std::exception& e) {
+        spdlog::error("Error serving stream {}: {}", stream->id(), e.what());
+        stream->Respond(BadRequest(version, true, e.what()));
+    }
+}
+
+boost::asio::awaitable<HttpResponse> HttpServer::handleRequest(HttpRequest&& req,
+                                                              const std::string& peer_ip) {
+    // Replaces whatever the client sent under that name, handlers can trust it
+    req.set(ApiHeader::kPeerAddress, peer_ip);
     std::string path(req.target());
     auto it = routes_.find(path);
 
@@ -303,10 +485,10 @@ boost::asio::awaitable<HttpResponse> HttpServer::handleRequest(HttpRequest&& req
     try {
         HttpResponse res;
         if (route_info.type == RequestType::kString) {
-            auto handler = std::get<StringRequestHandler>(route_info.handler);
-            res = co_await handler(binaryToStringRequest(req));
+            const auto& handler = std::get<StringRequestHandler>(route_info.handler);
+            res = co_await handler(binaryToStringRequest(std::move(req)));
         } else {
-            auto handler = std::get<BinaryRequestHandler>(route_info.handler);
+            const auto& handler = std::get<BinaryRequestHandler>(route_info.handler);
             res = co_await handler(std::move(req));
         }
         co_return res;
@@ -316,20 +498,21 @@ boost::asio::awaitable<HttpResponse> HttpServer::handleRequest(HttpRequest&& req
     }
 }
 
-StringRequest HttpServer::binaryToStringRequest(const BinaryRequest& req) {
-    http::request<http::string_body> string_req;
-    string_req.method(req.method());
-    string_req.target(req.target());
-    string_req.version(req.version());
-
-    for (auto const& field : req)
-        string_req.set(field.name(), field.value());
-
-    std::string body_str(reinterpret_cast<const char*>(req.body().data()), req.body().size());
-    string_req.body() = std::move(body_str);
-    string_req.prepare_payload();
+const StreamRequestHandler* HttpServer::findStreamHandler(
+    const http::request_header<>& header) const {
+    auto it = routes_.find(std::string(header.target()));
+    if (it == routes_.end() || it->second.type != RequestType::kStream
+        || it->second.method != header.method()) {
+        return nullptr;
+    }
+    return &std::get<StreamRequestHandler>(it->second.handler);
+}
 
-    return string_req;
+StringRequest HttpServer::binaryToStringRequest(BinaryRequest&& req) {
+    // The header is moved over as is, only the body bytes are copied
+    const auto& body = req.body();
+    std::string body_str(reinterpret_cast<const char*>(body.data()), body.size());
+    return StringRequest(std::move(req.base()), std::move(body_str));
 }
 
 } // namespace lansend::core
\ No newline at end of file
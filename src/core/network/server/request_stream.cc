@@ -0,0 +1,71 @@
+#include <array>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <chrono>
+#include <core/network/server/request_stream.h>
+#include <stdexcept>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+namespace lansend::core {
+
+HttpRequestStream::HttpRequestStream(Stream& stream, beast::flat_buffer& buffer, Parser& parser)
+    : stream_(stream)
+    , buffer_(buffer)
+    , parser_(parser) {}
+
+net::awaitable<std::size_t> HttpRequestStream::ReadSome(std::span<std::uint8_t> out) {
+    std::size_t filled = 0;
+    // A read may only consume framing (chunk headers), keep going until data arrives
+    while (filled == 0 && !parser_.is_done()) {
+        auto& body = parser_.get().body();
+        body.data = out.data();
+        body.size = out.size();
+
+        // Every piece gets a fresh deadline, a slow but steady sender is not cut off
+        beast::get_lowest_layer(stream_).expires_after(std::chrono::seconds(30));
+        beast::error_code ec;
+        co_await http::async_read_some(stream_,
+                                       buffer_,
+                                       parser_,
+                                       net::redirect_error(net::use_awaitable, ec));
+        if (ec == http::error::need_buffer) {
+            ec = {};
+        }
+        if (ec) {
+            throw beast::system_error(ec);
+        }
+        filled = out.size() - body.size;
+    }
+    co_return filled;
+}
+
+MuxRequestStream::MuxRequestStream(std::shared_ptr<MuxStream> stream)
+    : stream_(std::move(stream)) {}
+
+net::awaitable<std::size_t> MuxRequestStream::ReadSome(std::span<std::uint8_t> out) {
+    co_return co_await net::co_spawn(stream_->connection().executor(),
+                                     stream_->ReadSome(out),
+                                     net::use_awaitable);
+}
+
+net::awaitable<void> RequestStream::ReadExact(std::span<std::uint8_t> out) {
+    while (!out.empty()) {
+        std::size_t n = co_await ReadSome(out);
+        if (n == 0) {
+            throw std::runtime_error("Request body ended early");
+        }
+        out = out.subspan(n);
+    }
+}
+
+net::awaitable<void> RequestStream::Discard() {
+    std::array<std::uint8_t, 16 * 1024> sink;
+    while (co_await ReadSome(sink) != 0) {
+    }
+}
+
+} // namespace lansend::core
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <array>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/endian/conversion.hpp>
+#include <core/network/udp/datagram.h>
+#include <core/security/file_encryptor.h>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+
+namespace lansend::core {
+
+static constexpr std::array<std::uint8_t, 2> kMagic{'L', 'U'};
+static constexpr std::uint8_t kVersion = 1;
+static constexpr std::size_t kHeaderSize = 2 + 1 + 1 + 8;
+static constexpr std::size_t kDataFrameHeaderSize = 4 + 8;
+static constexpr std::size_t kAckFrameHeaderSize = 8 + 4 + 2;
+static constexpr std::size_t kAckRangeSize = 8 + 8;
+
+static std::vector<std::uint8_t> Nonce(DatagramDirection direction, std::uint64_t packet_number) {
+    std::vector<std::uint8_t> nonce(FileEncryptor::IV_SIZE);
+    boost::endian::store_big_u32(nonce.data(), static_cast<std::uint32_t>(direction));
+    boost::endian::store_big_u64(nonce.data() + 4, packet_number);
+    return nonce;
+}
+
+std::vector<std::uint8_t> SealDatagram(DatagramType type,
+                                       DatagramDirection direction,
+                                       std::uint64_t packet_number,
+                                       const std::vector<std::uint8_t>& frame,
+                                       const std::vector<std::uint8_t>& key) {
+    std::vector<std::uint8_t> header(kHeaderSize);
+    header[0] = kMagic[0];
+    header[1] = kMagic[1];
+    header[2] = kVersion;
+    header[3] = static_cast<std::uint8_t>(type);
+    boost::endian::store_big_u64(header.data() + 4, packet_number);
+
+    std::vector<std::uint8_t> tag;
+    auto ciphertext = FileEncryptor::EncryptData(frame,
+                                                 key,
+                                                 Nonce(direction, packet_number),
+                                                 tag,
+                                                 header);
+    if (!ciphertext) {
+        throw std::runtime_error("Failed to seal datagram: " + ciphertext.error());
+    }
+
+    std::vector<std::uint8_t> datagram = std::move(header);
+    datagram.reserve(kHeaderSize + ciphertext->size() + tag.size());
+    datagram.insert(datagram.end(), ciphertext->begin(), ciphertext->end());
+    datagram.insert(datagram.end(), tag.begin(), tag.end());
+    return datagram;
+}
+
+std::optional<OpenedDatagram> OpenDatagram(std::span<const std::uint8_t> datagram,
+                                           DatagramDirection direction,
+                                           const std::vector<std::uint8_t>& key) {
+    if (datagram.size() < kHeaderSize + FileEncryptor::TAG_SIZE || datagram[0] != kMagic[0]
+        || datagram[1] != kMagic[1] || datagram[2] != kVersion) {
+        return std::nullopt;
+    }
+    auto type = static_cast<DatagramType>(datagram[3]);
+    if (type != DatagramType::kData && type != DatagramType::kAck
+        && type != DatagramType::kClose) {
+        return std::nullopt;
+    }
+    std::uint64_t packet_number = boost::endian::load_big_u64(datagram.data() + 4);
+
+    auto body_end = datagram.end() - FileEncryptor::TAG_SIZE;
+    std::vector<std::uint8_t> header(datagram.begin(), datagram.begin() + kHeaderSize);
+    std::vector<std::uint8_t> ciphertext(datagram.begin() + kHeaderSize, body_end);
+    std::vector<std::uint8_t> tag(body_end, datagram.end());
+
+    auto frame = FileEncryptor::DecryptData(ciphertext,
+                                            key,
+                                            Nonce(direction, packet_number),
+                                            tag,
+                                            header);
+    if (!frame) {
+        return std::nullopt;
+    }
+    return OpenedDatagram{type, packet_number, std::move(*frame)};
+}
+
+std::vector<std::uint8_t> EncodeDataFrame(std::uint32_t file_index,
+                                          std::uint64_t offset,
+                                          std::span<const std::uint8_t> data) {
+    std::vector<std::uint8_t> frame(kDataFrameHeaderSize + data.size());
+    boost::endian::store_big_u32(frame.data(), file_index);
+    boost::endian::store_big_u64(frame.data() + 4, offset);
+    std::copy(data.begin(), data.end(), frame.begin() + kDataFrameHeaderSize);
+    return frame;
+}
+
+std::optional<DataFrame> DecodeDataFrame(std::span<const std::uint8_t> frame) {
+    if (frame.size() <= kDataFrameHeaderSize) {
+        return std::nullopt;
+    }
+    DataFrame data;
+    data.file_index = boost::endian::load_big_u32(frame.data());
+    data.offset = boost::endian::load_big_u64(frame.data() + 4);
+    data.data = frame.subspan(kDataFrameHeaderSize);
+    return data;
+}
+
+std::vector<std::uint8_t> EncodeAckFrame(const AckFrame& ack) {
+    std::size_t count = std::min<std::size_t>(ack.ranges.size(), 0xffff);
+    std::vector<std::uint8_t> frame(kAckFrameHeaderSize + count * kAckRangeSize);
+    boost::endian::store_big_u64(frame.data(), ack.largest);
+    boost::endian::store_big_u32(frame.data() + 8, ack.ack_delay_us);
+    boost::endian::store_big_u16(frame.data() + 12, static_cast<std::uint16_t>(count));
+
+    auto* out = frame.data() + kAckFrameHeaderSize;
+    for (std::size_t i = 0; i < count; ++i, out += kAckRangeSize) {
+        boost::endian::store_big_u64(out, ack.ranges[i].first);
+        boost::endian::store_big_u64(out + 8, ack.ranges[i].last);
+    }
+    return frame;
+}
+
+std::optional<AckFrame> DecodeAckFrame(std::span<const std::uint8_t> frame) {
+    if (frame.size() < kAckFrameHeaderSize) {
+        return std::nullopt;
+    }
+    AckFrame ack;
+    ack.largest = boost::endian::load_big_u64(frame.data());
+    ack.ack_delay_us = boost::endian::load_big_u32(frame.data() + 8);
+    std::size_t count = boost::endian::load_big_u16(frame.data() + 12);
+    if (frame.size() != kAckFrameHeaderSize + count * kAckRangeSize) {
+        return std::nullopt;
+    }
+
+    const auto* in = frame.data() + kAckFrameHeaderSize;
+    ack.ranges.reserve(count);
+    for (std::size_t i = 0; i < count; ++i, in += kAckRangeSize) {
+        AckFrame::Range range{boost::endian::load_big_u64(in), boost::endian::load_big_u64(in + 8)};
+        if (range.first > range.last || range.last > ack.largest) {
+            return std::nullopt;
+        }
+        ack.ranges.push_back(range);
+    }
+    return ack;
+}
+
+std::vector<std::uint8_t> EncodeCloseFrame(CloseReason reason) {
+    return {static_cast<std::uint8_t>(reason)};
+}
+
+std::optional<CloseReason> DecodeCloseFrame(std::span<const std::uint8_t> frame) {
+    if (frame.size() != 1 || frame[0] < static_cast<std::uint8_t>(CloseReason::kAborted)
+        || frame[0] > static_cast<std::uint8_t>(CloseReason::kCancelled)) {
+        return std::nullopt;
+    }
+    return static_cast<CloseReason>(frame[0]);
+}
+
+bool TransmitDatagram(boost::asio::ip::udp::socket& socket,
+                      const boost::asio::ip::udp::endpoint& to,
+                      std::vector<std::uint8_t> datagram,
+                      std::shared_ptr<const void> owner) {
+    const auto& link = SimulatedLink::Get();
+    if (link.Enabled()) {
+        if (link.Drop()) {
+            return true;
+        }
+        if (link.delay.count() > 0) {
+            auto timer = std::make_shared<boost::asio::steady_timer>(socket.get_executor(),
+                                                                     link.delay);
+            timer->async_wait([&socket, to, timer, datagram = std::move(datagram), owner](
+                                  const boost::system::error_code& ec) {
+                if (!ec && socket.is_open()) {
+                    boost::system::error_code send_ec;
+                    socket.send_to(boost::asio::buffer(datagram), to, 0, send_ec);
+                }
+            });
+            return true;
+        }
+    }
+
+    boost::system::error_code ec;
+    socket.send_to(boost::asio::buffer(datagram), to, 0, ec);
+    return !ec;
+}
+
+bool SimulatedLink::Drop() const {
+    if (loss <= 0) {
+        return false;
+    }
+    thread_local std::mt19937 engine{std::random_device{}()};
+    return std::bernoulli_distribution(loss)(engine);
+}
+
+const SimulatedLink& SimulatedLink::Get() {
+    static const SimulatedLink link = [] {
+        SimulatedLink parsed;
+#ifdef LANSEND_DEBUG
+        const char* spec = std::getenv("LANSEND_UDP_NETEM");
+        if (spec == nullptr) {
+            return parsed;
+        }
+        std::string_view rest(spec);
+        while (!rest.empty()) {
+            auto comma = rest.find(',');
+            auto item = rest.substr(0, comma);
+            rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+
+            auto equals = item.find('=');
+            if (equals == std::string_view::npos) {
+                continue;
+            }
+            auto name = item.substr(0, equals);
+            std::string value(item.substr(equals + 1));
+            if (name == "loss") {
+                parsed.loss = std::clamp(std::atof(value.c_str()), 0.0, 1.0);
+            } else if (name == "delay") {
+                parsed.delay = std::chrono::milliseconds(std::max(0, std::atoi(value.c_str())));
+            }
+        }
+#endif
+        return parsed;
+    }();
+    return link;
+}
+
+} // namespace lansend::core
@@ -0,0 +1,223 @@
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <core/constant/udp.h>
+#include <core/network/udp/udp_receiver.h>
+#include <core/security/file_encryptor.h>
+#include <iterator>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace net = boost::asio;
+
+namespace lansend::core {
+
+UdpReceiver::UdpReceiver(net::any_io_executor executor, const std::string& sender_ip)
+    : socket_(executor)
+    , ack_timer_(executor, net::steady_timer::time_point::max())
+    , sender_address_(net::ip::make_address(sender_ip)) {
+    auto key = FileEncryptor::GenerateKey();
+    if (!key) {
+        throw std::runtime_error("Failed to generate the data channel key: " + key.error());
+    }
+    key_ = std::move(*key);
+
+    auto protocol = sender_address_.is_v6() ? net::ip::udp::v6() : net::ip::udp::v4();
+    socket_.open(protocol);
+    socket_.bind(net::ip::udp::endpoint(protocol, 0));
+    socket_.non_blocking(true);
+    boost::system::error_code ec;
+    socket_.set_option(net::socket_base::receive_buffer_size(udp::kSocketBufferSize), ec);
+    port_ = socket_.local_endpoint().port();
+}
+
+void UdpReceiver::Start(DataHandler handler) {
+    handler_ = std::move(handler);
+    auto executor = socket_.get_executor();
+    net::co_spawn(
+        executor,
+        [self = shared_from_this()] { return self->receiveLoop(); },
+        net::detached);
+    net::co_spawn(
+        executor,
+        [self = shared_from_this()] { return self->ackLoop(); },
+        net::detached);
+}
+
+void UdpReceiver::Close(CloseReason reason) {
+    net::dispatch(socket_.get_executor(),
+                  [self = shared_from_this(), reason]() { self->close(reason); });
+}
+
+void UdpReceiver::close(CloseReason reason) {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+
+    // The sender also notices the silence, but only after its idle timeout. The close
+    // datagram is repeated since any one of them may be lost.
+    for (int i = 0; i < 3; ++i) {
+        send(DatagramType::kClose, EncodeCloseFrame(reason));
+    }
+    ack_timer_.cancel();
+    boost::system::error_code ec;
+    socket_.close(ec);
+    spdlog::info("UDP data channel on port {} closed: {} datagrams, {} duplicates, {} rejected",
+                 port_,
+                 packets_received_,
+                 duplicates_,
+                 rejected_);
+}
+
+net::awaitable<void> UdpReceiver::receiveLoop() {
+    std::vector<std::uint8_t> buffer(udp::kMaxDatagramSize);
+    net::ip::udp::endpoint from;
+    while (!closed_) {
+        boost::system::error_code ec;
+        std::size_t size = co_await socket_.async_receive_from(net::buffer(buffer),
+                                                               from,
+                                                               net::redirect_error(
+                                                                   net::use_awaitable,
+                                                                   ec));
+        if (closed_ || ec == net::error::operation_aborted) {
+            break;
+        }
+        // Errors of earlier sends (an ICMP port unreachable) are reported by receives, the
+        // socket itself is fine
+        if (ec) {
+            continue;
+        }
+        if (from.address() != sender_address_) {
+            ++rejected_;
+            continue;
+        }
+        auto datagram = OpenDatagram(std::span(buffer.data(), size),
+                                     DatagramDirection::kToReceiver,
+                                     key_);
+        if (!datagram || datagram->type != DatagramType::kData) {
+            ++rejected_;
+            continue;
+        }
+        sender_endpoint_ = from;
+        ++packets_received_;
+
+        if (recordPacket(datagram->packet_number)) {
+            if (auto frame = DecodeDataFrame(datagram->frame); frame && handler_) {
+                try {
+                    co_await handler_(*frame);
+                } catch (const std::exception& e) {
+                    spdlog::error("Error handling UDP datagram: {}", e.what());
+                    Close();
+                }
+                if (closed_) {
+                    break;
+                }
+            }
+            if (!received_.empty() && datagram->packet_number == received_.rbegin()->second) {
+                largest_handled_at_ = std::chrono::steady_clock::now();
+            }
+        } else {
+            // Our acknowledgement was probably lost, send a new one soon
+            ++duplicates_;
+        }
+
+        if (++unacked_ >= udp::kAckEveryPackets) {
+            sendAck();
+        } else if (!ack_armed_) {
+            ack_armed_ = true;
+            ack_timer_.expires_after(udp::kMaxAckDelay);
+        }
+    }
+    // Released here rather than in Close(), which may be called from within the handler
+    handler_ = nullptr;
+}
+
+net::awaitable<void> UdpReceiver::ackLoop() {
+    while (!closed_) {
+        boost::system::error_code ec;
+        co_await ack_timer_.async_wait(net::redirect_error(net::use_awaitable, ec));
+        if (closed_) {
+            break;
+        }
+        // Cancelled by expires_after() when an acknowledgement was scheduled
+        if (ec == net::error::operation_aborted) {
+            continue;
+        }
+        ack_armed_ = false;
+        ack_timer_.expires_at(net::steady_timer::time_point::max());
+        if (unacked_ > 0) {
+            sendAck();
+        }
+    }
+}
+
+bool UdpReceiver::recordPacket(std::uint64_t packet_number) {
+    auto next = received_.upper_bound(packet_number);
+    if (next != received_.begin()) {
+        auto prev = std::prev(next);
+        if (packet_number <= prev->second) {
+            return false;
+        }
+        if (prev->second + 1 == packet_number) {
+            prev->second = packet_number;
+            if (next != received_.end() && next->first == packet_number + 1) {
+                prev->second = next->second;
+                received_.erase(next);
+            }
+            return true;
+        }
+    }
+    if (next != received_.end() && next->first == packet_number + 1) {
+        std::uint64_t last = next->second;
+        received_.erase(next);
+        received_.emplace(packet_number, last);
+    } else {
+        received_.emplace(packet_number, packet_number);
+    }
+    if (received_.size() > udp::kMaxTrackedRanges) {
+        received_.erase(received_.begin());
+    }
+    return true;
+}
+
+void UdpReceiver::sendAck() {
+    if (received_.empty()) {
+        return;
+    }
+    AckFrame ack;
+    ack.largest = received_.rbegin()->second;
+    ack.ack_delay_us = static_cast<std::uint32_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()
+                                                              - largest_handled_at_)
+            .count());
+    for (auto it = received_.rbegin();
+         it != received_.rend() && ack.ranges.size() < udp::kMaxAckRanges;
+         ++it) {
+        ack.ranges.push_back({it->first, it->second});
+    }
+    send(DatagramType::kAck, EncodeAckFrame(ack));
+    unacked_ = 0;
+}
+
+void UdpReceiver::send(DatagramType type, const std::vector<std::uint8_t>& frame) {
+    if (!sender_endpoint_ || !socket_.is_open()) {
+        return;
+    }
+    try {
+        TransmitDatagram(socket_,
+                         *sender_endpoint_,
+                         SealDatagram(type,
+                                      DatagramDirection::kToSender,
+                                      next_packet_number_++,
+                                      frame,
+                                      key_),
+                         shared_from_this());
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to send UDP datagram: {}", e.what());
+    }
+}
+
+} // namespace lansend::core
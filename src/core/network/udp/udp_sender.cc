@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <core/constant/udp.h>
+#include <core/network/udp/udp_sender.h>
+#include <core/util/memory_governor.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace net = boost::asio;
+using namespace std::chrono_literals;
+
+namespace lansend::core {
+
+static double Seconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+UdpSender::UdpSender(net::any_io_executor executor,
+                     const std::string& local_address,
+                     net::ip::udp::endpoint receiver,
+                     std::vector<std::uint8_t> key)
+    : socket_(executor)
+    , receiver_(std::move(receiver))
+    , wake_(executor)
+    , key_(std::move(key))
+    , rate_(udp::kInitialRate) {
+    rtt_variance_ = udp::kInitialRtt / 2;
+
+    socket_.open(receiver_.protocol());
+    socket_.bind(net::ip::udp::endpoint(net::ip::make_address(local_address), 0));
+    socket_.non_blocking(true);
+    boost::system::error_code ec;
+    socket_.set_option(net::socket_base::send_buffer_size(udp::kSocketBufferSize), ec);
+}
+
+void UdpSender::Start() {
+    net::co_spawn(
+        socket_.get_executor(),
+        [self = shared_from_this()] { return self->receiveLoop(); },
+        net::detached);
+}
+
+void UdpSender::Close() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    wake_.cancel();
+    boost::system::error_code ec;
+    socket_.close(ec);
+}
+
+UdpSenderStats UdpSender::Stats() const {
+    UdpSenderStats stats = stats_;
+    stats.rate = rate_;
+    if (min_rtt_) {
+        stats.min_rtt = std::chrono::duration_cast<std::chrono::microseconds>(*min_rtt_);
+        stats.smoothed_rtt = std::chrono::duration_cast<std::chrono::microseconds>(smoothed_rtt_);
+    }
+    return stats;
+}
+
+net::awaitable<UdpSendResult> UdpSender::SendFile(std::uint32_t file_index,
+                                                  std::filesystem::path file_path,
+                                                  std::uint64_t file_size,
+                                                  CancelCondition cancelled,
+                                                  ProgressCallback progress) {
+    if (closed_) {
+        co_return UdpSendResult::kFailed;
+    }
+    file_.close();
+    file_.clear();
+    file_.open(file_path, std::ios::binary);
+    if (!file_) {
+        throw std::runtime_error("Failed to open file " + file_path.string());
+    }
+    auto reservation = co_await MemoryGovernor::Reserve(udp::kReadBlockSize);
+    block_.resize(udp::kReadBlockSize);
+    block_size_ = 0;
+
+    file_index_ = file_index;
+    file_size_ = file_size;
+    acked_segments_ = ChunkBitmap((file_size + udp::kSegmentSize - 1) / udp::kSegmentSize);
+    file_bytes_acked_ = 0;
+    // Packets of the previous file no longer matter, their acknowledgements are ignored
+    in_flight_.clear();
+    bytes_in_flight_ = 0;
+    lost_.clear();
+
+    auto now = std::chrono::steady_clock::now();
+    last_ack_at_ = now;
+    auto last_refill = now;
+    double credit = 0;
+    std::uint64_t next_offset = 0;
+    std::uint64_t reported_bytes = 0;
+    UdpSendResult result;
+    while (true) {
+        if (close_reason_) {
+            result = *close_reason_ == CloseReason::kCancelled ? UdpSendResult::kReceiverCancelled
+                                                               : UdpSendResult::kFailed;
+            break;
+        }
+        if (closed_) {
+            result = UdpSendResult::kFailed;
+            break;
+        }
+        if (cancelled && cancelled()) {
+            result = UdpSendResult::kCancelled;
+            break;
+        }
+        if (progress && file_bytes_acked_ != reported_bytes) {
+            reported_bytes = file_bytes_acked_;
+            progress(reported_bytes);
+        }
+        if (acked_segments_.IsComplete()) {
+            result = UdpSendResult::kCompleted;
+            break;
+        }
+
+        now = std::chrono::steady_clock::now();
+        if (!in_flight_.empty() && now - last_ack_at_ > udp::kIdleTimeout) {
+            spdlog::error("UDP data channel to {}:{} timed out",
+                          receiver_.address().to_string(),
+                          receiver_.port());
+            result = UdpSendResult::kFailed;
+            break;
+        }
+        detectLosses(now);
+
+        // Pacing: the rate earns sending credit, a little of it can be saved up for a burst
+        credit = std::min(credit + rate_ * Seconds(now - last_refill),
+                          rate_ * Seconds(udp::kMaxBurst) + udp::kSegmentSize);
+        last_refill = now;
+        while (credit > 0 && bytes_in_flight_ < inFlightLimit()) {
+            // A segment declared lost may have been acknowledged after all
+            while (!lost_.empty()
+                   && acked_segments_.Test(lost_.front().first / udp::kSegmentSize)) {
+                lost_.pop_front();
+            }
+            std::uint64_t offset;
+            std::uint32_t length;
+            bool retransmission = !lost_.empty();
+            if (retransmission) {
+                std::tie(offset, length) = lost_.front();
+            } else if (next_offset < file_size_) {
+                offset = next_offset;
+                length = static_cast<std::uint32_t>(
+                    std::min<std::uint64_t>(udp::kSegmentSize, file_size_ - next_offset));
+            } else {
+                break;
+            }
+            if (!sendSegment(offset, length)) {
+                break;
+            }
+            if (retransmission) {
+                lost_.pop_front();
+            } else {
+                next_offset += length;
+            }
+            credit -= length;
+        }
+
+        // Wait for more credit, or with nothing to send for an acknowledgement or the loss
+        // timer of the oldest packet
+        bool has_data = !lost_.empty() || next_offset < file_size_;
+        if ((has_data && bytes_in_flight_ < inFlightLimit()) || in_flight_.empty()) {
+            wake_.expires_after(udp::kPacingInterval);
+        } else {
+            const auto& [packet_number, oldest] = *in_flight_.begin();
+            bool acked_after = largest_acked_ && packet_number < *largest_acked_;
+            wake_.expires_at(oldest.sent_at + (acked_after ? lossDelay() : probeTimeout()));
+        }
+        boost::system::error_code ec;
+        co_await wake_.async_wait(net::redirect_error(net::use_awaitable, ec));
+    }
+
+    file_.close();
+    block_ = {};
+    in_flight_.clear();
+    bytes_in_flight_ = 0;
+    lost_.clear();
+    co_return result;
+}
+
+net::awaitable<void> UdpSender::receiveLoop() {
+    std::vector<std::uint8_t> buffer(udp::kMaxDatagramSize);
+    net::ip::udp::endpoint from;
+    while (!closed_) {
+        boost::system::error_code ec;
+        std::size_t size = co_await socket_.async_receive_from(net::buffer(buffer),
+                                                               from,
+                                                               net::redirect_error(
+                                                                   net::use_awaitable,
+                                                                   ec));
+        if (closed_ || ec == net::error::operation_aborted) {
+            break;
+        }
+        if (ec) {
+            continue;
+        }
+        // The receiver's source address may differ on a multihomed host, the key proves
+        // where the datagram comes from
+        auto datagram = OpenDatagram(std::span(buffer.data(), size),
+                                     DatagramDirection::kToSender,
+                                     key_);
+        if (!datagram) {
+            continue;
+        }
+        if (datagram->type == DatagramType::kAck) {
+            if (auto ack = DecodeAckFrame(datagram->frame); ack) {
+                onAck(*ack);
+            }
+        } else if (datagram->type == DatagramType::kClose) {
+            close_reason_ = DecodeCloseFrame(datagram->frame).value_or(CloseReason::kAborted);
+        }
+        wake_.cancel();
+    }
+}
+
+void UdpSender::onAck(const AckFrame& ack) {
+    auto now = std::chrono::steady_clock::now();
+    last_ack_at_ = now;
+
+    std::uint64_t acked_bytes = 0;
+    std::optional<std::chrono::steady_clock::time_point> largest_sent_at;
+    for (const auto& range : ack.ranges) {
+        auto it = in_flight_.lower_bound(range.first);
+        while (it != in_flight_.end() && it->first <= range.last) {
+            if (it->first == ack.largest) {
+                largest_sent_at = it->second.sent_at;
+            }
+            bytes_in_flight_ -= it->second.length;
+            acked_bytes += it->second.length;
+            ++acked_since_cut_;
+            onPacketAcked(it->second);
+            it = in_flight_.erase(it);
+        }
+    }
+    if (!largest_acked_ || ack.largest > *largest_acked_) {
+        largest_acked_ = ack.largest;
+    }
+
+    // Only a newly acknowledged largest packet gives a round trip sample
+    if (largest_sent_at) {
+        bool first_sample = !min_rtt_;
+        latest_rtt_ = now - *largest_sent_at;
+        min_rtt_ = std::min(min_rtt_.value_or(latest_rtt_), latest_rtt_);
+        auto adjusted_rtt = latest_rtt_;
+        auto ack_delay = std::chrono::microseconds(ack.ack_delay_us);
+        if (adjusted_rtt >= *min_rtt_ + ack_delay) {
+            adjusted_rtt -= ack_delay;
+        }
+        if (first_sample) {
+            smoothed_rtt_ = adjusted_rtt;
+            rtt_variance_ = adjusted_rtt / 2;
+        } else {
+            auto deviation = smoothed_rtt_ > adjusted_rtt ? smoothed_rtt_ - adjusted_rtt
+                                                          : adjusted_rtt - smoothed_rtt_;
+            rtt_variance_ = (3 * rtt_variance_ + deviation) / 4;
+            smoothed_rtt_ = (7 * smoothed_rtt_ + adjusted_rtt) / 8;
+        }
+        queuing_delay_ = adjusted_rtt - *min_rtt_;
+    }
+    if (acked_bytes == 0) {
+        return;
+    }
+
+    // Slow start doubles the rate every round trip until the queue starts to build, then
+    // the rate moves towards the target queuing delay
+    double round_trip = std::max(Seconds(smoothedRtt()), 1e-4);
+    if (slow_start_ && queuing_delay_ > udp::kTargetQueueDelay / 2) {
+        slow_start_ = false;
+    }
+    if (slow_start_) {
+        rate_ += acked_bytes / round_trip;
+    } else {
+        double off_target = std::clamp(1.0 - Seconds(queuing_delay_)
+                                                 / Seconds(udp::kTargetQueueDelay),
+                                       -1.0,
+                                       1.0);
+        rate_ += udp::kRateGain * off_target * acked_bytes / round_trip;
+    }
+    rate_ = std::clamp(rate_, udp::kMinRate, udp::kMaxRate);
+}
+
+void UdpSender::onPacketAcked(const SentPacket& packet) {
+    std::size_t segment = packet.offset / udp::kSegmentSize;
+    if (segment < acked_segments_.Size() && acked_segments_.Set(segment)) {
+        file_bytes_acked_ += packet.length;
+        stats_.bytes_acked += packet.length;
+    }
+}
+
+void UdpSender::detectLosses(std::chrono::steady_clock::time_point now) {
+    auto loss_delay = lossDelay();
+    auto probe_timeout = probeTimeout();
+    for (auto it = in_flight_.begin(); it != in_flight_.end();) {
+        const auto& [packet_number, packet] = *it;
+        bool lost;
+        if (largest_acked_ && packet_number < *largest_acked_) {
+            lost = *largest_acked_ - packet_number >= udp::kPacketThreshold
+                   || now - packet.sent_at >= loss_delay;
+        } else {
+            // Nothing after it was acknowledged: the tail was lost, or every acknowledgement
+            lost = now - packet.sent_at >= probe_timeout;
+            if (!lost) {
+                break; // The packets after it were sent later still
+            }
+        }
+        if (!lost) {
+            ++it;
+            continue;
+        }
+        SentPacket lost_packet = packet;
+        it = in_flight_.erase(it);
+        onLoss(lost_packet);
+    }
+}
+
+void UdpSender::onLoss(const SentPacket& packet) {
+    bytes_in_flight_ -= packet.length;
+    ++stats_.packets_lost;
+    lost_.emplace_back(packet.offset, packet.length);
+
+    // Random loss is common on Wi-Fi and says little about the queue, the rate is cut a
+    // little and once per round trip only. Losing a large share of the packets means a
+    // buffer overflows faster than the queuing delay shows, e.g. the receiver's socket buffer.
+    slow_start_ = false;
+    ++lost_since_cut_;
+    if (packet.sent_at > recovery_start_) {
+        double loss_rate = static_cast<double>(lost_since_cut_)
+                           / (lost_since_cut_ + acked_since_cut_);
+        double beta = loss_rate > udp::kCongestionLoss ? 0.5 : udp::kLossBeta;
+        rate_ = std::max(udp::kMinRate, rate_ * (1 - beta));
+        recovery_start_ = std::chrono::steady_clock::now();
+        acked_since_cut_ = 0;
+        lost_since_cut_ = 0;
+    }
+}
+
+bool UdpSender::sendSegment(std::uint64_t offset, std::uint32_t length) {
+    auto packet_number = next_packet_number_++;
+    auto datagram = SealDatagram(DatagramType::kData,
+                                 DatagramDirection::kToReceiver,
+                                 packet_number,
+                                 EncodeDataFrame(file_index_, offset, readSegment(offset, length)),
+                                 key_);
+    if (!TransmitDatagram(socket_, receiver_, std::move(datagram), shared_from_this())) {
+        return false;
+    }
+    in_flight_.emplace(packet_number,
+                       SentPacket{offset, length, std::chrono::steady_clock::now()});
+    bytes_in_flight_ += length;
+    ++stats_.packets_sent;
+    return true;
+}
+
+std::span<const std::uint8_t> UdpSender::readSegment(std::uint64_t offset, std::uint32_t length) {
+    if (offset < block_offset_ || offset + length > block_offset_ + block_size_) {
+        block_offset_ = offset;
+        block_size_ = std::min<std::uint64_t>(udp::kReadBlockSize, file_size_ - offset);
+        file_.clear();
+        file_.seekg(static_cast<std::streamoff>(offset));
+        file_.read(reinterpret_cast<char*>(block_.data()),
+                   static_cast<std::streamsize>(block_size_));
+        if (static_cast<std::uint64_t>(file_.gcount()) != block_size_) {
+            block_size_ = 0;
+            throw std::runtime_error("File was truncated while being sent");
+        }
+    }
+    return std::span(block_.data() + (offset - block_offset_), length);
+}
+
+std::chrono::steady_clock::duration UdpSender::smoothedRtt() const {
+    return min_rtt_ ? smoothed_rtt_ : std::chrono::steady_clock::duration(udp::kInitialRtt);
+}
+
+std::chrono::steady_clock::duration UdpSender::lossDelay() const {
+    auto rtt = min_rtt_ ? std::max(smoothed_rtt_, latest_rtt_) : smoothedRtt();
+    return std::max<std::chrono::steady_clock::duration>(rtt * 9 / 8, 1ms);
+}
+
+std::chrono::steady_clock::duration UdpSender::probeTimeout() const {
+    return smoothedRtt() + std::max<std::chrono::steady_clock::duration>(4 * rtt_variance_, 1ms)
+           + udp::kMaxAckDelay;
+}
+
+double UdpSender::inFlightLimit() const {
+    // Twice what the rate puts in flight over a round trip at the target delay, the pacing
+    // sets the actual rate. A receiver that stalls must not find more in its socket buffer
+    // than fits.
+    return std::clamp(2 * rate_ * Seconds(smoothedRtt() + udp::kTargetQueueDelay),
+                      4.0 * udp::kSegmentSize,
+                      udp::kMaxBytesInFlight);
+}
+
+} // namespace lansend::core
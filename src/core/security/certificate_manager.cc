@@ -1,9 +1,11 @@
+#include <chrono>
 #include <core/security/certificate_manager.h>
 #include <core/security/open_ssl_provider.h>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <nlohmann/json.hpp>
+#include <openssl/ec.h>
 #include <spdlog/spdlog.h>
 #include <sstream>
 
@@ -12,8 +14,70 @@ using json = nlohmann::json;
 
 namespace lansend::core {
 
-CertificateManager::CertificateManager(const fs::path& certDir)
-    : certificate_dir_(certDir) {
+static EVP_PKEY* GenerateKeyPair(KeyType key_type) {
+    int key_id = EVP_PKEY_EC;
+    if (key_type == KeyType::kRsa2048) {
+        key_id = EVP_PKEY_RSA;
+    } else if (key_type == KeyType::kEd25519) {
+        key_id = EVP_PKEY_ED25519;
+    }
+
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(key_id, nullptr);
+    if (!ctx || EVP_PKEY_keygen_init(ctx) <= 0) {
+        EVP_PKEY_CTX_free(ctx);
+        throw std::runtime_error("Failed to initialize key generation");
+    }
+
+    if (key_type == KeyType::kRsa2048 && EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) <= 0) {
+        EVP_PKEY_CTX_free(ctx);
+        throw std::runtime_error("Failed to set RSA key size");
+    }
+
+    if (key_type == KeyType::kEcdsaP256
+        && EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1) <= 0) {
+        EVP_PKEY_CTX_free(ctx);
+        throw std::runtime_error("Failed to set EC curve");
+    }
+
+    EVP_PKEY* pkey = nullptr;
+    if (EVP_PKEY_keygen(ctx, &pkey) <= 0) {
+        EVP_PKEY_CTX_free(ctx);
+        throw std::runtime_error("Failed to generate key pair");
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+    return pkey;
+}
+
+static std::optional<KeyType> DetectKeyType(const std::string& private_key_pem) {
+    BIO* keyBio = BIO_new_mem_buf(private_key_pem.data(), static_cast<int>(private_key_pem.size()));
+    EVP_PKEY* pkey = PEM_read_bio_PrivateKey(keyBio, nullptr, nullptr, nullptr);
+    BIO_free(keyBio);
+    if (!pkey) {
+        return std::nullopt;
+    }
+
+    std::optional<KeyType> key_type = std::nullopt;
+    switch (EVP_PKEY_get_base_id(pkey)) {
+    case EVP_PKEY_RSA:
+        key_type = KeyType::kRsa2048;
+        break;
+    case EVP_PKEY_EC:
+        key_type = KeyType::kEcdsaP256;
+        break;
+    case EVP_PKEY_ED25519:
+        key_type = KeyType::kEd25519;
+        break;
+    default:
+        break;
+    }
+    EVP_PKEY_free(pkey);
+    return key_type;
+}
+
+CertificateManager::CertificateManager(const fs::path& certDir, KeyType key_type)
+    : certificate_dir_(certDir)
+    , key_type_(key_type) {
     if (!fs::exists(certDir)) {
         fs::create_directories(certDir);
     }
@@ -24,8 +88,13 @@ CertificateManager::CertificateManager(const fs::path& certDir)
 
 bool CertificateManager::initSecurityContext() {
     if (loadSecurityContext()) {
-        spdlog::info("Loaded existing certificate with fingerprint: {}",
+        spdlog::info("Loaded existing {} certificate with fingerprint: {}",
+                     KeyTypeToString(security_context_.key_type),
                      security_context_.certificate_hash);
+        if (security_context_.key_type != key_type_) {
+            return migrateSecurityContext(security_context_.key_type);
+        }
+        loadPreviousFingerprint();
         return true;
     }
 
@@ -38,6 +107,69 @@ bool CertificateManager::initSecurityContext() {
     return false;
 }
 
+// Replace the loaded identity with one of the configured key type. The old fingerprint is kept
+// in previous_fingerprint.txt and announced next to the new one until the transition expires.
+bool CertificateManager::migrateSecurityContext(KeyType loaded_key_type) {
+    std::string previous_hash = security_context_.certificate_hash;
+    spdlog::info("Migrating certificate from {} to {}",
+                 KeyTypeToString(loaded_key_type),
+                 KeyTypeToString(key_type_));
+
+    if (!generateSelfSignedCertificate()) {
+        spdlog::error("Certificate migration failed, keep using the {} certificate",
+                      KeyTypeToString(loaded_key_type));
+        return true;
+    }
+    security_context_.previous_certificate_hash = previous_hash;
+
+    try {
+        auto expires_at = std::chrono::system_clock::now()
+                          + std::chrono::days(kFingerprintTransitionDays);
+        std::ofstream previousFile(certificate_dir_ / "previous_fingerprint.txt");
+        previousFile << previous_hash << "\n"
+                     << std::chrono::duration_cast<std::chrono::seconds>(
+                            expires_at.time_since_epoch())
+                            .count();
+        previousFile.close();
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to save previous fingerprint: {}", e.what());
+    }
+
+    spdlog::info("Migrated to new certificate with fingerprint: {}, previous fingerprint {}... "
+                 "announced for {} days",
+                 security_context_.certificate_hash,
+                 previous_hash.substr(0, 8),
+                 kFingerprintTransitionDays);
+    return saveSecurityContext();
+}
+
+void CertificateManager::loadPreviousFingerprint() {
+    auto previous_path = certificate_dir_ / "previous_fingerprint.txt";
+    if (!fs::exists(previous_path)) {
+        return;
+    }
+
+    try {
+        std::ifstream previousFile(previous_path);
+        std::string previous_hash;
+        long long expires_at = 0;
+        previousFile >> previous_hash >> expires_at;
+        previousFile.close();
+
+        auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+        if (previous_hash.empty() || now >= expires_at) {
+            spdlog::info("Fingerprint transition period is over, stop announcing the previous one");
+            fs::remove(previous_path);
+            return;
+        }
+        security_context_.previous_certificate_hash = previous_hash;
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to load previous fingerprint: {}", e.what());
+    }
+}
+
 const SecurityContext& CertificateManager::security_context() const {
     return security_context_;
 }
@@ -66,7 +198,8 @@ std::string CertificateManager::CalculateCertificateHash(const std::string& cert
 bool CertificateManager::VerifyCertificate(bool preverified,
                                            boost::asio::ssl::verify_context& ctx,
                                            const std::string& ip,
-                                           uint16_t port) {
+                                           uint16_t port,
+                                           const ReplacementFilter& accept_replacement) {
     // Get the certificate being verified
     X509* cert = X509_STORE_CTX_get_current_cert(ctx.native_handle());
     if (!cert) {
@@ -86,15 +219,38 @@ bool CertificateManager::VerifyCertificate(bool preverified,
     std::string actual_fingerprint = CalculateCertificateHash(certPem);
     BIO_free(certBio);
 
+    // Handshakes run on many threads, copy the entry out instead of holding the lock
+    std::optional<DeviceFingerprint> registered;
+    {
+        std::shared_lock lock(fingerprints_mutex_);
+        if (auto it = device_fingerprints_.find(makeDeviceKey(ip, port));
+            it != device_fingerprints_.end()) {
+            registered = it->second;
+        }
+    }
+
     // If the fingerprint is in our trusted set, allow the connection
-    if (auto expected_fingerprint = GetDeviceFingerprint(ip, port); expected_fingerprint) {
-        if (*expected_fingerprint == actual_fingerprint) {
+    if (registered) {
+        const auto& expected_fingerprint = registered->current;
+        if (expected_fingerprint == actual_fingerprint) {
             spdlog::info("Certificate fingerprint verified successfully: {}...",
                          actual_fingerprint.substr(0, 8));
             return true;
+        } else if (!registered->previous.empty() && registered->previous == actual_fingerprint) {
+            spdlog::info("Certificate matches the previous fingerprint announced by {}:{}: {}...",
+                         ip,
+                         port,
+                         actual_fingerprint.substr(0, 8));
+            return true;
+        } else if (accept_replacement && accept_replacement(actual_fingerprint)) {
+            spdlog::info("Certificate of {}:{} replaces the pinned one: {}...",
+                         ip,
+                         port,
+                         actual_fingerprint.substr(0, 8));
+            return true;
         } else {
             spdlog::error("Certificate fingerprint mismatch for {}:{}!", ip, port);
-            spdlog::error("Expected: {}...", expected_fingerprint->substr(0, 8));
+            spdlog::error("Expected: {}...", expected_fingerprint.substr(0, 8));
             spdlog::error("Actual: {}...", actual_fingerprint.substr(0, 8));
             spdlog::error("Possible man-in-the-middle attack detected!");
             return false;
@@ -116,25 +272,36 @@ bool CertificateManager::VerifyCertificate(bool preverified,
 
 void CertificateManager::RegisterDeviceFingerprint(const std::string& ip,
                                                    uint16_t port,
-                                                   const std::string& fingerprint) {
+                                                   const std::string& fingerprint,
+                                                   const std::string& previous_fingerprint) {
     std::string key = makeDeviceKey(ip, port);
+    std::unique_lock lock(fingerprints_mutex_);
 
     // 如果已存在且不同，记录警告
     auto it = device_fingerprints_.find(key);
-    if (it != device_fingerprints_.end() && it->second != fingerprint) {
-        spdlog::warn("Device {}:{} fingerprint changed from {} to {}!",
-                     ip,
-                     port,
-                     it->second.substr(0, 8),
-                     fingerprint.substr(0, 8));
+    if (it != device_fingerprints_.end() && it->second.current != fingerprint) {
+        if (it->second.current == previous_fingerprint) {
+            spdlog::info("Device {}:{} migrated its certificate from {} to {}",
+                         ip,
+                         port,
+                         it->second.current.substr(0, 8),
+                         fingerprint.substr(0, 8));
+        } else {
+            spdlog::warn("Device {}:{} fingerprint changed from {} to {}!",
+                         ip,
+                         port,
+                         it->second.current.substr(0, 8),
+                         fingerprint.substr(0, 8));
+        }
     }
 
-    device_fingerprints_[key] = fingerprint;
+    device_fingerprints_[key] = DeviceFingerprint{fingerprint, previous_fingerprint};
     spdlog::info("Registered fingerprint for {}:{}: {}...", ip, port, fingerprint.substr(0, 8));
 }
 
 void CertificateManager::RemoveDeviceFingerprint(const std::string& ip, uint16_t port) {
     std::string key = makeDeviceKey(ip, port);
+    std::unique_lock lock(fingerprints_mutex_);
     auto it = device_fingerprints_.find(key);
     if (it != device_fingerprints_.end()) {
         device_fingerprints_.erase(it);
@@ -147,9 +314,10 @@ void CertificateManager::RemoveDeviceFingerprint(const std::string& ip, uint16_t
 std::optional<std::string> CertificateManager::GetDeviceFingerprint(const std::string& ip,
                                                                     uint16_t port) const {
     std::string key = makeDeviceKey(ip, port);
+    std::shared_lock lock(fingerprints_mutex_);
     auto it = device_fingerprints_.find(key);
     if (it != device_fingerprints_.end()) {
-        return it->second;
+        return it->second.current;
     }
     return std::nullopt;
 }
@@ -159,27 +327,15 @@ bool CertificateManager::generateSelfSignedCertificate() {
     X509* x509 = nullptr;
 
     try {
-        // 1. Generate RSA key pair
-        spdlog::info("Generating 2048-bit RSA key pair...");
-        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
-        if (!ctx || EVP_PKEY_keygen_init(ctx) <= 0) {
-            EVP_PKEY_CTX_free(ctx);
-            throw std::runtime_error("Failed to initialize RSA key generation");
-        }
-
-        // Set RSA key parameters (key size and public exponent)
-        if (EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) <= 0) {
-            EVP_PKEY_CTX_free(ctx);
-            throw std::runtime_error("Failed to set RSA key size");
-        }
-
-        // Generate the key
-        if (EVP_PKEY_keygen(ctx, &pkey) <= 0) {
-            EVP_PKEY_CTX_free(ctx);
-            throw std::runtime_error("Failed to generate RSA key pair");
-        }
-
-        EVP_PKEY_CTX_free(ctx);
+        // 1. Generate key pair
+        spdlog::info("Generating {} key pair...", KeyTypeToString(key_type_));
+        auto keygen_start = std::chrono::steady_clock::now();
+        pkey = GenerateKeyPair(key_type_);
+        spdlog::info("Generated {} key pair in {} ms",
+                     KeyTypeToString(key_type_),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now() - keygen_start)
+                         .count());
 
         // 2. Create X509 certificate
         x509 = X509_new();
@@ -216,8 +372,9 @@ bool CertificateManager::generateSelfSignedCertificate() {
 
         X509_set_issuer_name(x509, name); // Self is the issuer
 
-        // Sign the certificate
-        if (X509_sign(x509, pkey, EVP_sha256()) == 0) {
+        // Sign the certificate, Ed25519 signs the message directly and takes no digest
+        const EVP_MD* digest = key_type_ == KeyType::kEd25519 ? nullptr : EVP_sha256();
+        if (X509_sign(x509, pkey, digest) == 0) {
             throw std::runtime_error("Failed to sign certificate");
         }
 
@@ -247,6 +404,8 @@ bool CertificateManager::generateSelfSignedCertificate() {
         // 4. Calculate certificate fingerprint
         security_context_.certificate_hash = CalculateCertificateHash(
             security_context_.certificate_pem);
+        security_context_.key_type = key_type_;
+        security_context_.previous_certificate_hash.clear();
 
         // Release all resources
         BIO_free(privateBio);
@@ -323,6 +482,13 @@ bool CertificateManager::loadSecurityContext() {
         fingerprintStream << fingerprintFile.rdbuf();
         security_context_.certificate_hash = fingerprintStream.str();
 
+        auto key_type = DetectKeyType(security_context_.private_key_pem);
+        if (!key_type) {
+            spdlog::error("Unsupported or corrupted private key");
+            return false;
+        }
+        security_context_.key_type = *key_type;
+
         return !security_context_.private_key_pem.empty()
                && !security_context_.public_key_pem.empty()
                && !security_context_.certificate_pem.empty()
@@ -4,6 +4,15 @@
 
 namespace lansend::core {
 
+static std::string ToHex(const unsigned char* hash, unsigned int hash_len) {
+    // Convert hash to hex string
+    std::stringstream ss;
+    for (unsigned int i = 0; i < hash_len; i++) {
+        ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(hash[i]);
+    }
+    return ss.str();
+}
+
 std::string FileHasher::CalculateFileChecksum(const std::filesystem::path& file_path) {
     std::ifstream file(file_path, std::ios::binary);
     if (!file) {
@@ -29,13 +38,7 @@ std::string FileHasher::CalculateFileChecksum(const std::filesystem::path& file_
     EVP_DigestFinal_ex(mdctx, hash, &hash_len);
     EVP_MD_CTX_free(mdctx);
 
-    // Convert hash to hex string
-    std::stringstream ss;
-    for (unsigned int i = 0; i < hash_len; i++) {
-        ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(hash[i]);
-    }
-
-    return ss.str();
+    return ToHex(hash, hash_len);
 }
 
 std::string FileHasher::CalculateDataChecksum(const BinaryData& data) {
@@ -48,16 +51,34 @@ std::string FileHasher::CalculateDataChecksum(const BinaryData& data) {
     EVP_DigestFinal_ex(mdctx, hash, &hash_len);
     EVP_MD_CTX_free(mdctx);
 
-    std::stringstream ss;
-    for (unsigned int i = 0; i < hash_len; i++) {
-        ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(hash[i]);
-    }
-
-    return ss.str();
+    return ToHex(hash, hash_len);
 }
 
 FileHasher::FileHasher() {
     OpenSSLProvider::InitOpenSSL();
 }
 
+IncrementalHasher::IncrementalHasher()
+    : context_(EVP_MD_CTX_new()) {
+    if (context_ == nullptr || EVP_DigestInit_ex(context_, EVP_sha256(), nullptr) != 1) {
+        EVP_MD_CTX_free(context_);
+        throw std::runtime_error("Failed to initialize SHA-256 context");
+    }
+}
+
+IncrementalHasher::~IncrementalHasher() {
+    EVP_MD_CTX_free(context_);
+}
+
+void IncrementalHasher::Update(const void* data, std::size_t size) {
+    EVP_DigestUpdate(context_, data, size);
+}
+
+std::string IncrementalHasher::Finish() {
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned int hash_len;
+    EVP_DigestFinal_ex(context_, hash, &hash_len);
+    return ToHex(hash, hash_len);
+}
+
 } // namespace lansend::core
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include <bit>
+#include <core/util/chunk_bitmap.h>
+#include <format>
+#include <stdexcept>
+
+namespace lansend::core {
+
+static constexpr std::size_t kWordBits = 64;
+
+ChunkBitmap::ChunkBitmap(std::size_t chunk_count)
+    : words_((chunk_count + kWordBits - 1) / kWordBits, 0)
+    , size_(chunk_count) {}
+
+bool ChunkBitmap::Set(std::size_t index) {
+    if (index >= size_) {
+        throw std::out_of_range(
+            std::format("Chunk index {} out of range ({} chunks)", index, size_));
+    }
+    auto& word = words_[index / kWordBits];
+    std::uint64_t mask = std::uint64_t{1} << (index % kWordBits);
+    if (word & mask) {
+        return false;
+    }
+    word |= mask;
+    ++count_;
+    return true;
+}
+
+bool ChunkBitmap::Test(std::size_t index) const {
+    if (index >= size_) {
+        return false;
+    }
+    return (words_[index / kWordBits] >> (index % kWordBits)) & 1;
+}
+
+std::optional<std::size_t> ChunkBitmap::FirstMissing() const {
+    for (std::size_t i = 0; i < words_.size(); ++i) {
+        if (words_[i] != ~std::uint64_t{0}) {
+            std::size_t index = i * kWordBits + std::countr_one(words_[i]);
+            if (index < size_) {
+                return index;
+            }
+            break;
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<std::uint8_t> ChunkBitmap::Serialize() const {
+    std::vector<std::uint8_t> bytes((size_ + 7) / 8, 0);
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<std::uint8_t>(words_[i / 8] >> (i % 8 * 8));
+    }
+    return bytes;
+}
+
+ChunkBitmap ChunkBitmap::Deserialize(std::span<const std::uint8_t> bytes,
+                                     std::size_t chunk_count) {
+    if (bytes.size() != (chunk_count + 7) / 8) {
+        throw std::invalid_argument(
+            std::format("Bitmap of {} bytes does not fit {} chunks", bytes.size(), chunk_count));
+    }
+    ChunkBitmap bitmap(chunk_count);
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        bitmap.words_[i / 8] |= std::uint64_t{bytes[i]} << (i % 8 * 8);
+    }
+    // Bits past the last chunk are not chunks
+    if (auto tail = chunk_count % kWordBits; tail != 0) {
+        bitmap.words_.back() &= (std::uint64_t{1} << tail) - 1;
+    }
+    for (auto word : bitmap.words_) {
+        bitmap.count_ += std::popcount(word);
+    }
+    return bitmap;
+}
+
+} // namespace lansend::core
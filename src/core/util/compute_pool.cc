@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <boost/asio/post.hpp>
+#include <core/util/compute_pool.h>
+#include <core/util/config.h>
+#include <spdlog/spdlog.h>
+#include <thread>
+
+namespace net = boost::asio;
+using namespace std::chrono;
+
+namespace lansend::core {
+
+static std::size_t ResolveThreadCount(std::size_t configured) {
+    if (configured > 0) {
+        return configured;
+    }
+    // Leave half of the cores to the io_context workers
+    return std::max<std::size_t>(1, std::thread::hardware_concurrency() / 2);
+}
+
+ComputePool::ComputePool(std::size_t thread_count)
+    : pool_(thread_count)
+    , slots_(pool_.get_executor(), thread_count * kQueueDepthPerThread)
+    , thread_count_(thread_count)
+    , max_queue_depth_(thread_count * kQueueDepthPerThread) {
+    spdlog::info("Compute pool started with {} thread(s), queue depth limited to {}",
+                 thread_count_,
+                 max_queue_depth_);
+}
+
+ComputePool::~ComputePool() {
+    pool_.join();
+}
+
+ComputePool& ComputePool::instance() {
+    static ComputePool instance(ResolveThreadCount(settings.compute_threads));
+    return instance;
+}
+
+net::awaitable<void> ComputePool::acquireSlot() {
+    // Completes immediately while the buffer has room, otherwise waits for releaseSlot()
+    co_await slots_.async_send(boost::system::error_code{}, net::use_awaitable);
+}
+
+void ComputePool::releaseSlot() {
+    slots_.try_receive([](boost::system::error_code) {});
+}
+
+void ComputePool::record(std::string_view task_name,
+                         steady_clock::duration wait,
+                         steady_clock::duration run) {
+    auto wait_us = duration_cast<microseconds>(wait);
+    auto run_us = duration_cast<microseconds>(run);
+    spdlog::trace("Compute task {} waited {}us, ran {}us",
+                  task_name,
+                  wait_us.count(),
+                  run_us.count());
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    auto& stats = stats_[std::string(task_name)];
+    stats.count++;
+    stats.total_wait += wait_us;
+    stats.total_run += run_us;
+    stats.max_run = std::max(stats.max_run, run_us);
+}
+
+std::unordered_map<std::string, ComputeTaskStats> ComputePool::Stats() {
+    auto& pool = instance();
+    std::lock_guard<std::mutex> lock(pool.stats_mutex_);
+    return pool.stats_;
+}
+
+void ComputePool::Shutdown() {
+    for (const auto& [task_name, stats] : Stats()) {
+        if (stats.count == 0) {
+            continue;
+        }
+        spdlog::info("Compute task {}: {} run(s), avg wait {}us, avg run {}us, max run {}us",
+                     task_name,
+                     stats.count,
+                     stats.total_wait.count() / static_cast<long long>(stats.count),
+                     stats.total_run.count() / static_cast<long long>(stats.count),
+                     stats.max_run.count());
+    }
+    instance().pool_.join();
+}
+
+} // namespace lansend::core
@@ -38,6 +38,72 @@ static void LoadSetting() {
     } else {
         settings.save_dir = path::kSystemDownloadDir;
     }
+    if (setting.contains("certificate-key-type")) {
+        settings.certificate_key_type = setting["certificate-key-type"].value_or(
+            std::string{"ecdsa-p256"});
+    } else {
+        settings.certificate_key_type = "ecdsa-p256";
+    }
+    if (setting.contains("worker-threads")) {
+        settings.worker_threads = setting["worker-threads"].value_or(0);
+    } else {
+        settings.worker_threads = 0;
+    }
+    if (setting.contains("compute-threads")) {
+        settings.compute_threads = setting["compute-threads"].value_or(0);
+    } else {
+        settings.compute_threads = 0;
+    }
+    if (setting.contains("max-receive-sessions")) {
+        settings.max_receive_sessions = setting["max-receive-sessions"].value_or(4);
+    } else {
+        settings.max_receive_sessions = 4;
+    }
+    if (setting.contains("max-receive-bandwidth")) {
+        settings.max_receive_bandwidth = setting["max-receive-bandwidth"].value_or(0);
+    } else {
+        settings.max_receive_bandwidth = 0;
+    }
+    if (setting.contains("progress-rate-hz")) {
+        settings.progress_rate_hz = setting["progress-rate-hz"].value_or(10);
+    } else {
+        settings.progress_rate_hz = 10;
+    }
+    if (setting.contains("max-connections")) {
+        settings.max_connections = setting["max-connections"].value_or(64);
+    } else {
+        settings.max_connections = 64;
+    }
+    if (setting.contains("max-peer-connections")) {
+        settings.max_peer_connections = setting["max-peer-connections"].value_or(8);
+    } else {
+        settings.max_peer_connections = 8;
+    }
+    if (setting.contains("peer-handshake-rate")) {
+        settings.peer_handshake_rate = setting["peer-handshake-rate"].value_or(5);
+    } else {
+        settings.peer_handshake_rate = 5;
+    }
+    if (setting.contains("memory-budget-mb")) {
+        settings.memory_budget_mb = setting["memory-budget-mb"].value_or(256);
+    } else {
+        settings.memory_budget_mb = 256;
+    }
+    if (setting.contains("multipath-transfer")) {
+        settings.multipath_transfer = setting["multipath-transfer"].value_or(true);
+    } else {
+        settings.multipath_transfer = true;
+    }
+    if (setting.contains("udp-transport")) {
+        settings.udp_transport = setting["udp-transport"].value_or(false);
+    } else {
+        settings.udp_transport = false;
+    }
+    if (setting.contains("mux-transport")) {
+        settings.mux_transport = setting["mux-transport"].value_or(true);
+    } else {
+        settings.mux_transport = true;
+    }
 }
 
 void InitConfig() {
@@ -73,6 +139,19 @@ void SaveConfig() {
                                 {"pin-code", settings.pin_code},
                                 {"auto-receive", settings.auto_receive},
                                 {"save-dir", settings.save_dir.string()},
+                                {"certificate-key-type", settings.certificate_key_type},
+                                {"worker-threads", settings.worker_threads},
+                                {"compute-threads", settings.compute_threads},
+                                {"max-receive-sessions", settings.max_receive_sessions},
+                                {"max-receive-bandwidth", settings.max_receive_bandwidth},
+                                {"progress-rate-hz", settings.progress_rate_hz},
+                                {"max-connections", settings.max_connections},
+                                {"max-peer-connections", settings.max_peer_connections},
+                                {"peer-handshake-rate", settings.peer_handshake_rate},
+                                {"memory-budget-mb", settings.memory_budget_mb},
+                                {"multipath-transfer", settings.multipath_transfer},
+                                {"udp-transport", settings.udp_transport},
+                                {"mux-transport", settings.mux_transport},
                             });
     ofs << config;
 }
@@ -0,0 +1,166 @@
+#include <core/constant/transfer.h>
+#include <core/util/dto_reader.h>
+#include <simdjson.h>
+
+namespace lansend::core {
+
+namespace ondemand = simdjson::ondemand;
+
+static_assert(transfer::kBodyPadding >= simdjson::SIMDJSON_PADDING);
+
+static ondemand::parser& Parser() {
+    thread_local ondemand::parser parser;
+    return parser;
+}
+
+// Parses body and hands its document to read. The document refers to the bytes it is parsed
+// from, a copy made for want of padding lives until read returns.
+template<typename Read>
+static auto Iterate(std::string_view body, std::size_t capacity, Read&& read) {
+    if (capacity >= body.size() + simdjson::SIMDJSON_PADDING) {
+        ondemand::document document = Parser().iterate(
+            simdjson::padded_string_view(body.data(), body.size(), capacity));
+        return read(document);
+    }
+    simdjson::padded_string json(body);
+    ondemand::document document = Parser().iterate(json);
+    return read(document);
+}
+
+static std::string ReadString(ondemand::value value) {
+    return std::string(std::string_view(value.get_string()));
+}
+
+static std::uint64_t ReadUint(ondemand::value value) {
+    return value.get_uint64().value();
+}
+
+// Fields are matched while iterating the object once, in whatever order the sender wrote them.
+// Unknown fields are skipped, missing ones keep their default.
+
+static DeviceAddress ReadAddress(ondemand::object object) {
+    DeviceAddress address{};
+    for (auto field : object) {
+        std::string_view key = field.unescaped_key();
+        if (key == "ip_address") {
+            address.ip_address = ReadString(field.value());
+        } else if (key == "link_speed_mbps") {
+            address.link_speed_mbps = static_cast<std::uint32_t>(ReadUint(field.value()));
+        }
+    }
+    return address;
+}
+
+static DeviceInfo ReadDeviceInfo(ondemand::object object) {
+    DeviceInfo device_info{};
+    for (auto field : object) {
+        std::string_view key = field.unescaped_key();
+        if (key == "device_id") {
+            device_info.device_id = ReadString(field.value());
+        } else if (key == "hostname") {
+            device_info.hostname = ReadString(field.value());
+        } else if (key == "operating_system") {
+            device_info.operating_system = ReadString(field.value());
+        } else if (key == "ip_address") {
+            device_info.ip_address = ReadString(field.value());
+        } else if (key == "port") {
+            device_info.port = static_cast<std::uint16_t>(ReadUint(field.value()));
+        } else if (key == "addresses") {
+            for (auto element : field.value().get_array()) {
+                device_info.addresses.push_back(ReadAddress(element.get_object()));
+            }
+        }
+    }
+    return device_info;
+}
+
+static FileDto ReadFile(ondemand::object object) {
+    FileDto file{};
+    for (auto field : object) {
+        std::string_view key = field.unescaped_key();
+        if (key == "file_id") {
+            file.file_id = ReadString(field.value());
+        } else if (key == "file_name") {
+            file.file_name = ReadString(field.value());
+        } else if (key == "file_size") {
+            file.file_size = ReadUint(field.value());
+        } else if (key == "chunk_size") {
+            file.chunk_size = ReadUint(field.value());
+        } else if (key == "total_chunks") {
+            file.total_chunks = ReadUint(field.value());
+        } else if (key == "file_checksum") {
+            file.file_checksum = ReadString(field.value());
+        } else if (key == "file_type") {
+            file.file_type = FileTypeFromString(std::string_view(field.value().get_string()));
+        }
+    }
+    return file;
+}
+
+static std::vector<FileDto> ReadFiles(ondemand::array array) {
+    std::vector<FileDto> files;
+    files.reserve(array.count_elements());
+    for (auto element : array) {
+        files.push_back(ReadFile(element.get_object()));
+    }
+    return files;
+}
+
+RequestSendDto DtoReader::ReadRequestSend(std::string_view body, std::size_t capacity) {
+    return Iterate(body, capacity, [](ondemand::document& document) {
+        RequestSendDto dto{};
+        for (auto field : document.get_object()) {
+            std::string_view key = field.unescaped_key();
+            if (key == "device_info") {
+                dto.device_info = ReadDeviceInfo(field.value().get_object());
+            } else if (key == "files") {
+                dto.files = ReadFiles(field.value().get_array());
+            } else if (key == "total_files") {
+                dto.total_files = ReadUint(field.value());
+            } else if (key == "udp_transport") {
+                dto.udp_transport = field.value().get_bool().value();
+            }
+        }
+        return dto;
+    });
+}
+
+ManifestPageDto DtoReader::ReadManifestPage(std::string_view body, std::size_t capacity) {
+    return Iterate(body, capacity, [](ondemand::document& document) {
+        ManifestPageDto dto{};
+        for (auto field : document.get_object()) {
+            std::string_view key = field.unescaped_key();
+            if (key == "session_id") {
+                dto.session_id = ReadString(field.value());
+            } else if (key == "files") {
+                dto.files = ReadFiles(field.value().get_array());
+            }
+        }
+        return dto;
+    });
+}
+
+VerifyIntegrityDto DtoReader::ReadVerifyIntegrity(std::string_view body, std::size_t capacity) {
+    return Iterate(body, capacity, [](ondemand::document& document) {
+        VerifyIntegrityDto dto{};
+        for (auto field : document.get_object()) {
+            std::string_view key = field.unescaped_key();
+            if (key == "session_id") {
+                dto.session_id = ReadString(field.value());
+            } else if (key == "file_id") {
+                dto.file_id = ReadString(field.value());
+            } else if (key == "file_token") {
+                dto.file_token = ReadString(field.value());
+            }
+        }
+        return dto;
+    });
+}
+
+std::string DtoReader::ReadSessionId(std::string_view body, std::size_t capacity) {
+    return Iterate(body, capacity, [](ondemand::document& document) {
+        return ReadString(document["session_id"]);
+    });
+}
+
+} // namespace lansend::core
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <core/util/config.h>
+#include <core/util/memory_governor.h>
+#include <spdlog/spdlog.h>
+#include <utility>
+
+namespace net = boost::asio;
+using namespace std::chrono;
+
+namespace lansend::core {
+
+MemoryReservation::MemoryReservation(MemoryReservation&& other) noexcept
+    : bytes_(std::exchange(other.bytes_, 0)) {}
+
+MemoryReservation& MemoryReservation::operator=(MemoryReservation&& other) noexcept {
+    if (this != &other) {
+        Release();
+        bytes_ = std::exchange(other.bytes_, 0);
+    }
+    return *this;
+}
+
+MemoryReservation::~MemoryReservation() {
+    Release();
+}
+
+void MemoryReservation::Release() {
+    if (bytes_ > 0) {
+        MemoryGovernor::instance().release(std::exchange(bytes_, 0));
+    }
+}
+
+MemoryGovernor::MemoryGovernor(std::size_t budget)
+    : budget_(budget) {
+    stats_.budget = budget;
+    if (budget_ > 0) {
+        spdlog::info("Memory governor limits in-flight buffers to {} MiB", budget_ >> 20);
+    } else {
+        spdlog::info("Memory governor is not limiting in-flight buffers");
+    }
+}
+
+MemoryGovernor& MemoryGovernor::instance() {
+    static MemoryGovernor instance(static_cast<std::size_t>(settings.memory_budget_mb) << 20);
+    return instance;
+}
+
+bool MemoryGovernor::fits(std::size_t bytes) const {
+    return budget_ == 0 || in_use_ == 0 || in_use_ + bytes <= budget_;
+}
+
+void MemoryGovernor::grant(std::size_t bytes) {
+    in_use_ += bytes;
+    stats_.in_use = in_use_;
+    stats_.peak = std::max(stats_.peak, in_use_);
+    stats_.reservations++;
+}
+
+void MemoryGovernor::release(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_use_ -= bytes;
+    stats_.in_use = in_use_;
+    serveWaiters();
+}
+
+void MemoryGovernor::abandon(const std::shared_ptr<Waiter>& waiter) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto it = std::ranges::find(waiters_, waiter); it != waiters_.end()) {
+        waiters_.erase(it);
+    } else {
+        // Granted by release() after the wait was given up
+        in_use_ -= waiter->bytes;
+        stats_.in_use = in_use_;
+    }
+    // Whoever queued behind it may fit now
+    serveWaiters();
+}
+
+void MemoryGovernor::serveWaiters() {
+    while (!waiters_.empty() && fits(waiters_.front()->bytes)) {
+        auto waiter = std::move(waiters_.front());
+        waiters_.pop_front();
+        grant(waiter->bytes);
+        // The waiter may run on any strand, the channel is safe to signal from here
+        waiter->granted->try_send(boost::system::error_code{});
+    }
+}
+
+net::awaitable<MemoryReservation> MemoryGovernor::Reserve(std::size_t bytes) {
+    if (bytes == 0) {
+        co_return MemoryReservation{};
+    }
+
+    auto& governor = instance();
+    auto executor = co_await net::this_coro::executor;
+    std::shared_ptr<Waiter> waiter;
+    {
+        std::lock_guard<std::mutex> lock(governor.mutex_);
+        if (governor.waiters_.empty() && governor.fits(bytes)) {
+            governor.grant(bytes);
+            co_return MemoryReservation{bytes};
+        }
+        waiter = std::make_shared<Waiter>(Waiter{
+            .bytes = bytes,
+            .granted = std::make_unique<Signal>(executor, 1),
+        });
+        governor.waiters_.push_back(waiter);
+    }
+
+    // Runs when the wait throws on cancellation, or when the coroutine is destroyed while
+    // suspended in it
+    struct AbandonGuard {
+        MemoryGovernor& governor;
+        const std::shared_ptr<Waiter>& waiter;
+        bool received = false;
+
+        ~AbandonGuard() {
+            if (!received) {
+                governor.abandon(waiter);
+            }
+        }
+    } guard{governor, waiter};
+
+    // The bytes are accounted to us by release() before the signal is sent
+    auto queued_at = steady_clock::now();
+    co_await waiter->granted->async_receive(net::use_awaitable);
+    guard.received = true;
+    auto waited = duration_cast<microseconds>(steady_clock::now() - queued_at);
+
+    std::size_t in_use;
+    {
+        std::lock_guard<std::mutex> lock(governor.mutex_);
+        governor.stats_.waits++;
+        governor.stats_.total_wait += waited;
+        governor.stats_.max_wait = std::max(governor.stats_.max_wait, waited);
+        in_use = governor.in_use_;
+    }
+    spdlog::debug("Memory reservation of {} bytes waited {}us, {} bytes in use",
+                  bytes,
+                  waited.count(),
+                  in_use);
+    co_return MemoryReservation{bytes};
+}
+
+MemoryGovernorStats MemoryGovernor::Stats() {
+    auto& governor = instance();
+    std::lock_guard<std::mutex> lock(governor.mutex_);
+    return governor.stats_;
+}
+
+void MemoryGovernor::LogStats() {
+    auto stats = Stats();
+    if (stats.reservations == 0) {
+        return;
+    }
+    spdlog::info("Memory governor: {} reservation(s), peak {} KiB of {} KiB, {} wait(s), "
+                 "avg wait {}us, max wait {}us",
+                 stats.reservations,
+                 stats.peak >> 10,
+                 stats.budget >> 10,
+                 stats.waits,
+                 stats.waits > 0 ? stats.total_wait.count() / static_cast<long long>(stats.waits)
+                                 : 0,
+                 stats.max_wait.count());
+}
+
+} // namespace lansend::core
@@ -0,0 +1,87 @@
+#include <core/util/progress_aggregator.h>
+
+namespace lansend::core {
+
+using Clock = std::chrono::steady_clock;
+
+static double Seconds(Clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+ProgressAggregator::ProgressAggregator(double rate_hz) {
+    SetRate(rate_hz);
+}
+
+void ProgressAggregator::SetRate(double rate_hz) {
+    interval_ = rate_hz > 0 ? std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::duration<double>(1.0 / rate_hz))
+                            : Clock::duration::zero();
+}
+
+std::optional<ProgressSample> ProgressAggregator::Update(std::string_view key,
+                                                         std::uint64_t bytes_transferred,
+                                                         std::uint64_t total_bytes) {
+    auto now = Clock::now();
+    auto it = progresses_.find(std::string(key));
+    if (it == progresses_.end()) {
+        progresses_.emplace(std::string(key),
+                            Progress{
+                                .started_at = now,
+                                .last_sample_at = now,
+                                .start_bytes = bytes_transferred,
+                                .last_sample_bytes = bytes_transferred,
+                                .smoothed_throughput = 0,
+                            });
+        return ProgressSample{
+            .bytes_transferred = bytes_transferred,
+            .total_bytes = total_bytes,
+            .progress = total_bytes == 0 ? 100.0 : 100.0 * bytes_transferred / total_bytes,
+            .throughput = 0,
+            .average_throughput = 0,
+            .eta_seconds = -1,
+        };
+    }
+
+    auto& progress = it->second;
+    bool finished = bytes_transferred >= total_bytes;
+    if (!finished && now - progress.last_sample_at < interval_) {
+        return std::nullopt;
+    }
+
+    double elapsed = Seconds(now - progress.last_sample_at);
+    double throughput = elapsed > 0
+                            ? (bytes_transferred - progress.last_sample_bytes) / elapsed
+                            : 0;
+    double total_elapsed = Seconds(now - progress.started_at);
+    double average_throughput = total_elapsed > 0
+                                    ? (bytes_transferred - progress.start_bytes) / total_elapsed
+                                    : 0;
+    progress.smoothed_throughput = progress.smoothed_throughput == 0
+                                       ? throughput
+                                       : kSmoothing * throughput
+                                             + (1 - kSmoothing) * progress.smoothed_throughput;
+    progress.last_sample_at = now;
+    progress.last_sample_bytes = bytes_transferred;
+
+    double eta_seconds = -1;
+    if (finished) {
+        eta_seconds = 0;
+    } else if (progress.smoothed_throughput > 0) {
+        eta_seconds = (total_bytes - bytes_transferred) / progress.smoothed_throughput;
+    }
+
+    return ProgressSample{
+        .bytes_transferred = bytes_transferred,
+        .total_bytes = total_bytes,
+        .progress = total_bytes == 0 ? 100.0 : 100.0 * bytes_transferred / total_bytes,
+        .throughput = throughput,
+        .average_throughput = average_throughput,
+        .eta_seconds = eta_seconds,
+    };
+}
+
+void ProgressAggregator::Remove(std::string_view key) {
+    progresses_.erase(std::string(key));
+}
+
+} // namespace lansend::core
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <core/util/rate_limiter.h>
+
+namespace net = boost::asio;
+using namespace std::chrono;
+
+namespace lansend::core {
+
+RateLimiter::RateLimiter(double rate, double burst)
+    : rate_(rate)
+    , burst_(burst > 0 ? burst : rate)
+    , tokens_(burst_)
+    , last_refill_(steady_clock::now()) {}
+
+void RateLimiter::SetRate(double rate, double burst) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rate_ = rate;
+    burst_ = burst > 0 ? burst : rate;
+    tokens_ = std::min(tokens_, burst_);
+    last_refill_ = steady_clock::now();
+}
+
+bool RateLimiter::IsLimited() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rate_ > 0;
+}
+
+double RateLimiter::Rate() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rate_;
+}
+
+bool RateLimiter::TryAcquire(double tokens) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (rate_ <= 0) {
+        return true;
+    }
+    refill(steady_clock::now());
+    if (tokens_ < tokens) {
+        return false;
+    }
+    tokens_ -= tokens;
+    return true;
+}
+
+net::awaitable<void> RateLimiter::Acquire(double tokens) {
+    steady_clock::duration delay{0};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rate_ <= 0) {
+            co_return;
+        }
+        refill(steady_clock::now());
+        // The bucket may go into debt, the caller waits until it is paid back.
+        // Later callers queue behind that debt, which keeps the order fair.
+        tokens_ -= tokens;
+        if (tokens_ < 0) {
+            delay = duration_cast<steady_clock::duration>(duration<double>(-tokens_ / rate_));
+        }
+    }
+    if (delay.count() > 0) {
+        net::steady_timer timer(co_await net::this_coro::executor, delay);
+        co_await timer.async_wait(net::use_awaitable);
+    }
+}
+
+void RateLimiter::refill(steady_clock::time_point now) {
+    double elapsed = duration<double>(now - last_refill_).count();
+    tokens_ = std::min(burst_, tokens_ + elapsed * rate_);
+    last_refill_ = now;
+}
+
+} // namespace lansend::core
@@ -1,17 +1,30 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/ip/udp.hpp>
+#include <algorithm>
 #include <core/util/system.h>
 #include <cstring>
+#include <mutex>
+#include <optional>
 #include <spdlog/spdlog.h>
 #include <string>
 #if defined(__APPLE__) || defined(__MACH__)
+#include <arpa/inet.h>
 #include <errno.h>
+#include <ifaddrs.h>
+#include <net/if.h>
 #include <sys/sysctl.h>
 #elif defined(__linux__)
+#include <arpa/inet.h>
+#include <filesystem>
+#include <fstream>
+#include <ifaddrs.h>
+#include <net/if.h>
 #include <sys/types.h>
 #elif defined(_WIN32) || defined(_WIN64)
+#include <iphlpapi.h>
 #include <windows.h>
+#include <ws2tcpip.h>
 #endif
 
 namespace lansend::core {
@@ -30,7 +43,7 @@ std::string Hostname() {
     return hostname;
 }
 
-std::string PublicIpv4Address() {
+static std::string ResolvePublicIpv4Address() {
     try {
         namespace net = boost::asio;
         net::io_context io_context;
@@ -50,6 +63,168 @@ std::string PublicIpv4Address() {
     }
 }
 
+static std::mutex public_ipv4_mutex;
+static std::optional<std::string> public_ipv4_address;
+
+std::string PublicIpv4Address() {
+    std::lock_guard<std::mutex> lock(public_ipv4_mutex);
+    if (!public_ipv4_address) {
+        public_ipv4_address = ResolvePublicIpv4Address();
+    }
+    return *public_ipv4_address;
+}
+
+bool RefreshPublicIpv4Address() {
+    // Resolved outside the lock, readers keep getting the old address meanwhile
+    std::string address = ResolvePublicIpv4Address();
+    std::lock_guard<std::mutex> lock(public_ipv4_mutex);
+    if (public_ipv4_address == address) {
+        return false;
+    }
+    spdlog::info("Local address changed from {} to {}",
+                 public_ipv4_address.value_or("none"),
+                 address);
+    public_ipv4_address = std::move(address);
+    return true;
+}
+
+#if defined(__APPLE__) || defined(__MACH__) || defined(__linux__)
+static std::string Ipv4ToString(const sockaddr* address) {
+    char text[INET_ADDRSTRLEN] = "";
+    const auto* address_in = reinterpret_cast<const sockaddr_in*>(address);
+    inet_ntop(AF_INET, &address_in->sin_addr, text, sizeof(text));
+    return text;
+}
+
+static bool IsVirtualInterface(const std::string& name) {
+#if defined(__linux__)
+    // Physical NICs, Wi-Fi included, are backed by a device, bridges and veth pairs are not
+    return !std::filesystem::exists("/sys/class/net/" + name + "/device");
+#else
+    for (std::string_view prefix : {"bridge", "utun", "vmnet", "awdl", "llw", "gif", "stf"}) {
+        if (name.starts_with(prefix)) {
+            return true;
+        }
+    }
+    return false;
+#endif
+}
+
+static std::uint32_t LinkSpeedMbps([[maybe_unused]] const std::string& name) {
+#if defined(__linux__)
+    // -1 or unreadable for Wi-Fi and for links that are down
+    std::ifstream file("/sys/class/net/" + name + "/speed");
+    long long speed = 0;
+    if (file >> speed && speed > 0) {
+        return static_cast<std::uint32_t>(speed);
+    }
+#endif
+    return 0;
+}
+#endif
+
+static std::vector<NetworkInterface> EnumerateNetworkInterfaces() {
+    std::vector<NetworkInterface> interfaces;
+#if defined(__APPLE__) || defined(__MACH__) || defined(__linux__)
+    ifaddrs* addresses = nullptr;
+    if (getifaddrs(&addresses) != 0) {
+        spdlog::error("Failed to enumerate network interfaces: {}", strerror(errno));
+        return interfaces;
+    }
+    for (ifaddrs* entry = addresses; entry != nullptr; entry = entry->ifa_next) {
+        if (entry->ifa_addr == nullptr || entry->ifa_addr->sa_family != AF_INET
+            || entry->ifa_netmask == nullptr || (entry->ifa_flags & IFF_UP) == 0
+            || (entry->ifa_flags & IFF_LOOPBACK) != 0) {
+            continue;
+        }
+        std::string name = entry->ifa_name;
+        if (IsVirtualInterface(name)) {
+            continue;
+        }
+        interfaces.push_back(NetworkInterface{
+            .name = name,
+            .address = Ipv4ToString(entry->ifa_addr),
+            .netmask = Ipv4ToString(entry->ifa_netmask),
+            .link_speed_mbps = LinkSpeedMbps(name),
+        });
+    }
+    freeifaddrs(addresses);
+#elif defined(_WIN32) || defined(_WIN64)
+    ULONG size = 16 * 1024;
+    std::vector<unsigned char> storage;
+    ULONG result = ERROR_BUFFER_OVERFLOW;
+    for (int attempt = 0; attempt < 3 && result == ERROR_BUFFER_OVERFLOW; ++attempt) {
+        storage.resize(size);
+        result = GetAdaptersAddresses(AF_INET,
+                                      GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST
+                                          | GAA_FLAG_SKIP_DNS_SERVER,
+                                      nullptr,
+                                      reinterpret_cast<IP_ADAPTER_ADDRESSES*>(storage.data()),
+                                      &size);
+    }
+    if (result != NO_ERROR) {
+        spdlog::error("Failed to enumerate network interfaces: error {}", result);
+        return interfaces;
+    }
+    for (auto* adapter = reinterpret_cast<IP_ADAPTER_ADDRESSES*>(storage.data());
+         adapter != nullptr;
+         adapter = adapter->Next) {
+        // Hyper-V and VPN adapters present themselves as Ethernet, they are named vEthernet
+        if (adapter->OperStatus != IfOperStatusUp
+            || (adapter->IfType != IF_TYPE_ETHERNET_CSMACD
+                && adapter->IfType != IF_TYPE_IEEE80211)
+            || std::wstring_view(adapter->FriendlyName).starts_with(L"vEthernet")) {
+            continue;
+        }
+        for (auto* unicast = adapter->FirstUnicastAddress; unicast != nullptr;
+             unicast = unicast->Next) {
+            auto* address = reinterpret_cast<sockaddr_in*>(unicast->Address.lpSockaddr);
+            char text[INET_ADDRSTRLEN] = "";
+            inet_ntop(AF_INET, &address->sin_addr, text, sizeof(text));
+            in_addr mask{};
+            ConvertLengthToIpv4Mask(unicast->OnLinkPrefixLength, &mask.S_un.S_addr);
+            char mask_text[INET_ADDRSTRLEN] = "";
+            inet_ntop(AF_INET, &mask, mask_text, sizeof(mask_text));
+            interfaces.push_back(NetworkInterface{
+                .name = adapter->AdapterName,
+                .address = text,
+                .netmask = mask_text,
+                .link_speed_mbps = static_cast<std::uint32_t>(adapter->TransmitLinkSpeed
+                                                              / 1'000'000),
+            });
+        }
+    }
+#endif
+    std::stable_sort(interfaces.begin(),
+                     interfaces.end(),
+                     [](const NetworkInterface& lhs, const NetworkInterface& rhs) {
+                         return lhs.link_speed_mbps > rhs.link_speed_mbps;
+                     });
+    return interfaces;
+}
+
+static std::mutex network_interfaces_mutex;
+static std::optional<std::vector<NetworkInterface>> network_interfaces;
+
+std::vector<NetworkInterface> NetworkInterfaces() {
+    std::lock_guard<std::mutex> lock(network_interfaces_mutex);
+    if (!network_interfaces) {
+        network_interfaces = EnumerateNetworkInterfaces();
+    }
+    return *network_interfaces;
+}
+
+bool RefreshNetworkInterfaces() {
+    auto interfaces = EnumerateNetworkInterfaces();
+    std::lock_guard<std::mutex> lock(network_interfaces_mutex);
+    if (network_interfaces == interfaces) {
+        return false;
+    }
+    spdlog::info("Network interfaces changed, {} usable", interfaces.size());
+    network_interfaces = std::move(interfaces);
+    return true;
+}
+
 std::string OperatingSystem() {
     std::string pretty_name{};
     constexpr auto architecture =
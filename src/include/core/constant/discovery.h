@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+namespace lansend::core {
+
+namespace discovery {
+
+constexpr std::uint16_t kPort = 37020;
+constexpr std::string_view kMulticastGroup = "224.0.0.167"; // Link-local, never routed
+
+// Beacons start frequent after a change and back off while nothing changes
+constexpr auto kMinBeaconInterval = std::chrono::milliseconds(250);
+constexpr auto kMaxBeaconInterval = std::chrono::seconds(8);
+constexpr auto kMaxReplyJitter = std::chrono::milliseconds(50); // Replies to a query
+constexpr auto kDeviceTimeout = std::chrono::seconds(25);       // About three missed beacons
+
+} // namespace discovery
+
+} // namespace lansend::core
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace lansend::core {
+
+namespace mux {
+
+constexpr std::string_view kProtocol = "lansend-mux/1"; // Upgrade token
+
+constexpr std::size_t kFrameHeaderSize = 4 + 1 + 1 + 4;
+constexpr std::size_t kMaxDataFrameSize = 16 * 1024; // Streams interleave at this granularity
+constexpr std::size_t kMaxControlFrameSize = 16 * 1024 * 1024; // Request heads and responses
+constexpr std::size_t kMaxWriteBatch = 64 * 1024;    // Queued frames coalesced into one write
+constexpr std::size_t kMaxQueuedFramesPerStream = 4; // Keeps one stream from hogging the queue
+
+// Credit-based flow control, the receiver of the bytes grants more once it has read half
+constexpr std::uint32_t kStreamWindow = 1024 * 1024;
+constexpr std::uint32_t kConnectionWindow = 4 * 1024 * 1024;
+
+constexpr std::size_t kMaxConcurrentStreams = 64;
+constexpr std::size_t kStreamsPerPath = 4; // Chunks a sender keeps in flight per connection
+constexpr auto kIdleTimeout = std::chrono::seconds(120);
+
+} // namespace mux
+
+} // namespace lansend::core
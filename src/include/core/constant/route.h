@@ -8,11 +8,26 @@ class ApiRoute {
 public:
     static constexpr std::string_view kPing = "/ping";
     static constexpr std::string_view kConnect = "/connect";
+    static constexpr std::string_view kDeviceInfo = "/device-info";
     static constexpr std::string_view kRequestSend = "/request-send";
+    static constexpr std::string_view kManifestPage = "/manifest-page";
     static constexpr std::string_view kSendChunk = "/send-chunk";
     static constexpr std::string_view kVerifyIntegrity = "/verify-integrity";
     static constexpr std::string_view kCancelSend = "/cancel-send";
     static constexpr std::string_view kCancelWait = "/cancel-wait";
+    // Upgrades the connection to the multiplexed frame protocol
+    static constexpr std::string_view kMux = "/mux";
+};
+
+class ApiHeader {
+public:
+    // Handed to a sender waiting for a free receive session, sent back to keep its queue position
+    static constexpr std::string_view kQueueTicket = "X-Lansend-Queue-Ticket";
+    static constexpr std::string_view kQueuePosition = "X-Lansend-Queue-Position";
+    // Granted in every chunk acknowledgement: the chunks the sender may have in flight
+    static constexpr std::string_view kChunkCredits = "X-Lansend-Chunk-Credits";
+    // Set by the server on every buffered request: the remote address of its connection
+    static constexpr std::string_view kPeerAddress = "X-Lansend-Peer-Address";
 };
 
 } // namespace lansend::core
\ No newline at end of file
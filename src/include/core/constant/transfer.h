@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 
 namespace lansend::core {
@@ -8,6 +9,31 @@ namespace transfer {
 
 constexpr size_t kDefaultChunkSize = 1 * 1024 * 1024; // 1 MB
 constexpr size_t kMaxChunkSize = 32 * 1024 * 1024;    // 32 MB
+constexpr size_t kManifestPageSize = 1000;            // Files per request-send/manifest-page body
+constexpr size_t kMaxManifestFiles = 100000;          // Files a single send request may offer
+
+// Spare capacity reserved past a buffered request body, JSON bodies are parsed in place then.
+// At least SIMDJSON_PADDING.
+constexpr size_t kBodyPadding = 64;
+
+// Happy Eyeballs (RFC 8305) between the receiver's addresses
+constexpr std::chrono::milliseconds kConnectionAttemptDelay{250};
+constexpr std::chrono::seconds kConnectionRaceTimeout{10};
+
+// Multipath transfer
+constexpr size_t kMaxTransferPaths = 4;
+constexpr size_t kMaxChunkAttempts = 3; // Paths a chunk may fail on before the file fails
+constexpr std::chrono::seconds kPathConnectTimeout{5};
+
+// Receiver-driven flow control: the receiver grants the chunks a sender may have in flight so
+// that its write queue drains within the target delay at the rate the disk absorbs them
+constexpr size_t kInitialChunkCredits = 4; // Until the receiver has measured its disk
+constexpr size_t kMaxChunkCredits = 16;
+constexpr std::chrono::milliseconds kTargetWriteDelay{250};
+
+// A cancelled send session keeps its connections open this long for the receiver to hear of
+// the cancellation, it would take the sender for lost otherwise
+constexpr std::chrono::seconds kCancelNotifyTimeout{2};
 
 } // namespace transfer
 
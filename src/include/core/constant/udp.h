@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace lansend::core {
+
+namespace udp {
+
+constexpr std::size_t kSegmentSize = 1200;          // File bytes per datagram, fits any LAN MTU
+constexpr std::size_t kMaxDatagramSize = 1400;      // Segment plus header, frame and tag
+constexpr std::size_t kReadBlockSize = 1024 * 1024; // File bytes the sender reads at once
+constexpr int kSocketBufferSize = 4 * 1024 * 1024;  // Absorbs bursts while a side is busy
+constexpr double kMaxBytesInFlight = 1024 * 1024;   // Well within the receiver's socket buffer
+
+// Acknowledgements
+constexpr std::size_t kAckEveryPackets = 2;
+constexpr auto kMaxAckDelay = std::chrono::milliseconds(5);
+constexpr std::size_t kMaxAckRanges = 32;
+constexpr std::size_t kMaxTrackedRanges = 256; // Received packet ranges kept by the receiver
+
+// Loss detection, as in QUIC (RFC 9002)
+constexpr std::uint64_t kPacketThreshold = 3;
+constexpr auto kInitialRtt = std::chrono::milliseconds(50);
+constexpr auto kIdleTimeout = std::chrono::seconds(10); // No acknowledgement at all
+
+// Delay-based rate control, LEDBAT style (RFC 6817): the rate grows while the queuing delay
+// stays below the target and shrinks above it. Random loss on Wi-Fi only costs a little.
+constexpr auto kTargetQueueDelay = std::chrono::milliseconds(10);
+constexpr auto kPacingInterval = std::chrono::milliseconds(1);
+constexpr auto kMaxBurst = std::chrono::milliseconds(4); // Sending credit saved up at most
+constexpr double kRateGain = 0.25;       // Largest rate change in one round trip
+constexpr double kLossBeta = 0.05;       // Rate decrease per round trip with losses
+constexpr double kCongestionLoss = 0.1;  // Loss rate that is congestion, the rate is halved
+constexpr double kInitialRate = 1.25e6;  // Bytes per second, 10 Mbit/s
+constexpr double kMinRate = 64e3;
+constexpr double kMaxRate = 1.25e9;
+
+} // namespace udp
+
+} // namespace lansend::core
@@ -2,19 +2,33 @@
 #include <core/util/config.h>
 #include <core/util/system.h>
 #include <cstdint>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <vector>
 
 namespace lansend::core {
 
+// One of the addresses a device is reachable at
+struct DeviceAddress {
+    std::string ip_address;
+    std::uint32_t link_speed_mbps = 0; // 0 = unknown
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(DeviceAddress, ip_address, link_speed_mbps)
+};
+
 struct DeviceInfo {
     std::string device_id;        // 唯一ID
     std::string hostname;         // 主机名
     std::string operating_system; // 操作系统
     std::string ip_address;
-    uint16_t port;
+    uint16_t port{0};
+    // Every interface the device listens on, fastest first; ip_address is the one it was seen at
+    std::vector<DeviceAddress> addresses;
 
-    static auto& LocalDeviceInfo() {
+    // Returned by value, callers on any thread get a consistent snapshot
+    static DeviceInfo LocalDeviceInfo() {
+        static std::mutex mutex;
         static DeviceInfo local_device_info = []() {
             DeviceInfo info;
             info.hostname = system::Hostname();
@@ -30,19 +44,24 @@ struct DeviceInfo {
 
             return info;
         }();
-        auto addr = system::PublicIpv4Address();
-        if (local_device_info.ip_address != addr) {
-            local_device_info.ip_address = addr;
-        }
-        if (local_device_info.port != settings.port) {
-            local_device_info.port = settings.port;
+        // The address is cached by system::PublicIpv4Address() and only resolved again when
+        // NetworkMonitor sees the interfaces change
+        std::lock_guard<std::mutex> lock(mutex);
+        local_device_info.ip_address = system::PublicIpv4Address();
+        local_device_info.port = settings.port;
+        local_device_info.addresses.clear();
+        for (const auto& network_interface : system::NetworkInterfaces()) {
+            local_device_info.addresses.push_back(DeviceAddress{
+                .ip_address = network_interface.address,
+                .link_speed_mbps = network_interface.link_speed_mbps,
+            });
         }
         return local_device_info;
     }
 
-    // 序列化/反序列化函数
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(
-        DeviceInfo, device_id, hostname, operating_system, ip_address, port)
+    // 序列化/反序列化函数，旧版本的设备不发送 addresses
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(
+        DeviceInfo, device_id, hostname, operating_system, ip_address, port, addresses)
 };
 
 } // namespace lansend::core
\ No newline at end of file
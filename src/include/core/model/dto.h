@@ -1,6 +1,7 @@
 #pragma once
 
 #include "dto/file_dto.h"
+#include "dto/manifest_page_dto.h"
 #include "dto/request_send_dto.h"
 #include "dto/request_send_response_dto.h"
 #include "dto/send_chunk_dto.h"
@@ -4,11 +4,30 @@
 #include <nlohmann/json.hpp>
 namespace lansend::core {
 
+enum class BroadcastType {
+    kAnnounce, // Periodic beacon, also the answer to a query
+    kQuery,    // Sent once on start, peers answer right away
+    kGoodbye,  // Sent on stop, peers drop the device without waiting for the timeout
+};
+
+NLOHMANN_JSON_SERIALIZE_ENUM(BroadcastType,
+                             {
+                                 {BroadcastType::kAnnounce, "announce"},
+                                 {BroadcastType::kQuery, "query"},
+                                 {BroadcastType::kGoodbye, "goodbye"},
+                             })
+
 struct BroadcastDto {
+    BroadcastType type = BroadcastType::kAnnounce; // Absent in beacons of older versions
     DeviceInfo device_info;
     std::string fingerprint;
+    std::string previous_fingerprint; // Only set while migrating to a new certificate
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(BroadcastDto, device_info, fingerprint);
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(BroadcastDto,
+                                                type,
+                                                device_info,
+                                                fingerprint,
+                                                previous_fingerprint);
 };
 
-} // namespace lansend::core
\ No newline at end of file
+} // namespace lansend::core
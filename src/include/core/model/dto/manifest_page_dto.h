@@ -0,0 +1,18 @@
+#pragma once
+
+#include "file_dto.h"
+#include <nlohmann/detail/macro_scope.hpp>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace lansend::core {
+
+struct ManifestPageDto {
+    std::string session_id;     // request-send 返回的会话ID
+    std::vector<FileDto> files; // 清单的下一页
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(ManifestPageDto, session_id, files);
+};
+
+} // namespace lansend::core
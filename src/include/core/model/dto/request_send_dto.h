@@ -4,15 +4,22 @@
 #include "file_dto.h"
 #include <nlohmann/detail/macro_scope.hpp>
 #include <nlohmann/json.hpp>
+#include <cstddef>
 #include <vector>
 
 namespace lansend::core {
 
 struct RequestSendDto {
     DeviceInfo device_info;     // 发送方的设备信息
-    std::vector<FileDto> files; // 文件信息列表
+    std::vector<FileDto> files; // 文件信息列表（分页发送时为第一页）
+    std::size_t total_files{0}; // 分页时清单的文件总数，0 表示 files 即完整清单
+    bool udp_transport{false};  // 发送方可通过 UDP 数据通道发送文件数据
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(RequestSendDto, device_info, files);
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(RequestSendDto,
+                                                device_info,
+                                                files,
+                                                total_files,
+                                                udp_transport);
 };
 
 } // namespace lansend::core
@@ -2,15 +2,25 @@
 
 #include <nlohmann/detail/macro_scope.hpp>
 #include <nlohmann/json.hpp>
+#include <cstdint>
 #include <unordered_map>
+#include <vector>
 
 namespace lansend::core {
 
 struct RequestSendResponseDto {
     std::string session_id;                                   // 服务器生成的会话ID
     std::unordered_map<std::string, std::string> file_tokens; // 文件ID到令牌的映射
+    bool manifest_pending{false}; // 清单尚未收全，发送方需继续发送 manifest-page
+    std::uint16_t udp_port{0};         // UDP 数据通道端口，0 表示使用 HTTPS 发送分块
+    std::vector<std::uint8_t> udp_key; // UDP 数据通道的 AES-256-GCM 密钥
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(RequestSendResponseDto, session_id, file_tokens);
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(RequestSendResponseDto,
+                                                session_id,
+                                                file_tokens,
+                                                manifest_pending,
+                                                udp_port,
+                                                udp_key);
 };
 
 } // namespace lansend::core
\ No newline at end of file
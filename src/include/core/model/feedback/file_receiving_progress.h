@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <nlohmann/json.hpp>
 #include <string>
 
@@ -9,8 +10,21 @@ struct FileReceivingProgress {
     std::string session_id;
     std::string filename;
     double progress;
+    std::uint64_t bytes_transferred = 0;
+    std::uint64_t total_bytes = 0;
+    double throughput = 0;         // Bytes per second since the previous update
+    double average_throughput = 0; // Bytes per second since the file started
+    double eta_seconds = -1;       // -1 while unknown
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(FileReceivingProgress, session_id, filename, progress);
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(FileReceivingProgress,
+                                   session_id,
+                                   filename,
+                                   progress,
+                                   bytes_transferred,
+                                   total_bytes,
+                                   throughput,
+                                   average_throughput,
+                                   eta_seconds);
 };
 
 } // namespace lansend::core::feedback
\ No newline at end of file
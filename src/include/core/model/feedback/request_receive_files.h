@@ -8,11 +8,18 @@
 namespace lansend::core::feedback {
 
 struct RequestReceiveFiles {
+    std::string session_id; // Identifies the request when answering with ConfirmReceive
+
     DeviceInfo device_info;
 
     std::vector<std::string> file_names;
+    std::vector<std::string> file_ids; // Parallel to file_names, preferred when answering
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(RequestReceiveFiles, device_info, file_names);
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(RequestReceiveFiles,
+                                   session_id,
+                                   device_info,
+                                   file_names,
+                                   file_ids);
 };
 
 } // namespace lansend::core::feedback
\ No newline at end of file
@@ -11,8 +11,16 @@ struct Settings {
     std::string pin_code;
     bool auto_receive;
     std::string save_dir;
+    std::uint16_t max_receive_sessions;
+    std::uint32_t max_receive_bandwidth;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(Settings, port, pin_code, auto_receive, save_dir);
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(Settings,
+                                   port,
+                                   pin_code,
+                                   auto_receive,
+                                   save_dir,
+                                   max_receive_sessions,
+                                   max_receive_bandwidth);
 
     static Settings FromConfigSettings() {
         return Settings{
@@ -20,6 +28,8 @@ struct Settings {
             .pin_code = core::settings.pin_code,
             .auto_receive = core::settings.auto_receive,
             .save_dir = core::settings.save_dir.string(),
+            .max_receive_sessions = core::settings.max_receive_sessions,
+            .max_receive_bandwidth = core::settings.max_receive_bandwidth,
         };
     }
 };
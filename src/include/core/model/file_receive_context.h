@@ -1,8 +1,8 @@
 #pragma once
 
+#include <core/util/chunk_bitmap.h>
 #include <filesystem>
 #include <string>
-#include <unordered_set>
 
 namespace lansend::core {
 
@@ -13,7 +13,7 @@ struct ReceiveFileContext {
     size_t file_size;                                // 文件总大小
     size_t chunk_size;                               // 块大小
     size_t total_chunks;                             // 总块数
-    std::unordered_set<std::size_t> received_chunks; // 已接收块集合
+    ChunkBitmap received_chunks;                     // 已接收块位图，按 total_chunks 分配
     std::string file_checksum;                       // 整个文件的校验和
 };
 
@@ -61,6 +61,23 @@ inline std::string_view FileTypeToString(FileType type) {
     return "Unknown";
 }
 
+inline FileType FileTypeFromString(std::string_view type) {
+    for (auto candidate : {FileType::kImage,
+                           FileType::kVideo,
+                           FileType::kAudio,
+                           FileType::kText,
+                           FileType::kPDF,
+                           FileType::kArchive,
+                           FileType::kDocument,
+                           FileType::kPresentation,
+                           FileType::kSpreadsheet}) {
+        if (FileTypeToString(candidate) == type) {
+            return candidate;
+        }
+    }
+    return FileType::kOther;
+}
+
 inline FileType GetFileType(std::string_view filepath) {
     std::filesystem::path path(filepath);
     std::string ext = path.extension().string();
@@ -1,14 +1,49 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 namespace lansend::core {
 
+enum class KeyType {
+    kRsa2048,
+    kEcdsaP256,
+    kEd25519,
+};
+
+inline std::string_view KeyTypeToString(KeyType type) {
+    switch (type) {
+    case KeyType::kRsa2048:
+        return "rsa-2048";
+    case KeyType::kEcdsaP256:
+        return "ecdsa-p256";
+    case KeyType::kEd25519:
+        return "ed25519";
+    }
+    return "unknown";
+}
+
+inline KeyType KeyTypeFromString(std::string_view type) {
+    if (type == "rsa-2048" || type == "rsa") {
+        return KeyType::kRsa2048;
+    }
+    if (type == "ed25519") {
+        return KeyType::kEd25519;
+    }
+    // ECDSA P-256 is the default: cheap to generate and to sign with during handshakes
+    return KeyType::kEcdsaP256;
+}
+
 struct SecurityContext {
     std::string private_key_pem;
     std::string public_key_pem;
     std::string certificate_pem;
     std::string certificate_hash; // SHA-256 fingerprint
+    KeyType key_type = KeyType::kEcdsaP256;
+
+    // Fingerprint of the identity replaced by a key type migration. It keeps being announced
+    // until the transition period expires, so peers holding the old fingerprint still accept us.
+    std::string previous_certificate_hash;
 };
 
-} // namespace lansend::core
\ No newline at end of file
+} // namespace lansend::core
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace lansend::core {
+
+// Hands the chunks of the file being sent to the paths of a send session. Every working path
+// pulls the next chunk as soon as it is free, so each one carries a share proportional to its
+// throughput. A chunk whose send failed goes back to the front of the queue and its path is
+// retired. Not thread-safe, the session drives it from its strand.
+class ChunkScheduler {
+public:
+    struct PathStats {
+        double throughput = 0; // Bytes per second, moving average over the chunks sent
+        std::size_t chunks_sent = 0;
+        bool failed = false;
+    };
+
+    ChunkScheduler() = default;
+    // The paths keep their stats from file to file
+    explicit ChunkScheduler(std::size_t path_count);
+
+    void StartFile(std::size_t total_chunks);
+
+    // The next chunk for the path, nullopt while it has to wait or once it failed. credits caps
+    // the chunks in flight over all paths.
+    std::optional<std::size_t> Take(std::size_t path_index, std::size_t credits);
+    // streams: chunks the path had in flight at once while this one was sent
+    void ChunkSent(std::size_t path_index,
+                   std::size_t bytes,
+                   std::size_t streams,
+                   std::chrono::duration<double> elapsed);
+    // Retires the path. The file fails once the chunk failed on kMaxChunkAttempts paths.
+    void ChunkFailed(std::size_t path_index, std::size_t chunk);
+    // Fails the file, e.g. when it was truncated. chunk is the one the path had taken, if any.
+    void Abandon(std::optional<std::size_t> chunk);
+
+    // Every chunk was sent, or the file failed
+    bool Finished() const { return failed_ || (pending_.empty() && in_flight_ == 0); }
+    bool Failed() const { return failed_; }
+    std::size_t Completed() const { return completed_; }
+
+    std::size_t PathCount() const { return paths_.size(); }
+    const PathStats& Path(std::size_t path_index) const { return paths_.at(path_index); }
+
+private:
+    // A slow path leaves the last chunks to the faster ones
+    bool shouldTakeChunk(std::size_t path_index) const;
+
+    std::vector<PathStats> paths_;
+    std::deque<std::size_t> pending_;
+    std::unordered_map<std::size_t, std::size_t> attempts_; // Failed sends per chunk
+    std::size_t in_flight_ = 0;
+    std::size_t completed_ = 0;
+    bool failed_ = false;
+
+    static constexpr double kSmoothing = 0.3; // Weight of the newest chunk in the throughput
+};
+
+} // namespace lansend::core
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <chrono>
+#include <core/constant/transfer.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lansend::core {
+
+struct RacedConnection {
+    std::string address;
+    boost::asio::ip::tcp::socket socket;
+};
+
+/**
+ * @brief Connect to the first of several addresses of one peer that answers (Happy Eyeballs)
+ *
+ * The addresses are tried in order, each attempt starting attempt_delay after the previous one,
+ * or right away when the previous one failed. The first TCP connection wins, the others are
+ * closed. Put the preferred (e.g. fastest) address first: it gets a head start but a slow or
+ * unreachable one does not hold the transfer up.
+ *
+ * @return The winning address and its connected socket, nullopt when none connected in time
+ */
+boost::asio::awaitable<std::optional<RacedConnection>> RaceConnect(
+    boost::asio::io_context& ioc,
+    std::vector<std::string> addresses,
+    unsigned short port,
+    std::chrono::milliseconds attempt_delay = transfer::kConnectionAttemptDelay,
+    std::chrono::milliseconds timeout = transfer::kConnectionRaceTimeout);
+
+} // namespace lansend::core
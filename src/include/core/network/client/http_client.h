@@ -9,8 +9,13 @@
 #include <boost/beast/ssl.hpp>
 #include <boost/beast/version.hpp>
 #include <core/constant/route.h>
+#include <core/network/mux/mux_connection.h>
 #include <core/security/certificate_manager.h>
+#include <memory>
+#include <span>
+#include <sstream>
 #include <string>
+#include <type_traits>
 
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -29,11 +34,27 @@ public:
     HttpsClient& operator=(const HttpsClient&) = delete;
 
     net::awaitable<bool> Connect(std::string_view host, unsigned short port);
+    // Handshake over a socket already connected to host:port, e.g. the winner of RaceConnect()
+    net::awaitable<bool> Connect(tcp::socket socket, std::string_view host, unsigned short port);
 
     net::awaitable<bool> Disconnect();
 
+    // Switch the connection to the multiplexed frame protocol. Requests are then sent on
+    // streams of their own and may be awaited concurrently, without waiting for each other.
+    // Returns false, the connection staying on HTTP/1.1, if the server does not support it.
+    // Requests must then be sent from the executor this is called on.
+    net::awaitable<bool> UpgradeToMux();
+
     bool IsConnected() const;
 
+    // Lets the following handshakes accept a certificate other than the one pinned for the
+    // host, if filter approves its fingerprint. Only this client is affected.
+    void AcceptReplacementCertificate(CertificateManager::ReplacementFilter filter) {
+        accept_replacement_ = std::move(filter);
+    }
+
+    bool IsMultiplexed() const { return mux_ && mux_->IsOpen(); }
+
     std::optional<boost::asio::ip::tcp::endpoint> local_endpoint() const;
 
     std::string current_host() const;
@@ -49,13 +70,19 @@ public:
                                       bool keepAlive = true);
 
 private:
+    // Connects the socket first unless it is open already
+    net::awaitable<bool> connect(tcp::socket socket, std::string_view host, unsigned short port);
+
     net::io_context& ioc_;
     CertificateManager& cert_manager_;
     ssl::context ssl_ctx_;
-    std::unique_ptr<beast::ssl_stream<beast::tcp_stream>> connection_;
+    // Shared with the multiplexed connection's frame loops
+    std::shared_ptr<beast::ssl_stream<beast::tcp_stream>> connection_;
+    std::shared_ptr<MuxConnection> mux_;
     std::string current_host_;
     unsigned short current_port_ = 0;
     SSL_SESSION* ssl_session_ = nullptr;
+    CertificateManager::ReplacementFilter accept_replacement_;
 };
 
 template<typename RequestBody>
@@ -65,6 +92,16 @@ net::awaitable<http::response<http::string_body>> HttpsClient::SendRequest(
         throw std::runtime_error("No active connection");
     }
 
+    if (mux_) {
+        std::ostringstream head;
+        head << req.base();
+        std::span<const std::uint8_t> body;
+        if constexpr (!std::is_same_v<RequestBody, http::empty_body>) {
+            body = {reinterpret_cast<const std::uint8_t*>(req.body().data()), req.body().size()};
+        }
+        co_return co_await mux_->SendRequest(std::move(head).str(), body);
+    }
+
     co_await http::async_write(*connection_, req);
 
     beast::flat_buffer buffer;
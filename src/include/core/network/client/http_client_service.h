@@ -30,6 +30,9 @@ public:
                    const std::vector<std::filesystem::path>& file_paths,
                    std::string_view device_id = {});
 
+    // Races the device's addresses and sends over the first one that connects
+    void SendFiles(const DeviceInfo& device, const std::vector<std::filesystem::path>& file_paths);
+
     void CancelSend(const std::string& session_id);
 
     void CancelWaitForConfirmation(std::string_view ip, unsigned short port);
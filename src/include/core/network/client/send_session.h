@@ -2,14 +2,22 @@
 
 #include "core/model/feedback.h"
 #include <boost/asio.hpp>
+#include <chrono>
 #include <core/constant/transfer.h>
 #include <core/model.h>
+#include <core/network/client/chunk_scheduler.h>
 #include <core/network/client/http_client.h>
+#include <core/network/udp/udp_sender.h>
 #include <core/security/certificate_manager.h>
 #include <core/security/file_hasher.h>
 #include <core/util/binary_message.h>
+#include <core/util/progress_aggregator.h>
+#include <list>
+#include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace lansend::core {
 
@@ -34,35 +42,119 @@ public:
 
     void RecordReceiverId(std::string_view receiver_id) { receiver_device_id_ = receiver_id; }
 
+    // Aborts the requests in flight at once and tells the receiver over a connection of its
+    // own, the data connections may be stuck behind a chunk
     void Cancel();
 
     bool IsCancelled() const;
 
-    boost::asio::awaitable<void> Start(const std::vector<std::filesystem::path>& file_paths,
-                                       std::string_view host,
+    // Arguments are taken by value: the coroutine outlives the caller's frame.
+    // With several hosts (the receiver's addresses, preferred first) the connections are raced.
+    boost::asio::awaitable<void> Start(std::vector<std::filesystem::path> file_paths,
+                                       std::vector<std::string> hosts,
                                        unsigned int port,
                                        SessionStartedCallback callback = nullptr);
 
+    // All of the session's work runs on this strand
+    const boost::asio::strand<boost::asio::io_context::executor_type>& strand() const {
+        return strand_;
+    }
+
 private:
+    // A data connection to the receiver, the first one is the control connection client_.
+    // Its index is also its index in scheduler_.
+    struct TransferPath {
+        std::string local_address;
+        std::string remote_address;
+        std::unique_ptr<HttpsClient> owned_client; // Null for the control connection
+        HttpsClient* client = nullptr;
+        std::size_t streams = 1; // Chunks in flight at once, more on a multiplexed connection
+    };
+
+    // The workers sending the file, one per path and stream
+    struct ChunkSchedule {
+        boost::asio::steady_timer changed; // Cancelled whenever scheduler_ changes
+        std::size_t workers = 0;
+    };
+
+    boost::asio::awaitable<void> run(std::vector<std::filesystem::path> file_paths,
+                                     std::vector<std::string> hosts,
+                                     unsigned int port,
+                                     SessionStartedCallback callback);
     boost::asio::awaitable<bool> requestSend(const RequestSendDto& dto);
+    // Send the rest of a large manifest while the receiver asks for it, returns the response
+    // to the last page
+    boost::asio::awaitable<boost::beast::http::response<boost::beast::http::string_body>>
+    sendManifestPages(const RequestSendDto& dto,
+                      boost::beast::http::response<boost::beast::http::string_body> res);
     boost::asio::awaitable<void> sendFile(std::string_view file_id);
-    boost::asio::awaitable<bool> sendChunk(const SendChunkDto& dto, const BinaryData& chunk_data);
+    // Both return whether every byte of the file reached the receiver
+    boost::asio::awaitable<bool> sendChunks(std::string_view file_id);
+    boost::asio::awaitable<bool> sendOverUdp(std::string_view file_id);
+    void reportSendProgress(const std::string& file_id,
+                            const TransferFileInfo& file_info,
+                            std::uint64_t bytes_sent);
+    boost::asio::awaitable<void> pathWorker(std::string file_id,
+                                            std::size_t path_index,
+                                            ChunkSchedule& schedule);
+    boost::asio::awaitable<bool> sendChunk(HttpsClient& client,
+                                           const SendChunkDto& dto,
+                                           const BinaryData& chunk_data);
+    // Takes the credits the receiver granted in a chunk acknowledgement
+    void updateChunkCredits(
+        const boost::beast::http::response<boost::beast::http::string_body>& res);
     boost::asio::awaitable<bool> verifyIntegrity(const VerifyIntegrityDto& dto);
+    // Sends the request so that Cancel() aborts it mid-way, the connection is unusable then
+    template<typename RequestBody>
+    boost::asio::awaitable<boost::beast::http::response<boost::beast::http::string_body>>
+    sendAbortable(HttpsClient& client, boost::beast::http::request<RequestBody>& req);
+    void requestSettled(std::list<boost::asio::cancellation_signal>::iterator signal);
+    // Runs on the strand: ends the session, aborts the requests in flight and notifies the
+    // receiver
+    void abort(std::chrono::steady_clock::time_point requested_at);
+    boost::asio::awaitable<void> notifyCancel(std::chrono::steady_clock::time_point requested_at);
     boost::asio::awaitable<bool> cancelSend();
 
-    std::vector<FileDto> prepareFiles(const std::vector<std::filesystem::path>& file_paths);
+    boost::asio::awaitable<std::vector<FileDto>> prepareFiles(
+        const std::vector<std::filesystem::path>& file_paths);
+
+    // Opens the UDP data channel the receiver offered in its response, if any
+    void openUdpChannel(RequestSendResponseDto& response_dto);
+    // Opens a data connection from every local interface that reaches one of the receiver's
+    // addresses, in addition to the control connection. Not with the UDP data channel.
+    boost::asio::awaitable<void> openPaths(const std::vector<std::string>& hosts,
+                                           unsigned short port);
+    boost::asio::awaitable<void> closePaths();
+    // The first path still working, the control connection when none is
+    HttpsClient& liveClient();
 
     boost::asio::io_context& ioc_;
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
     CertificateManager& cert_manager_;
     HttpsClient client_;
+    std::vector<TransferPath> paths_;
+    ChunkScheduler scheduler_; // Which path sends which chunk of the file being sent
+    std::shared_ptr<UdpSender> udp_sender_;
+    std::vector<std::string> udp_file_ids_; // Sorted, a file's index in data frames
 
     std::unordered_map<std::string, TransferFileInfo> transfer_files_;
     SessionStatus session_status_ = SessionStatus::kIdle;
 
     std::string session_id_ = {};         // Generated by the server
     std::string receiver_device_id_ = {}; // The device ID of the receiver
+    std::string queue_ticket_ = {};       // Our place in the receiver's admission queue
+    std::string request_send_body_ = {};  // Serialized manifest, reused across retries
+    std::size_t chunk_credits_ = transfer::kInitialChunkCredits; // Granted by the receiver
+    ProgressAggregator progress_;         // Keyed by file id
     FeedbackCallback callback_ = nullptr;
 
+    // One signal per request in flight, Cancel() emits them all
+    std::list<boost::asio::cancellation_signal> request_signals_;
+    std::optional<std::chrono::steady_clock::time_point> cancel_requested_at_;
+    // Start() returns once the receiver heard of the cancellation or the wait timed out
+    bool cancel_notifying_ = false;
+    boost::asio::steady_timer cancel_notified_;
+
     void feedback(Feedback&& feedback) {
         if (callback_) {
             callback_(std::move(feedback));
@@ -4,6 +4,7 @@
 #include "send_session.h"
 #include <boost/asio/io_context.hpp>
 #include <core/security/certificate_manager.h>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -19,7 +20,8 @@ public:
     SendSessionManager(const SendSessionManager&) = delete;
     SendSessionManager& operator=(const SendSessionManager&) = delete;
 
-    void SendFiles(std::string_view,
+    // hosts: the receiver's addresses, raced when there are several, preferred first
+    void SendFiles(std::vector<std::string> hosts,
                    unsigned short port,
                    const std::vector<std::filesystem::path>& file_paths,
                    std::string_view device_id = {});
@@ -30,6 +32,7 @@ public:
 
 private:
     void addSendSession(std::shared_ptr<SendSession> session) {
+        std::lock_guard lock(sessions_mutex_);
         send_sessions_[session->session_id()] = std::move(session);
     }
 
@@ -37,6 +40,8 @@ private:
     CertificateManager& cert_manager_;
     FeedbackCallback callback_;
 
+    // Sessions run on their own strands, the table is shared with the IPC side
+    std::mutex sessions_mutex_;
     std::unordered_map<std::string, std::shared_ptr<SendSession>> send_sessions_;
 
     void feedback(Feedback&& feedback) {
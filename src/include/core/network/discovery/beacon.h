@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <core/model/dto/broadcast_dto.h>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace lansend::core {
+
+// Compact discovery beacon. The full device info and fingerprints are served on
+// /device-info and only fetched when info_version changes.
+//
+// Layout, integers big-endian:
+//   magic "LS" | format 1 | type 1 | port 2 | info_version 4 | fingerprint digest 8 |
+//   device id length 1 | device id
+struct Beacon {
+    BroadcastType type = BroadcastType::kAnnounce;
+    std::string device_id;
+    std::uint16_t port = 0;
+    std::uint32_t info_version = 0; // Bumped whenever the device info or fingerprint changes
+    std::array<std::uint8_t, 8> fingerprint_digest{};
+
+    static constexpr std::uint8_t kFormat = 1;
+    static constexpr std::size_t kMaxDeviceIdSize = 255;
+};
+
+std::string EncodeBeacon(const Beacon& beacon);
+
+// Returns nullopt for anything that is not a well-formed beacon, including JSON beacons
+std::optional<Beacon> DecodeBeacon(std::string_view data);
+
+// The first 8 bytes of a hex SHA-256 fingerprint, enough to notice a changed certificate
+std::array<std::uint8_t, 8> FingerprintDigest(std::string_view hex_fingerprint);
+
+} // namespace lansend::core
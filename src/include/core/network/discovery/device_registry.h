@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <core/model/device_info.h>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lansend::core {
+
+// Discovered devices indexed by id and by ip:port, expiring through a min-heap.
+// Not synchronized, DiscoveryManager guards it with its own mutex.
+class DeviceRegistry {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Change {
+        kNone,    // Only the expiry was extended
+        kAdded,   // Device seen for the first time
+        kUpdated, // Known device whose info changed
+    };
+
+    // Devices added, updated and removed after a version, for incremental UI updates.
+    // Apply removed before upserted, a device removed and seen again is in both.
+    struct Delta {
+        std::uint64_t version = 0; // Pass it to the next Changes() call
+        bool full = false;         // since_version is too old, upserted is a full snapshot
+        std::vector<DeviceInfo> upserted;
+        std::vector<std::string> removed;
+    };
+
+    // info_version is the one announced in the device's beacons
+    Change Upsert(const DeviceInfo& device,
+                  Clock::time_point expires_at,
+                  std::uint32_t info_version = 0);
+    // Extend the expiry of a known device whose info is still at info_version.
+    // Returns false when the device is unknown or its info has to be fetched again.
+    bool Refresh(const std::string& device_id,
+                 std::uint32_t info_version,
+                 Clock::time_point expires_at);
+    std::optional<DeviceInfo> Remove(const std::string& device_id);
+    // Remove and return the devices that expired before now
+    std::vector<DeviceInfo> Expire(Clock::time_point now);
+
+    const DeviceInfo* Find(const std::string& device_id) const;
+    const DeviceInfo* FindByEndpoint(const std::string& ip, std::uint16_t port) const;
+    std::vector<DeviceInfo> Snapshot() const;
+    Delta Changes(std::uint64_t since_version) const;
+
+    std::optional<Clock::time_point> NextExpiry() const;
+    std::size_t Size() const { return devices_.size(); }
+    std::uint64_t Version() const { return version_; }
+
+private:
+    struct Entry {
+        DeviceInfo device;
+        Clock::time_point expires_at;
+        std::uint32_t info_version;
+        std::uint64_t version;       // Version of the last change to device
+        std::uint64_t added_version; // Tells its deadline from one of a removed namesake
+    };
+
+    struct Deadline {
+        Clock::time_point expires_at;
+        std::string device_id;
+        std::uint64_t added_version;
+        bool operator>(const Deadline& other) const { return expires_at > other.expires_at; }
+    };
+
+    static std::string endpointKey(const std::string& ip, std::uint16_t port);
+    void erase(std::unordered_map<std::string, Entry>::iterator it);
+
+    std::unordered_map<std::string, Entry> devices_;
+    std::unordered_map<std::string, std::string> by_endpoint_; // ip:port to device id
+    // One deadline per device. A refresh only moves Entry::expires_at, the deadline is
+    // pushed back lazily when it surfaces, so beacons never touch the heap.
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> deadlines_;
+
+    std::uint64_t version_ = 0;
+    // Removals remembered for Changes(), older ones are forgotten past kMaxTombstones
+    std::deque<std::pair<std::uint64_t, std::string>> tombstones_;
+    std::uint64_t forgotten_version_ = 0; // Changes() since before this needs a full snapshot
+
+    static constexpr std::size_t kMaxTombstones = 1024;
+};
+
+} // namespace lansend::core
@@ -1,67 +1,111 @@
 #pragma once
 
 #include "core/security/certificate_manager.h"
+#include <atomic>
 #include <boost/asio.hpp>
 #include <chrono>
+#include <core/constant/discovery.h>
 #include <core/model.h>
+#include <core/model/dto/broadcast_dto.h>
+#include <core/network/discovery/beacon.h>
+#include <core/network/discovery/device_registry.h>
 #include <core/util/config.h>
 #include <core/util/logger.h>
+#include <core/util/system.h>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <random>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace lansend::core {
 
-// 定义一个结构体来存储设备信息和最后活跃时间，用来管理删除长时间不活跃的设备
-struct DeviceEntry {
-    DeviceInfo device;
-    std::chrono::system_clock::time_point last_seen;
-};
-
 class DiscoveryManager {
 public:
     DiscoveryManager(boost::asio::io_context& ioc, CertificateManager& cert_manager);
     ~DiscoveryManager();
 
-    void Start(uint16_t port);
+    // port: UDP discovery port, the same on every peer
+    void Start(uint16_t port = discovery::kPort);
+    // 发送 goodbye 消息后关闭套接字
     void Stop();
 
+    // Called when the local address or port changed, announces the new info at once
+    void NotifyLocalInfoChanged();
+
     // 设备管理
-    void AddDevice(const DeviceInfo& device);
-    void RemoveDevice(const std::string& device_id);
+    void AddDevice(const DeviceInfo& device, std::uint32_t info_version = 0);
+    void RemoveDevice(const std::string& device_id); // 同时移除设备指纹
     std::optional<DeviceInfo> GetDevice(const std::string& device_id) const;
+    std::optional<DeviceInfo> GetDeviceByEndpoint(const std::string& ip, uint16_t port) const;
     std::vector<DeviceInfo> GetDevices() const;
+    // 增量快照：返回 since_version 之后新增、变化和移除的设备
+    DeviceRegistry::Delta GetDeviceChanges(std::uint64_t since_version) const;
 
     // 为Electron预留的事件接口
     void SetDeviceFoundCallback(std::function<void(const DeviceInfo&)> callback);
     void SetDeviceLostCallback(std::function<void(std::string_view)> callback);
 
 private:
-    std::mutex devices_mutex_;
+    // Guards registry_, queried from the IPC side while discovery updates it
+    mutable std::mutex devices_mutex_;
     boost::asio::io_context& io_context_;
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
     CertificateManager& cert_manager_;
     std::string device_id_;
 
-    std::unordered_map<std::string, DeviceEntry> discovered_devices_;
+    DeviceRegistry registry_;
     std::function<void(const DeviceInfo&)> device_found_callback_ = nullptr;
     std::function<void(std::string_view)> device_lost_callback_ = nullptr;
 
+    // 每个网络接口一个发送套接字，绑定到接口地址，信标的源地址即该接口的地址
+    struct InterfaceSocket {
+        system::NetworkInterface network_interface; // 没有可用接口时为空，套接字绑定到任意地址
+        boost::asio::ip::network_v4 network;
+        boost::asio::ip::udp::socket socket;
+        // 组播地址；在该接口上加入组播组失败时退回到子网广播地址
+        boost::asio::ip::udp::endpoint announce_endpoint;
+    };
+
     // UDP相关
-    boost::asio::ip::udp::socket broadcast_socket_;
+    // 只在 strand_ 上替换；协程发送前复制列表，被替换的套接字关闭后发送失败即可
+    std::vector<std::shared_ptr<InterfaceSocket>> interface_sockets_;
     boost::asio::ip::udp::socket listen_socket_;
     boost::asio::steady_timer broadcast_timer_;
     boost::asio::steady_timer cleanup_timer_; // 新增清理定时器
+    uint16_t port_{discovery::kPort};
+    std::chrono::steady_clock::duration beacon_interval_{discovery::kMinBeaconInterval};
+    std::mt19937 rng_{std::random_device{}()}; // 回复抖动，只在 strand_ 上使用
+
+    // 本机信息（即 /device-info 的内容）每次变化时递增，随信标发送；Stop() 也会读取
+    std::atomic<std::uint32_t> info_version_{0};
+    std::string local_info_;
+    // 正在通过 HTTPS 获取完整信息的设备，只在 strand_ 上使用
+    std::unordered_set<std::string> pending_fetches_;
 
     // 协程任务
     boost::asio::awaitable<void> broadcaster();
     boost::asio::awaitable<void> listener();
+    boost::asio::awaitable<void> answerQuery(boost::asio::ip::udp::endpoint querier);
+    boost::asio::awaitable<void> fetchDeviceInfo(boost::asio::ip::address address, Beacon beacon);
+    void handleJsonBeacon(std::string_view data, const boost::asio::ip::udp::endpoint& sender);
 
     boost::asio::awaitable<void> cleanupDevices();
 
-    std::string generateDeviceId();
+    // 按当前的网络接口重新打开发送套接字，并在每个接口上加入组播组
+    void openInterfaceSockets();
+    // 与 peer 在同一子网的接口，没有时返回第一个接口
+    std::shared_ptr<InterfaceSocket> interfaceSocketFor(const boost::asio::ip::address& peer) const;
+    boost::asio::awaitable<void> announce(BroadcastType type);
+    // 移除设备所有地址上登记的指纹
+    void removeFingerprints(const DeviceInfo& device);
+
+    std::string beaconData(BroadcastType type) const;
+    bool refreshLocalInfo(); // Returns true when the local info changed
 };
 
 } // namespace lansend::core
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <core/constant/mux.h>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace lansend::core {
+
+// Frames of the multiplexed protocol a connection switches to after upgrading on /mux. Every
+// request and its response is a stream, the client opens them with odd ids.
+//
+// Layout, integers big-endian:
+//   payload length 4 | type 1 | flags 1 | stream id 4 | payload
+enum class FrameType : std::uint8_t {
+    kHeaders = 1,      // Opens a stream, the payload is the HTTP/1.1 request head
+    kData = 2,         // Body bytes, counted against the stream's and the connection's credit
+    kAck = 3,          // Ends a stream, the payload is the whole HTTP/1.1 response
+    kWindowUpdate = 4, // Credit increment 4, stream 0 is the connection
+    kCancel = 5,       // Aborts a stream, the payload is the CancelCode
+};
+
+enum FrameFlag : std::uint8_t {
+    kEndStream = 0x1, // Last frame of the request body
+};
+
+enum class CancelCode : std::uint8_t {
+    kCancelled = 1,
+    kRefused = 2, // Too many concurrent streams, nothing of the request was processed
+    kProtocolError = 3,
+};
+
+struct FrameHeader {
+    std::uint32_t length = 0;
+    FrameType type = FrameType::kData;
+    std::uint8_t flags = 0;
+    std::uint32_t stream_id = 0;
+};
+
+std::vector<std::uint8_t> EncodeFrame(FrameType type,
+                                      std::uint8_t flags,
+                                      std::uint32_t stream_id,
+                                      std::span<const std::uint8_t> payload);
+// Returns nullopt for an unknown type or a payload over the type's limit
+std::optional<FrameHeader> DecodeFrameHeader(
+    std::span<const std::uint8_t, mux::kFrameHeaderSize> bytes);
+
+std::vector<std::uint8_t> EncodeWindowUpdate(std::uint32_t stream_id, std::uint32_t increment);
+std::optional<std::uint32_t> DecodeWindowUpdate(std::span<const std::uint8_t> payload);
+
+std::vector<std::uint8_t> EncodeCancel(std::uint32_t stream_id, CancelCode code);
+
+} // namespace lansend::core
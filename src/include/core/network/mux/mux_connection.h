@@ -0,0 +1,177 @@
+#pragma once
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
+#include <boost/beast/http.hpp>
+#include <core/network/mux/frame.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lansend::core {
+
+class MuxConnection;
+
+// One request and its response on a multiplexed connection
+class MuxStream {
+public:
+    using Response = boost::beast::http::response<boost::beast::http::string_body>;
+
+    MuxStream(std::shared_ptr<MuxConnection> connection, std::uint32_t id);
+
+    std::uint32_t id() const { return id_; }
+    MuxConnection& connection() const { return *connection_; }
+
+    // Server side: the request head the stream was opened with
+    const boost::beast::http::request_header<>& header() const { return request_; }
+    std::optional<std::uint64_t> ContentLength() const { return content_length_; }
+    // The whole request body has been read
+    bool IsDone() const { return remote_done_ && inbound_.empty(); }
+
+    // Read the next piece of the request body into out, returns 0 only once the body is
+    // complete. Each read hands credit back to the peer. Throws once the stream is cancelled.
+    boost::asio::awaitable<std::size_t> ReadSome(std::span<std::uint8_t> out);
+    // The rest of the body, throws if it is longer than limit. The vector has padding bytes of
+    // spare capacity past the body when the content length was announced.
+    boost::asio::awaitable<std::vector<std::uint8_t>> ReadAll(std::size_t limit,
+                                                              std::size_t padding = 0);
+
+    // Send body bytes as DATA frames, as fast as the peer grants credit. Returns early once the
+    // peer has responded, it reads no more.
+    boost::asio::awaitable<void> Write(std::span<const std::uint8_t> data, bool end_stream);
+
+    // Server side: end the stream with the response
+    void Respond(const Response& res);
+    // Client side: wait for the response
+    boost::asio::awaitable<Response> ReadResponse();
+
+    // Abort the stream on both ends
+    void Cancel(CancelCode code = CancelCode::kCancelled);
+
+private:
+    friend class MuxConnection;
+
+    // Throws once the stream was cancelled or the connection closed
+    void throwIfAborted() const;
+
+    std::shared_ptr<MuxConnection> connection_;
+    std::uint32_t id_;
+
+    boost::beast::http::request<boost::beast::http::empty_body> request_;
+    std::optional<std::uint64_t> content_length_;
+
+    std::deque<std::vector<std::uint8_t>> inbound_; // Received body bytes not read yet
+    std::size_t inbound_offset_ = 0;                // Read from the front piece
+    std::size_t inbound_bytes_ = 0;
+    std::size_t recv_credit_ = 0;      // Bytes the peer may still send
+    std::size_t unacked_consumed_ = 0; // Read since credit was last handed back
+    bool remote_done_ = false;
+
+    std::size_t send_credit_ = 0;
+    std::size_t queued_frames_ = 0; // DATA frames waiting in the connection's write queue
+    bool local_done_ = false;
+
+    std::optional<std::vector<std::uint8_t>> response_;
+    bool cancelled_ = false;
+};
+
+// A TLS connection switched to the multiplexed frame protocol. Any number of requests share
+// it without blocking each other: bodies are cut into small DATA frames that are interleaved
+// across streams, and a stream only sends as much as its peer granted credit for, so a slow
+// consumer stalls its own stream only. Responses and control frames jump the data queue.
+//
+// All methods, and those of its streams, must be called on the executor Run runs on.
+class MuxConnection : public std::enable_shared_from_this<MuxConnection> {
+public:
+    using Stream = boost::asio::ssl::stream<boost::beast::tcp_stream>;
+    // Server side, run for every stream the client opens
+    using StreamHandler = std::function<boost::asio::awaitable<void>(std::shared_ptr<MuxStream>)>;
+
+    // leftover are bytes already read from stream past the upgrade. owner keeps stream alive
+    // while Run is pending, it may be null when the caller awaits Run itself.
+    MuxConnection(Stream& stream,
+                  bool client,
+                  std::span<const std::uint8_t> leftover = {},
+                  std::shared_ptr<void> owner = nullptr);
+
+    // Read and write frames until the connection closes, every stream fails then. Rethrows
+    // the error that closed the connection, unless it was closed by Close.
+    boost::asio::awaitable<void> Run(StreamHandler handler = nullptr);
+
+    // Client side: send a request on a new stream and wait for its response. Cancelling the
+    // awaiting coroutine through its cancellation slot cancels the stream on both ends.
+    boost::asio::awaitable<MuxStream::Response> SendRequest(std::string head,
+                                                           std::span<const std::uint8_t> body);
+
+    bool IsOpen() const { return !closed_; }
+
+    // Where Run runs, the streams must be used there too
+    const boost::asio::any_io_executor& executor() const { return executor_; }
+
+    // Stop Run, it may still be unwinding when this returns
+    void Close();
+    // Wait until Run has returned
+    boost::asio::awaitable<void> WaitStopped();
+
+private:
+    friend class MuxStream;
+
+    boost::asio::awaitable<void> readLoop();
+    boost::asio::awaitable<void> writeLoop();
+    // Read until the buffer holds at least size bytes
+    boost::asio::awaitable<void> fill(std::size_t size);
+    void onFrame(const FrameHeader& header, std::span<const std::uint8_t> payload);
+    void onHeaders(const FrameHeader& header, std::span<const std::uint8_t> payload);
+    void onData(const FrameHeader& header, std::span<const std::uint8_t> payload);
+
+    boost::asio::awaitable<std::shared_ptr<MuxStream>> openStream(std::string head,
+                                                                  bool end_stream);
+    // Drop a finished stream, the credit of its unread bytes goes back to the connection
+    void removeStream(std::uint32_t id);
+    // The application read bytes of a stream, the peer gets their credit back in batches
+    void consumed(MuxStream& stream, std::size_t bytes);
+    void returnCredit(std::size_t bytes);
+    void queueControl(std::vector<std::uint8_t> frame);
+    void queueData(MuxStream& stream, std::vector<std::uint8_t> frame);
+    void fail(boost::system::error_code ec);
+    // Wake everything waiting on the connection
+    void notify() { changed_.cancel(); }
+    // Wait for the next change, throws operation_aborted once the awaiting coroutine is cancelled
+    boost::asio::awaitable<void> wait();
+
+    Stream& stream_;
+    std::shared_ptr<void> owner_;
+    boost::asio::any_io_executor executor_;
+    bool client_;
+    StreamHandler handler_;
+
+    boost::beast::flat_buffer read_buffer_;
+    std::deque<std::vector<std::uint8_t>> control_queue_;
+    std::deque<std::pair<std::uint32_t, std::vector<std::uint8_t>>> data_queue_; // By stream id
+    boost::asio::steady_timer changed_; // Cancelled whenever any state changes
+
+    std::unordered_map<std::uint32_t, std::shared_ptr<MuxStream>> streams_;
+    std::uint32_t next_stream_id_ = 1;
+    std::uint32_t last_peer_stream_id_ = 0;
+
+    std::size_t send_credit_ = mux::kConnectionWindow;
+    std::size_t recv_credit_ = mux::kConnectionWindow;
+    std::size_t unacked_consumed_ = 0;
+
+    bool closed_ = false;
+    bool stopped_ = false;
+    bool writer_running_ = false;
+    boost::system::error_code error_;
+};
+
+} // namespace lansend::core
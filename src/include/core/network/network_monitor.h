@@ -0,0 +1,48 @@
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <chrono>
+#include <functional>
+#ifdef __linux__
+#include <boost/asio/generic/raw_protocol.hpp>
+#endif
+
+namespace lansend::core {
+
+// Watches the local interfaces and refreshes the cached local addresses when they change.
+// Linux is notified through netlink (RTM_NEWADDR, RTM_DELADDR and friends), other platforms
+// poll the address at a slow interval.
+class NetworkMonitor {
+public:
+    // Called on the monitor's strand after the local address or the interface list changed
+    using ChangeCallback = std::function<void()>;
+
+    explicit NetworkMonitor(boost::asio::io_context& ioc);
+
+    void Start();
+    void Stop();
+
+    void SetChangeCallback(ChangeCallback callback);
+
+private:
+    boost::asio::awaitable<void> watch();
+    // Wait for the burst of notifications of one change to settle, then resolve the address
+    boost::asio::awaitable<void> refreshSoon();
+
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+    boost::asio::steady_timer timer_;
+    ChangeCallback callback_;
+    bool running_{false};
+    bool refresh_scheduled_{false};
+#ifdef __linux__
+    boost::asio::generic::raw_protocol::socket netlink_socket_;
+#endif
+
+    static constexpr auto kSettleDelay = std::chrono::milliseconds(500);
+    static constexpr auto kPollInterval = std::chrono::seconds(30);
+};
+
+} // namespace lansend::core
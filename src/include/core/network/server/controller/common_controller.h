@@ -23,8 +23,13 @@ private:
     boost::asio::awaitable<boost::beast::http::response<boost::beast::http::string_body>> onConnect(
         const boost::beast::http::request<boost::beast::http::string_body>& req);
 
+    // Full device info and fingerprints, fetched by peers when our beacon's info version changes
+    boost::asio::awaitable<HttpResponse> onDeviceInfo(
+        const boost::beast::http::request<boost::beast::http::string_body>& req);
+
     void InstallRoutes(HttpServer& server);
 
+    CertificateManager& cert_manager_;
     FeedbackCallback callback_;
 
     void feedback(Feedback&& feedback) {
@@ -7,27 +7,122 @@
 #include <core/constant/path.h>
 #include <core/model.h>
 #include <core/network/server/http_server.h>
+#include <core/network/udp/udp_receiver.h>
 #include <core/security/file_hasher.h>
+#include <core/util/progress_aggregator.h>
+#include <core/util/rate_limiter.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <nlohmann/detail/macro_scope.hpp>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
 
 namespace lansend::core {
 
 enum class ReceiveSessionStatus {
     kIdle,
+    kManifest, // Receiving the remaining pages of a large manifest
+    kWaiting,  // Waiting for the user to confirm
     kWorking,
 };
 
 using FileId = std::string;
 using SessionId = std::string;
 
+// A file received over the UDP data channel. Its bytes are counted per chunk, so the chunk
+// bitmap is complete for /verify-integrity just as if the chunks came over HTTPS.
+struct UdpFileState {
+    FileId file_id;
+    ChunkBitmap segments;
+    std::vector<std::size_t> chunk_missing_bytes;
+    // Open until the file is complete, shared with the write running on the compute pool
+    std::shared_ptr<std::fstream> stream;
+};
+
+// A chunk whose body is being read on its connection's executor. Ending the session sets
+// aborted and emits signal on that executor, the chunk's reads and bandwidth waits are bound
+// to it.
+struct ChunkAbort {
+    boost::asio::any_io_executor executor;
+    boost::asio::cancellation_signal signal;
+    std::atomic<bool> aborted{false};
+};
+
+// State of one receive session, sessions from different senders run independently
+struct ReceiveSession {
+    SessionId session_id;
+    ReceiveSessionStatus status{ReceiveSessionStatus::kWaiting};
+    std::string sender_ip;
+    unsigned short sender_port{};
+    // Remote address of the /request-send connection, sender_ip is only what the sender claims
+    std::string peer_ip;
+    std::unordered_map<FileId, ReceiveFileContext> files;
+    std::size_t completed_file_count{0};
+
+    // Manifest of the request, collected page by page when it is large
+    DeviceInfo sender_device;
+    std::vector<FileDto> manifest;
+    std::size_t expected_files{0};
+    std::chrono::steady_clock::time_point manifest_expires_at; // Ended after this in kManifest
+
+    // Cancelled to wake the handler waiting for the user's confirmation
+    std::shared_ptr<boost::asio::steady_timer> confirm_signal;
+    std::optional<std::chrono::steady_clock::time_point> confirm_notified_at;
+
+    // UDP data channel, offered by the sender and opened once the files are accepted
+    bool udp_offered{false};
+    std::shared_ptr<UdpReceiver> udp_receiver;
+    std::vector<UdpFileState> udp_files; // By DataFrame::file_index
+
+    // Chunks being received and written, the session's part of the write queue
+    std::size_t chunks_writing{0};
+    // One per chunk being received, emitted when the session ends to abort its body reads
+    std::list<std::shared_ptr<ChunkAbort>> chunk_cancellations;
+};
+
+// A chunk admitted on the controller's strand. Its body is received off the strand, the
+// results are filled in for the strand to complete the chunk with.
+struct IncomingChunk {
+    std::shared_ptr<ReceiveSession> session;
+    SendChunkDto dto;
+    std::filesystem::path temp_file_path;
+    std::string file_name;
+    std::uint64_t offset{0};
+    std::size_t expected_size{0};
+    std::shared_ptr<ChunkAbort> abort;
+    std::list<std::shared_ptr<ChunkAbort>>::iterator abort_position;
+
+    std::size_t received_size{0};
+    std::string checksum;
+    std::chrono::steady_clock::duration disk_time{};
+};
+
+// A sender waiting for a free session slot, queued in arrival order
+struct AdmissionTicket {
+    std::string ticket;
+    std::shared_ptr<boost::asio::steady_timer> timer; // Cancelled to wake the long-poll
+    bool polling{false};                              // A request is waiting on the timer
+    std::chrono::steady_clock::time_point expires_at; // Dropped after this while not polling
+};
+
 class ReceiveController {
 public:
     using FileId = std::string;
-    using WaitConditionFunc = std::function<std::optional<std::vector<std::string>>()>;
-    using CancelConditionFunc = std::function<bool()>;
+    // Both are polled with the session id the user operation is meant for. The wait condition
+    // is polled once per NotifyConfirmation(), not in a loop, and yields accepted file ids or
+    // file names.
+    using WaitConditionFunc
+        = std::function<std::optional<std::vector<std::string>>(std::string_view session_id)>;
+    using CancelConditionFunc = std::function<bool(std::string_view session_id)>;
 
     ReceiveController(HttpServer& server,
                       const std::filesystem::path& save_dir = path::kSystemDownloadDir,
@@ -36,25 +131,63 @@ public:
 
     void SetSaveDirectory(const std::filesystem::path& save_dir);
 
-    ReceiveSessionStatus session_status() const;
-    std::string_view sender_ip() const;
-    unsigned short sender_port() const;
+    // Called by Controller's HttpServer when a connection is lost, from the connection's strand.
+    // Only the sessions of that sender are failed.
+    void NotifySenderLost(std::string ip, unsigned short port);
 
-    void NotifySenderLost(); // Called by Controller's HttpServer when sender is lost
+    // Called when the user answered a receive request, from any thread. An empty session id
+    // wakes every session waiting for confirmation.
+    void NotifyConfirmation(std::string session_id);
+
+    // Whether a session requested from the connection address ip is in progress, safe to call
+    // from any thread. HttpServer gives these peers priority when admitting connections.
+    bool HasActiveSession(const std::string& ip) const;
 
     void SetFeedbackCallback(FeedbackCallback callback);
     void SetWaitConditionFunc(WaitConditionFunc func);
     void SetCancelConditionFunc(CancelConditionFunc func);
 
-    // 重置接收控制器状态为空闲，取消当前的接收会话
-    void resetToIdle();
+    // Aggregate bandwidth of all receive sessions in bytes per second, 0 for unlimited
+    void SetBandwidthLimit(std::uint64_t bytes_per_second);
 
 private:
-    boost::asio::awaitable<boost::beast::http::response<boost::beast::http::string_body>>
-    onRequestSend(const boost::beast::http::request<boost::beast::http::string_body>& req);
+    // Manifest routes take the raw body, DtoReader parses it in place
+    boost::asio::awaitable<HttpResponse> onRequestSend(const BinaryRequest& req);
+
+    boost::asio::awaitable<HttpResponse> onManifestPage(const BinaryRequest& req);
+
+    // Ask the user about the complete manifest and answer the sender with the file tokens
+    boost::asio::awaitable<HttpResponse> confirmManifest(std::shared_ptr<ReceiveSession> session,
+                                                         unsigned int version,
+                                                         bool keep_alive);
 
-    boost::asio::awaitable<boost::beast::http::response<boost::beast::http::string_body>> onSendChunk(
-        const boost::beast::http::request<boost::beast::http::vector_body<std::uint8_t>>& req);
+    // Streams the chunk to its temp file as it arrives, memory use does not grow with chunk size.
+    // Runs on the connection's executor and only enters strand_ to admit and complete the
+    // chunk, sessions do not wait for each other's TLS reads, hashing and disk writes.
+    boost::asio::awaitable<HttpResponse> onSendChunk(RequestStream& body);
+    // Checks the chunk against its session and registers it in the write queue, or answers it
+    boost::asio::awaitable<std::variant<HttpResponse, IncomingChunk>> admitChunk(
+        SendChunkDto dto,
+        unsigned int version,
+        bool keep_alive,
+        boost::asio::any_io_executor executor);
+    // Reads, hashes and writes the body, the latter two on the compute pool
+    boost::asio::awaitable<void> receiveChunkData(RequestStream& body, IncomingChunk& chunk);
+    // Marks the chunk received, or fails the session when error or the body is bad
+    boost::asio::awaitable<HttpResponse> completeChunk(IncomingChunk chunk,
+                                                       std::exception_ptr error,
+                                                       unsigned int version,
+                                                       bool keep_alive);
+
+    // Opens the UDP data channel of the session and tells the sender where to find it, the
+    // session keeps receiving chunks over HTTPS when that fails
+    void openUdpChannel(const std::shared_ptr<ReceiveSession>& session,
+                        RequestSendResponseDto& response_dto);
+
+    // Writes a segment received over the UDP data channel. Runs on strand_, the receiver
+    // decrypts on a strand of its own and the write runs on the compute pool.
+    boost::asio::awaitable<void> onUdpData(std::weak_ptr<ReceiveSession> weak_session,
+                                           DataFrame frame);
 
     boost::asio::awaitable<boost::beast::http::response<boost::beast::http::string_body>>
     onVerifyIntegrity(const boost::beast::http::request<boost::beast::http::string_body>& req);
@@ -65,26 +198,82 @@ private:
     boost::asio::awaitable<boost::beast::http::response<boost::beast::http::string_body>>
     onCancelWait(const boost::beast::http::request<boost::beast::http::string_body>& req);
 
+    // Waits in the admission queue until a session slot is free or the long-poll expires.
+    // Returns false when still queued, ticket then holds the sender's place in the queue.
+    boost::asio::awaitable<bool> waitForAdmission(std::string& ticket);
+    void wakeAdmissionQueue(); // Wake the head of the queue if a slot is free
+    void purgeAdmissionQueue();
+    // End the sessions whose sender stopped sending manifest pages, they hold a slot otherwise
+    void purgeManifestSessions();
+    std::size_t sessionCapacity() const;
+
     boost::asio::awaitable<std::optional<std::vector<FileDto>>> waitForUserConfirmation(
-        std::string device_id, const std::vector<FileDto>& files, int timeout_seconds = 30);
+        std::shared_ptr<ReceiveSession> session,
+        const std::vector<FileDto>& files,
+        int timeout_seconds = 30);
+
+    // Route handlers run on strand_, so the session state below is never touched by two
+    // connections at the same time, no matter how many threads run the io_context. They hold
+    // it only between awaits, file I/O and hashing are awaited on the compute pool.
+    template<typename Request>
+    using MemberHandler
+        = boost::asio::awaitable<HttpResponse> (ReceiveController::*)(const Request&);
+
+    template<typename Request>
+    auto onStrand(MemberHandler<Request> handler) {
+        return [this, handler](Request&& req) -> boost::asio::awaitable<HttpResponse> {
+            co_return co_await boost::asio::co_spawn(strand_,
+                                                     (this->*handler)(req),
+                                                     boost::asio::use_awaitable);
+        };
+    }
 
     void installRoutes();
-    void doCleanup(); // Clean up any unfinished temp files when cancelled or failed
-    void checkSessionCompletion();
+
+    // Returns the session if it is still in the table and in the expected status
+    std::shared_ptr<ReceiveSession> findSession(const SessionId& session_id,
+                                                ReceiveSessionStatus status);
+    // Remove the session from the table and clean up its unfinished temp files
+    void endSession(const SessionId& session_id);
+    void doCleanup(const ReceiveSession& session); // Clean up unfinished temp files of a session
+    void checkSessionCompletion(const ReceiveSession& session);
+    void reportReceiveProgress(const ReceiveSession& session,
+                               const FileId& file_id,
+                               const ReceiveFileContext& file_context,
+                               std::uint64_t bytes_received);
+    // Receiver-driven flow control: the disk rate is measured from the chunk writes, every
+    // chunk acknowledgement grants the sender the chunks it may have in flight
+    void recordDiskWrite(std::size_t bytes, std::chrono::steady_clock::duration elapsed);
+    void grantChunkCredits(HttpResponse& res,
+                           const ReceiveSession& session,
+                           std::size_t chunk_size) const;
 
     HttpServer& server_;
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
     std::filesystem::path save_dir_;
     FeedbackCallback callback_;
     WaitConditionFunc wait_condition_;
     CancelConditionFunc cancel_condition_;
 
-    ReceiveSessionStatus session_status_{ReceiveSessionStatus::kIdle};
-    std::string session_id_{};
-    std::unordered_map<FileId, ReceiveFileContext> received_files_;
-    std::size_t completed_file_count_{0};
+    // Sessions are shared with the handlers awaiting on them, a handler resuming after its
+    // session ended still holds valid memory and finds the session gone from the table
+    std::unordered_map<SessionId, std::shared_ptr<ReceiveSession>> sessions_;
+    std::deque<std::shared_ptr<AdmissionTicket>> admission_queue_;
+
+    // Sessions per peer_ip, mirrors sessions_ for readers off the strand
+    mutable std::mutex active_peers_mutex_;
+    std::unordered_map<std::string, std::size_t> active_peers_;
+
+    // Shared by all sessions, chunks are acknowledged once their bytes fit in the budget
+    RateLimiter bandwidth_limiter_;
+    ProgressAggregator progress_; // Keyed by session id and file id
+
+    std::size_t chunks_writing_{0}; // Write queue depth over all sessions
+    double disk_rate_{0};           // Bytes per second the chunk writes take, moving average
 
-    std::string sender_ip_{};
-    unsigned short sender_port_{};
+    static constexpr auto kAdmissionLongPoll = std::chrono::seconds(20);
+    static constexpr auto kTicketGracePeriod = std::chrono::seconds(10);
+    static constexpr auto kManifestIdleTimeout = std::chrono::seconds(30); // Between pages
 
     void feedback(Feedback&& feedback) {
         if (callback_) {
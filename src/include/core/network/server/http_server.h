@@ -6,11 +6,16 @@
 #include <boost/beast/core/tcp_stream.hpp>
 #include <boost/beast/http.hpp>
 #include <core/model/feedback.h>
+#include <core/network/server/request_stream.h>
+#include <core/util/rate_limiter.h>
 #include <cstdint>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <variant>
 
 namespace lansend::core {
 
@@ -24,6 +29,8 @@ using HttpResponse = boost::beast::http::response<boost::beast::http::string_bod
 
 using StringRequestHandler = std::function<boost::asio::awaitable<HttpResponse>(StringRequest&&)>;
 using BinaryRequestHandler = std::function<boost::asio::awaitable<HttpResponse>(BinaryRequest&&)>;
+// Called once the header is read, the handler pulls the body from the stream itself
+using StreamRequestHandler = std::function<boost::asio::awaitable<HttpResponse>(RequestStream&)>;
 
 using HttpRequest = BinaryRequest;
 using RouteHandler = BinaryRequestHandler;
@@ -31,20 +38,28 @@ using RouteHandler = BinaryRequestHandler;
 enum class RequestType {
     kString,
     kBinary,
+    kStream,
 };
 
 // 路由信息结构体
 struct RouteInfo {
     boost::beast::http::verb method;
     RequestType type;
-    std::variant<StringRequestHandler, BinaryRequestHandler> handler;
+    std::variant<StringRequestHandler, BinaryRequestHandler, StreamRequestHandler> handler;
+};
+
+// 单个对端 IP 的连接状态，在 TLS 握手之前统计
+struct PeerConnections {
+    std::size_t active{0};
+    RateLimiter handshakes; // New connections per second
 };
 
 //HTTPS 服务器类
 class HttpServer {
 public:
-    using ReceiveWaitConditionFunc = std::function<std::optional<std::vector<std::string>>()>;
-    using ReceiveCancelConditionFunc = std::function<bool()>;
+    using ReceiveWaitConditionFunc
+        = std::function<std::optional<std::vector<std::string>>(std::string_view session_id)>;
+    using ReceiveCancelConditionFunc = std::function<bool(std::string_view session_id)>;
 
     // 构造函数
     HttpServer(boost::asio::io_context& io_context, CertificateManager& cert_manager);
@@ -59,6 +74,9 @@ public:
     void AddRoute(const std::string& path,
                   boost::beast::http::verb method,
                   StringRequestHandler&& handler);
+    void AddRoute(const std::string& path,
+                  boost::beast::http::verb method,
+                  StreamRequestHandler&& handler);
 
     // 启动服务器
     void Start(uint16_t port);
@@ -91,18 +109,41 @@ public:
     // 获取接收控制器
     ReceiveController& GetReceiveController() { return *receive_controller_; }
 
+    boost::asio::io_context& GetIoContext() { return io_context_; }
+
+    CertificateManager& GetCertificateManager() { return cert_manager_; }
+
 private:
     // 接受连接
     boost::asio::awaitable<void> acceptConnections();
 
     // 处理连接
     boost::asio::awaitable<void> handleConnection(
-        boost::asio::ssl::stream<boost::beast::tcp_stream> stream);
+        boost::asio::ssl::stream<boost::beast::tcp_stream> stream,
+        std::string peer_ip);
 
-    // 处理请求
-    boost::asio::awaitable<HttpResponse> handleRequest(HttpRequest&& request);
+    // 把连接切换到多路复用帧协议，直到连接关闭
+    boost::asio::awaitable<void> serveMux(
+        boost::asio::ssl::stream<boost::beast::tcp_stream>& stream,
+        boost::beast::flat_buffer& buffer,
+        const std::string& peer_ip);
+    // 处理多路复用连接上的一个请求
+    boost::asio::awaitable<void> serveMuxStream(std::shared_ptr<MuxStream> stream,
+                                                std::string peer_ip);
 
-    static StringRequest binaryToStringRequest(const BinaryRequest& req);
+    // 连接准入，被拒绝的连接在握手前关闭；可从任意线程调用
+    bool admitConnection(const std::string& peer_ip);
+    void releaseConnection(const std::string& peer_ip);
+
+    // 处理请求，peer_ip 是连接的对端地址，写入 ApiHeader::kPeerAddress
+    boost::asio::awaitable<HttpResponse> handleRequest(HttpRequest&& request,
+                                                       const std::string& peer_ip);
+
+    // 查找流式路由，非流式路由或方法不匹配时返回 nullptr
+    const StreamRequestHandler* findStreamHandler(
+        const boost::beast::http::request_header<>& header) const;
+
+    static StringRequest binaryToStringRequest(BinaryRequest&& req);
 
     boost::asio::io_context& io_context_;
     CertificateManager& cert_manager_;
@@ -112,6 +153,14 @@ private:
     std::map<std::string, RouteInfo> routes_;
     std::unique_ptr<CommonController> common_controller_;
     std::unique_ptr<ReceiveController> receive_controller_;
+
+    std::mutex connections_mutex_;
+    std::size_t active_connections_{0};
+    std::unordered_map<std::string, PeerConnections> peers_;
+
+    static constexpr auto kHandshakeTimeout = std::chrono::seconds(10);
+    // Idle peers are forgotten once this many are tracked
+    static constexpr std::size_t kMaxTrackedPeers = 1024;
 };
 
 } // namespace lansend::core
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
+#include <boost/beast/http.hpp>
+#include <core/network/mux/mux_connection.h>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+
+namespace lansend::core {
+
+// Body of a request served by a streaming route. The header has already been read, the body
+// is pulled from the connection piece by piece as the handler consumes it.
+class RequestStream {
+public:
+    virtual ~RequestStream() = default;
+
+    virtual const boost::beast::http::request_header<>& header() const = 0;
+
+    virtual std::optional<std::uint64_t> ContentLength() const = 0;
+
+    virtual bool IsDone() const = 0;
+
+    // Read the next piece of the body into out, returns 0 only once the body is complete
+    virtual boost::asio::awaitable<std::size_t> ReadSome(std::span<std::uint8_t> out) = 0;
+
+    // Fill out entirely, throws if the body ends first
+    boost::asio::awaitable<void> ReadExact(std::span<std::uint8_t> out);
+
+    // Read and drop the rest of the body, so the connection can serve the next request
+    boost::asio::awaitable<void> Discard();
+};
+
+// A request on an HTTP/1.1 connection
+class HttpRequestStream : public RequestStream {
+public:
+    using Stream = boost::asio::ssl::stream<boost::beast::tcp_stream>;
+    using Parser = boost::beast::http::request_parser<boost::beast::http::buffer_body>;
+
+    HttpRequestStream(Stream& stream, boost::beast::flat_buffer& buffer, Parser& parser);
+
+    const boost::beast::http::request_header<>& header() const override { return parser_.get(); }
+
+    std::optional<std::uint64_t> ContentLength() const override {
+        // Beast reports it as a boost::optional
+        if (auto length = parser_.content_length(); length) {
+            return *length;
+        }
+        return std::nullopt;
+    }
+
+    bool IsDone() const override { return parser_.is_done(); }
+
+    boost::asio::awaitable<std::size_t> ReadSome(std::span<std::uint8_t> out) override;
+
+private:
+    Stream& stream_;
+    boost::beast::flat_buffer& buffer_;
+    Parser& parser_;
+};
+
+// A request on a stream of a multiplexed connection. Handlers may read from any executor, the
+// reads hop over to the connection's.
+class MuxRequestStream : public RequestStream {
+public:
+    explicit MuxRequestStream(std::shared_ptr<MuxStream> stream);
+
+    const boost::beast::http::request_header<>& header() const override {
+        return stream_->header();
+    }
+
+    std::optional<std::uint64_t> ContentLength() const override {
+        return stream_->ContentLength();
+    }
+
+    bool IsDone() const override { return stream_->IsDone(); }
+
+    boost::asio::awaitable<std::size_t> ReadSome(std::span<std::uint8_t> out) override;
+
+private:
+    std::shared_ptr<MuxStream> stream_;
+};
+
+} // namespace lansend::core
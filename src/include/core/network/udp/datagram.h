@@ -0,0 +1,109 @@
+#pragma once
+
+#include <boost/asio/ip/udp.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace lansend::core {
+
+// Datagrams of the UDP data channel. Each one is sealed with AES-256-GCM under the key
+// negotiated on /request-send, the header is authenticated as additional data.
+//
+// Layout, integers big-endian:
+//   magic "LU" | version 1 | type 1 | packet number 8 | encrypted frame | tag 16
+//
+// The nonce is the direction followed by the packet number. Packet numbers are never reused
+// in one direction, a retransmitted segment goes out under a new one.
+enum class DatagramType : std::uint8_t {
+    kData = 1,
+    kAck = 2,
+    kClose = 3, // The receiver stopped, the frame is the CloseReason
+};
+
+enum class CloseReason : std::uint8_t {
+    kAborted = 1,
+    kCancelled = 2, // Cancelled by the user
+};
+
+enum class DatagramDirection : std::uint32_t {
+    kToReceiver = 1,
+    kToSender = 2,
+};
+
+struct OpenedDatagram {
+    DatagramType type;
+    std::uint64_t packet_number;
+    std::vector<std::uint8_t> frame;
+};
+
+// Segment of a file: file index (position of the file id among the accepted ids, sorted) 4 |
+// offset 8 | data
+struct DataFrame {
+    std::uint32_t file_index = 0;
+    std::uint64_t offset = 0;
+    std::span<const std::uint8_t> data;
+};
+
+// Received packet numbers as ranges, highest first: largest 8 | ack delay in us 4 | count 2 |
+// (first 8, last 8) per range
+struct AckFrame {
+    struct Range {
+        std::uint64_t first;
+        std::uint64_t last;
+    };
+
+    std::uint64_t largest = 0;
+    std::uint32_t ack_delay_us = 0; // Time the receiver held the largest before acknowledging
+    std::vector<Range> ranges;
+};
+
+// Throws std::runtime_error when encryption fails
+std::vector<std::uint8_t> SealDatagram(DatagramType type,
+                                       DatagramDirection direction,
+                                       std::uint64_t packet_number,
+                                       const std::vector<std::uint8_t>& frame,
+                                       const std::vector<std::uint8_t>& key);
+
+// Returns nullopt for anything malformed, forged or sent in the other direction
+std::optional<OpenedDatagram> OpenDatagram(std::span<const std::uint8_t> datagram,
+                                           DatagramDirection direction,
+                                           const std::vector<std::uint8_t>& key);
+
+std::vector<std::uint8_t> EncodeDataFrame(std::uint32_t file_index,
+                                          std::uint64_t offset,
+                                          std::span<const std::uint8_t> data);
+// The data of the result points into frame
+std::optional<DataFrame> DecodeDataFrame(std::span<const std::uint8_t> frame);
+
+std::vector<std::uint8_t> EncodeAckFrame(const AckFrame& ack);
+std::optional<AckFrame> DecodeAckFrame(std::span<const std::uint8_t> frame);
+
+std::vector<std::uint8_t> EncodeCloseFrame(CloseReason reason);
+std::optional<CloseReason> DecodeCloseFrame(std::span<const std::uint8_t> frame);
+
+// Hands the datagram to a non-blocking socket, false when the socket buffer is full. Nothing
+// waits for buffer space: the datagram is simply lost, like on a congested link, and rate
+// control backs off. owner keeps the socket alive while a simulated delay is pending.
+bool TransmitDatagram(boost::asio::ip::udp::socket& socket,
+                      const boost::asio::ip::udp::endpoint& to,
+                      std::vector<std::uint8_t> datagram,
+                      std::shared_ptr<const void> owner);
+
+// Debug builds read LANSEND_UDP_NETEM="loss=0.05,delay=20" (delay in milliseconds) and drop
+// and delay outgoing datagrams like netem, so both transports can be compared over a lossy
+// link on loopback. Release builds never simulate anything.
+struct SimulatedLink {
+    double loss = 0;
+    std::chrono::milliseconds delay{0};
+
+    bool Enabled() const { return loss > 0 || delay.count() > 0; }
+    bool Drop() const;
+
+    static const SimulatedLink& Get();
+};
+
+} // namespace lansend::core
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <core/network/udp/datagram.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lansend::core {
+
+// Receiving end of the UDP data channel of one receive session. Segments are handed to the
+// handler in arrival order and acknowledged once it returns, so a slow disk or the bandwidth
+// limit shows up as queuing delay at the sender.
+//
+// Everything runs on the executor given to the constructor, which must be a strand.
+class UdpReceiver : public std::enable_shared_from_this<UdpReceiver> {
+public:
+    using DataHandler = std::function<boost::asio::awaitable<void>(const DataFrame& frame)>;
+
+    // Binds an ephemeral port and generates the channel key. Only datagrams from sender_ip are
+    // read. Throws std::runtime_error or boost::system::system_error on failure.
+    UdpReceiver(boost::asio::any_io_executor executor, const std::string& sender_ip);
+
+    void Start(DataHandler handler);
+
+    // Tells the sender the channel is gone and stops, safe to call more than once and from
+    // any thread
+    void Close(CloseReason reason = CloseReason::kAborted);
+
+    unsigned short port() const { return port_; }
+    const std::vector<std::uint8_t>& key() const { return key_; }
+
+private:
+    void close(CloseReason reason); // Close() on the receiver's executor
+    boost::asio::awaitable<void> receiveLoop();
+    boost::asio::awaitable<void> ackLoop();
+
+    // Returns false for a packet number seen before
+    bool recordPacket(std::uint64_t packet_number);
+    void sendAck();
+    void send(DatagramType type, const std::vector<std::uint8_t>& frame);
+
+    boost::asio::ip::udp::socket socket_;
+    boost::asio::steady_timer ack_timer_;
+    boost::asio::ip::address sender_address_;
+    std::optional<boost::asio::ip::udp::endpoint> sender_endpoint_; // From the last datagram
+    std::vector<std::uint8_t> key_;
+    unsigned short port_ = 0;
+    DataHandler handler_;
+    bool closed_ = false;
+
+    // Packet numbers received, as ranges first -> last. Only the newest ranges are kept,
+    // older numbers are no longer acknowledged and the sender stopped waiting for them.
+    std::map<std::uint64_t, std::uint64_t> received_;
+    std::chrono::steady_clock::time_point largest_handled_at_;
+    std::size_t unacked_ = 0;
+    bool ack_armed_ = false;
+    std::uint64_t next_packet_number_ = 0;
+
+    std::uint64_t packets_received_ = 0;
+    std::uint64_t duplicates_ = 0;
+    std::uint64_t rejected_ = 0; // Failed authentication
+};
+
+} // namespace lansend::core
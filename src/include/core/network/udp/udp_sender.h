@@ -0,0 +1,132 @@
+#pragma once
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <core/network/udp/datagram.h>
+#include <core/util/chunk_bitmap.h>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lansend::core {
+
+enum class UdpSendResult {
+    kCompleted,         // Every byte was acknowledged
+    kCancelled,         // Stopped by the cancel condition
+    kReceiverCancelled, // The receiver's user cancelled
+    kFailed,            // The receiver aborted or went silent
+};
+
+struct UdpSenderStats {
+    std::uint64_t packets_sent = 0;
+    std::uint64_t packets_lost = 0; // Declared lost, their segments were sent again
+    std::uint64_t bytes_acked = 0;
+    double rate = 0; // Bytes per second
+    std::chrono::microseconds min_rtt{0};
+    std::chrono::microseconds smoothed_rtt{0};
+};
+
+// Sending end of the UDP data channel of one send session. Files are cut into segments that
+// are paced out at the current rate, every datagram carries a new packet number and a lost
+// segment goes out again under a new one. Losses are detected as in QUIC (RFC 9002), the rate
+// follows the queuing delay as in LEDBAT (RFC 6817).
+//
+// Everything runs on the executor given to the constructor, which must be a strand.
+class UdpSender : public std::enable_shared_from_this<UdpSender> {
+public:
+    using CancelCondition = std::function<bool()>;
+    using ProgressCallback = std::function<void(std::uint64_t bytes_acked)>;
+
+    // Binds to local_address, so the receiver sees the address of the control connection.
+    // Throws boost::system::system_error on failure.
+    UdpSender(boost::asio::any_io_executor executor,
+              const std::string& local_address,
+              boost::asio::ip::udp::endpoint receiver,
+              std::vector<std::uint8_t> key);
+
+    void Start();
+    void Close();
+
+    // Throws std::runtime_error when the file cannot be read
+    boost::asio::awaitable<UdpSendResult> SendFile(std::uint32_t file_index,
+                                                   std::filesystem::path file_path,
+                                                   std::uint64_t file_size,
+                                                   CancelCondition cancelled,
+                                                   ProgressCallback progress);
+
+    UdpSenderStats Stats() const;
+
+private:
+    struct SentPacket {
+        std::uint64_t offset;
+        std::uint32_t length;
+        std::chrono::steady_clock::time_point sent_at;
+    };
+
+    boost::asio::awaitable<void> receiveLoop();
+    void onAck(const AckFrame& ack);
+    void onPacketAcked(const SentPacket& packet);
+    void detectLosses(std::chrono::steady_clock::time_point now);
+    void onLoss(const SentPacket& packet);
+    // Sends the segment at offset, false when the socket buffer is full
+    bool sendSegment(std::uint64_t offset, std::uint32_t length);
+    std::span<const std::uint8_t> readSegment(std::uint64_t offset, std::uint32_t length);
+
+    std::chrono::steady_clock::duration smoothedRtt() const;
+    std::chrono::steady_clock::duration lossDelay() const;
+    std::chrono::steady_clock::duration probeTimeout() const;
+    double inFlightLimit() const;
+
+    boost::asio::ip::udp::socket socket_;
+    boost::asio::ip::udp::endpoint receiver_;
+    boost::asio::steady_timer wake_; // Cancelled when an acknowledgement arrives
+    std::vector<std::uint8_t> key_;
+    bool closed_ = false;
+    std::optional<CloseReason> close_reason_;
+
+    // The file being sent
+    std::uint32_t file_index_ = 0;
+    std::uint64_t file_size_ = 0;
+    std::ifstream file_;
+    std::vector<std::uint8_t> block_; // kReadBlockSize bytes of the file at block_offset_
+    std::uint64_t block_offset_ = 0;
+    std::uint64_t block_size_ = 0;
+    ChunkBitmap acked_segments_;
+    std::uint64_t file_bytes_acked_ = 0;
+    ProgressCallback progress_;
+
+    std::uint64_t next_packet_number_ = 0;
+    std::map<std::uint64_t, SentPacket> in_flight_; // By packet number
+    std::uint64_t bytes_in_flight_ = 0;
+    std::deque<std::pair<std::uint64_t, std::uint32_t>> lost_; // Segments to send again
+    std::optional<std::uint64_t> largest_acked_;
+    std::chrono::steady_clock::time_point last_ack_at_;
+
+    // Round trip times, measured from the receiver handling the largest packet acknowledged
+    std::optional<std::chrono::steady_clock::duration> min_rtt_;
+    std::chrono::steady_clock::duration smoothed_rtt_{};
+    std::chrono::steady_clock::duration rtt_variance_{};
+    std::chrono::steady_clock::duration latest_rtt_{};
+    std::chrono::steady_clock::duration queuing_delay_{}; // Above the minimum round trip time
+
+    double rate_;
+    bool slow_start_ = true;
+    // Packets sent before this were in flight when the rate was last cut for a loss
+    std::chrono::steady_clock::time_point recovery_start_{};
+    std::uint64_t acked_since_cut_ = 0; // Packets
+    std::uint64_t lost_since_cut_ = 0;
+
+    UdpSenderStats stats_;
+};
+
+} // namespace lansend::core
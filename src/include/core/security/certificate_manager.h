@@ -3,27 +3,39 @@
 #include <boost/asio/ssl/context.hpp>
 #include <core/model/security_context.h>
 #include <filesystem>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
 
 #define CERTIFICATE_MANAGER_ALLOW_UNREGISTERED 1
 namespace lansend::core {
 
 class CertificateManager {
 public:
-    CertificateManager(const std::filesystem::path& certDir);
+    CertificateManager(const std::filesystem::path& certDir,
+                       KeyType key_type = KeyType::kEcdsaP256);
 
     const SecurityContext& security_context() const;
 
     static std::string CalculateCertificateHash(const std::string& certificatePem);
 
+    // Accepts a certificate that does not match the pinned one when accept_replacement
+    // approves its fingerprint. The pin itself is left as it is.
+    using ReplacementFilter = std::function<bool(const std::string& fingerprint)>;
+
     bool VerifyCertificate(bool preverified,
                            boost::asio::ssl::verify_context& ctx,
                            const std::string& ip,
-                           uint16_t port);
+                           uint16_t port,
+                           const ReplacementFilter& accept_replacement = {});
 
+    // previous_fingerprint is announced by peers that are migrating to a new key type
     void RegisterDeviceFingerprint(const std::string& ip,
                                    uint16_t port,
-                                   const std::string& fingerprint);
+                                   const std::string& fingerprint,
+                                   const std::string& previous_fingerprint = {});
     void RemoveDeviceFingerprint(const std::string& ip, uint16_t port);
     std::optional<std::string> GetDeviceFingerprint(const std::string& ip, uint16_t port) const;
 
@@ -31,20 +43,31 @@ public:
     void SetUnregisteredAllowed(bool allow) { unregistered_allowed_ = allow; }
 
 private:
+    struct DeviceFingerprint {
+        std::string current;
+        std::string previous;
+    };
+
     bool initSecurityContext();
     bool generateSelfSignedCertificate();
     bool saveSecurityContext();
     bool loadSecurityContext();
+    bool migrateSecurityContext(KeyType loaded_key_type);
+    void loadPreviousFingerprint();
 
     std::string makeDeviceKey(const std::string& ip, uint16_t port) const;
 
     SecurityContext security_context_;
     std::filesystem::path certificate_dir_;
+    KeyType key_type_;
     bool unregistered_allowed_ = false;
 
-    std::unordered_map<std::string, std::string> device_fingerprints_;
+    // Read by every TLS handshake, written by discovery
+    mutable std::shared_mutex fingerprints_mutex_;
+    std::unordered_map<std::string, DeviceFingerprint> device_fingerprints_;
 
     static constexpr int kCertValidityDays = 3650;
+    static constexpr int kFingerprintTransitionDays = 30;
 };
 
 } // namespace lansend::core
\ No newline at end of file
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <core/util/binary_message.h>
+#include <cstddef>
 #include <filesystem>
+#include <string>
+
+struct evp_md_ctx_st;
 
 namespace lansend::core {
 
@@ -15,4 +19,21 @@ private:
     static FileHasher instance;
 };
 
+// SHA-256 of data fed piece by piece, digests match FileHasher's
+class IncrementalHasher {
+public:
+    IncrementalHasher();
+    ~IncrementalHasher();
+    IncrementalHasher(const IncrementalHasher&) = delete;
+    IncrementalHasher& operator=(const IncrementalHasher&) = delete;
+
+    void Update(const void* data, std::size_t size);
+
+    // Hex digest of everything fed so far, the hasher cannot be updated afterwards
+    std::string Finish();
+
+private:
+    evp_md_ctx_st* context_;
+};
+
 } // namespace lansend::core
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace lansend::core {
+
+// One bit per chunk of a file, set once the chunk has been received
+class ChunkBitmap {
+public:
+    ChunkBitmap() = default;
+    explicit ChunkBitmap(std::size_t chunk_count);
+
+    // Returns false if the chunk was already set. Throws std::out_of_range for a bad index.
+    bool Set(std::size_t index);
+    bool Test(std::size_t index) const;
+
+    std::size_t Count() const { return count_; } // Chunks received
+    std::size_t Size() const { return size_; }   // Chunks in the file
+    bool IsComplete() const { return count_ == size_; }
+
+    // Index of the first chunk not received yet, nullopt when complete
+    std::optional<std::size_t> FirstMissing() const;
+
+    // Bit i is bit (i % 8) of byte (i / 8), independent of the host's byte order
+    std::vector<std::uint8_t> Serialize() const;
+    static ChunkBitmap Deserialize(std::span<const std::uint8_t> bytes, std::size_t chunk_count);
+
+private:
+    std::vector<std::uint64_t> words_;
+    std::size_t size_{0};
+    std::size_t count_{0};
+};
+
+} // namespace lansend::core
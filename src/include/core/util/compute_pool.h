@@ -0,0 +1,113 @@
+/**
+ * @file compute_pool.h
+ * @brief A bounded thread pool for CPU-heavy work (hashing, encryption) awaited from coroutines
+ */
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+namespace lansend::core {
+
+struct ComputeTaskStats {
+    std::size_t count = 0;
+    std::chrono::microseconds total_wait{0}; // Time spent waiting for a free slot and a thread
+    std::chrono::microseconds total_run{0};
+    std::chrono::microseconds max_run{0};
+};
+
+class ComputePool {
+private:
+    explicit ComputePool(std::size_t thread_count);
+    ComputePool(const ComputePool&) = delete;
+    ComputePool& operator=(const ComputePool&) = delete;
+    ~ComputePool();
+
+    static ComputePool& instance();
+
+    boost::asio::awaitable<void> acquireSlot();
+    void releaseSlot();
+    void record(std::string_view task_name,
+                std::chrono::steady_clock::duration wait,
+                std::chrono::steady_clock::duration run);
+
+    struct SlotGuard {
+        ComputePool& pool;
+        ~SlotGuard() { pool.releaseSlot(); }
+    };
+
+    boost::asio::thread_pool pool_;
+    // Every queued or running task holds one element of the channel's buffer,
+    // so callers are suspended once max_queue_depth_ tasks are in flight
+    boost::asio::experimental::concurrent_channel<void(boost::system::error_code)> slots_;
+    std::size_t thread_count_;
+    std::size_t max_queue_depth_;
+
+    std::mutex stats_mutex_;
+    std::unordered_map<std::string, ComputeTaskStats> stats_;
+
+    static constexpr std::size_t kQueueDepthPerThread = 4;
+
+public:
+    /**
+     * @brief Run a CPU-bound task on the compute pool and resume the caller with its result
+     *
+     * The calling coroutine is resumed on its own executor, the event loop keeps serving
+     * network I/O while the task runs. Exceptions thrown by the task are rethrown to the caller.
+     *
+     * @param task_name Name the task's latency is accounted under
+     * @param task Callable taking no arguments, it must stay valid until the task completes
+     */
+    template<typename F>
+    static boost::asio::awaitable<std::invoke_result_t<F&>> Run(std::string_view task_name,
+                                                                F task) {
+        using Result = std::invoke_result_t<F&>;
+        auto& pool = instance();
+
+        auto queued_at = std::chrono::steady_clock::now();
+        co_await pool.acquireSlot();
+        SlotGuard guard{pool};
+
+        auto timed = [&]() -> boost::asio::awaitable<Result> {
+            auto started_at = std::chrono::steady_clock::now();
+            if constexpr (std::is_void_v<Result>) {
+                task();
+                pool.record(task_name,
+                            started_at - queued_at,
+                            std::chrono::steady_clock::now() - started_at);
+                co_return;
+            } else {
+                Result result = task();
+                pool.record(task_name,
+                            started_at - queued_at,
+                            std::chrono::steady_clock::now() - started_at);
+                co_return result;
+            }
+        };
+        co_return co_await boost::asio::co_spawn(pool.pool_.get_executor(),
+                                                 timed,
+                                                 boost::asio::use_awaitable);
+    }
+
+    /**
+     * @brief Snapshot of the latency metrics, keyed by task name
+     */
+    static std::unordered_map<std::string, ComputeTaskStats> Stats();
+
+    /**
+     * @brief Log the latency metrics, then wait for the running tasks and join the threads
+     */
+    static void Shutdown();
+};
+
+} // namespace lansend::core
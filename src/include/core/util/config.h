@@ -42,10 +42,24 @@ namespace lansend::core {
 inline toml::table config;
 
 struct Settings {
-    std::uint16_t port;             // Server port
-    std::string pin_code;           // Pin Code for other devices to connect
-    bool auto_receive;              // Whether to automatically receive files from other devices
-    std::filesystem::path save_dir; // Directory to save files from other devices
+    std::uint16_t port;               // Server port
+    std::string pin_code;             // Pin Code for other devices to connect
+    bool auto_receive;                // Whether to automatically receive files from other devices
+    std::filesystem::path save_dir;   // Directory to save files from other devices
+    std::string certificate_key_type; // Key type of the TLS identity: ecdsa-p256, ed25519, rsa-2048
+
+    std::uint16_t worker_threads;        // io_context threads, 0 for hardware concurrency
+    std::uint16_t compute_threads;       // Hashing threads, 0 for half of the cores
+    std::uint16_t max_receive_sessions;  // Receive sessions served at the same time
+    std::uint32_t max_receive_bandwidth; // Aggregate receive bandwidth in KiB/s, 0 for unlimited
+    std::uint16_t progress_rate_hz;      // Progress updates per second and file, 0 for every chunk
+    std::uint16_t max_connections;       // Concurrent connections, peers in a session may exceed it
+    std::uint16_t max_peer_connections;  // Concurrent connections from one ip, 0 for unlimited
+    std::uint16_t peer_handshake_rate;   // New connections per second from one ip, 0 for unlimited
+    std::uint32_t memory_budget_mb;      // Budget for in-flight bodies and send buffers, 0 no limit
+    bool multipath_transfer;             // Send over every path to the receiver at once
+    bool udp_transport;                  // Move file data over the encrypted UDP channel
+    bool mux_transport;                  // Multiplex requests over one connection per path
 };
 
 inline Settings settings;
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <core/model.h>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace lansend::core {
+
+// Reads control DTOs straight from a request body with simdjson's on-demand parser, without
+// building a JSON document first. The parser is reused per thread, so steady-state parsing
+// only allocates the DTO's own strings. Throws simdjson::simdjson_error on malformed input.
+//
+// capacity is the size of the buffer body lies at the start of. A body with
+// transfer::kBodyPadding bytes to spare past its end, as HttpServer leaves them, is parsed in
+// place, any other is copied into a padded buffer first.
+class DtoReader {
+public:
+    static RequestSendDto ReadRequestSend(std::string_view body, std::size_t capacity = 0);
+    static ManifestPageDto ReadManifestPage(std::string_view body, std::size_t capacity = 0);
+    static VerifyIntegrityDto ReadVerifyIntegrity(std::string_view body,
+                                                  std::size_t capacity = 0);
+
+    // The session_id field of a cancel-send body
+    static std::string ReadSessionId(std::string_view body, std::size_t capacity = 0);
+};
+
+} // namespace lansend::core
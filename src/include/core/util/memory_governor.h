@@ -0,0 +1,103 @@
+/**
+ * @file memory_governor.h
+ * @brief A process-wide byte budget for in-flight request bodies and send buffers
+ */
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace lansend::core {
+
+struct MemoryGovernorStats {
+    std::size_t budget = 0; // 0 when unlimited
+    std::size_t in_use = 0;
+    std::size_t peak = 0;
+    std::size_t reservations = 0;
+    std::size_t waits = 0; // Reservations that had to wait for memory to be released
+    std::chrono::microseconds total_wait{0};
+    std::chrono::microseconds max_wait{0};
+};
+
+// Bytes held against the budget, returned when the reservation is destroyed
+class MemoryReservation {
+public:
+    MemoryReservation() = default;
+    MemoryReservation(MemoryReservation&& other) noexcept;
+    MemoryReservation& operator=(MemoryReservation&& other) noexcept;
+    MemoryReservation(const MemoryReservation&) = delete;
+    MemoryReservation& operator=(const MemoryReservation&) = delete;
+    ~MemoryReservation();
+
+    std::size_t Size() const { return bytes_; }
+
+    void Release();
+
+private:
+    friend class MemoryGovernor;
+    explicit MemoryReservation(std::size_t bytes)
+        : bytes_(bytes) {}
+
+    std::size_t bytes_ = 0;
+};
+
+class MemoryGovernor {
+private:
+    explicit MemoryGovernor(std::size_t budget);
+    MemoryGovernor(const MemoryGovernor&) = delete;
+    MemoryGovernor& operator=(const MemoryGovernor&) = delete;
+
+    friend class MemoryReservation;
+    static MemoryGovernor& instance();
+
+    using Signal = boost::asio::experimental::concurrent_channel<void(boost::system::error_code)>;
+
+    struct Waiter {
+        std::size_t bytes;
+        std::unique_ptr<Signal> granted;
+    };
+
+    bool fits(std::size_t bytes) const;
+    void grant(std::size_t bytes);
+    void release(std::size_t bytes);
+    // Grants the queued waiters that fit now, the mutex is held
+    void serveWaiters();
+    // The waiter's coroutine was cancelled or destroyed before it received its grant. It leaves
+    // the queue, or gives back the bytes it was granted but never took.
+    void abandon(const std::shared_ptr<Waiter>& waiter);
+
+    std::mutex mutex_;
+    std::size_t budget_;
+    std::size_t in_use_ = 0;
+    // Served in FIFO order, a large reservation is not starved by a stream of small ones
+    std::deque<std::shared_ptr<Waiter>> waiters_;
+    MemoryGovernorStats stats_;
+
+public:
+    /**
+     * @brief Reserve bytes before allocating them, waiting while the budget is exhausted
+     *
+     * A reservation larger than the whole budget is granted once nothing else is held,
+     * so it is served alone instead of waiting forever.
+     *
+     * @param bytes Number of bytes the caller is about to buffer
+     */
+    static boost::asio::awaitable<MemoryReservation> Reserve(std::size_t bytes);
+
+    /**
+     * @brief Snapshot of the usage and wait metrics
+     */
+    static MemoryGovernorStats Stats();
+
+    /**
+     * @brief Log the usage and wait metrics
+     */
+    static void LogStats();
+};
+
+} // namespace lansend::core
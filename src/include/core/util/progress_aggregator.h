@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace lansend::core {
+
+struct ProgressSample {
+    std::uint64_t bytes_transferred;
+    std::uint64_t total_bytes;
+    double progress;           // Percentage
+    double throughput;         // Bytes per second since the previous sample
+    double average_throughput; // Bytes per second since the first update
+    double eta_seconds;        // Estimated from the smoothed throughput, -1 while unknown
+};
+
+// Coalesces per-chunk progress updates into samples emitted at a bounded rate.
+// Not thread-safe, the owner updates it from its own strand.
+class ProgressAggregator {
+public:
+    // rate_hz: samples emitted per second and per key, 0 emits every update
+    explicit ProgressAggregator(double rate_hz);
+
+    void SetRate(double rate_hz);
+
+    // Record the progress of a transfer, returns a sample when one is due. The first and the
+    // final (bytes_transferred >= total_bytes) updates are always emitted.
+    std::optional<ProgressSample> Update(std::string_view key,
+                                         std::uint64_t bytes_transferred,
+                                         std::uint64_t total_bytes);
+
+    void Remove(std::string_view key);
+
+private:
+    struct Progress {
+        std::chrono::steady_clock::time_point started_at;
+        std::chrono::steady_clock::time_point last_sample_at;
+        std::uint64_t start_bytes;
+        std::uint64_t last_sample_bytes;
+        double smoothed_throughput;
+    };
+
+    std::chrono::steady_clock::duration interval_;
+    std::unordered_map<std::string, Progress> progresses_;
+
+    static constexpr double kSmoothing = 0.3; // Weight of the newest throughput in the ETA
+};
+
+} // namespace lansend::core
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <chrono>
+#include <mutex>
+
+namespace lansend::core {
+
+// Token bucket shared by coroutines running on any thread.
+// Tokens are whatever the caller meters: bytes for bandwidth, handshakes for connection rate.
+class RateLimiter {
+public:
+    // rate: tokens refilled per second, 0 disables the limit
+    // burst: bucket capacity, defaults to one second worth of tokens
+    explicit RateLimiter(double rate = 0, double burst = 0);
+
+    void SetRate(double rate, double burst = 0);
+    bool IsLimited() const;
+    double Rate() const; // 0 when unlimited
+
+    // Take tokens if they are available right now, never waits
+    bool TryAcquire(double tokens = 1);
+
+    // Take tokens, waiting until the bucket has refilled enough.
+    // Requests larger than the burst are allowed and paid back by later callers.
+    boost::asio::awaitable<void> Acquire(double tokens);
+
+private:
+    void refill(std::chrono::steady_clock::time_point now);
+
+    mutable std::mutex mutex_;
+    double rate_;
+    double burst_;
+    double tokens_;
+    std::chrono::steady_clock::time_point last_refill_;
+};
+
+} // namespace lansend::core
@@ -1,13 +1,33 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace lansend::core {
 
 namespace system {
 
+struct NetworkInterface {
+    std::string name;
+    std::string address; // IPv4
+    std::string netmask;
+    std::uint32_t link_speed_mbps = 0; // 0 when the platform does not report it (e.g. Wi-Fi)
+
+    bool operator==(const NetworkInterface&) const = default;
+};
+
 std::string Hostname();
+// The address of the interface holding the default route, resolved once and cached
 std::string PublicIpv4Address();
+// Resolve the address again, NetworkMonitor calls it when interfaces change.
+// Returns true when the address changed.
+bool RefreshPublicIpv4Address();
+// Up, non-loopback IPv4 interfaces, cached like the public address. Virtual interfaces
+// (Docker and VM bridges, veth pairs, tunnels) are left out, the faster links come first.
+std::vector<NetworkInterface> NetworkInterfaces();
+// Enumerate the interfaces again, returns true when the list changed
+bool RefreshNetworkInterfaces();
 std::string OperatingSystem(); // etc: Windows 11 (x86_64)
 
 } // namespace system
@@ -2,10 +2,12 @@
 
 #include "core/network/client/http_client_service.h"
 #include "core/network/discovery/discovery_manager.h"
+#include "core/network/network_monitor.h"
 #include "core/network/server/http_server.h"
 #include "core/security/certificate_manager.h"
 #include "ipc_event_stream.h"
 #include "model.h"
+#include <atomic>
 #include <boost/asio/io_context.hpp>
 #include <nlohmann/json_fwd.hpp>
 #include <string>
@@ -44,10 +46,11 @@ private:
     IpcEventStream& event_stream_;
     core::CertificateManager cert_manager_;
     core::DiscoveryManager discovery_manager_;
+    core::NetworkMonitor network_monitor_;
     core::HttpClientService http_client_service_;
     core::HttpServer http_server_;
     std::function<void()> exit_app_callback_ = nullptr;
-    bool is_running_{false};
+    std::atomic_bool is_running_{false};
 
     // 协程任务，开启服务
     boost::asio::awaitable<void> start();
@@ -1,10 +1,20 @@
 #pragma once
 
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
 #include <core/model/feedback.h>
 #include <deque>
+#include <functional>
 #include <ipc/model.h>
 #include <mutex>
+#include <optional>
 #include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace lansend::ipc {
 
@@ -12,29 +22,57 @@ class IpcEventStream {
     using Feedback = core::Feedback;
 
 public:
+    explicit IpcEventStream(boost::asio::any_io_executor executor);
+
+    // Invoked outside the lock with the session id of each ConfirmReceive operation posted
+    using ConfirmReceiveCallback = std::function<void(std::string_view session_id)>;
+
+    void SetConfirmReceiveCallback(ConfirmReceiveCallback callback);
+
     void PostOperation(Operation&& operation);
     void PostOperation(const Operation& operation);
     void PostFeedback(Feedback&& feedback);
     void PostFeedback(const Feedback& feedback);
 
-    std::optional<Operation> PollActiveOperation();
-    std::optional<operation::ConfirmReceive> PollConfirmReceiveOperation();
-    bool PollCancelReceiveOperation();
-    std::optional<Feedback> PollFeedback();
+    // Suspends until at least one "common" or "send" operation is posted, then takes all of
+    // them. Returns an empty batch once the stream is closed.
+    boost::asio::awaitable<std::vector<Operation>> WaitActiveOperations();
+    // Operations without a session id are taken by the first session polling for one
+    std::optional<operation::ConfirmReceive> PollConfirmReceiveOperation(
+        std::string_view session_id);
+    bool PollCancelReceiveOperation(std::string_view session_id);
+    // Suspends until at least one feedback is posted, then takes all of them.
+    // Returns an empty batch once the stream is closed.
+    boost::asio::awaitable<std::vector<Feedback>> WaitFeedbacks();
+
+    // Wake up and release the waiters for good
+    void Close();
 
 private:
+    // Returns the session id to notify when a ConfirmReceive operation was stored
+    std::optional<std::string> postReceiveOperation(const Operation& operation);
+
     mutable std::mutex mutex_;
     // "common" and "send" operations that will be polling actively
     std::deque<Operation> active_operations_;
 
-    // for confirm receive operations polling in ReceiveController
-    std::optional<operation::ConfirmReceive> confirm_receive_operation_;
+    // for confirm receive operations polling in ReceiveController, keyed by session id
+    std::unordered_map<std::string, operation::ConfirmReceive> confirm_receive_operations_;
 
-    // for cancel receive operations polling in ReceiveController
-    bool cancel_receive_operation_{false};
+    // for cancel receive operations polling in ReceiveController, keyed by session id
+    std::unordered_set<std::string> cancel_receive_operations_;
 
     // for notifications
     std::deque<Feedback> feedbacks_;
+
+    ConfirmReceiveCallback confirm_receive_callback_ = nullptr;
+
+    // Signals hold at most one pending wake-up: producers push under the lock and then signal,
+    // the consumer drains the whole queue for every wake-up it takes
+    using Signal = boost::asio::experimental::concurrent_channel<void(boost::system::error_code)>;
+    Signal operation_signal_;
+    Signal feedback_signal_;
+    bool closed_{false};
 };
 
 } // namespace lansend::ipc
\ No newline at end of file
@@ -1,10 +1,10 @@
 #pragma once
 
 #include <boost/asio.hpp>
+#include <deque>
 #include <functional>
 #include <iostream>
 #include <ipc/ipc_event_stream.h>
-#include <mutex>
 #include <nlohmann/json.hpp>
 #include <string>
 
@@ -40,8 +40,20 @@ public:
     boost::asio::awaitable<void> send_message(const std::string& type, const nlohmann::json& data);
 
 private:
+    // 消息体编码，前端在收到 backend_started 后可通过 SelectEncoding 切换
+    enum class Encoding {
+        kJson,
+        kCbor,
+    };
+
     IpcEventStream& event_stream_;
 
+    // 编码消息并加入写队列，不等待写出
+    void enqueue_message(const std::string& type, const nlohmann::json& data);
+
+    // 将写队列中所有的帧合并为一次写操作写出
+    boost::asio::awaitable<void> flush_messages();
+
     // 处理从标准输入读取的消息
     boost::asio::awaitable<void> read_message_loop();
 
@@ -53,6 +65,8 @@ private:
 
 private:
     boost::asio::io_context& io_context_;
+    // 所有管道读写都在此 strand 上执行，io_context 可能由多个线程驱动
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
 #ifdef _WIN32
     boost::asio::windows::stream_handle input_;
     boost::asio::windows::stream_handle output_;
@@ -62,7 +76,9 @@ private:
 #endif
     std::map<std::string, MessageHandler> handlers_;
     bool running_;
-    std::mutex write_mutex_; // 用于同步对管道的写入操作
+    std::deque<std::string> write_queue_; // 待写入的完整帧（长度前缀 + 消息体）
+    bool writing_{false};                 // 是否有协程正在写管道
+    Encoding encoding_{Encoding::kJson};  // 发往前端的消息体编码
 };
 
 } // namespace lansend::ipc
\ No newline at end of file
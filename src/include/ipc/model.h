@@ -1,5 +1,6 @@
 #pragma once
 
+#include "model/cancel_receive.h"
 #include "model/cancel_send.h"
 #include "model/cancel_wait_for_confirmation.h"
 #include "model/confirm_receive.h"
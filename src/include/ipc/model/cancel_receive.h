@@ -0,0 +1,17 @@
+#pragma once
+
+#include "std_optional.h"
+#include <nlohmann/detail/macro_scope.hpp>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+
+namespace lansend::ipc::operation {
+
+struct CancelReceive {
+    std::optional<std::string> session_id; // 要取消的接收session_id，为空时取消最早的接收
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(CancelReceive, session_id);
+};
+
+} // namespace lansend::ipc::operation
\ No newline at end of file
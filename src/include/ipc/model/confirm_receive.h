@@ -9,10 +9,17 @@
 namespace lansend::ipc::operation {
 
 struct ConfirmReceive {
-    bool accepted;
-    std::optional<std::vector<std::string>> accepted_files;
+    bool accepted = false;
+    std::optional<std::vector<std::string>> accepted_files;    // File names
+    std::optional<std::vector<std::string>> accepted_file_ids; // Takes precedence over names
+    // session_id of the RequestReceiveFiles feedback, answers the oldest request when absent
+    std::optional<std::string> session_id;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(ConfirmReceive, accepted, accepted_files);
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(ConfirmReceive,
+                                                accepted,
+                                                accepted_files,
+                                                accepted_file_ids,
+                                                session_id);
 };
 
 } // namespace lansend::ipc::operation
\ No newline at end of file
@@ -1,10 +1,12 @@
 // clang-format off
 #include <boost/asio/awaitable.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/asio/use_awaitable.hpp>
 #include <ipc/ipc_backend_service.h>
 #include "core/constant/path.h"
 #include "core/model/feedback.h"
 #include "core/model/feedback/feedback_type.h"
+#include "core/network/server/controller/receive_controller.h"
 #include "core/security/certificate_manager.h"
 #include "core/util/config.h"
 // clang-format on
@@ -16,11 +18,14 @@ namespace lansend::ipc {
 IpcBackendService::IpcBackendService(boost::asio::io_context& ioc, IpcEventStream& event_stream)
     : ioc_(ioc)
     , event_stream_(event_stream)
-    , cert_manager_(core::path::kCertificateDir)
+    , cert_manager_(core::path::kCertificateDir,
+                    core::KeyTypeFromString(core::settings.certificate_key_type))
     , http_client_service_(ioc, cert_manager_)
     , http_server_(ioc, cert_manager_)
     , discovery_manager_(ioc, cert_manager_)
+    , network_monitor_(ioc)
     , is_running_(true) {
+    network_monitor_.SetChangeCallback([this]() { discovery_manager_.NotifyLocalInfoChanged(); });
     discovery_manager_.SetDeviceFoundCallback([this](const core::DeviceInfo& device) {
         event_stream_.PostFeedback(core::Feedback{
             .type = core::FeedbackType::kFoundDevice,
@@ -37,14 +42,27 @@ IpcBackendService::IpcBackendService(boost::asio::io_context& ioc, IpcEventStrea
         [this](core::Feedback&& feedback) { event_stream_.PostFeedback(std::move(feedback)); });
     http_server_.SetFeedbackCallback(
         [this](core::Feedback&& feedback) { event_stream_.PostFeedback(std::move(feedback)); });
-    http_server_.SetReceiveWaitConditionFunc([this]() -> std::optional<std::vector<std::string>> {
-        if (auto operation = event_stream_.PollConfirmReceiveOperation(); operation) {
-            return operation->accepted_files;
-        }
-        return std::nullopt;
+    http_server_.SetReceiveWaitConditionFunc(
+        [this](std::string_view session_id) -> std::optional<std::vector<std::string>> {
+            if (auto operation = event_stream_.PollConfirmReceiveOperation(session_id);
+                operation) {
+                if (!operation->accepted) {
+                    return std::vector<std::string>{};
+                }
+                if (operation->accepted_file_ids) {
+                    return std::move(operation->accepted_file_ids);
+                }
+                return std::move(operation->accepted_files);
+            }
+            return std::nullopt;
+        });
+    // Wake the waiting receive session as soon as the user answers, instead of polling
+    event_stream_.SetConfirmReceiveCallback([this](std::string_view session_id) {
+        http_server_.GetReceiveController().NotifyConfirmation(std::string(session_id));
+    });
+    http_server_.SetReceiveCancelConditionFunc([this](std::string_view session_id) -> bool {
+        return event_stream_.PollCancelReceiveOperation(session_id);
     });
-    http_server_.SetReceiveCancelConditionFunc(
-        [this]() -> bool { return event_stream_.PollCancelReceiveOperation(); });
 }
 
 void IpcBackendService::Start() {
@@ -53,14 +71,17 @@ void IpcBackendService::Start() {
         .type = core::FeedbackType::kSettings,
         .data = core::feedback::Settings::FromConfigSettings(),
     });
-    net::co_spawn(ioc_, start(), net::detached);
+    // Operations are dispatched one at a time, whichever worker thread picks them up
+    net::co_spawn(net::make_strand(ioc_), start(), net::detached);
     spdlog::debug("IpcBackendService started");
 }
 
 void IpcBackendService::Stop() {
+    network_monitor_.Stop();
     discovery_manager_.Stop();
     http_server_.Stop();
     is_running_ = false;
+    event_stream_.Close();
     spdlog::debug("IpcBackendService stopped");
 }
 
@@ -69,14 +90,16 @@ void IpcBackendService::SetExitAppCallback(std::function<void()>&& callback) {
 }
 
 net::awaitable<void> IpcBackendService::start() {
-    auto executor = co_await net::this_coro::executor;
     http_server_.Start(core::settings.port);
-    discovery_manager_.Start(core::settings.port);
+    discovery_manager_.Start();
+    network_monitor_.Start();
+    // Sleeps until the frontend posts operations, then dispatches them in arrival order
     while (is_running_) {
-        if (auto operation = event_stream_.PollActiveOperation(); operation) {
-            dispatchOperation(*operation);
-        } else {
-            co_await net::post(executor);
+        for (const auto& operation : co_await event_stream_.WaitActiveOperations()) {
+            dispatchOperation(operation);
+            if (!is_running_) {
+                break;
+            }
         }
     }
 }
@@ -158,24 +181,32 @@ void IpcBackendService::sendFiles(const operation::SendFiles& send_file) {
     if (send_file.file_paths.size() > 10) {
         spdlog::error("IPC Error: Too many files to send");
         return;
-        std::vector<std::filesystem::path> file_paths;
-        for (const auto& file_path : send_file.file_paths) {
-            file_paths.emplace_back(file_path);
-        }
-        http_client_service_.SendFiles(device->ip_address, device->port, file_paths);
     }
+    std::vector<std::filesystem::path> file_paths;
+    for (const auto& file_path : send_file.file_paths) {
+        file_paths.emplace_back(file_path);
+    }
+    http_client_service_.SendFiles(*device, file_paths);
 }
 
 void IpcBackendService::modifySettings(std::string_view key, nlohmann::json value) {
     try {
         if (key == "port") {
             core::settings.port = value.get<std::uint16_t>();
+            discovery_manager_.NotifyLocalInfoChanged();
         } else if (key == "pin-code") {
             core::settings.pin_code = value.get<std::string>();
         } else if (key == "auto-receive") {
             core::settings.auto_receive = value.get<bool>();
         } else if (key == "save-dir") {
             core::settings.save_dir = value.get<std::string>();
+            http_server_.GetReceiveController().SetSaveDirectory(core::settings.save_dir);
+        } else if (key == "max-receive-sessions") {
+            core::settings.max_receive_sessions = value.get<std::uint16_t>();
+        } else if (key == "max-receive-bandwidth") {
+            core::settings.max_receive_bandwidth = value.get<std::uint32_t>();
+            http_server_.GetReceiveController().SetBandwidthLimit(
+                static_cast<std::uint64_t>(core::settings.max_receive_bandwidth) * 1024);
         } else {
             spdlog::error("IPC Error: Invalid key for ModifySettings");
             return;
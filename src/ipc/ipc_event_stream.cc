@@ -1,92 +1,173 @@
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
 #include <core/model/feedback.h>
 #include <ipc/ipc_event_stream.h>
 #include <ipc/model.h>
+#include <iterator>
 #include <spdlog/spdlog.h>
 
 namespace lansend::ipc {
 
 using Feedback = core::Feedback;
+namespace net = boost::asio;
+
+IpcEventStream::IpcEventStream(net::any_io_executor executor)
+    : operation_signal_(executor, 1)
+    , feedback_signal_(executor, 1) {}
 
 void IpcEventStream::PostOperation(Operation&& operation) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (operation.type == OperationType::kRespondToReceiveRequest) {
-        operation::ConfirmReceive confirm_receive;
-        try {
-            nlohmann::from_json(operation.data, confirm_receive);
-            confirm_receive_operation_ = std::move(confirm_receive);
-        } catch (const std::exception& e) {
-            spdlog::error("Failed to parse ConfirmReceiveOperation: {}", e.what());
-            return;
+    std::optional<std::string> confirmed_session;
+    ConfirmReceiveCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        callback = confirm_receive_callback_;
+        if (operation.type == OperationType::kRespondToReceiveRequest
+            || operation.type == OperationType::kCancelReceive) {
+            confirmed_session = postReceiveOperation(operation);
+        } else {
+            active_operations_.emplace_back(std::move(operation));
         }
-    } else if (operation.type == OperationType::kCancelReceive) {
-        cancel_receive_operation_ = true;
-    } else {
-        active_operations_.emplace_back(std::move(operation));
+    }
+    if (!confirmed_session) {
+        operation_signal_.try_send(boost::system::error_code{});
+    }
+    if (confirmed_session && callback) {
+        callback(*confirmed_session);
     }
 }
 
 void IpcEventStream::PostOperation(const Operation& operation) {
+    std::optional<std::string> confirmed_session;
+    ConfirmReceiveCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        callback = confirm_receive_callback_;
+        if (operation.type == OperationType::kRespondToReceiveRequest
+            || operation.type == OperationType::kCancelReceive) {
+            confirmed_session = postReceiveOperation(operation);
+        } else {
+            active_operations_.emplace_back(operation);
+        }
+    }
+    if (!confirmed_session) {
+        operation_signal_.try_send(boost::system::error_code{});
+    }
+    if (confirmed_session && callback) {
+        callback(*confirmed_session);
+    }
+}
+
+void IpcEventStream::SetConfirmReceiveCallback(ConfirmReceiveCallback callback) {
     std::lock_guard<std::mutex> lock(mutex_);
-    if (operation.type == OperationType::kRespondToReceiveRequest) {
-        operation::ConfirmReceive confirm_receive_operation;
-        try {
-            nlohmann::from_json(operation.data, confirm_receive_operation);
-            confirm_receive_operation_ = std::move(confirm_receive_operation);
-        } catch (const std::exception& e) {
-            spdlog::error("Failed to parse ConfirmReceiveOperation: {}", e.what());
-            return;
+    confirm_receive_callback_ = std::move(callback);
+}
+
+std::optional<std::string> IpcEventStream::postReceiveOperation(const Operation& operation) {
+    try {
+        if (operation.type == OperationType::kRespondToReceiveRequest) {
+            operation::ConfirmReceive confirm_receive;
+            nlohmann::from_json(operation.data, confirm_receive);
+            auto session_id = confirm_receive.session_id.value_or("");
+            confirm_receive_operations_[session_id] = std::move(confirm_receive);
+            return session_id;
+        } else {
+            operation::CancelReceive cancel_receive;
+            if (!operation.data.is_null()) {
+                nlohmann::from_json(operation.data, cancel_receive);
+            }
+            cancel_receive_operations_.insert(cancel_receive.session_id.value_or(""));
         }
-    } else if (operation.type == OperationType::kCancelReceive) {
-        cancel_receive_operation_ = true;
-    } else {
-        active_operations_.emplace_back(operation);
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to parse receive operation: {}", e.what());
     }
+    return std::nullopt;
 }
 
 void IpcEventStream::PostFeedback(Feedback&& feedback) {
-    feedbacks_.emplace_back(std::move(feedback));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        feedbacks_.emplace_back(std::move(feedback));
+    }
+    feedback_signal_.try_send(boost::system::error_code{});
 }
 
 void IpcEventStream::PostFeedback(const Feedback& feedback) {
-    feedbacks_.emplace_back(feedback);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        feedbacks_.emplace_back(feedback);
+    }
+    feedback_signal_.try_send(boost::system::error_code{});
 }
 
-std::optional<Operation> IpcEventStream::PollActiveOperation() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (active_operations_.empty()) {
-        return std::nullopt;
+net::awaitable<std::vector<Operation>> IpcEventStream::WaitActiveOperations() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!active_operations_.empty()) {
+                std::vector<Operation> operations(
+                    std::make_move_iterator(active_operations_.begin()),
+                    std::make_move_iterator(active_operations_.end()));
+                active_operations_.clear();
+                co_return operations;
+            }
+            if (closed_) {
+                co_return std::vector<Operation>{};
+            }
+        }
+        boost::system::error_code ec;
+        co_await operation_signal_.async_receive(net::redirect_error(net::use_awaitable, ec));
     }
-    Operation op = active_operations_.front();
-    active_operations_.pop_front();
-    return op;
 }
 
-std::optional<operation::ConfirmReceive> IpcEventStream::PollConfirmReceiveOperation() {
-    if (!confirm_receive_operation_) {
+std::optional<operation::ConfirmReceive> IpcEventStream::PollConfirmReceiveOperation(
+    std::string_view session_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = confirm_receive_operations_.find(std::string(session_id));
+    if (it == confirm_receive_operations_.end()) {
+        it = confirm_receive_operations_.find("");
+    }
+    if (it == confirm_receive_operations_.end()) {
         return std::nullopt;
     }
-    operation::ConfirmReceive operation = *confirm_receive_operation_;
-    confirm_receive_operation_ = std::nullopt;
+    operation::ConfirmReceive operation = std::move(it->second);
+    confirm_receive_operations_.erase(it);
     return operation;
 }
 
-bool IpcEventStream::PollCancelReceiveOperation() {
+bool IpcEventStream::PollCancelReceiveOperation(std::string_view session_id) {
     std::lock_guard<std::mutex> lock(mutex_);
-    if (!cancel_receive_operation_) {
-        return false;
+    if (cancel_receive_operations_.erase(std::string(session_id)) > 0) {
+        return true;
     }
-    cancel_receive_operation_ = false;
-    return true;
+    return cancel_receive_operations_.erase("") > 0;
 }
 
-std::optional<Feedback> IpcEventStream::PollFeedback() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (feedbacks_.empty()) {
-        return std::nullopt;
+net::awaitable<std::vector<Feedback>> IpcEventStream::WaitFeedbacks() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!feedbacks_.empty()) {
+                std::vector<Feedback> feedbacks(std::make_move_iterator(feedbacks_.begin()),
+                                                std::make_move_iterator(feedbacks_.end()));
+                feedbacks_.clear();
+                co_return feedbacks;
+            }
+            if (closed_) {
+                co_return std::vector<Feedback>{};
+            }
+        }
+        boost::system::error_code ec;
+        co_await feedback_signal_.async_receive(net::redirect_error(net::use_awaitable, ec));
+    }
+}
+
+void IpcEventStream::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
     }
-    Feedback feedback = feedbacks_.front();
-    feedbacks_.pop_front();
-    return feedback;
+    operation_signal_.try_send(boost::system::error_code{});
+    feedback_signal_.try_send(boost::system::error_code{});
 }
 
 } // namespace lansend::ipc
\ No newline at end of file
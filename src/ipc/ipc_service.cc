@@ -6,8 +6,9 @@
 #include <boost/asio/use_awaitable.hpp>
 #include <boost/endian/conversion.hpp>
 #include <cstdint>
-#include <iostream>
+#include <cstring>
 #include <system_error>
+#include <vector>
 
 #ifdef _WIN32
 #include <fcntl.h>
@@ -17,7 +18,6 @@
 #include <unistd.h>
 #endif
 #include <ipc/ipc_event_stream.h>
-#include <mutex>
 
 namespace lansend::ipc {
 IpcService::IpcService(boost::asio::io_context& io_context,
@@ -25,6 +25,7 @@ IpcService::IpcService(boost::asio::io_context& io_context,
                        const std::string& stdin_pipe_name_str,
                        const std::string& stdout_pipe_name_str)
     : io_context_(io_context)
+    , strand_(boost::asio::make_strand(io_context))
     , event_stream_(event_stream)
     ,
 #ifdef _WIN32
@@ -123,10 +124,12 @@ void IpcService::start() {
 
     spdlog::info("Pipe communication started");
     boost::asio::co_spawn(
-        io_context_,
-        [&]() -> boost::asio::awaitable<void> {
+        strand_,
+        [this]() -> boost::asio::awaitable<void> {
+            // 前端可从 encodings 中选择消息体编码，默认为 json
             co_await send_message("backend_started",
                                   {{"version", "1.0.0"},
+                                   {"encodings", {"json", "cbor"}},
                                    {"platform",
 #ifdef _WIN32
                                     "windows"
@@ -140,7 +143,7 @@ void IpcService::start() {
         boost::asio::detached);
 
     // 启动读取消息的协程
-    boost::asio::co_spawn(io_context_, read_message_loop(), [](std::exception_ptr e) {
+    boost::asio::co_spawn(strand_, read_message_loop(), [](std::exception_ptr e) {
         if (e) {
             try {
                 std::rethrow_exception(e);
@@ -150,7 +153,7 @@ void IpcService::start() {
         }
     });
 
-    boost::asio::co_spawn(io_context_, read_event_stream_loop(), [](std::exception_ptr e) {
+    boost::asio::co_spawn(strand_, read_event_stream_loop(), [](std::exception_ptr e) {
         if (e) {
             try {
                 std::rethrow_exception(e);
@@ -167,41 +170,65 @@ void IpcService::register_handler(const std::string& message_type, MessageHandle
 
 boost::asio::awaitable<void> IpcService::send_message(const std::string& type,
                                                       const nlohmann::json& data) {
-    // 使用互斥锁确保对管道的写入是同步的
-    std::unique_lock<std::mutex> lock(write_mutex_);
-
     try {
-        // 准备消息
-        nlohmann::json message = {{"feedback", type},
-                                  {"data", data},
-                                  {"timestamp",
-                                   std::chrono::system_clock::now().time_since_epoch().count()}};
-
-        std::string message_str = message.dump();
-
-        spdlog::debug("Sending message: {}", message_str);
-
-        // 写入消息长度（4字节）
-        uint32_t length = static_cast<uint32_t>(message_str.size());
-        uint32_t length_be = boost::endian::native_to_big(length);
+        enqueue_message(type, data);
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to encode message: {}", e.what());
+        co_return;
+    }
+    co_await flush_messages();
+}
 
-        // 发送长度
-        co_await boost::asio::async_write(output_,
-                                          boost::asio::buffer(&length_be, sizeof(length_be)),
-                                          boost::asio::use_awaitable);
+void IpcService::enqueue_message(const std::string& type, const nlohmann::json& data) {
+    // 准备消息
+    nlohmann::json message = {{"feedback", type},
+                              {"data", data},
+                              {"timestamp",
+                               std::chrono::system_clock::now().time_since_epoch().count()}};
+
+    std::string body;
+    if (encoding_ == Encoding::kCbor) {
+        nlohmann::json::to_cbor(message, body);
+    } else {
+        body = message.dump();
+        spdlog::debug("Sending message: {}", body);
+    }
 
-        // 发送消息内容
-        co_await boost::asio::async_write(output_,
-                                          boost::asio::buffer(message_str),
-                                          boost::asio::use_awaitable);
+    // 消息长度（4字节，大端序）与消息内容组成一帧
+    uint32_t length = static_cast<uint32_t>(body.size());
+    uint32_t length_be = boost::endian::native_to_big(length);
 
-        // 确保输出刷新
-        std::cout.flush();
+    std::string frame(sizeof(length_be) + body.size(), '\0');
+    std::memcpy(frame.data(), &length_be, sizeof(length_be));
+    std::memcpy(frame.data() + sizeof(length_be), body.data(), body.size());
+    write_queue_.emplace_back(std::move(frame));
+}
 
-        spdlog::debug("Message sent successfully: {}", type);
+boost::asio::awaitable<void> IpcService::flush_messages() {
+    // 已有协程在写管道时，由它负责写出队列中剩余的帧
+    // 协程都运行在 strand_ 上，不需要互斥锁
+    if (writing_) {
+        co_return;
+    }
+    writing_ = true;
+    try {
+        while (!write_queue_.empty()) {
+            // 积压的帧通过一次聚集写（gather write）写出
+            std::deque<std::string> batch;
+            batch.swap(write_queue_);
+            std::vector<boost::asio::const_buffer> buffers;
+            buffers.reserve(batch.size());
+            for (const auto& frame : batch) {
+                buffers.emplace_back(boost::asio::buffer(frame));
+            }
+            co_await boost::asio::async_write(output_, buffers, boost::asio::use_awaitable);
+            spdlog::debug("{} message(s) sent successfully", batch.size());
+        }
     } catch (const std::exception& e) {
+        write_queue_.clear();
         spdlog::error("Failed to send message: {}", e.what());
     }
+    writing_ = false;
 }
 
 boost::asio::awaitable<void> IpcService::read_message_loop() {
@@ -366,52 +393,29 @@ boost::asio::awaitable<void> IpcService::read_event_stream_loop() {
     spdlog::info("Starting read event stream loop");
 
     while (running_) {
-        try {
-            // 添加短暂延迟，避免CPU占用过高
-            auto executor = co_await boost::asio::this_coro::executor;
-            co_await boost::asio::steady_timer(executor, std::chrono::milliseconds(10))
-                .async_wait(boost::asio::use_awaitable);
-
-            auto feedback = event_stream_.PollFeedback();
-            if (!feedback) {
-                continue;
-            }
-
-            // 直接使用枚举类型对应的字符串，而不是序列化枚举值
-            std::string feedback_type;
-            nlohmann::json j = feedback->type;
-            j.get_to(feedback_type);
-
-            nlohmann::json data = feedback->data;
-
-            // 获取通知类型名称
-            spdlog::debug("Processing feedback: {}", feedback_type);
+        // 没有通知时挂起，被唤醒后一次取出所有积压的通知
+        auto feedbacks = co_await event_stream_.WaitFeedbacks();
+        if (feedbacks.empty()) {
+            // 事件流已关闭
+            break;
+        }
 
-            // 尝试发送通知
-            bool send_success = false;
+        for (const auto& feedback : feedbacks) {
             try {
-                co_await send_message(feedback_type, data);
-                send_success = true;
-            } catch (const std::exception& send_ex) {
-                spdlog::error("Error sending feedback: {}", send_ex.what());
-                // 在catch块中不能使用co_await，所以只记录错误
-            }
+                // 直接使用枚举类型对应的字符串，而不是序列化枚举值
+                std::string feedback_type;
+                nlohmann::json j = feedback.type;
+                j.get_to(feedback_type);
 
-            // 如果发送失败，添加延迟
-            if (!send_success) {
-                auto executor = co_await boost::asio::this_coro::executor;
-                co_await boost::asio::steady_timer(executor, std::chrono::milliseconds(100))
-                    .async_wait(boost::asio::use_awaitable);
+                // 获取通知类型名称
+                spdlog::debug("Processing feedback: {}", feedback_type);
+
+                enqueue_message(feedback_type, feedback.data);
+            } catch (const std::exception& e) {
+                spdlog::error("Error encoding feedback: {}", e.what());
             }
-        } catch (const std::exception& e) {
-            spdlog::error("Error reading event stream: {}", e.what());
-            // 在catch块外添加延迟
         }
-
-        // 每次循环后添加短暂延迟，无论是否出错
-        auto executor = co_await boost::asio::this_coro::executor;
-        co_await boost::asio::steady_timer(executor, std::chrono::milliseconds(100))
-            .async_wait(boost::asio::use_awaitable);
+        co_await flush_messages();
     }
     spdlog::info("Exiting read event stream loop");
 }
@@ -422,8 +426,10 @@ boost::asio::awaitable<void> IpcService::handle_message(const std::string& messa
     std::string error_message;
 
     try {
-        // 解析JSON消息
-        nlohmann::json message = nlohmann::json::parse(message_str);
+        // JSON 消息以 '{' 开头，否则按 CBOR 解析
+        nlohmann::json message = !message_str.empty() && message_str.front() != '{'
+                                     ? nlohmann::json::from_cbor(message_str)
+                                     : nlohmann::json::parse(message_str);
 
         // 获取消息类型
         if (!message.contains("operation") || !message["operation"].is_string()) {
@@ -431,6 +437,16 @@ boost::asio::awaitable<void> IpcService::handle_message(const std::string& messa
             co_return;
         }
 
+        // 编码协商属于传输层，不交给 IpcEventStream
+        if (message["operation"] == "SelectEncoding") {
+            std::string encoding = message["data"].is_object()
+                                       ? message["data"].value("encoding", "json")
+                                       : "json";
+            encoding_ = encoding == "cbor" ? Encoding::kCbor : Encoding::kJson;
+            spdlog::info("IPC messages are encoded as {}", encoding == "cbor" ? "cbor" : "json");
+            co_return;
+        }
+
         event_stream_.PostOperation(Operation(message["operation"], message["data"]));
 
     } catch (const std::exception& e) {
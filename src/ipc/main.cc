@@ -1,11 +1,16 @@
+#include <algorithm>
 #include <boost/asio/io_context.hpp>
 #include <core/constant/path.h>
 #include <core/security/open_ssl_provider.h>
+#include <core/util/compute_pool.h>
 #include <core/util/config.h>
 #include <core/util/logger.h>
+#include <core/util/memory_governor.h>
 #include <ipc/ipc_backend_service.h>
 #include <ipc/ipc_event_stream.h>
 #include <ipc/ipc_service.h>
+#include <thread>
+#include <vector>
 
 using namespace lansend;
 using namespace lansend::core;
@@ -36,17 +41,34 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    net::io_context ioc;
-    ipc::IpcEventStream event_stream;
+    unsigned int thread_count = settings.worker_threads;
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    net::io_context ioc(static_cast<int>(thread_count));
+    ipc::IpcEventStream event_stream(ioc.get_executor());
     ipc::IpcService ipc_service(ioc, event_stream, stdin_pipe_name, stdout_pipe_name);
     ipc::IpcBackendService backend_service(ioc, event_stream);
 
-    spdlog::info("lansend ipc backend started");
+    spdlog::info("lansend ipc backend started with {} worker thread(s)", thread_count);
 
     ipc_service.start();     // communication with Electron
     backend_service.Start(); // core service
 
+    // Connections, sessions and the IPC service each run on their own strand,
+    // the main thread is one of the workers
+    std::vector<std::thread> workers;
+    workers.reserve(thread_count - 1);
+    for (unsigned int i = 1; i < thread_count; ++i) {
+        workers.emplace_back([&ioc]() { ioc.run(); });
+    }
     ioc.run();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    ComputePool::Shutdown();
+    MemoryGovernor::LogStats();
 
     SaveConfig();
 }
\ No newline at end of file
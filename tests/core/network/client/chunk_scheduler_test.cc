@@ -0,0 +1,178 @@
+#include <core/constant/transfer.h>
+#include <core/network/client/chunk_scheduler.h>
+#include <gtest/gtest.h>
+#include <limits>
+#include <vector>
+
+namespace lansend::core {
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr std::size_t kChunkSize = 1024 * 1024;
+constexpr std::size_t kNoCreditLimit = std::numeric_limits<std::size_t>::max();
+
+// Sends total_chunks over paths of the given speeds (chunks per second), each path pulling its
+// next chunk as soon as it is free. Returns the seconds the file took.
+double Simulate(ChunkScheduler& scheduler,
+                const std::vector<double>& chunks_per_second,
+                std::size_t total_chunks) {
+    struct InFlight {
+        std::size_t chunk;
+        double done_at;
+    };
+    std::vector<std::optional<InFlight>> in_flight(chunks_per_second.size());
+    double now = 0;
+    scheduler.StartFile(total_chunks);
+    while (!scheduler.Finished()) {
+        for (std::size_t path = 0; path < in_flight.size(); ++path) {
+            if (!in_flight[path]) {
+                if (auto chunk = scheduler.Take(path, kNoCreditLimit)) {
+                    in_flight[path] = InFlight{*chunk, now + 1 / chunks_per_second[path]};
+                }
+            }
+        }
+        std::size_t next = in_flight.size();
+        for (std::size_t path = 0; path < in_flight.size(); ++path) {
+            if (in_flight[path] && (next == in_flight.size()
+                                    || in_flight[path]->done_at < in_flight[next]->done_at)) {
+                next = path;
+            }
+        }
+        if (next == in_flight.size()) {
+            ADD_FAILURE() << "No path took a chunk";
+            break;
+        }
+        now = in_flight[next]->done_at;
+        std::chrono::duration<double> elapsed(1 / chunks_per_second[next]);
+        scheduler.ChunkSent(next, kChunkSize, 1, elapsed);
+        in_flight[next].reset();
+    }
+    return now;
+}
+
+TEST(ChunkSchedulerTest, SinglePathTakesEveryChunkInOrder) {
+    ChunkScheduler scheduler(1);
+    scheduler.StartFile(3);
+    for (std::size_t chunk = 0; chunk < 3; ++chunk) {
+        EXPECT_EQ(scheduler.Take(0, kNoCreditLimit), chunk);
+        scheduler.ChunkSent(0, kChunkSize, 1, 10ms);
+    }
+    EXPECT_FALSE(scheduler.Take(0, kNoCreditLimit));
+    EXPECT_TRUE(scheduler.Finished());
+    EXPECT_FALSE(scheduler.Failed());
+    EXPECT_EQ(scheduler.Completed(), 3u);
+    EXPECT_EQ(scheduler.Path(0).chunks_sent, 3u);
+}
+
+TEST(ChunkSchedulerTest, CreditsCapChunksInFlight) {
+    ChunkScheduler scheduler(2);
+    scheduler.StartFile(10);
+    EXPECT_TRUE(scheduler.Take(0, 2));
+    EXPECT_TRUE(scheduler.Take(1, 2));
+    EXPECT_FALSE(scheduler.Take(0, 2));
+    scheduler.ChunkSent(1, kChunkSize, 1, 10ms);
+    EXPECT_TRUE(scheduler.Take(0, 2));
+}
+
+TEST(ChunkSchedulerTest, ThroughputIsMovingAverage) {
+    ChunkScheduler scheduler(1);
+    scheduler.StartFile(2);
+    scheduler.Take(0, kNoCreditLimit);
+    scheduler.ChunkSent(0, kChunkSize, 4, 1s);
+    EXPECT_DOUBLE_EQ(scheduler.Path(0).throughput, 4.0 * kChunkSize);
+    scheduler.Take(0, kNoCreditLimit);
+    scheduler.ChunkSent(0, kChunkSize, 1, 1s);
+    EXPECT_DOUBLE_EQ(scheduler.Path(0).throughput, (0.7 * 4 + 0.3) * kChunkSize);
+}
+
+TEST(ChunkSchedulerTest, SharesChunksInProportionToThroughput) {
+    ChunkScheduler scheduler(3);
+    double seconds = Simulate(scheduler, {100, 50, 10}, 1600);
+    EXPECT_EQ(scheduler.Completed(), 1600u);
+
+    // 1600 chunks at 160 chunks per second
+    EXPECT_NEAR(static_cast<double>(scheduler.Path(0).chunks_sent), 1000, 20);
+    EXPECT_NEAR(static_cast<double>(scheduler.Path(1).chunks_sent), 500, 20);
+    EXPECT_NEAR(static_cast<double>(scheduler.Path(2).chunks_sent), 100, 20);
+    EXPECT_LT(seconds, 10.2);
+}
+
+TEST(ChunkSchedulerTest, SlowPathLeavesLastChunksToFasterPaths) {
+    ChunkScheduler scheduler(2);
+    Simulate(scheduler, {100, 1}, 200);
+    auto slow_chunks = scheduler.Path(1).chunks_sent;
+
+    // Once the fast path's throughput is known, the slow one only takes a chunk while the
+    // fast one has more than 100 left. One chunk more would hold the file up by a second.
+    Simulate(scheduler, {100, 1}, 50);
+    EXPECT_EQ(scheduler.Path(1).chunks_sent, slow_chunks);
+    EXPECT_EQ(scheduler.Path(0).chunks_sent, 250 - slow_chunks);
+}
+
+TEST(ChunkSchedulerTest, PathsKeepTheirStatsAcrossFiles) {
+    ChunkScheduler scheduler(2);
+    scheduler.StartFile(1);
+    auto chunk = scheduler.Take(1, kNoCreditLimit);
+    ASSERT_TRUE(chunk);
+    scheduler.ChunkFailed(1, *chunk);
+    scheduler.Take(0, kNoCreditLimit);
+    scheduler.ChunkSent(0, kChunkSize, 1, 10ms);
+
+    scheduler.StartFile(1);
+    EXPECT_TRUE(scheduler.Path(1).failed);
+    EXPECT_FALSE(scheduler.Take(1, kNoCreditLimit));
+    EXPECT_EQ(scheduler.Take(0, kNoCreditLimit), 0u);
+    EXPECT_EQ(scheduler.Path(0).chunks_sent, 1u);
+}
+
+TEST(ChunkSchedulerTest, FailedChunkMovesToAnotherPath) {
+    ChunkScheduler scheduler(2);
+    scheduler.StartFile(4);
+    EXPECT_EQ(scheduler.Take(0, kNoCreditLimit), 0u);
+    EXPECT_EQ(scheduler.Take(1, kNoCreditLimit), 1u);
+
+    scheduler.ChunkFailed(1, 1);
+    EXPECT_TRUE(scheduler.Path(1).failed);
+    EXPECT_FALSE(scheduler.Path(0).failed);
+    EXPECT_FALSE(scheduler.Failed());
+    EXPECT_FALSE(scheduler.Take(1, kNoCreditLimit));
+
+    // The failed chunk goes first, then the rest in order
+    scheduler.ChunkSent(0, kChunkSize, 1, 10ms);
+    std::vector<std::size_t> order;
+    while (auto chunk = scheduler.Take(0, kNoCreditLimit)) {
+        order.push_back(*chunk);
+        scheduler.ChunkSent(0, kChunkSize, 1, 10ms);
+    }
+    EXPECT_EQ(order, (std::vector<std::size_t>{1, 2, 3}));
+    EXPECT_TRUE(scheduler.Finished());
+    EXPECT_FALSE(scheduler.Failed());
+    EXPECT_EQ(scheduler.Completed(), 4u);
+}
+
+TEST(ChunkSchedulerTest, FileFailsAfterMaxAttempts) {
+    ChunkScheduler scheduler(transfer::kMaxChunkAttempts + 1);
+    scheduler.StartFile(2);
+    for (std::size_t path = 0; path < transfer::kMaxChunkAttempts; ++path) {
+        EXPECT_FALSE(scheduler.Failed());
+        ASSERT_EQ(scheduler.Take(path, kNoCreditLimit), 0u);
+        scheduler.ChunkFailed(path, 0);
+    }
+    EXPECT_TRUE(scheduler.Failed());
+    EXPECT_TRUE(scheduler.Finished());
+    EXPECT_FALSE(scheduler.Take(transfer::kMaxChunkAttempts, kNoCreditLimit));
+}
+
+TEST(ChunkSchedulerTest, AbandonFailsTheFile) {
+    ChunkScheduler scheduler(1);
+    scheduler.StartFile(2);
+    auto chunk = scheduler.Take(0, kNoCreditLimit);
+    scheduler.Abandon(chunk);
+    EXPECT_TRUE(scheduler.Failed());
+    EXPECT_TRUE(scheduler.Finished());
+    EXPECT_FALSE(scheduler.Path(0).failed);
+}
+
+} // namespace
+} // namespace lansend::core
@@ -0,0 +1,92 @@
+#include <core/network/discovery/beacon.h>
+#include <gtest/gtest.h>
+#include <string>
+
+namespace lansend::core {
+namespace {
+
+Beacon MakeBeacon() {
+    Beacon beacon;
+    beacon.type = BroadcastType::kAnnounce;
+    beacon.device_id = "8c5e1f0a-6a43-4b8e-9d51-2f0c3b7e9a10";
+    beacon.port = 56789;
+    beacon.info_version = 0x01020304;
+    beacon.fingerprint_digest = FingerprintDigest("00112233445566778899aabbccddeeff");
+    return beacon;
+}
+
+TEST(BeaconTest, RoundTrip) {
+    for (auto type : {BroadcastType::kAnnounce, BroadcastType::kQuery, BroadcastType::kGoodbye}) {
+        auto beacon = MakeBeacon();
+        beacon.type = type;
+        auto decoded = DecodeBeacon(EncodeBeacon(beacon));
+        ASSERT_TRUE(decoded);
+        EXPECT_EQ(decoded->type, beacon.type);
+        EXPECT_EQ(decoded->device_id, beacon.device_id);
+        EXPECT_EQ(decoded->port, beacon.port);
+        EXPECT_EQ(decoded->info_version, beacon.info_version);
+        EXPECT_EQ(decoded->fingerprint_digest, beacon.fingerprint_digest);
+    }
+}
+
+TEST(BeaconTest, EncodesBigEndianHeader) {
+    auto data = EncodeBeacon(MakeBeacon());
+    ASSERT_EQ(data.size(), 19 + MakeBeacon().device_id.size());
+    EXPECT_EQ(data.substr(0, 2), "LS");
+    EXPECT_EQ(static_cast<unsigned char>(data[2]), Beacon::kFormat);
+    EXPECT_EQ(static_cast<unsigned char>(data[4]), 0xdd); // 56789 = 0xddd5
+    EXPECT_EQ(static_cast<unsigned char>(data[5]), 0xd5);
+    EXPECT_EQ(static_cast<unsigned char>(data[6]), 0x01);
+    EXPECT_EQ(static_cast<unsigned char>(data[9]), 0x04);
+    EXPECT_EQ(static_cast<unsigned char>(data[10]), 0x00);
+    EXPECT_EQ(static_cast<unsigned char>(data[17]), 0x77);
+}
+
+TEST(BeaconTest, TruncatesLongDeviceId) {
+    auto beacon = MakeBeacon();
+    beacon.device_id = std::string(300, 'x');
+    auto decoded = DecodeBeacon(EncodeBeacon(beacon));
+    ASSERT_TRUE(decoded);
+    EXPECT_EQ(decoded->device_id.size(), Beacon::kMaxDeviceIdSize);
+}
+
+TEST(BeaconTest, RejectsJsonBeacon) {
+    EXPECT_FALSE(DecodeBeacon(R"({"type":"announce","device_info":{}})"));
+}
+
+TEST(BeaconTest, RejectsMalformedBeacons) {
+    auto data = EncodeBeacon(MakeBeacon());
+
+    EXPECT_FALSE(DecodeBeacon(""));
+    EXPECT_FALSE(DecodeBeacon(data.substr(0, 18))); // Shorter than the header
+    EXPECT_FALSE(DecodeBeacon(data.substr(0, data.size() - 1)));
+    EXPECT_FALSE(DecodeBeacon(data + "x"));
+
+    auto bad_magic = data;
+    bad_magic[1] = 'X';
+    EXPECT_FALSE(DecodeBeacon(bad_magic));
+
+    auto bad_format = data;
+    bad_format[2] = Beacon::kFormat + 1;
+    EXPECT_FALSE(DecodeBeacon(bad_format));
+
+    auto bad_type = data;
+    bad_type[3] = static_cast<char>(static_cast<std::uint8_t>(BroadcastType::kGoodbye) + 1);
+    EXPECT_FALSE(DecodeBeacon(bad_type));
+
+    auto empty_id = MakeBeacon();
+    empty_id.device_id.clear();
+    EXPECT_FALSE(DecodeBeacon(EncodeBeacon(empty_id)));
+}
+
+TEST(BeaconTest, FingerprintDigest) {
+    auto digest = FingerprintDigest("0123456789ABCDEFffffffff");
+    EXPECT_EQ(digest,
+              (std::array<std::uint8_t, 8>{0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef}));
+    // A short fingerprint leaves the rest zero
+    EXPECT_EQ(FingerprintDigest("ab"), (std::array<std::uint8_t, 8>{0xab}));
+    EXPECT_NE(FingerprintDigest("00"), FingerprintDigest("01"));
+}
+
+} // namespace
+} // namespace lansend::core
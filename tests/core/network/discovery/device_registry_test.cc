@@ -0,0 +1,190 @@
+#include <core/network/discovery/device_registry.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace lansend::core {
+namespace {
+
+using Clock = DeviceRegistry::Clock;
+
+DeviceInfo MakeDevice() {
+    DeviceInfo device;
+    device.device_id = "device";
+    device.hostname = "host";
+    device.operating_system = "linux";
+    device.ip_address = "192.168.1.2";
+    device.port = 56789;
+    device.addresses = {{.ip_address = "192.168.1.2", .link_speed_mbps = 1000},
+                        {.ip_address = "10.0.0.2", .link_speed_mbps = 100}};
+    return device;
+}
+
+DeviceInfo MakeDevice(const std::string& device_id, const std::string& ip_address) {
+    auto device = MakeDevice();
+    device.device_id = device_id;
+    device.ip_address = ip_address;
+    return device;
+}
+
+std::vector<std::string> Ids(const std::vector<DeviceInfo>& devices) {
+    std::vector<std::string> ids;
+    for (const auto& device : devices) {
+        ids.push_back(device.device_id);
+    }
+    return ids;
+}
+
+TEST(DeviceRegistryTest, SameInfoIsNoChange) {
+    DeviceRegistry registry;
+    auto expires_at = Clock::now() + std::chrono::seconds(10);
+    EXPECT_EQ(registry.Upsert(MakeDevice(), expires_at), DeviceRegistry::Change::kAdded);
+    auto version = registry.Version();
+    EXPECT_EQ(registry.Upsert(MakeDevice(), expires_at), DeviceRegistry::Change::kNone);
+    EXPECT_EQ(registry.Version(), version);
+}
+
+TEST(DeviceRegistryTest, AddedAddressIsUpdate) {
+    DeviceRegistry registry;
+    auto expires_at = Clock::now() + std::chrono::seconds(10);
+    registry.Upsert(MakeDevice(), expires_at);
+
+    auto device = MakeDevice();
+    device.addresses.push_back({.ip_address = "172.16.0.2", .link_speed_mbps = 2500});
+    EXPECT_EQ(registry.Upsert(device, expires_at), DeviceRegistry::Change::kUpdated);
+    ASSERT_NE(registry.Find("device"), nullptr);
+    EXPECT_EQ(registry.Find("device")->addresses.size(), 3u);
+
+    auto delta = registry.Changes(1);
+    ASSERT_EQ(delta.upserted.size(), 1u);
+    EXPECT_EQ(delta.upserted[0].addresses.size(), 3u);
+}
+
+TEST(DeviceRegistryTest, ChangedAddressIsUpdate) {
+    DeviceRegistry registry;
+    auto expires_at = Clock::now() + std::chrono::seconds(10);
+    registry.Upsert(MakeDevice(), expires_at);
+
+    auto device = MakeDevice();
+    device.addresses[1].ip_address = "10.0.0.3";
+    EXPECT_EQ(registry.Upsert(device, expires_at), DeviceRegistry::Change::kUpdated);
+    EXPECT_EQ(registry.Find("device")->addresses[1].ip_address, "10.0.0.3");
+}
+
+TEST(DeviceRegistryTest, ChangedLinkSpeedIsUpdate) {
+    DeviceRegistry registry;
+    auto expires_at = Clock::now() + std::chrono::seconds(10);
+    registry.Upsert(MakeDevice(), expires_at);
+
+    auto device = MakeDevice();
+    device.addresses[0].link_speed_mbps = 10000;
+    EXPECT_EQ(registry.Upsert(device, expires_at), DeviceRegistry::Change::kUpdated);
+    EXPECT_EQ(registry.Find("device")->addresses[0].link_speed_mbps, 10000u);
+}
+
+TEST(DeviceRegistryTest, RemovedAddressIsUpdate) {
+    DeviceRegistry registry;
+    auto expires_at = Clock::now() + std::chrono::seconds(10);
+    registry.Upsert(MakeDevice(), expires_at);
+
+    auto device = MakeDevice();
+    device.addresses.pop_back();
+    EXPECT_EQ(registry.Upsert(device, expires_at), DeviceRegistry::Change::kUpdated);
+    EXPECT_EQ(registry.Find("device")->addresses.size(), 1u);
+}
+
+TEST(DeviceRegistryTest, ExpiresInDeadlineOrder) {
+    DeviceRegistry registry;
+    auto now = Clock::now();
+    registry.Upsert(MakeDevice("c", "192.168.1.3"), now + std::chrono::seconds(3));
+    registry.Upsert(MakeDevice("a", "192.168.1.4"), now + std::chrono::seconds(1));
+    registry.Upsert(MakeDevice("b", "192.168.1.5"), now + std::chrono::seconds(2));
+    EXPECT_EQ(registry.NextExpiry(), now + std::chrono::seconds(1));
+
+    EXPECT_TRUE(registry.Expire(now).empty());
+    EXPECT_EQ(Ids(registry.Expire(now + std::chrono::seconds(2))),
+              (std::vector<std::string>{"a", "b"}));
+    EXPECT_EQ(registry.Size(), 1u);
+    EXPECT_EQ(registry.NextExpiry(), now + std::chrono::seconds(3));
+
+    EXPECT_EQ(Ids(registry.Expire(now + std::chrono::seconds(3))),
+              (std::vector<std::string>{"c"}));
+    EXPECT_EQ(registry.NextExpiry(), std::nullopt);
+}
+
+TEST(DeviceRegistryTest, RefreshMovesTheDeadline) {
+    DeviceRegistry registry;
+    auto now = Clock::now();
+    registry.Upsert(MakeDevice(), now + std::chrono::seconds(1), 7);
+    EXPECT_TRUE(registry.Refresh("device", 7, now + std::chrono::seconds(5)));
+    EXPECT_FALSE(registry.Refresh("device", 8, now + std::chrono::seconds(9))); // Info changed
+    EXPECT_FALSE(registry.Refresh("unknown", 7, now + std::chrono::seconds(9)));
+
+    // The old deadline surfaces and is pushed back to the refreshed one
+    EXPECT_TRUE(registry.Expire(now + std::chrono::seconds(2)).empty());
+    EXPECT_NE(registry.Find("device"), nullptr);
+    EXPECT_EQ(registry.NextExpiry(), now + std::chrono::seconds(5));
+
+    // A refresh never brings the deadline forward
+    EXPECT_TRUE(registry.Refresh("device", 7, now + std::chrono::seconds(3)));
+    EXPECT_TRUE(registry.Expire(now + std::chrono::seconds(4)).empty());
+    EXPECT_EQ(Ids(registry.Expire(now + std::chrono::seconds(5))),
+              (std::vector<std::string>{"device"}));
+    EXPECT_EQ(registry.Size(), 0u);
+}
+
+TEST(DeviceRegistryTest, RemovedDeviceDeadlineIsDropped) {
+    DeviceRegistry registry;
+    auto now = Clock::now();
+    registry.Upsert(MakeDevice(), now + std::chrono::seconds(1));
+    ASSERT_TRUE(registry.Remove("device"));
+    EXPECT_FALSE(registry.Remove("device"));
+
+    // Seen again, the deadline of the removed namesake does not expire it
+    registry.Upsert(MakeDevice(), now + std::chrono::seconds(5));
+    EXPECT_TRUE(registry.Expire(now + std::chrono::seconds(2)).empty());
+    EXPECT_NE(registry.Find("device"), nullptr);
+    EXPECT_EQ(Ids(registry.Expire(now + std::chrono::seconds(5))),
+              (std::vector<std::string>{"device"}));
+}
+
+TEST(DeviceRegistryTest, FindByEndpointAfterRemove) {
+    DeviceRegistry registry;
+    auto expires_at = Clock::now() + std::chrono::seconds(10);
+    registry.Upsert(MakeDevice(), expires_at);
+    ASSERT_NE(registry.FindByEndpoint("192.168.1.2", 56789), nullptr);
+    EXPECT_EQ(registry.FindByEndpoint("192.168.1.2", 56789)->device_id, "device");
+    EXPECT_EQ(registry.FindByEndpoint("192.168.1.2", 56790), nullptr);
+
+    registry.Remove("device");
+    EXPECT_EQ(registry.FindByEndpoint("192.168.1.2", 56789), nullptr);
+}
+
+TEST(DeviceRegistryTest, FindByEndpointAfterExpire) {
+    DeviceRegistry registry;
+    auto now = Clock::now();
+    registry.Upsert(MakeDevice(), now + std::chrono::seconds(1));
+    registry.Expire(now + std::chrono::seconds(1));
+    EXPECT_EQ(registry.FindByEndpoint("192.168.1.2", 56789), nullptr);
+}
+
+TEST(DeviceRegistryTest, FindByEndpointAfterReaddressing) {
+    DeviceRegistry registry;
+    auto expires_at = Clock::now() + std::chrono::seconds(10);
+    registry.Upsert(MakeDevice(), expires_at);
+
+    auto device = MakeDevice();
+    device.ip_address = "192.168.1.9";
+    device.port = 56790;
+    EXPECT_EQ(registry.Upsert(device, expires_at), DeviceRegistry::Change::kUpdated);
+    EXPECT_EQ(registry.FindByEndpoint("192.168.1.2", 56789), nullptr);
+    ASSERT_NE(registry.FindByEndpoint("192.168.1.9", 56790), nullptr);
+    EXPECT_EQ(registry.FindByEndpoint("192.168.1.9", 56790)->device_id, "device");
+
+    // Removing it clears the new endpoint, not just the one it was added under
+    registry.Remove("device");
+    EXPECT_EQ(registry.FindByEndpoint("192.168.1.9", 56790), nullptr);
+}
+
+} // namespace
+} // namespace lansend::core
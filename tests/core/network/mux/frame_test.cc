@@ -0,0 +1,88 @@
+#include <core/network/mux/frame.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace lansend::core {
+namespace {
+
+std::optional<FrameHeader> Decode(const std::vector<std::uint8_t>& frame) {
+    return DecodeFrameHeader(std::span(frame).first<mux::kFrameHeaderSize>());
+}
+
+std::vector<std::uint8_t> Header(std::uint32_t length, std::uint8_t type) {
+    std::vector<std::uint8_t> frame(mux::kFrameHeaderSize);
+    frame[0] = static_cast<std::uint8_t>(length >> 24);
+    frame[1] = static_cast<std::uint8_t>(length >> 16);
+    frame[2] = static_cast<std::uint8_t>(length >> 8);
+    frame[3] = static_cast<std::uint8_t>(length);
+    frame[4] = type;
+    return frame;
+}
+
+TEST(MuxFrameTest, RoundTrip) {
+    std::vector<std::uint8_t> payload{'G', 'E', 'T', ' ', '/'};
+    auto frame = EncodeFrame(FrameType::kHeaders, kEndStream, 0x01020305, payload);
+    ASSERT_EQ(frame.size(), mux::kFrameHeaderSize + payload.size());
+    EXPECT_EQ(frame[3], payload.size());
+    EXPECT_EQ(frame[6], 0x01);
+    EXPECT_EQ(frame[9], 0x05);
+    EXPECT_EQ(std::vector<std::uint8_t>(frame.begin() + mux::kFrameHeaderSize, frame.end()),
+              payload);
+
+    auto header = Decode(frame);
+    ASSERT_TRUE(header);
+    EXPECT_EQ(header->length, payload.size());
+    EXPECT_EQ(header->type, FrameType::kHeaders);
+    EXPECT_EQ(header->flags, kEndStream);
+    EXPECT_EQ(header->stream_id, 0x01020305u);
+}
+
+TEST(MuxFrameTest, AcceptsPayloadsUpToTheTypeLimit) {
+    EXPECT_TRUE(Decode(Header(mux::kMaxDataFrameSize, 2)));
+    EXPECT_TRUE(Decode(Header(mux::kMaxControlFrameSize, 1)));
+    EXPECT_TRUE(Decode(Header(mux::kMaxControlFrameSize, 3)));
+    EXPECT_TRUE(Decode(Header(0, 2)));
+}
+
+TEST(MuxFrameTest, RejectsOversizedPayloads) {
+    EXPECT_FALSE(Decode(Header(mux::kMaxDataFrameSize + 1, 2)));
+    EXPECT_FALSE(Decode(Header(mux::kMaxControlFrameSize + 1, 1)));
+    EXPECT_FALSE(Decode(Header(mux::kMaxControlFrameSize + 1, 3)));
+    EXPECT_FALSE(Decode(Header(5, 4)));
+    EXPECT_FALSE(Decode(Header(2, 5)));
+    EXPECT_FALSE(Decode(Header(0xffffffff, 2)));
+}
+
+TEST(MuxFrameTest, RejectsUnknownTypes) {
+    EXPECT_FALSE(Decode(Header(0, 0)));
+    EXPECT_FALSE(Decode(Header(0, 6)));
+    EXPECT_FALSE(Decode(Header(0, 0xff)));
+}
+
+TEST(MuxFrameTest, WindowUpdate) {
+    auto frame = EncodeWindowUpdate(0, mux::kConnectionWindow);
+    auto header = Decode(frame);
+    ASSERT_TRUE(header);
+    EXPECT_EQ(header->type, FrameType::kWindowUpdate);
+    EXPECT_EQ(header->stream_id, 0u);
+    EXPECT_EQ(DecodeWindowUpdate(std::span(frame).subspan(mux::kFrameHeaderSize)),
+              mux::kConnectionWindow);
+
+    std::vector<std::uint8_t> short_payload{0, 0, 1};
+    std::vector<std::uint8_t> long_payload{0, 0, 0, 1, 0};
+    EXPECT_FALSE(DecodeWindowUpdate(short_payload));
+    EXPECT_FALSE(DecodeWindowUpdate(long_payload));
+}
+
+TEST(MuxFrameTest, Cancel) {
+    auto frame = EncodeCancel(7, CancelCode::kRefused);
+    auto header = Decode(frame);
+    ASSERT_TRUE(header);
+    EXPECT_EQ(header->type, FrameType::kCancel);
+    EXPECT_EQ(header->length, 1u);
+    EXPECT_EQ(header->stream_id, 7u);
+    EXPECT_EQ(frame.back(), static_cast<std::uint8_t>(CancelCode::kRefused));
+}
+
+} // namespace
+} // namespace lansend::core
@@ -0,0 +1,344 @@
+#include <array>
+#include <boost/asio/bind_cancellation_slot.hpp>
+#include <boost/asio/cancellation_signal.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+#include <chrono>
+#include <core/network/mux/frame.h>
+#include <core/network/mux/mux_connection.h>
+#include <core/security/certificate_manager.h>
+#include <core/security/open_ssl_provider.h>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lansend::core {
+namespace {
+
+namespace net = boost::asio;
+namespace ssl = net::ssl;
+namespace beast = boost::beast;
+using tcp = net::ip::tcp;
+
+// Long enough for a few MiB to cross loopback, the credit caps what arrives meanwhile
+constexpr auto kSettle = std::chrono::milliseconds(200);
+
+struct Frame {
+    FrameHeader header;
+    std::vector<std::uint8_t> payload;
+};
+
+std::vector<std::uint8_t> Headers(std::uint32_t stream_id, const std::string& head) {
+    return EncodeFrame(FrameType::kHeaders,
+                       0,
+                       stream_id,
+                       {reinterpret_cast<const std::uint8_t*>(head.data()), head.size()});
+}
+
+// bytes of body in frames of the largest size
+std::vector<std::vector<std::uint8_t>> Data(std::uint32_t stream_id, std::size_t bytes) {
+    std::vector<std::vector<std::uint8_t>> frames;
+    for (std::size_t sent = 0; sent < bytes; sent += mux::kMaxDataFrameSize) {
+        std::vector<std::uint8_t> payload(std::min(bytes - sent, mux::kMaxDataFrameSize), 'x');
+        frames.push_back(EncodeFrame(FrameType::kData, 0, stream_id, payload));
+    }
+    return frames;
+}
+
+// A TLS connection over loopback. One end runs the MuxConnection under test, the test reads
+// and writes raw frames on the other.
+class MuxConnectionTest : public ::testing::Test {
+protected:
+    using Stream = MuxConnection::Stream;
+
+    void SetUp() override {
+        OpenSSLProvider::InitOpenSSL();
+        static CertificateManager certs(std::filesystem::temp_directory_path()
+                                        / "lansend-mux-connection-test");
+        const auto& identity = certs.security_context();
+        server_ctx_.emplace(OpenSSLProvider::BuildServerContext(identity.certificate_pem,
+                                                                identity.private_key_pem));
+        // Who is on the other end does not matter here
+        client_ctx_.emplace(OpenSSLProvider::BuildClientContext(
+            [](bool, ssl::verify_context&) { return true; }));
+        server_.emplace(ioc_, *server_ctx_);
+        client_.emplace(ioc_, *client_ctx_);
+
+        tcp::acceptor acceptor(ioc_, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+        net::co_spawn(
+            ioc_,
+            [&]() -> net::awaitable<void> {
+                co_await acceptor.async_accept(beast::get_lowest_layer(*server_).socket(),
+                                               net::use_awaitable);
+                co_await server_->async_handshake(ssl::stream_base::server, net::use_awaitable);
+            },
+            net::detached);
+        net::co_spawn(
+            ioc_,
+            [&]() -> net::awaitable<void> {
+                co_await beast::get_lowest_layer(*client_).async_connect(acceptor.local_endpoint(),
+                                                                         net::use_awaitable);
+                co_await client_->async_handshake(ssl::stream_base::client, net::use_awaitable);
+            },
+            net::detached);
+        ioc_.run();
+        ioc_.restart();
+    }
+
+    void TearDown() override {
+        if (connection_) {
+            connection_->Close();
+        }
+        beast::get_lowest_layer(*server_).close();
+        beast::get_lowest_layer(*client_).close();
+        settle();
+    }
+
+    // The server end runs the connection, the test is the client
+    void startServer(MuxConnection::StreamHandler handler) {
+        connection_ = std::make_shared<MuxConnection>(*server_, false);
+        start(*client_, std::move(handler));
+    }
+
+    // The client end runs the connection, the test is the server
+    void startClient() {
+        connection_ = std::make_shared<MuxConnection>(*client_, true);
+        start(*server_, nullptr);
+    }
+
+    void settle() {
+        ioc_.run_for(kSettle);
+        ioc_.restart();
+    }
+
+    // Writes the frames in order on the raw end, one send at a time
+    void send(std::vector<std::vector<std::uint8_t>> frames) {
+        net::co_spawn(
+            ioc_,
+            [this, frames = std::move(frames)]() -> net::awaitable<void> {
+                for (const auto& frame : frames) {
+                    co_await net::async_write(*raw_, net::buffer(frame), net::use_awaitable);
+                }
+            },
+            net::detached);
+        settle();
+    }
+
+    // Body bytes received on the stream, or on all of them for stream 0
+    std::size_t dataBytes(std::uint32_t stream_id = 0) const {
+        std::size_t bytes = 0;
+        for (const auto& frame : frames_) {
+            if (frame.header.type == FrameType::kData
+                && (stream_id == 0 || frame.header.stream_id == stream_id)) {
+                bytes += frame.payload.size();
+            }
+        }
+        return bytes;
+    }
+
+    std::vector<std::uint32_t> windowUpdates(std::uint32_t stream_id) const {
+        std::vector<std::uint32_t> increments;
+        for (const auto& frame : frames_) {
+            if (frame.header.type == FrameType::kWindowUpdate
+                && frame.header.stream_id == stream_id) {
+                increments.push_back(*DecodeWindowUpdate(frame.payload));
+            }
+        }
+        return increments;
+    }
+
+    const Frame* findFrame(FrameType type, std::uint32_t stream_id) const {
+        for (const auto& frame : frames_) {
+            if (frame.header.type == type && frame.header.stream_id == stream_id) {
+                return &frame;
+            }
+        }
+        return nullptr;
+    }
+
+    net::io_context ioc_;
+    std::optional<ssl::context> server_ctx_;
+    std::optional<ssl::context> client_ctx_;
+    std::optional<Stream> server_;
+    std::optional<Stream> client_;
+    std::shared_ptr<MuxConnection> connection_;
+    std::exception_ptr run_error_;
+    bool run_returned_ = false;
+
+    Stream* raw_ = nullptr;
+    std::vector<Frame> frames_; // Received on the raw end
+
+private:
+    void start(Stream& raw, MuxConnection::StreamHandler handler) {
+        raw_ = &raw;
+        net::co_spawn(ioc_,
+                      connection_->Run(std::move(handler)),
+                      [this](std::exception_ptr error) {
+                          run_returned_ = true;
+                          run_error_ = error;
+                      });
+        net::co_spawn(ioc_, readFrames(), net::detached);
+    }
+
+    net::awaitable<void> readFrames() {
+        while (true) {
+            std::array<std::uint8_t, mux::kFrameHeaderSize> bytes;
+            co_await net::async_read(*raw_, net::buffer(bytes), net::use_awaitable);
+            Frame frame{.header = *DecodeFrameHeader(bytes)};
+            frame.payload.resize(frame.header.length);
+            co_await net::async_read(*raw_, net::buffer(frame.payload), net::use_awaitable);
+            frames_.push_back(std::move(frame));
+        }
+    }
+};
+
+std::string PostHead(std::size_t content_length) {
+    return "POST /upload HTTP/1.1\r\nContent-Length: " + std::to_string(content_length)
+           + "\r\n\r\n";
+}
+
+TEST_F(MuxConnectionTest, StreamWindowHoldsBackTheWriter) {
+    startClient();
+    std::vector<std::uint8_t> body(3 * mux::kStreamWindow, 'x');
+    net::co_spawn(ioc_, connection_->SendRequest(PostHead(body.size()), body), net::detached);
+    settle();
+
+    ASSERT_NE(findFrame(FrameType::kHeaders, 1), nullptr);
+    EXPECT_EQ(dataBytes(1), mux::kStreamWindow);
+
+    // Exactly the granted credit follows
+    send({EncodeWindowUpdate(1, mux::kStreamWindow / 2)});
+    EXPECT_EQ(dataBytes(1), mux::kStreamWindow + mux::kStreamWindow / 2);
+}
+
+TEST_F(MuxConnectionTest, ConnectionWindowCapsAllStreams) {
+    startClient();
+    constexpr std::size_t kStreams = mux::kConnectionWindow / mux::kStreamWindow + 1;
+    std::vector<std::uint8_t> body(mux::kStreamWindow, 'x');
+    for (std::size_t i = 0; i < kStreams; ++i) {
+        net::co_spawn(ioc_, connection_->SendRequest(PostHead(body.size()), body), net::detached);
+    }
+    settle();
+    EXPECT_EQ(dataBytes(), mux::kConnectionWindow);
+
+    // Every stream still has credit of its own, the connection's was the limit
+    send({EncodeWindowUpdate(0, mux::kStreamWindow)});
+    EXPECT_EQ(dataBytes(), mux::kConnectionWindow + mux::kStreamWindow);
+}
+
+TEST_F(MuxConnectionTest, ReadingHandsCreditBack) {
+    std::vector<std::shared_ptr<MuxStream>> streams; // Kept open, the bodies never end
+    startServer([&](std::shared_ptr<MuxStream> stream) -> net::awaitable<void> {
+        streams.push_back(stream);
+        std::vector<std::uint8_t> buffer(64 * 1024);
+        while (co_await stream->ReadSome(buffer) > 0) {
+        }
+    });
+
+    // Two full stream windows are half the connection's, its credit comes back in one update
+    for (std::uint32_t stream_id : {1u, 3u}) {
+        auto frames = Data(stream_id, mux::kStreamWindow);
+        frames.insert(frames.begin(), Headers(stream_id, PostHead(2 * mux::kStreamWindow)));
+        send(std::move(frames));
+    }
+    EXPECT_EQ(streams.size(), 2u);
+    EXPECT_EQ(windowUpdates(0), std::vector<std::uint32_t>{2 * mux::kStreamWindow});
+
+    // Stream credit is batched, at least half a window at a time
+    for (std::uint32_t stream_id : {1u, 3u}) {
+        auto increments = windowUpdates(stream_id);
+        ASSERT_FALSE(increments.empty());
+        for (auto increment : increments) {
+            EXPECT_GE(increment, mux::kStreamWindow / 2);
+        }
+    }
+}
+
+TEST_F(MuxConnectionTest, OverrunningTheStreamWindowFailsTheConnection) {
+    startServer([](std::shared_ptr<MuxStream>) -> net::awaitable<void> { co_return; });
+    auto frames = Data(1, mux::kStreamWindow + 1);
+    frames.insert(frames.begin(), Headers(1, PostHead(2 * mux::kStreamWindow)));
+    send(std::move(frames));
+
+    ASSERT_TRUE(run_returned_);
+    ASSERT_TRUE(run_error_);
+    try {
+        std::rethrow_exception(run_error_);
+    } catch (const boost::system::system_error& e) {
+        EXPECT_EQ(e.code(), boost::system::errc::protocol_error);
+    }
+}
+
+TEST_F(MuxConnectionTest, PeerCancelAbortsTheHandler) {
+    std::optional<boost::system::error_code> handler_error;
+    startServer([&](std::shared_ptr<MuxStream> stream) -> net::awaitable<void> {
+        std::vector<std::uint8_t> buffer(1024);
+        try {
+            co_await stream->ReadSome(buffer);
+        } catch (const boost::system::system_error& e) {
+            handler_error = e.code();
+        }
+    });
+    send({Headers(1, PostHead(1024))});
+    EXPECT_FALSE(handler_error);
+
+    send({EncodeCancel(1, CancelCode::kCancelled)});
+    ASSERT_TRUE(handler_error);
+    EXPECT_EQ(*handler_error, net::error::operation_aborted);
+}
+
+TEST_F(MuxConnectionTest, CancelledRequestCancelsTheStream) {
+    startClient();
+    net::cancellation_signal cancel;
+    std::optional<boost::system::error_code> request_error;
+    net::co_spawn(
+        ioc_,
+        [&]() -> net::awaitable<void> {
+            try {
+                co_await connection_->SendRequest("GET /wait HTTP/1.1\r\n\r\n", {});
+            } catch (const boost::system::system_error& e) {
+                request_error = e.code();
+            }
+        },
+        net::bind_cancellation_slot(cancel.slot(), net::detached));
+    settle();
+    ASSERT_NE(findFrame(FrameType::kHeaders, 1), nullptr);
+
+    cancel.emit(net::cancellation_type::terminal);
+    settle();
+    ASSERT_TRUE(request_error);
+    EXPECT_EQ(*request_error, net::error::operation_aborted);
+    const auto* frame = findFrame(FrameType::kCancel, 1);
+    ASSERT_NE(frame, nullptr);
+    ASSERT_EQ(frame->payload.size(), 1u);
+    EXPECT_EQ(frame->payload[0], static_cast<std::uint8_t>(CancelCode::kCancelled));
+}
+
+TEST_F(MuxConnectionTest, BytesOfCancelledStreamsAreCredited) {
+    startServer([](std::shared_ptr<MuxStream> stream) -> net::awaitable<void> {
+        stream->Cancel();
+        co_return;
+    });
+    send({Headers(1, PostHead(mux::kStreamWindow)), Headers(3, PostHead(mux::kStreamWindow))});
+    ASSERT_NE(findFrame(FrameType::kCancel, 1), nullptr);
+    ASSERT_NE(findFrame(FrameType::kCancel, 3), nullptr);
+
+    // Sent before the cancel arrived as far as the receiver knows, dropped but credited
+    auto frames = Data(1, mux::kStreamWindow);
+    auto more = Data(3, mux::kStreamWindow);
+    frames.insert(frames.end(), more.begin(), more.end());
+    send(std::move(frames));
+    EXPECT_FALSE(run_returned_);
+    EXPECT_EQ(windowUpdates(0), std::vector<std::uint32_t>{2 * mux::kStreamWindow});
+}
+
+} // namespace
+} // namespace lansend::core
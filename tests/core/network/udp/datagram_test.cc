@@ -0,0 +1,132 @@
+#include <core/network/udp/datagram.h>
+#include <core/security/file_encryptor.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace lansend::core {
+namespace {
+
+std::vector<std::uint8_t> Key(std::uint8_t fill = 0x42) {
+    return std::vector<std::uint8_t>(FileEncryptor::KEY_SIZE, fill);
+}
+
+std::vector<std::uint8_t> Seal(DatagramType type,
+                               std::uint64_t packet_number,
+                               const std::vector<std::uint8_t>& frame) {
+    return SealDatagram(type, DatagramDirection::kToReceiver, packet_number, frame, Key());
+}
+
+TEST(DatagramTest, SealOpenRoundTrip) {
+    std::vector<std::uint8_t> frame{1, 2, 3, 4, 5};
+    for (auto type : {DatagramType::kData, DatagramType::kAck, DatagramType::kClose}) {
+        auto datagram = Seal(type, 0x0102030405060708, frame);
+        ASSERT_EQ(datagram.size(), 12 + frame.size() + FileEncryptor::TAG_SIZE);
+        EXPECT_EQ(datagram[0], 'L');
+        EXPECT_EQ(datagram[1], 'U');
+        EXPECT_EQ(datagram[3], static_cast<std::uint8_t>(type));
+        EXPECT_EQ(datagram[4], 0x01);
+        EXPECT_EQ(datagram[11], 0x08);
+
+        auto opened = OpenDatagram(datagram, DatagramDirection::kToReceiver, Key());
+        ASSERT_TRUE(opened);
+        EXPECT_EQ(opened->type, type);
+        EXPECT_EQ(opened->packet_number, 0x0102030405060708u);
+        EXPECT_EQ(opened->frame, frame);
+    }
+}
+
+TEST(DatagramTest, SealsEmptyFrame) {
+    auto opened = OpenDatagram(Seal(DatagramType::kAck, 1, {}),
+                               DatagramDirection::kToReceiver,
+                               Key());
+    ASSERT_TRUE(opened);
+    EXPECT_TRUE(opened->frame.empty());
+}
+
+TEST(DatagramTest, RejectsOtherDirectionAndKey) {
+    auto datagram = Seal(DatagramType::kData, 7, {1, 2, 3});
+    EXPECT_FALSE(OpenDatagram(datagram, DatagramDirection::kToSender, Key()));
+    EXPECT_FALSE(OpenDatagram(datagram, DatagramDirection::kToReceiver, Key(0x43)));
+}
+
+TEST(DatagramTest, RejectsTamperedDatagram) {
+    auto datagram = Seal(DatagramType::kData, 7, {1, 2, 3});
+    // Every byte is covered: the header as additional data, the rest by the tag
+    for (std::size_t i = 0; i < datagram.size(); ++i) {
+        auto tampered = datagram;
+        tampered[i] ^= 0x01;
+        EXPECT_FALSE(OpenDatagram(tampered, DatagramDirection::kToReceiver, Key())) << i;
+    }
+}
+
+TEST(DatagramTest, RejectsMalformedDatagram) {
+    auto datagram = Seal(DatagramType::kData, 7, {});
+    EXPECT_FALSE(OpenDatagram({}, DatagramDirection::kToReceiver, Key()));
+    EXPECT_FALSE(OpenDatagram(std::span(datagram).first(datagram.size() - 1),
+                              DatagramDirection::kToReceiver,
+                              Key()));
+
+    auto bad_type = Seal(DatagramType::kData, 7, {});
+    bad_type[3] = 4;
+    EXPECT_FALSE(OpenDatagram(bad_type, DatagramDirection::kToReceiver, Key()));
+}
+
+TEST(DatagramTest, DataFrameRoundTrip) {
+    std::vector<std::uint8_t> data{9, 8, 7};
+    auto frame = EncodeDataFrame(3, 0x100000000, data);
+    auto decoded = DecodeDataFrame(frame);
+    ASSERT_TRUE(decoded);
+    EXPECT_EQ(decoded->file_index, 3u);
+    EXPECT_EQ(decoded->offset, 0x100000000u);
+    EXPECT_EQ(std::vector<std::uint8_t>(decoded->data.begin(), decoded->data.end()), data);
+    EXPECT_EQ(decoded->data.data(), frame.data() + 12);
+}
+
+TEST(DatagramTest, RejectsDataFrameWithoutData) {
+    auto frame = EncodeDataFrame(0, 0, {});
+    EXPECT_FALSE(DecodeDataFrame(frame));
+    EXPECT_FALSE(DecodeDataFrame(std::span(frame).first(5)));
+}
+
+TEST(DatagramTest, AckFrameRoundTrip) {
+    AckFrame ack{.largest = 100, .ack_delay_us = 250, .ranges = {{90, 100}, {10, 80}, {0, 0}}};
+    auto decoded = DecodeAckFrame(EncodeAckFrame(ack));
+    ASSERT_TRUE(decoded);
+    EXPECT_EQ(decoded->largest, 100u);
+    EXPECT_EQ(decoded->ack_delay_us, 250u);
+    ASSERT_EQ(decoded->ranges.size(), 3u);
+    EXPECT_EQ(decoded->ranges[1].first, 10u);
+    EXPECT_EQ(decoded->ranges[1].last, 80u);
+
+    auto empty = DecodeAckFrame(EncodeAckFrame(AckFrame{}));
+    ASSERT_TRUE(empty);
+    EXPECT_TRUE(empty->ranges.empty());
+}
+
+TEST(DatagramTest, RejectsMalformedAckFrame) {
+    auto frame = EncodeAckFrame({.largest = 100, .ranges = {{90, 100}}});
+    EXPECT_FALSE(DecodeAckFrame(std::span(frame).first(13)));
+    EXPECT_FALSE(DecodeAckFrame(std::span(frame).first(frame.size() - 1)));
+    frame.push_back(0);
+    EXPECT_FALSE(DecodeAckFrame(frame));
+
+    // Inverted range and range above the largest
+    EXPECT_FALSE(DecodeAckFrame(EncodeAckFrame({.largest = 100, .ranges = {{50, 40}}})));
+    EXPECT_FALSE(DecodeAckFrame(EncodeAckFrame({.largest = 100, .ranges = {{90, 101}}})));
+}
+
+TEST(DatagramTest, CloseFrame) {
+    for (auto reason : {CloseReason::kAborted, CloseReason::kCancelled}) {
+        EXPECT_EQ(DecodeCloseFrame(EncodeCloseFrame(reason)), reason);
+    }
+    std::vector<std::uint8_t> unknown{3};
+    std::vector<std::uint8_t> zero{0};
+    std::vector<std::uint8_t> too_long{1, 1};
+    EXPECT_FALSE(DecodeCloseFrame(unknown));
+    EXPECT_FALSE(DecodeCloseFrame(zero));
+    EXPECT_FALSE(DecodeCloseFrame(too_long));
+    EXPECT_FALSE(DecodeCloseFrame({}));
+}
+
+} // namespace
+} // namespace lansend::core
@@ -0,0 +1,101 @@
+#include <core/util/chunk_bitmap.h>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+namespace lansend::core {
+namespace {
+
+TEST(ChunkBitmapTest, SetAndTest) {
+    ChunkBitmap bitmap(130);
+    EXPECT_EQ(bitmap.Size(), 130u);
+    EXPECT_EQ(bitmap.Count(), 0u);
+    EXPECT_TRUE(bitmap.Set(0));
+    EXPECT_TRUE(bitmap.Set(64));
+    EXPECT_TRUE(bitmap.Set(129));
+    EXPECT_FALSE(bitmap.Set(64)); // Already received
+    EXPECT_EQ(bitmap.Count(), 3u);
+    EXPECT_TRUE(bitmap.Test(0));
+    EXPECT_TRUE(bitmap.Test(64));
+    EXPECT_TRUE(bitmap.Test(129));
+    EXPECT_FALSE(bitmap.Test(1));
+    EXPECT_FALSE(bitmap.Test(130)); // Past the end
+}
+
+TEST(ChunkBitmapTest, RejectsIndexOutOfRange) {
+    ChunkBitmap bitmap(10);
+    EXPECT_THROW(bitmap.Set(10), std::out_of_range);
+    EXPECT_EQ(bitmap.Count(), 0u);
+}
+
+TEST(ChunkBitmapTest, FirstMissingAndComplete) {
+    ChunkBitmap bitmap(70);
+    EXPECT_EQ(bitmap.FirstMissing(), 0u);
+    for (std::size_t i = 0; i < 70; ++i) {
+        if (i != 66) {
+            bitmap.Set(i);
+        }
+    }
+    EXPECT_FALSE(bitmap.IsComplete());
+    EXPECT_EQ(bitmap.FirstMissing(), 66u);
+    bitmap.Set(66);
+    EXPECT_TRUE(bitmap.IsComplete());
+    EXPECT_EQ(bitmap.FirstMissing(), std::nullopt);
+}
+
+TEST(ChunkBitmapTest, FullWordsComplete) {
+    ChunkBitmap bitmap(128);
+    for (std::size_t i = 0; i < 128; ++i) {
+        bitmap.Set(i);
+    }
+    EXPECT_TRUE(bitmap.IsComplete());
+    EXPECT_EQ(bitmap.FirstMissing(), std::nullopt);
+}
+
+TEST(ChunkBitmapTest, EmptyFileIsComplete) {
+    ChunkBitmap bitmap(0);
+    EXPECT_TRUE(bitmap.IsComplete());
+    EXPECT_EQ(bitmap.FirstMissing(), std::nullopt);
+    EXPECT_TRUE(bitmap.Serialize().empty());
+}
+
+TEST(ChunkBitmapTest, SerializesLittleEndianBits) {
+    ChunkBitmap bitmap(20);
+    bitmap.Set(0);
+    bitmap.Set(9);
+    bitmap.Set(19);
+    EXPECT_EQ(bitmap.Serialize(), (std::vector<std::uint8_t>{0x01, 0x02, 0x08}));
+}
+
+TEST(ChunkBitmapTest, RoundTrip) {
+    for (std::size_t chunks : {1u, 7u, 8u, 63u, 64u, 65u, 200u}) {
+        ChunkBitmap bitmap(chunks);
+        for (std::size_t i = 0; i < chunks; i += 3) {
+            bitmap.Set(i);
+        }
+        auto restored = ChunkBitmap::Deserialize(bitmap.Serialize(), chunks);
+        EXPECT_EQ(restored.Size(), chunks);
+        EXPECT_EQ(restored.Count(), bitmap.Count());
+        EXPECT_EQ(restored.FirstMissing(), bitmap.FirstMissing());
+        for (std::size_t i = 0; i < chunks; ++i) {
+            EXPECT_EQ(restored.Test(i), bitmap.Test(i)) << "chunk " << i << " of " << chunks;
+        }
+    }
+}
+
+TEST(ChunkBitmapTest, DeserializeRejectsWrongLength) {
+    std::vector<std::uint8_t> bytes(2);
+    EXPECT_THROW(ChunkBitmap::Deserialize(bytes, 17), std::invalid_argument);
+    EXPECT_THROW(ChunkBitmap::Deserialize(bytes, 8), std::invalid_argument);
+}
+
+TEST(ChunkBitmapTest, DeserializeIgnoresBitsPastTheLastChunk) {
+    std::vector<std::uint8_t> bytes{0xff, 0xff};
+    auto bitmap = ChunkBitmap::Deserialize(bytes, 12);
+    EXPECT_EQ(bitmap.Count(), 12u);
+    EXPECT_TRUE(bitmap.IsComplete());
+    EXPECT_FALSE(bitmap.Test(12));
+}
+
+} // namespace
+} // namespace lansend::core
@@ -0,0 +1,111 @@
+#include <core/constant/transfer.h>
+#include <core/model.h>
+#include <core/util/dto_reader.h>
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <simdjson.h>
+#include <string>
+#include <vector>
+
+namespace lansend::core {
+namespace {
+
+RequestSendDto MakeRequestSend() {
+    RequestSendDto dto;
+    dto.device_info.device_id = "device";
+    dto.device_info.hostname = "host";
+    dto.device_info.operating_system = "linux";
+    dto.device_info.ip_address = "192.168.1.2";
+    dto.device_info.port = 56789;
+    dto.device_info.addresses = {{.ip_address = "192.168.1.2", .link_speed_mbps = 1000},
+                                 {.ip_address = "10.0.0.2", .link_speed_mbps = 0}};
+    for (int i = 0; i < 3; ++i) {
+        FileDto file;
+        file.file_id = "file-" + std::to_string(i);
+        file.file_name = "name \"" + std::to_string(i) + "\".txt";
+        file.file_size = 3 * 1024 * 1024 + i;
+        file.chunk_size = 1024 * 1024;
+        file.total_chunks = 4;
+        file.file_checksum = "checksum";
+        dto.files.push_back(file);
+    }
+    dto.total_files = 3;
+    dto.udp_transport = true;
+    return dto;
+}
+
+void ExpectSameRequestSend(const RequestSendDto& actual, const RequestSendDto& expected) {
+    EXPECT_EQ(actual.device_info.device_id, expected.device_info.device_id);
+    EXPECT_EQ(actual.device_info.hostname, expected.device_info.hostname);
+    EXPECT_EQ(actual.device_info.operating_system, expected.device_info.operating_system);
+    EXPECT_EQ(actual.device_info.ip_address, expected.device_info.ip_address);
+    EXPECT_EQ(actual.device_info.port, expected.device_info.port);
+    ASSERT_EQ(actual.device_info.addresses.size(), expected.device_info.addresses.size());
+    for (std::size_t i = 0; i < expected.device_info.addresses.size(); ++i) {
+        EXPECT_EQ(actual.device_info.addresses[i].ip_address,
+                  expected.device_info.addresses[i].ip_address);
+        EXPECT_EQ(actual.device_info.addresses[i].link_speed_mbps,
+                  expected.device_info.addresses[i].link_speed_mbps);
+    }
+    ASSERT_EQ(actual.files.size(), expected.files.size());
+    for (std::size_t i = 0; i < expected.files.size(); ++i) {
+        EXPECT_EQ(actual.files[i].file_id, expected.files[i].file_id);
+        EXPECT_EQ(actual.files[i].file_name, expected.files[i].file_name);
+        EXPECT_EQ(actual.files[i].file_size, expected.files[i].file_size);
+        EXPECT_EQ(actual.files[i].chunk_size, expected.files[i].chunk_size);
+        EXPECT_EQ(actual.files[i].total_chunks, expected.files[i].total_chunks);
+        EXPECT_EQ(actual.files[i].file_checksum, expected.files[i].file_checksum);
+    }
+    EXPECT_EQ(actual.total_files, expected.total_files);
+    EXPECT_EQ(actual.udp_transport, expected.udp_transport);
+}
+
+TEST(DtoReaderTest, ReadsRequestSendWithoutPadding) {
+    auto expected = MakeRequestSend();
+    std::string body = nlohmann::json(expected).dump();
+    ExpectSameRequestSend(DtoReader::ReadRequestSend(body), expected);
+}
+
+TEST(DtoReaderTest, ReadsRequestSendInPlace) {
+    auto expected = MakeRequestSend();
+    std::string json = nlohmann::json(expected).dump();
+    // Laid out like a body HttpServer read, with the padding past its end
+    std::vector<std::uint8_t> body(json.begin(), json.end());
+    body.reserve(body.size() + transfer::kBodyPadding);
+    std::string_view view(reinterpret_cast<const char*>(body.data()), body.size());
+    ExpectSameRequestSend(DtoReader::ReadRequestSend(view, body.capacity()), expected);
+}
+
+TEST(DtoReaderTest, ReadsDeviceInfoOfOlderSenders) {
+    // Versions before multipath send no addresses
+    std::string body = R"({"device_info":{"device_id":"device","port":1234},"files":[]})";
+    auto dto = DtoReader::ReadRequestSend(body);
+    EXPECT_EQ(dto.device_info.device_id, "device");
+    EXPECT_EQ(dto.device_info.port, 1234);
+    EXPECT_TRUE(dto.device_info.addresses.empty());
+}
+
+TEST(DtoReaderTest, ReadsManifestPage) {
+    ManifestPageDto expected;
+    expected.session_id = "session";
+    expected.files = MakeRequestSend().files;
+    std::string body = nlohmann::json(expected).dump();
+    auto dto = DtoReader::ReadManifestPage(body, body.capacity());
+    EXPECT_EQ(dto.session_id, "session");
+    ASSERT_EQ(dto.files.size(), expected.files.size());
+    EXPECT_EQ(dto.files[2].file_name, expected.files[2].file_name);
+}
+
+TEST(DtoReaderTest, ReadsSessionId) {
+    EXPECT_EQ(DtoReader::ReadSessionId(R"({"other":1,"session_id":"abc"})"), "abc");
+}
+
+TEST(DtoReaderTest, RejectsMalformedBody) {
+    EXPECT_THROW(DtoReader::ReadRequestSend(R"({"files":[{"file_size":"big"}]})"),
+                 simdjson::simdjson_error);
+    EXPECT_THROW(DtoReader::ReadManifestPage(R"({"session_id":)"), simdjson::simdjson_error);
+    EXPECT_THROW(DtoReader::ReadSessionId("[]"), simdjson::simdjson_error);
+}
+
+} // namespace
+} // namespace lansend::core
@@ -0,0 +1,126 @@
+#include <boost/asio/bind_cancellation_slot.hpp>
+#include <boost/asio/cancellation_signal.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/io_context.hpp>
+#include <core/util/config.h>
+#include <core/util/memory_governor.h>
+#include <gtest/gtest.h>
+#include <optional>
+
+namespace lansend::core {
+namespace {
+
+namespace net = boost::asio;
+
+constexpr std::size_t kBudget = 1 << 20;
+
+// The governor is a process-wide singleton that reads its budget on first use
+std::size_t InUse() {
+    settings.memory_budget_mb = kBudget >> 20;
+    return MemoryGovernor::Stats().in_use;
+}
+
+// Holds the whole budget, so the next reservation queues
+std::optional<MemoryReservation> HoldBudget(net::io_context& ioc) {
+    std::optional<MemoryReservation> held;
+    net::co_spawn(
+        ioc,
+        [&]() -> net::awaitable<void> { held = co_await MemoryGovernor::Reserve(kBudget); },
+        net::detached);
+    ioc.run();
+    ioc.restart();
+    return held;
+}
+
+// A later reservation is granted without waiting
+bool GrantedAtOnce(net::io_context& ioc) {
+    bool granted = false;
+    net::co_spawn(
+        ioc,
+        [&]() -> net::awaitable<void> {
+            auto reservation = co_await MemoryGovernor::Reserve(kBudget);
+            granted = reservation.Size() == kBudget;
+        },
+        net::detached);
+    ioc.poll();
+    ioc.restart();
+    return granted;
+}
+
+TEST(MemoryGovernorTest, CancelledWaiterLeavesTheQueue) {
+    ASSERT_EQ(InUse(), 0u);
+    net::io_context ioc;
+    auto held = HoldBudget(ioc);
+    ASSERT_TRUE(held);
+    EXPECT_EQ(InUse(), kBudget);
+
+    net::cancellation_signal cancel;
+    bool aborted = false;
+    net::co_spawn(
+        ioc,
+        [&]() -> net::awaitable<void> {
+            try {
+                co_await MemoryGovernor::Reserve(kBudget / 2);
+            } catch (const boost::system::system_error&) {
+                aborted = true;
+            }
+        },
+        net::bind_cancellation_slot(cancel.slot(), net::detached));
+    ioc.poll(); // Queued behind the held budget
+    cancel.emit(net::cancellation_type::terminal);
+    ioc.run();
+    ioc.restart();
+    EXPECT_TRUE(aborted);
+
+    // Nothing is granted to the cancelled waiter
+    held.reset();
+    EXPECT_EQ(InUse(), 0u);
+    EXPECT_TRUE(GrantedAtOnce(ioc));
+    EXPECT_EQ(InUse(), 0u);
+}
+
+TEST(MemoryGovernorTest, DestroyedWaiterLeavesTheQueue) {
+    ASSERT_EQ(InUse(), 0u);
+    net::io_context ioc;
+    auto held = HoldBudget(ioc);
+    ASSERT_TRUE(held);
+
+    {
+        net::io_context waiting;
+        net::co_spawn(
+            waiting,
+            [&]() -> net::awaitable<void> { co_await MemoryGovernor::Reserve(kBudget / 2); },
+            net::detached);
+        waiting.poll();
+    } // The coroutine is destroyed while queued
+
+    held.reset();
+    EXPECT_EQ(InUse(), 0u);
+    EXPECT_TRUE(GrantedAtOnce(ioc));
+}
+
+TEST(MemoryGovernorTest, GrantNeverTakenIsGivenBack) {
+    ASSERT_EQ(InUse(), 0u);
+    net::io_context ioc;
+    auto held = HoldBudget(ioc);
+    ASSERT_TRUE(held);
+
+    {
+        net::io_context waiting;
+        net::co_spawn(
+            waiting,
+            [&]() -> net::awaitable<void> { co_await MemoryGovernor::Reserve(kBudget / 2); },
+            net::detached);
+        waiting.poll();
+        // Granted to the waiter, but its coroutine never runs again to take the bytes
+        held.reset();
+        EXPECT_EQ(InUse(), kBudget / 2);
+    }
+
+    EXPECT_EQ(InUse(), 0u);
+    EXPECT_TRUE(GrantedAtOnce(ioc));
+}
+
+} // namespace
+} // namespace lansend::core